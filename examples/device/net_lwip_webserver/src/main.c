@@ -103,8 +103,24 @@ static err_t linkoutput_fn(struct netif *netif, struct pbuf *p) {
 
     /* if the network driver can accept another packet, we make it happen */
     if (tud_network_can_xmit(p->tot_len)) {
+#if CFG_TUD_NCM && CFG_TUD_NCM_XMIT_SG
+      tud_network_seg_t segs[8];
+      uint8_t count = 0;
+      for (struct pbuf *q = p; q != NULL; q = q->next) {
+        if (count == TU_ARRAY_SIZE(segs)) return ERR_MEM;
+        segs[count].buf = q->payload;
+        segs[count].len = q->len;
+        count++;
+      }
+
+      /* the pbuf chain is sent in place, keep it until tud_network_xmit_done_cb() */
+      pbuf_ref(p);
+      if (tud_network_xmit_sg(p, segs, count)) return ERR_OK;
+      pbuf_free(p);
+#else
       tud_network_xmit(p, 0 /* unused for this example */);
       return ERR_OK;
+#endif
     }
 
     /* transfer execution to TinyUSB in the hopes that it will finish transmitting the prior packet */
@@ -191,6 +207,12 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg) {
   return pbuf_copy_partial(p, dst, p->tot_len, 0);
 }
 
+#if CFG_TUD_NCM && CFG_TUD_NCM_XMIT_SG
+void tud_network_xmit_done_cb(void *ref) {
+  pbuf_free((struct pbuf *) ref);
+}
+#endif
+
 static void service_traffic(void) {
   /* handle any packet received by tud_network_recv_cb() */
   if (received_frame) {
@@ -120,6 +120,11 @@ extern "C" {
   #define CFG_TUD_NCM_IN_NTB_N 1
 #endif
 
+// Send lwIP pbufs in place instead of copying them into transmission NTBs
+#ifndef CFG_TUD_NCM_XMIT_SG
+  #define CFG_TUD_NCM_XMIT_SG 0
+#endif
+
 //--------------------------------------------------------------------
 // DEVICE CONFIGURATION
 //--------------------------------------------------------------------
@@ -61,6 +61,23 @@
 
 #include "audio_device.h"
 
+#if CFG_TUD_AUDIO_LOW_LATENCY && CFG_TUSB_TRACE
+  #include "common/tusb_trace.h"
+  #define AUDIOD_LATENCY_STATS 1
+#else
+  #define AUDIOD_LATENCY_STATS 0
+#endif
+
+// Structured load/store intrinsics for PCM interleave kernels. There are no x86 SSE/AVX2 kernels: hosts use the scalar
+// kernel as vectorized by the compiler, test/audio_kernels compares it with the SIMD ones built for Arm
+#if (CFG_TUD_AUDIO_ENABLE_DECODING || CFG_TUD_AUDIO_ENABLE_ENCODING) && defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+  #include <arm_mve.h>
+  #define AUDIOD_SIMD_MVE  1
+#elif (CFG_TUD_AUDIO_ENABLE_DECODING || CFG_TUD_AUDIO_ENABLE_ENCODING) && defined(__ARM_NEON)
+  #include <arm_neon.h>
+  #define AUDIOD_SIMD_NEON 1
+#endif
+
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
@@ -282,6 +299,10 @@ tu_static uint8_t alt_setting_3[CFG_TUD_AUDIO_FUNC_3_N_AS_INT];
   #endif
 #endif
 
+// Maximum number of support FIFOs of all functions, for interleaving all FIFOs in one pass
+#define AUDIOD_N_TX_SUPP_FF_MAX  TU_MAX(1, TU_MAX(CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO, TU_MAX(CFG_TUD_AUDIO_FUNC_2_N_TX_SUPP_SW_FIFO, CFG_TUD_AUDIO_FUNC_3_N_TX_SUPP_SW_FIFO)))
+#define AUDIOD_N_RX_SUPP_FF_MAX  TU_MAX(1, TU_MAX(CFG_TUD_AUDIO_FUNC_1_N_RX_SUPP_SW_FIFO, TU_MAX(CFG_TUD_AUDIO_FUNC_2_N_RX_SUPP_SW_FIFO, CFG_TUD_AUDIO_FUNC_3_N_RX_SUPP_SW_FIFO)))
+
 // Aligned buffer for feedback EP
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 tu_static CFG_TUD_MEM_SECTION struct {
@@ -304,6 +325,19 @@ tu_static CFG_TUD_MEM_SECTION struct {
 } int_ep_buf[CFG_TUD_AUDIO];
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+// Sample conversion of one direction, set up when host selects an alternate setting
+typedef struct {
+  uint8_t usb_type;   // AUDIOD_USB_PCM, AUDIOD_USB_PCM8 or AUDIOD_USB_FLOAT
+  uint8_t usb_sz;     // bSubslotSize
+  uint8_t app_format; // audio_sample_format_t, AUDIO_SAMPLE_FORMAT_USB if samples are copied as they are
+  uint8_t app_sz;     // Size of one sample in support FIFO
+  uint8_t options;
+  uint8_t dither_bits;// Target resolution if dither applies, otherwise 0
+  uint32_t usb_mask;  // Bits within bBitResolution of a left-justified USB sample
+} audiod_conv_t;
+#endif
+
 typedef struct
 {
   uint8_t rhport;
@@ -343,6 +377,7 @@ typedef struct
     uint8_t frame_shift;// bInterval-1 in unit of frame (FS), micro-frame (HS)
     uint8_t compute_method;
     bool format_correction;
+    bool send_deferred;// transmit is queued to usbd task
     union {
       uint8_t power_of_2;// pre-computed power of 2 shift
       float float_const; // pre-computed float constant
@@ -357,12 +392,32 @@ typedef struct
         uint32_t fifo_lvl_avg; // In 16.16 format
         uint16_t fifo_lvl_thr; // fifo level threshold
         uint16_t rate_const[2];// pre-computed feedback/fifo_depth rate
+        uint32_t kp;           // PI gains in 16.16 format
+        uint32_t ki;
+        int32_t integral;      // PI integral part in 16.16 format, in units of max. feedback deviation
       } fifo_count;
     } compute;
 
   } feedback;
+
+  struct {
+    uint32_t nom_value;// In 16.16 format
+    uint64_t value_avg;// Low-pass filtered feedback value in 16.32 format, 0 until first value
+    uint32_t lvl_count;
+    uint32_t lvl_mean; // Exponentially weighted in 16.16 format
+    uint64_t lvl_var;  // Exponentially weighted in 56.8 format
+    uint16_t lvl_min;
+    uint16_t lvl_max;
+    uint32_t underrun_count;
+    uint32_t overrun_count;
+  } fb_stats;
 #endif// CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 
+#if AUDIOD_LATENCY_STATS
+  audio_latency_stats_t latency_rx;
+  audio_latency_stats_t latency_tx;
+#endif
+
 // Decoding parameters - parameters are set when alternate AS interface is set by host
 // Coding is currently only supported for EP. Software coding corresponding to AS interfaces without EPs are not supported currently.
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -373,6 +428,10 @@ typedef struct
   audio_data_format_type_I_t format_type_I_rx;
   uint8_t n_bytes_per_sample_rx;
   uint8_t n_ff_used_rx;
+    #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+  uint8_t bit_resolution_rx;
+  audiod_conv_t conv_rx;
+    #endif
   #endif
 #endif
 
@@ -392,6 +451,10 @@ typedef struct
   #if CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
   audio_data_format_type_I_t format_type_I_tx;
   uint8_t n_ff_used_tx;
+    #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+  uint8_t bit_resolution_tx;
+  audiod_conv_t conv_tx;
+    #endif
   #endif
 #endif
 
@@ -404,6 +467,19 @@ typedef struct
   // Current active alternate settings
   uint8_t *alt_setting;// We need to save the current alternate setting this way, because it is possible that there are AS interfaces which do not have an EP!
 
+// Application sample formats of support FIFOs, see tud_audio_n_set_rx_format()
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+  #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+  uint8_t sample_format_rx;
+  uint8_t sample_options_rx;
+  #endif
+  #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
+  uint8_t sample_format_tx;
+  uint8_t sample_options_tx;
+  #endif
+  uint32_t dither_state;
+#endif
+
 // EP Transfer buffers and FIFOs
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
   tu_fifo_t ep_out_ff;
@@ -501,6 +577,27 @@ TU_ATTR_WEAK bool tud_audio_rx_done_post_read_cb(uint8_t rhport, uint16_t n_byte
 }
 #endif
 
+#if CFG_TUD_AUDIO_LOW_LATENCY
+TU_ATTR_WEAK void tud_audio_rx_block_isr_cb(uint8_t func_id, uint16_t n) {
+  (void) func_id;
+  (void) n;
+}
+
+TU_ATTR_WEAK void tud_audio_tx_block_isr_cb(uint8_t func_id, uint16_t n) {
+  (void) func_id;
+  (void) n;
+}
+
+  #if CFG_TUD_XFER_COALESCE
+TU_ATTR_WEAK void tud_audio_xfer_coalesced_cb(uint8_t func_id, uint8_t ep_addr, uint16_t n_xfers, uint32_t n_bytes) {
+  (void) func_id;
+  (void) ep_addr;
+  (void) n_xfers;
+  (void) n_bytes;
+}
+  #endif
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 TU_ATTR_WEAK void tud_audio_fb_done_cb(uint8_t func_id) {
   (void) func_id;
@@ -601,11 +698,11 @@ TU_ATTR_WEAK bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_reque
 tu_static CFG_TUD_MEM_SECTION audiod_function_t _audiod_fct[CFG_TUD_AUDIO];
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
-static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received);
+static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received, bool in_isr);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
-static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received);
+static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received, bool in_isr);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -637,7 +734,9 @@ static uint16_t audiod_tx_packet_size(const uint16_t *norminal_size, uint16_t da
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 static bool audiod_set_fb_params_freq(audiod_function_t *audio, uint32_t sample_freq, uint32_t mclk_freq);
-static void audiod_fb_fifo_count_update(audiod_function_t *audio, uint16_t lvl_new);
+static void audiod_fb_fifo_count_update(audiod_function_t *audio, uint16_t lvl_new, bool in_isr);
+static void audiod_fb_set_value(audiod_function_t *audio, uint32_t feedback);
+static void audiod_fb_send_deferred(void *param);
 #endif
 
 bool tud_audio_n_mounted(uint8_t func_id) {
@@ -660,7 +759,11 @@ uint16_t tud_audio_n_available(uint8_t func_id) {
 
 uint16_t tud_audio_n_read(uint8_t func_id, void *buffer, uint16_t bufsize) {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
-  return tu_fifo_read_n(&_audiod_fct[func_id].ep_out_ff, buffer, bufsize);
+  uint16_t const count = tu_fifo_read_n(&_audiod_fct[func_id].ep_out_ff, buffer, bufsize);
+  #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  if (count == 0 && bufsize != 0 && _audiod_fct[func_id].ep_fb != 0) _audiod_fct[func_id].fb_stats.underrun_count++;
+  #endif
+  return count;
 }
 
 bool tud_audio_n_clear_ep_out_ff(uint8_t func_id) {
@@ -689,7 +792,11 @@ uint16_t tud_audio_n_available_support_ff(uint8_t func_id, uint8_t ff_idx) {
 
 uint16_t tud_audio_n_read_support_ff(uint8_t func_id, uint8_t ff_idx, void *buffer, uint16_t bufsize) {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff);
-  return tu_fifo_read_n(&_audiod_fct[func_id].rx_supp_ff[ff_idx], buffer, bufsize);
+  uint16_t const count = tu_fifo_read_n(&_audiod_fct[func_id].rx_supp_ff[ff_idx], buffer, bufsize);
+  #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  if (count == 0 && bufsize != 0 && ff_idx == 0 && _audiod_fct[func_id].ep_fb != 0) _audiod_fct[func_id].fb_stats.underrun_count++;
+  #endif
+  return count;
 }
 
 tu_fifo_t *tud_audio_n_get_rx_support_ff(uint8_t func_id, uint8_t ff_idx) {
@@ -703,7 +810,8 @@ tu_fifo_t *tud_audio_n_get_rx_support_ff(uint8_t func_id, uint8_t ff_idx) {
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
 
-static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received) {
+static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received, bool in_isr) {
+  (void) in_isr;
   uint8_t idxItf = 0;
   uint8_t const *dummy2;
   uint8_t idx_audio_fct = 0;
@@ -727,7 +835,7 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t
 
       switch (audio->format_type_I_rx) {
         case AUDIO_DATA_FORMAT_TYPE_I_PCM:
-          TU_VERIFY(audiod_decode_type_I_pcm(rhport, audio, n_bytes_received));
+          TU_VERIFY(audiod_decode_type_I_pcm(rhport, audio, n_bytes_received, in_isr));
           break;
 
         default:
@@ -751,19 +859,25 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t
   #else
 
     #if USE_LINEAR_BUFFER_RX
+      #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  if (tu_fifo_remaining(&audio->ep_out_ff) < n_bytes_received) audio->fb_stats.overrun_count++;
+      #endif
   // Data currently is in linear buffer, copy into EP OUT FIFO
   TU_VERIFY(tu_fifo_write_n(&audio->ep_out_ff, audio->lin_buf_out, n_bytes_received));
 
   // Schedule for next receive
   TU_VERIFY(usbd_edpt_xfer(rhport, audio->ep_out, audio->lin_buf_out, audio->ep_out_sz), false);
     #else
+      #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  if (tu_fifo_overflowed(&audio->ep_out_ff)) audio->fb_stats.overrun_count++;
+      #endif
   // Data is already placed in EP FIFO, schedule for next receive
   TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_out, &audio->ep_out_ff, audio->ep_out_sz), false);
     #endif
 
     #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
-  if (audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT) {
-    audiod_fb_fifo_count_update(audio, tu_fifo_count(&audio->ep_out_ff));
+  if (audio->ep_fb != 0) {
+    audiod_fb_fifo_count_update(audio, tu_fifo_count(&audio->ep_out_ff), in_isr);
   }
     #endif
 
@@ -777,91 +891,549 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t *audio, uint16_t
 
 #endif//CFG_TUD_AUDIO_ENABLE_EP_OUT
 
-// The following functions are used in case CFG_TUD_AUDIO_ENABLE_DECODING != 0
-#if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
+// The following functions are used in case CFG_TUD_AUDIO_ENABLE_DECODING != 0 or CFG_TUD_AUDIO_ENABLE_ENCODING != 0
+#if (CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT) || (CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN)
 
-// Decoding according to 2.3.1.5 Audio Streams
+// Interleave kernels according to 2.3.1.5 Audio Streams
+// An interleaved stream is a sequence of frames, each frame holds one slot per support FIFO and a slot holds
+// the channels of that FIFO i.e slot size = channels per FIFO * bytes per sample (packed 24-bit samples are 3 bytes).
+// Samples are copied as is, justification and sample size are not changed.
+
+// Word type used by audiod_copy_slots(), may alias FIFO and linear buffers
+#if defined(__GNUC__)
+typedef uint32_t __attribute__((__may_alias__)) audiod_word_t;
+#else
+typedef uint32_t audiod_word_t;
+#endif
+
+// Copy n slots of slot_sz bytes, dst and src advance by their own stride after each slot.
+// Fixed size copies let the compiler emit plain load/store pairs instead of calling memcpy() per slot.
+static void audiod_copy_slots(uint8_t *dst, uint16_t dst_stride, uint8_t const *src, uint16_t src_stride, uint16_t slot_sz, uint16_t n) {
+  #define AUDIOD_COPY_SLOTS(_copy) \
+    for (; n != 0; n--, dst += dst_stride, src += src_stride) { _copy; } \
+    return
+
+  #define W_DST ((audiod_word_t *) (uintptr_t) dst)
+  #define W_SRC ((audiod_word_t const *) (uintptr_t) src)
+
+  // Word aligned: typical since support FIFOs and linear buffers are 4-byte aligned
+  if ((((uintptr_t) dst | (uintptr_t) src | dst_stride | src_stride | slot_sz) & 0x03) == 0) {
+    switch (slot_sz) {
+      case 4:  AUDIOD_COPY_SLOTS(W_DST[0] = W_SRC[0]);
+      case 8:  AUDIOD_COPY_SLOTS(W_DST[0] = W_SRC[0]; W_DST[1] = W_SRC[1]);
+      case 16: AUDIOD_COPY_SLOTS(W_DST[0] = W_SRC[0]; W_DST[1] = W_SRC[1]; W_DST[2] = W_SRC[2]; W_DST[3] = W_SRC[3]);
+      default: AUDIOD_COPY_SLOTS(for (uint16_t i = 0; i < slot_sz / 4; i++) W_DST[i] = W_SRC[i]);
+    }
+  }
+
+  switch (slot_sz) {
+    case 1:  AUDIOD_COPY_SLOTS(*dst = *src);
+    case 2:  AUDIOD_COPY_SLOTS(memcpy(dst, src, 2));
+    case 3:  AUDIOD_COPY_SLOTS(memcpy(dst, src, 3)); // packed 24-bit, 1 channel
+    case 4:  AUDIOD_COPY_SLOTS(memcpy(dst, src, 4));
+    case 6:  AUDIOD_COPY_SLOTS(memcpy(dst, src, 6)); // packed 24-bit, 2 channels
+    case 8:  AUDIOD_COPY_SLOTS(memcpy(dst, src, 8));
+    default: AUDIOD_COPY_SLOTS(memcpy(dst, src, slot_sz));
+  }
+
+  #undef W_DST
+  #undef W_SRC
+  #undef AUDIOD_COPY_SLOTS
+}
+
+#if AUDIOD_SIMD_MVE || AUDIOD_SIMD_NEON
+// Helium/Neon: one structured load/store splits/merges 2 to 4 FIFOs (3 for Neon only) of 1, 2, 4 (and 8 on AArch64)
+// byte slots, i.e all FIFOs are handled in one pass. Remaining frames are left to the scalar kernel.
+// Key is (slot size << 4) | number of FIFOs, _kernel(element bits, lanes, number of FIFOs)
+#define AUDIOD_SIMD_CASES_2_4(_kernel)                               \
+  case 0x12: _kernel(8, 16, 2); case 0x14: _kernel(8, 16, 4);        \
+  case 0x22: _kernel(16, 8, 2); case 0x24: _kernel(16, 8, 4);        \
+  case 0x42: _kernel(32, 4, 2); case 0x44: _kernel(32, 4, 4);
+
+#if AUDIOD_SIMD_NEON
+  #define AUDIOD_SIMD_CASES_3(_kernel) \
+    case 0x13: _kernel(8, 16, 3); case 0x23: _kernel(16, 8, 3); case 0x43: _kernel(32, 4, 3);
+#else
+  #define AUDIOD_SIMD_CASES_3(_kernel)
+#endif
+
+#if AUDIOD_SIMD_NEON && defined(__aarch64__)
+  #define AUDIOD_SIMD_CASES_64(_kernel) \
+    case 0x82: _kernel(64, 2, 2); case 0x83: _kernel(64, 2, 3); case 0x84: _kernel(64, 2, 4);
+#else
+  #define AUDIOD_SIMD_CASES_64(_kernel)
+#endif
+
+#define AUDIOD_SIMD_CASES(_kernel) AUDIOD_SIMD_CASES_2_4(_kernel) AUDIOD_SIMD_CASES_3(_kernel) AUDIOD_SIMD_CASES_64(_kernel)
+
+// Structured accesses need element aligned buffers
+static inline bool audiod_simd_aligned(uint8_t const *buf, uint8_t *const ff_buf[], uint8_t n_ff, uint16_t slot_sz) {
+  uintptr_t addr = (uintptr_t) buf;
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff; cnt_ff++) {
+    addr |= (uintptr_t) ff_buf[cnt_ff];
+  }
+  return (slot_sz & (slot_sz - 1)) == 0 && (addr & (slot_sz - 1)) == 0;
+}
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+// Sample conversion: every sample goes through left-justified Q31, conversion is fused into the interleave loop.
+// Loops are specialised on the application format, USB format is loop invariant.
+enum {
+  AUDIOD_USB_PCM = 0,// signed, bSubslotSize 1 to 4 bytes
+  AUDIOD_USB_PCM8,   // unsigned 8 bit
+  AUDIOD_USB_FLOAT,  // IEEE 754 single precision
+};
+
+// Resolution of application formats, float has 24-bit mantissa but is never dithered to
+static inline uint8_t audiod_app_sample_bits(uint8_t app_format) {
+  switch (app_format) {
+    case AUDIO_SAMPLE_FORMAT_INT16: return 16;
+    case AUDIO_SAMPLE_FORMAT_INT24: return 24;
+    default: return 32;
+  }
+}
+
+// Set up conversion of an alternate setting, samples are copied as they are if formats match or are not supported
+static void audiod_conv_init(audiod_conv_t *conv, uint8_t app_format, uint8_t options, uint32_t usb_formats, uint8_t usb_sz, uint8_t usb_bits, bool is_encode) {
+  conv->usb_sz = usb_sz;
+  conv->options = options;
+  conv->dither_bits = 0;
+  conv->usb_mask = (usb_bits == 0 || usb_bits >= 32) ? UINT32_MAX : ~(UINT32_MAX >> usb_bits);
+
+  bool native;
+  if (usb_formats == AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT && usb_sz == 4) {
+    conv->usb_type = AUDIOD_USB_FLOAT;
+    native = (app_format == AUDIO_SAMPLE_FORMAT_FLOAT32);
+  } else if (usb_formats == AUDIO_DATA_FORMAT_TYPE_I_PCM8 && usb_sz == 1) {
+    conv->usb_type = AUDIOD_USB_PCM8;
+    native = false;
+  } else if (usb_formats == AUDIO_DATA_FORMAT_TYPE_I_PCM && usb_sz >= 1 && usb_sz <= 4) {
+    conv->usb_type = AUDIOD_USB_PCM;
+    // copying keeps padding bits, only without any
+    native = (usb_bits == 0 || usb_bits == 8 * usb_sz) &&
+             ((app_format == AUDIO_SAMPLE_FORMAT_INT16 && usb_sz == 2) || (app_format == AUDIO_SAMPLE_FORMAT_Q31 && usb_sz == 4));
+  } else {
+    native = true;
+  }
+
+  uint8_t const app_bits = audiod_app_sample_bits(app_format);
+  uint8_t const usb_res = (usb_bits == 0) ? (uint8_t) (8 * usb_sz) : usb_bits;
+  uint8_t const src_bits = is_encode ? app_bits : usb_res;
+  uint8_t const dst_bits = is_encode ? usb_res : app_bits;
+
+  if ((options & AUDIO_SAMPLE_CONV_DITHER) && dst_bits < src_bits && conv->usb_type != AUDIOD_USB_FLOAT &&
+      app_format != AUDIO_SAMPLE_FORMAT_FLOAT32) {
+    conv->dither_bits = dst_bits;
+    native = false;
+  }
+
+  if (app_format == AUDIO_SAMPLE_FORMAT_USB || native) {
+    conv->app_format = AUDIO_SAMPLE_FORMAT_USB;
+    conv->app_sz = usb_sz;
+  } else {
+    conv->app_format = app_format;
+    conv->app_sz = (app_format == AUDIO_SAMPLE_FORMAT_INT16) ? 2 : 4;
+  }
+}
+
+// xorshift32, state must not be zero
+static inline uint32_t audiod_rand(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_q31_add_sat(int32_t a, int32_t b) {
+  int64_t const sum = (int64_t) a + b;
+  if (sum > INT32_MAX) return INT32_MAX;
+  if (sum < INT32_MIN) return INT32_MIN;
+  return (int32_t) sum;
+}
+
+// Add TPDF dither of +-1 LSB of given resolution. Always saturating: a full scale sample must not wrap to the
+// opposite sign
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_q31_dither(int32_t q, uint8_t bits, uint32_t *state) {
+  int32_t const noise = (int32_t) (audiod_rand(state) >> bits) - (int32_t) (audiod_rand(state) >> bits);
+  return audiod_q31_add_sat(q, noise);
+}
+
+// Float samples are always clipped, out of range float to integer conversion is undefined (NaN becomes -1)
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_float_to_q31(float f) {
+  if (f >= 1.0f) return INT32_MAX;
+  if (!(f >= -1.0f)) return INT32_MIN;
+  return (int32_t) (f * 2147483648.0f);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline float audiod_q31_to_float(int32_t q) {
+  return (float) q * (1.0f / 2147483648.0f);
+}
+
+// USB samples are little endian and left-justified (2.3.1.7.1 PCM Format)
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_usb_sample_read(audiod_conv_t const *conv, uint8_t const *p) {
+  switch (conv->usb_type) {
+    case AUDIOD_USB_PCM8:
+      return (int32_t) ((uint32_t) (p[0] ^ 0x80) << 24);
 
-// Helper function
-static inline void *audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesPerSample, void *dst, const void *dst_end, void *src, uint8_t const n_ff_used) {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t *dst16 = dst;
-  uint16_t *src16 = src;
-  const uint16_t *dst_end16 = dst_end;
-  uint32_t *dst32 = dst;
-  uint32_t *src32 = src;
-  const uint32_t *dst_end32 = dst_end;
-
-  if (nBytesPerSample == 1) {
-    while (dst16 < dst_end16) {
-      *dst16++ = *src16++;
-      src16 += n_ff_used - 1;
+    case AUDIOD_USB_FLOAT: {
+      float f;
+      memcpy(&f, p, 4);
+      return audiod_float_to_q31(f);
     }
-    return src16;
-  } else if (nBytesPerSample == 2) {
-    while (dst32 < dst_end32) {
-      *dst32++ = *src32++;
-      src32 += n_ff_used - 1;
+
+    default: {
+      uint32_t v = 0;
+      for (uint8_t i = 0; i < conv->usb_sz; i++) {
+        v = (v >> 8) | ((uint32_t) p[i] << 24);
+      }
+      return (int32_t) v;
     }
-    return src32;
-  } else if (nBytesPerSample == 3) {
-    while (dst16 < dst_end16) {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      src16 += 3 * (n_ff_used - 1);
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void audiod_usb_sample_write(audiod_conv_t const *conv, uint8_t *p, int32_t q) {
+  switch (conv->usb_type) {
+    case AUDIOD_USB_PCM8:
+      p[0] = (uint8_t) (((uint32_t) q >> 24) ^ 0x80);
+      break;
+
+    case AUDIOD_USB_FLOAT: {
+      float const f = audiod_q31_to_float(q);
+      memcpy(p, &f, 4);
+      break;
     }
-    return src16;
-  } else// nBytesPerSample == 4
-  {
-    while (dst32 < dst_end32) {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      src32 += 2 * (n_ff_used - 1);
+
+    default: {
+      // Padding bits below bBitResolution are zero
+      uint32_t const v = (uint32_t) q & conv->usb_mask;
+      for (uint8_t i = 0; i < conv->usb_sz; i++) {
+        p[i] = (uint8_t) (v >> (8 * (4 - conv->usb_sz + i)));
+      }
+      break;
     }
-    return src32;
   }
 }
 
-static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received) {
+TU_ATTR_ALWAYS_INLINE static inline int32_t audiod_app_sample_read(uint8_t app_format, uint8_t const *p, bool saturate) {
+  switch (app_format) {
+    case AUDIO_SAMPLE_FORMAT_INT16: {
+      int16_t s;
+      memcpy(&s, p, 2);
+      return (int32_t) ((uint32_t) s << 16);
+    }
+
+    case AUDIO_SAMPLE_FORMAT_INT24: {
+      int32_t s;
+      memcpy(&s, p, 4);
+      if (saturate) {
+        if (s > 0x7FFFFF) s = 0x7FFFFF;
+        if (s < -0x800000) s = -0x800000;
+      }
+      return (int32_t) ((uint32_t) s << 8);
+    }
+
+    case AUDIO_SAMPLE_FORMAT_FLOAT32: {
+      float f;
+      memcpy(&f, p, 4);
+      return audiod_float_to_q31(f);
+    }
+
+    default: {
+      int32_t q;
+      memcpy(&q, p, 4);
+      return q;
+    }
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void audiod_app_sample_write(uint8_t app_format, uint8_t *p, int32_t q) {
+  switch (app_format) {
+    case AUDIO_SAMPLE_FORMAT_INT16: {
+      int16_t const s = (int16_t) (q >> 16);
+      memcpy(p, &s, 2);
+      break;
+    }
+
+    case AUDIO_SAMPLE_FORMAT_INT24: {
+      int32_t const s = q >> 8;
+      memcpy(p, &s, 4);
+      break;
+    }
+
+    case AUDIO_SAMPLE_FORMAT_FLOAT32: {
+      float const f = audiod_q31_to_float(q);
+      memcpy(p, &f, 4);
+      break;
+    }
+
+    default:
+      memcpy(p, &q, 4);
+      break;
+  }
+}
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
+
+#if AUDIOD_SIMD_MVE || AUDIOD_SIMD_NEON
+static uint16_t audiod_deinterleave_simd(uint8_t *const dst[], uint8_t n_ff, uint8_t const *src, uint16_t slot_sz, uint16_t n_frames) {
+  uint16_t const frame_sz = (uint16_t) (n_ff * slot_sz);
+  uint16_t done = 0;
+
+  #define AUDIOD_DEINTERLEAVE(_bits, _lanes, _n)                                                                     \
+    for (; done + _lanes <= n_frames; done += _lanes) {                                                              \
+      uint##_bits##x##_lanes##x##_n##_t const v = vld##_n##q_u##_bits((uint##_bits##_t const *) (uintptr_t) (src + done * frame_sz)); \
+      for (uint8_t cnt_ff = 0; cnt_ff < _n; cnt_ff++) {                                                            \
+        vst1q_u##_bits((uint##_bits##_t *) (uintptr_t) (dst[cnt_ff] + done * slot_sz), v.val[cnt_ff]);           \
+      }                                                                                                            \
+    }                                                                                                              \
+    break;
+
+  if (n_ff <= 4 && audiod_simd_aligned(src, dst, n_ff, slot_sz)) {
+    switch ((slot_sz << 4) | n_ff) {
+      AUDIOD_SIMD_CASES(AUDIOD_DEINTERLEAVE)
+      default: break;
+    }
+  }
+
+  #undef AUDIOD_DEINTERLEAVE
+  return done;
+}
+#endif
+
+// De-interleave n_frames frames of src into n_ff buffers
+static void audiod_deinterleave(uint8_t *const dst[], uint8_t n_ff, uint8_t const *src, uint16_t slot_sz, uint16_t n_frames) {
+  if (n_ff == 1) {
+    memcpy(dst[0], src, (size_t) n_frames * slot_sz);
+    return;
+  }
+
+  uint16_t done = 0;
+  #if AUDIOD_SIMD_MVE || AUDIOD_SIMD_NEON
+  done = audiod_deinterleave_simd(dst, n_ff, src, slot_sz, n_frames);
+  #endif
+
+  uint16_t const frame_sz = (uint16_t) (n_ff * slot_sz);
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff; cnt_ff++) {
+    audiod_copy_slots(dst[cnt_ff] + done * slot_sz, slot_sz, src + done * frame_sz + cnt_ff * slot_sz, frame_sz, slot_sz, n_frames - done);
+  }
+}
+
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+TU_ATTR_ALWAYS_INLINE static inline void audiod_deinterleave_convert_loop(uint8_t *const dst[], uint8_t n_ff, uint8_t const *src, uint8_t n_ch, uint16_t n_frames,
+                                                                          audiod_conv_t const *conv, uint32_t *dither_state, uint8_t const app_format) {
+  uint8_t const app_sz = (app_format == AUDIO_SAMPLE_FORMAT_INT16) ? 2 : 4;
+  uint16_t const slot_sz = (uint16_t) (n_ch * conv->usb_sz);
+  uint16_t const skip = (uint16_t) ((n_ff - 1) * slot_sz);
+
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff; cnt_ff++) {
+    uint8_t *d = dst[cnt_ff];
+    uint8_t const *s = src + cnt_ff * slot_sz;
+    for (uint16_t n = n_frames; n != 0; n--, s += skip) {
+      for (uint8_t ch = 0; ch < n_ch; ch++, s += conv->usb_sz, d += app_sz) {
+        int32_t q = audiod_usb_sample_read(conv, s);
+        if (conv->dither_bits) {
+          q = audiod_q31_dither(q, conv->dither_bits, dither_state);
+        }
+        audiod_app_sample_write(app_format, d, q);
+      }
+    }
+  }
+}
+
+// De-interleave n_frames frames of src into n_ff buffers converting USB samples to application format
+static void audiod_deinterleave_convert(uint8_t *const dst[], uint8_t n_ff, uint8_t const *src, uint8_t n_ch, uint16_t n_frames,
+                                        audiod_conv_t const *conv, uint32_t *dither_state) {
+  switch (conv->app_format) {
+    case AUDIO_SAMPLE_FORMAT_INT16:
+      audiod_deinterleave_convert_loop(dst, n_ff, src, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_INT16);
+      break;
+    case AUDIO_SAMPLE_FORMAT_INT24:
+      audiod_deinterleave_convert_loop(dst, n_ff, src, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_INT24);
+      break;
+    case AUDIO_SAMPLE_FORMAT_Q31:
+      audiod_deinterleave_convert_loop(dst, n_ff, src, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_Q31);
+      break;
+    case AUDIO_SAMPLE_FORMAT_FLOAT32:
+      audiod_deinterleave_convert_loop(dst, n_ff, src, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_FLOAT32);
+      break;
+    default: break;
+  }
+}
+#endif
+
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN
+
+#if AUDIOD_SIMD_MVE || AUDIOD_SIMD_NEON
+static uint16_t audiod_interleave_simd(uint8_t *dst, uint8_t *const src[], uint8_t n_ff, uint16_t slot_sz, uint16_t n_frames) {
+  uint16_t const frame_sz = (uint16_t) (n_ff * slot_sz);
+  uint16_t done = 0;
+
+  #define AUDIOD_INTERLEAVE(_bits, _lanes, _n)                                                                       \
+    for (; done + _lanes <= n_frames; done += _lanes) {                                                              \
+      uint##_bits##x##_lanes##x##_n##_t v;                                                                           \
+      for (uint8_t cnt_ff = 0; cnt_ff < _n; cnt_ff++) {                                                            \
+        v.val[cnt_ff] = vld1q_u##_bits((uint##_bits##_t const *) (uintptr_t) (src[cnt_ff] + done * slot_sz));     \
+      }                                                                                                            \
+      vst##_n##q_u##_bits((uint##_bits##_t *) (uintptr_t) (dst + done * frame_sz), v);                             \
+    }                                                                                                              \
+    break;
+
+  if (n_ff <= 4 && audiod_simd_aligned(dst, src, n_ff, slot_sz)) {
+    switch ((slot_sz << 4) | n_ff) {
+      AUDIOD_SIMD_CASES(AUDIOD_INTERLEAVE)
+      default: break;
+    }
+  }
+
+  #undef AUDIOD_INTERLEAVE
+  return done;
+}
+#endif
+
+// Interleave n_frames frames of n_ff buffers into dst
+static void audiod_interleave(uint8_t *dst, uint8_t *const src[], uint8_t n_ff, uint16_t slot_sz, uint16_t n_frames) {
+  if (n_ff == 1) {
+    memcpy(dst, src[0], (size_t) n_frames * slot_sz);
+    return;
+  }
+
+  uint16_t done = 0;
+  #if AUDIOD_SIMD_MVE || AUDIOD_SIMD_NEON
+  done = audiod_interleave_simd(dst, src, n_ff, slot_sz, n_frames);
+  #endif
+
+  uint16_t const frame_sz = (uint16_t) (n_ff * slot_sz);
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff; cnt_ff++) {
+    audiod_copy_slots(dst + done * frame_sz + cnt_ff * slot_sz, frame_sz, src[cnt_ff] + done * slot_sz, slot_sz, slot_sz, n_frames - done);
+  }
+}
+
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+TU_ATTR_ALWAYS_INLINE static inline void audiod_interleave_convert_loop(uint8_t *dst, uint8_t *const src[], uint8_t n_ff, uint8_t n_ch, uint16_t n_frames,
+                                                                        audiod_conv_t const *conv, uint32_t *dither_state, uint8_t const app_format) {
+  uint8_t const app_sz = (app_format == AUDIO_SAMPLE_FORMAT_INT16) ? 2 : 4;
+  uint16_t const slot_sz = (uint16_t) (n_ch * conv->usb_sz);
+  uint16_t const skip = (uint16_t) ((n_ff - 1) * slot_sz);
+  bool const saturate = conv->options & AUDIO_SAMPLE_CONV_SATURATE;
+
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff; cnt_ff++) {
+    uint8_t *d = dst + cnt_ff * slot_sz;
+    uint8_t const *s = src[cnt_ff];
+    for (uint16_t n = n_frames; n != 0; n--, d += skip) {
+      for (uint8_t ch = 0; ch < n_ch; ch++, s += app_sz, d += conv->usb_sz) {
+        int32_t q = audiod_app_sample_read(app_format, s, saturate);
+        if (conv->dither_bits) {
+          q = audiod_q31_dither(q, conv->dither_bits, dither_state);
+        }
+        audiod_usb_sample_write(conv, d, q);
+      }
+    }
+  }
+}
+
+// Interleave n_frames frames of n_ff buffers into dst converting application samples to USB format
+static void audiod_interleave_convert(uint8_t *dst, uint8_t *const src[], uint8_t n_ff, uint8_t n_ch, uint16_t n_frames,
+                                      audiod_conv_t const *conv, uint32_t *dither_state) {
+  switch (conv->app_format) {
+    case AUDIO_SAMPLE_FORMAT_INT16:
+      audiod_interleave_convert_loop(dst, src, n_ff, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_INT16);
+      break;
+    case AUDIO_SAMPLE_FORMAT_INT24:
+      audiod_interleave_convert_loop(dst, src, n_ff, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_INT24);
+      break;
+    case AUDIO_SAMPLE_FORMAT_Q31:
+      audiod_interleave_convert_loop(dst, src, n_ff, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_Q31);
+      break;
+    case AUDIO_SAMPLE_FORMAT_FLOAT32:
+      audiod_interleave_convert_loop(dst, src, n_ff, n_ch, n_frames, conv, dither_state, AUDIO_SAMPLE_FORMAT_FLOAT32);
+      break;
+    default: break;
+  }
+}
+#endif
+
+#endif
+
+#endif
+
+// The following functions are used in case CFG_TUD_AUDIO_ENABLE_DECODING != 0
+#if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
+
+// Decoding according to 2.3.1.5 Audio Streams
+
+static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t *audio, uint16_t n_bytes_received, bool in_isr) {
   (void) rhport;
+  (void) in_isr;
 
-  // Determine amount of samples
   uint8_t const n_ff_used = audio->n_ff_used_rx;
-  uint16_t const nBytesPerFFToRead = n_bytes_received / n_ff_used;
+  uint8_t const n_ch = audio->n_channels_per_ff_rx;
+  uint16_t const slot_sz = (uint16_t) (n_ch * audio->n_bytes_per_sample_rx);
+  #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+  audiod_conv_t const *conv = &audio->conv_rx;
+  uint16_t const ff_slot_sz = (uint16_t) (n_ch * conv->app_sz);
+  #else
+  uint16_t const ff_slot_sz = slot_sz;
+  #endif
+  TU_VERIFY(n_ff_used != 0 && n_ff_used <= audio->n_rx_supp_ff && slot_sz != 0 && ff_slot_sz != 0);
+
+  // Number of frames received, limited by the support FIFO with least space such that channels stay in sync.
+  // Number of bytes should be a multiple of the frame size but checking makes no sense - no way to correct it
+  uint16_t n_frames = (uint16_t) (n_bytes_received / (n_ff_used * slot_sz));
+  tu_fifo_buffer_info_t info[AUDIOD_N_RX_SUPP_FF_MAX];
   uint8_t cnt_ff;
 
-  // Decode
-  uint8_t *src;
-  uint8_t *dst_end;
+  for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
+    tu_fifo_get_write_info(&audio->rx_supp_ff[cnt_ff], &info[cnt_ff]);
+    n_frames = tu_min16(n_frames, (uint16_t) ((info[cnt_ff].len_lin + info[cnt_ff].len_wrap) / ff_slot_sz));
+  }
+
+  // Decode in runs along which no support FIFO wraps
+  uint8_t const *src = audio->lin_buf_out;
+  uint8_t *dst[AUDIOD_N_RX_SUPP_FF_MAX];
+  uint16_t done = 0;
 
-  tu_fifo_buffer_info_t info;
+  while (done < n_frames) {
+    uint16_t const offset = (uint16_t) (done * ff_slot_sz);
+    uint16_t run = n_frames - done;
 
-  for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
-    tu_fifo_get_write_info(&audio->rx_supp_ff[cnt_ff], &info);
-
-    if (info.len_lin != 0) {
-      info.len_lin = tu_min16(nBytesPerFFToRead, info.len_lin);
-      src = &audio->lin_buf_out[cnt_ff * audio->n_channels_per_ff_rx * audio->n_bytes_per_sample_rx];
-      dst_end = info.ptr_lin + info.len_lin;
-      src = audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sample_rx, info.ptr_lin, dst_end, src, n_ff_used);
-
-      // Handle wrapped part of FIFO
-      info.len_wrap = tu_min16(nBytesPerFFToRead - info.len_lin, info.len_wrap);
-      if (info.len_wrap != 0) {
-        dst_end = info.ptr_wrap + info.len_wrap;
-        audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sample_rx, info.ptr_wrap, dst_end, src, n_ff_used);
+    for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
+      if (offset < info[cnt_ff].len_lin) {
+        dst[cnt_ff] = (uint8_t *) info[cnt_ff].ptr_lin + offset;
+        run = tu_min16(run, (uint16_t) ((info[cnt_ff].len_lin - offset) / ff_slot_sz));
+      } else {
+        dst[cnt_ff] = (uint8_t *) info[cnt_ff].ptr_wrap + (offset - info[cnt_ff].len_lin);
       }
-      tu_fifo_advance_write_pointer(&audio->rx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
     }
+
+    // Linear part is a multiple of slot size since FIFO depth is, see set_interface()
+    if (run == 0) break;
+
+  #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+    if (conv->app_format != AUDIO_SAMPLE_FORMAT_USB) {
+      audiod_deinterleave_convert(dst, n_ff_used, src, n_ch, run, conv, &audio->dither_state);
+    } else
+  #endif
+    {
+      audiod_deinterleave(dst, n_ff_used, src, slot_sz, run);
+    }
+    src += run * n_ff_used * slot_sz;
+    done += run;
   }
 
-  // Number of bytes should be a multiple of CFG_TUD_AUDIO_N_BYTES_PER_SAMPLE_RX * CFG_TUD_AUDIO_N_CHANNELS_RX but checking makes no sense - no way to correct it
-  // TU_VERIFY(cnt != n_bytes);
+  for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
+    tu_fifo_advance_write_pointer(&audio->rx_supp_ff[cnt_ff], (uint16_t) (done * ff_slot_sz));
+  }
 
   #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
-  if (audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT) {
-    audiod_fb_fifo_count_update(audio, tu_fifo_count(&audio->rx_supp_ff[0]));
+  if (audio->ep_fb != 0) {
+    if (done < n_bytes_received / (n_ff_used * slot_sz)) audio->fb_stats.overrun_count++;
+    audiod_fb_fifo_count_update(audio, tu_fifo_count(&audio->rx_supp_ff[0]), in_isr);
   }
   #endif
 
@@ -938,6 +1510,38 @@ tu_fifo_t *tud_audio_n_get_tx_support_ff(uint8_t func_id, uint8_t ff_idx) {
 
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+
+bool tud_audio_n_set_rx_format(uint8_t func_id, audio_sample_format_t format, uint8_t options) {
+  #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && format <= AUDIO_SAMPLE_FORMAT_FLOAT32);
+  _audiod_fct[func_id].sample_format_rx = (uint8_t) format;
+  _audiod_fct[func_id].sample_options_rx = options;
+  return true;
+  #else
+  (void) func_id;
+  (void) format;
+  (void) options;
+  return false;
+  #endif
+}
+
+bool tud_audio_n_set_tx_format(uint8_t func_id, audio_sample_format_t format, uint8_t options) {
+  #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && format <= AUDIO_SAMPLE_FORMAT_FLOAT32);
+  _audiod_fct[func_id].sample_format_tx = (uint8_t) format;
+  _audiod_fct[func_id].sample_options_tx = options;
+  return true;
+  #else
+  (void) func_id;
+  (void) format;
+  (void) options;
+  return false;
+  #endif
+}
+
+#endif
+
 
 #if CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP
 // If no interrupt transmit is pending bytes get written into buffer and a transmit is scheduled - once transmit completed tud_audio_int_done_cb() is called in inform user
@@ -1065,47 +1669,6 @@ range [-1, +1)
  * does not change the number of bytes per sample.
  * */
 
-// Helper function
-static inline void *audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesPerSample, void *src, const void *src_end, void *dst, uint8_t const n_ff_used) {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t *dst16 = dst;
-  uint16_t *src16 = src;
-  const uint16_t *src_end16 = src_end;
-  uint32_t *dst32 = dst;
-  uint32_t *src32 = src;
-  const uint32_t *src_end32 = src_end;
-
-  if (nBytesPerSample == 1) {
-    while (src16 < src_end16) {
-      *dst16++ = *src16++;
-      dst16 += n_ff_used - 1;
-    }
-    return dst16;
-  } else if (nBytesPerSample == 2) {
-    while (src32 < src_end32) {
-      *dst32++ = *src32++;
-      dst32 += n_ff_used - 1;
-    }
-    return dst32;
-  } else if (nBytesPerSample == 3) {
-    while (src16 < src_end16) {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      dst16 += 3 * (n_ff_used - 1);
-    }
-    return dst16;
-  } else// nBytesPerSample == 4
-  {
-    while (src32 < src_end32) {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      dst32 += 2 * (n_ff_used - 1);
-    }
-    return dst32;
-  }
-}
-
 static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t *audio) {
   // This function relies on the fact that the length of the support FIFOs was configured to be a multiple of the active sample size in bytes s.t. no sample is split within a wrap
   // This is ensured within set_interface, where the FIFOs are reconfigured according to this size
@@ -1115,22 +1678,36 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t *audi
 
   // Determine amount of samples
   uint8_t const n_ff_used = audio->n_ff_used_tx;
-  uint16_t nBytesPerFFToSend = tu_fifo_count(&audio->tx_supp_ff[0]);
+  uint8_t const n_ch = audio->n_channels_per_ff_tx;
+  uint16_t const slot_sz = (uint16_t) (n_ch * audio->n_bytes_per_sample_tx);
+  #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+  audiod_conv_t const *conv = &audio->conv_tx;
+  uint16_t const ff_slot_sz = (uint16_t) (n_ch * conv->app_sz);
+  #else
+  uint16_t const ff_slot_sz = slot_sz;
+  #endif
+  TU_VERIFY(n_ff_used != 0 && n_ff_used <= audio->n_tx_supp_ff && slot_sz != 0 && ff_slot_sz != 0, 0);
+
+  uint16_t ff_count = tu_fifo_count(&audio->tx_supp_ff[0]);
   uint8_t cnt_ff;
 
   for (cnt_ff = 1; cnt_ff < n_ff_used; cnt_ff++) {
     uint16_t const count = tu_fifo_count(&audio->tx_supp_ff[cnt_ff]);
-    if (count < nBytesPerFFToSend) {
-      nBytesPerFFToSend = count;
+    if (count < ff_count) {
+      ff_count = count;
     }
   }
 
+  // Support FIFO level in bytes of USB samples
+  uint16_t nBytesPerFFToSend = (uint16_t) (ff_count / ff_slot_sz * slot_sz);
+
   #if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
   const uint16_t norm_packet_sz_tx[3] = {audio->packet_sz_tx[0] / n_ff_used,
                                          audio->packet_sz_tx[1] / n_ff_used,
                                          audio->packet_sz_tx[2] / n_ff_used};
+  const uint16_t ff_depth = (uint16_t) (audio->tx_supp_ff[0].depth / ff_slot_sz * slot_sz);
   // packet_sz_tx is based on total packet size, here we want size for each support buffer.
-  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, nBytesPerFFToSend, audio->tx_supp_ff[0].depth, audio->ep_in_sz / n_ff_used);
+  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, nBytesPerFFToSend, ff_depth, audio->ep_in_sz / n_ff_used);
   // Check if there is enough data
   if (nBytesPerFFToSend == 0) return 0;
   #else
@@ -1138,41 +1715,54 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t *audi
   if (nBytesPerFFToSend == 0) return 0;
   // Limit to maximum sample number - THIS IS A POSSIBLE ERROR SOURCE IF TOO MANY SAMPLE WOULD NEED TO BE SENT BUT CAN NOT!
   nBytesPerFFToSend = tu_min16(nBytesPerFFToSend, audio->ep_in_sz / n_ff_used);
-  // Round to full number of samples (flooring)
-  uint16_t const nSlotSize = audio->n_channels_per_ff_tx * audio->n_bytes_per_sample_tx;
-  nBytesPerFFToSend = (nBytesPerFFToSend / nSlotSize) * nSlotSize;
   #endif
 
-  // Encode
-  uint8_t *dst;
-  uint8_t *src_end;
+  // Round to full number of samples (flooring)
+  uint16_t const n_frames = nBytesPerFFToSend / slot_sz;
 
-  tu_fifo_buffer_info_t info;
+  // Encode in runs along which no support FIFO wraps
+  tu_fifo_buffer_info_t info[AUDIOD_N_TX_SUPP_FF_MAX];
+  uint8_t *src[AUDIOD_N_TX_SUPP_FF_MAX];
+  uint8_t *dst = audio->lin_buf_in;
+  uint16_t done = 0;
 
   for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
-    dst = &audio->lin_buf_in[cnt_ff * audio->n_channels_per_ff_tx * audio->n_bytes_per_sample_tx];
-
-    tu_fifo_get_read_info(&audio->tx_supp_ff[cnt_ff], &info);
-
-    if (info.len_lin != 0) {
-      info.len_lin = tu_min16(nBytesPerFFToSend, info.len_lin);// Limit up to desired length
-      src_end = (uint8_t *) info.ptr_lin + info.len_lin;
-      dst = audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sample_tx, info.ptr_lin, src_end, dst, n_ff_used);
+    tu_fifo_get_read_info(&audio->tx_supp_ff[cnt_ff], &info[cnt_ff]);
+  }
 
-      // Limit up to desired length
-      info.len_wrap = tu_min16(nBytesPerFFToSend - info.len_lin, info.len_wrap);
+  while (done < n_frames) {
+    uint16_t const offset = (uint16_t) (done * ff_slot_sz);
+    uint16_t run = n_frames - done;
 
-      // Handle wrapped part of FIFO
-      if (info.len_wrap != 0) {
-        src_end = (uint8_t *) info.ptr_wrap + info.len_wrap;
-        audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sample_tx, info.ptr_wrap, src_end, dst, n_ff_used);
+    for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
+      if (offset < info[cnt_ff].len_lin) {
+        src[cnt_ff] = (uint8_t *) info[cnt_ff].ptr_lin + offset;
+        run = tu_min16(run, (uint16_t) ((info[cnt_ff].len_lin - offset) / ff_slot_sz));
+      } else {
+        src[cnt_ff] = (uint8_t *) info[cnt_ff].ptr_wrap + (offset - info[cnt_ff].len_lin);
       }
+    }
+
+    // Linear part is a multiple of slot size since FIFO depth is, see set_interface()
+    if (run == 0) break;
 
-      tu_fifo_advance_read_pointer(&audio->tx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
+  #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+    if (conv->app_format != AUDIO_SAMPLE_FORMAT_USB) {
+      audiod_interleave_convert(dst, src, n_ff_used, n_ch, run, conv, &audio->dither_state);
+    } else
+  #endif
+    {
+      audiod_interleave(dst, src, n_ff_used, slot_sz, run);
     }
+    dst += run * n_ff_used * slot_sz;
+    done += run;
   }
 
-  return nBytesPerFFToSend * n_ff_used;
+  for (cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++) {
+    tu_fifo_advance_read_pointer(&audio->tx_supp_ff[cnt_ff], (uint16_t) (done * ff_slot_sz));
+  }
+
+  return (uint16_t) (done * slot_sz * n_ff_used);
 }
 #endif//CFG_TUD_AUDIO_ENABLE_ENCODING
 
@@ -1467,7 +2057,7 @@ void audiod_init(void) {
         for (uint8_t cnt = 0; cnt < CFG_TUD_AUDIO_FUNC_1_N_RX_SUPP_SW_FIFO; cnt++) {
           tu_fifo_config(&rx_supp_ff_1[cnt], rx_supp_ff_buf_1[cnt], CFG_TUD_AUDIO_FUNC_1_RX_SUPP_SW_FIFO_SZ, 1, true);
     #if CFG_FIFO_MUTEX
-          tu_fifo_config_mutex(&rx_supp_ff_1[cnt], osal_mutex_create(&rx_supp_ff_mutex_rd_1[cnt]), NULL);
+          tu_fifo_config_mutex(&rx_supp_ff_1[cnt], NULL, osal_mutex_create(&rx_supp_ff_mutex_rd_1[cnt]));
     #endif
         }
 
@@ -1482,7 +2072,7 @@ void audiod_init(void) {
         for (uint8_t cnt = 0; cnt < CFG_TUD_AUDIO_FUNC_2_N_RX_SUPP_SW_FIFO; cnt++) {
           tu_fifo_config(&rx_supp_ff_2[cnt], rx_supp_ff_buf_2[cnt], CFG_TUD_AUDIO_FUNC_2_RX_SUPP_SW_FIFO_SZ, 1, true);
     #if CFG_FIFO_MUTEX
-          tu_fifo_config_mutex(&rx_supp_ff_2[cnt], osal_mutex_create(&rx_supp_ff_mutex_rd_2[cnt]), NULL);
+          tu_fifo_config_mutex(&rx_supp_ff_2[cnt], NULL, osal_mutex_create(&rx_supp_ff_mutex_rd_2[cnt]));
     #endif
         }
 
@@ -1497,7 +2087,7 @@ void audiod_init(void) {
         for (uint8_t cnt = 0; cnt < CFG_TUD_AUDIO_FUNC_3_N_RX_SUPP_SW_FIFO; cnt++) {
           tu_fifo_config(&rx_supp_ff_3[cnt], rx_supp_ff_buf_3[cnt], CFG_TUD_AUDIO_FUNC_3_RX_SUPP_SW_FIFO_SZ, 1, true);
     #if CFG_FIFO_MUTEX
-          tu_fifo_config_mutex(&rx_supp_ff_3[cnt], osal_mutex_create(&rx_supp_ff_mutex_rd_3[cnt]), NULL);
+          tu_fifo_config_mutex(&rx_supp_ff_3[cnt], NULL, osal_mutex_create(&rx_supp_ff_mutex_rd_3[cnt]));
     #endif
         }
 
@@ -1778,6 +2368,9 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
   if (audio->ep_in_as_intf_num == itf) {
     audio->ep_in_as_intf_num = 0;
+  #if CFG_TUD_AUDIO_LOW_LATENCY
+    usbd_edpt_isr_set(rhport, audio->ep_in, false);
+  #endif
   #ifndef TUP_DCD_EDPT_ISO_ALLOC
     usbd_edpt_close(rhport, audio->ep_in);
   #endif
@@ -1807,6 +2400,9 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
   if (audio->ep_out_as_intf_num == itf) {
     audio->ep_out_as_intf_num = 0;
+  #if CFG_TUD_AUDIO_LOW_LATENCY
+    usbd_edpt_isr_set(rhport, audio->ep_out, false);
+  #endif
   #ifndef TUP_DCD_EDPT_ISO_ALLOC
     usbd_edpt_close(rhport, audio->ep_out);
   #endif
@@ -1881,7 +2477,15 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
 
               // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
-            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / (audio->n_channels_per_ff_tx * audio->n_bytes_per_sample_tx)) * (audio->n_channels_per_ff_tx * audio->n_bytes_per_sample_tx));
+      #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+            if (audio->dither_state == 0) audio->dither_state = 0x2545F491u;
+            audiod_conv_init(&audio->conv_tx, audio->sample_format_tx, audio->sample_options_tx, audio->format_type_I_tx,
+                             audio->n_bytes_per_sample_tx, audio->bit_resolution_tx, true);
+            const uint16_t ff_slot_sz = (uint16_t) (audio->n_channels_per_ff_tx * audio->conv_tx.app_sz);
+      #else
+            const uint16_t ff_slot_sz = (uint16_t) (audio->n_channels_per_ff_tx * audio->n_bytes_per_sample_tx);
+      #endif
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / ff_slot_sz) * ff_slot_sz);
             for (uint8_t cnt = 0; cnt < audio->n_tx_supp_ff; cnt++) {
               tu_fifo_config(&audio->tx_supp_ff[cnt], audio->tx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
             }
@@ -1890,6 +2494,11 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
     #endif
   #endif
 
+  #if CFG_TUD_AUDIO_LOW_LATENCY
+            // Following transmits are loaded in ISR
+            TU_ASSERT(usbd_edpt_isr_set(rhport, ep_addr, true));
+  #endif
+
             // Schedule first transmit if alternate interface is not zero i.e. streaming is disabled - in case no sample data is available a ZLP is loaded
             // It is necessary to trigger this here since the refill is done with an RX FIFO empty interrupt which can only trigger if something was in there
             TU_VERIFY(audiod_tx_done_cb(rhport, &_audiod_fct[func_id]));
@@ -1910,7 +2519,15 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
 
               // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
-            const uint16_t active_fifo_depth = (audio->rx_supp_ff_sz_max / audio->n_bytes_per_sample_rx) * audio->n_bytes_per_sample_rx;
+      #if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+            if (audio->dither_state == 0) audio->dither_state = 0x2545F491u;
+            audiod_conv_init(&audio->conv_rx, audio->sample_format_rx, audio->sample_options_rx, audio->format_type_I_rx,
+                             audio->n_bytes_per_sample_rx, audio->bit_resolution_rx, false);
+            const uint16_t ff_slot_sz = (uint16_t) (audio->n_channels_per_ff_rx * audio->conv_rx.app_sz);
+      #else
+            const uint16_t ff_slot_sz = (uint16_t) (audio->n_channels_per_ff_rx * audio->n_bytes_per_sample_rx);
+      #endif
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->rx_supp_ff_sz_max / ff_slot_sz) * ff_slot_sz);
             for (uint8_t cnt = 0; cnt < audio->n_rx_supp_ff; cnt++) {
               tu_fifo_config(&audio->rx_supp_ff[cnt], audio->rx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
             }
@@ -1919,6 +2536,10 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
     #endif
   #endif
 
+  #if CFG_TUD_AUDIO_LOW_LATENCY
+            TU_ASSERT(usbd_edpt_isr_set(rhport, ep_addr, true));
+  #endif
+
             // Prepare for incoming data
   #if USE_LINEAR_BUFFER_RX
             TU_VERIFY(usbd_edpt_xfer(rhport, audio->ep_out, audio->lin_buf_out, audio->ep_out_sz), false);
@@ -1950,6 +2571,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
       // Prepare feedback computation if endpoint is available
       if (audio->ep_fb != 0) {
         audio_feedback_params_t fb_param;
+        tu_memclr(&fb_param, sizeof(fb_param));
 
         tud_audio_feedback_params_cb(func_id, alt, &fb_param);
         audio->feedback.compute_method = fb_param.method;
@@ -1962,6 +2584,12 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
         audio->feedback.min_value = ((fb_param.sample_freq - 1) / frame_div) << 16;
         audio->feedback.max_value = (fb_param.sample_freq / frame_div + 1) << 16;
 
+        // Avoid 64bit division
+        uint32_t const nominal = ((fb_param.sample_freq / 100) << 16) / (frame_div / 100);
+        tud_audio_n_fb_clear_stats(func_id);
+        audio->fb_stats.nom_value = nominal;
+        audio->fb_stats.value_avg = 0;
+
         switch (fb_param.method) {
           case AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED:
           case AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT:
@@ -1969,7 +2597,8 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
             audiod_set_fb_params_freq(audio, fb_param.sample_freq, fb_param.frequency.mclk_freq);
             break;
 
-          case AUDIO_FEEDBACK_METHOD_FIFO_COUNT: {
+          case AUDIO_FEEDBACK_METHOD_FIFO_COUNT:
+          case AUDIO_FEEDBACK_METHOD_FIFO_PI: {
             // Initialize the threshold level to half filled
             uint16_t fifo_lvl_thr;
   #if CFG_TUD_AUDIO_ENABLE_DECODING
@@ -1977,10 +2606,18 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *p
   #else
             fifo_lvl_thr = tu_fifo_depth(&audio->ep_out_ff) / 2;
   #endif
+            if (fb_param.method == AUDIO_FEEDBACK_METHOD_FIFO_PI) {
+              if (fb_param.fifo_pi.target_lvl != 0 && fb_param.fifo_pi.target_lvl < 2 * fifo_lvl_thr) {
+                fifo_lvl_thr = fb_param.fifo_pi.target_lvl;
+              }
+              bool const dflt = (fb_param.fifo_pi.kp == 0 && fb_param.fifo_pi.ki == 0);
+              audio->feedback.compute.fifo_count.kp = dflt ? (1UL << 16) : fb_param.fifo_pi.kp;
+              audio->feedback.compute.fifo_count.ki = dflt ? (1UL << 8) : fb_param.fifo_pi.ki;
+              audio->feedback.compute.fifo_count.integral = 0;
+            }
+            TU_VERIFY(fifo_lvl_thr != 0);
             audio->feedback.compute.fifo_count.fifo_lvl_thr = fifo_lvl_thr;
             audio->feedback.compute.fifo_count.fifo_lvl_avg = ((uint32_t) fifo_lvl_thr) << 16;
-            // Avoid 64bit division
-            uint32_t nominal = ((fb_param.sample_freq / 100) << 16) / (frame_div / 100);
             audio->feedback.compute.fifo_count.nom_value = nominal;
             audio->feedback.compute.fifo_count.rate_const[0] = (uint16_t) ((audio->feedback.max_value - nominal) / fifo_lvl_thr);
             audio->feedback.compute.fifo_count.rate_const[1] = (uint16_t) ((nominal - audio->feedback.min_value) / fifo_lvl_thr);
@@ -2224,7 +2861,7 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
 
     // New audio packet received
     if (audio->ep_out == ep_addr) {
-      TU_VERIFY(audiod_rx_done_cb(rhport, audio, (uint16_t) xferred_bytes));
+      TU_VERIFY(audiod_rx_done_cb(rhport, audio, (uint16_t) xferred_bytes, false));
       return true;
     }
 
@@ -2247,6 +2884,144 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
   return false;
 }
 
+#if CFG_TUD_AUDIO_LOW_LATENCY
+
+  #if AUDIOD_LATENCY_STATS
+static void audiod_latency_record(audio_latency_stats_t *stats, uint32_t t_start) {
+  uint32_t const ticks = CFG_TUSB_TRACE_TIMESTAMP() - t_start;
+  if (stats->count == 0) {
+    stats->min = ticks;
+    stats->max = ticks;
+    stats->avg = ticks;
+  } else {
+    stats->min = tu_min32(stats->min, ticks);
+    stats->max = tu_max32(stats->max, ticks);
+    stats->avg = (uint32_t) ((int32_t) stats->avg + (int32_t) (ticks - stats->avg) / 16);
+  }
+  stats->last = ticks;
+  stats->count++;
+}
+  #endif
+
+  #if CFG_TUD_AUDIO_ENABLE_EP_IN
+// Block size passed to tud_audio_tx_block_isr_cb()
+static uint16_t audiod_tx_block_size(audiod_function_t const *audio) {
+    #if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
+  uint16_t const frame_sz = (uint16_t) (audio->n_channels_tx * audio->n_bytes_per_sample_tx);
+  return frame_sz ? (uint16_t) (audio->packet_sz_tx[1] / frame_sz) : 0;
+    #elif CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+  return audio->packet_sz_tx[1];
+    #else
+  (void) audio;
+  return 0;
+    #endif
+}
+  #endif
+
+  #if CFG_TUD_AUDIO_ENABLE_EP_OUT
+// Block size passed to tud_audio_rx_block_isr_cb()
+static uint16_t audiod_rx_block_size(audiod_function_t const *audio, uint16_t n_bytes_received) {
+    #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+  uint16_t const frame_sz = (uint16_t) (audio->n_channels_rx * audio->n_bytes_per_sample_rx);
+  return frame_sz ? (uint16_t) (n_bytes_received / frame_sz) : 0;
+    #else
+  (void) audio;
+  return n_bytes_received;
+    #endif
+}
+  #endif
+
+// Transfer complete of isochronous data EPs in ISR context. A completion is always consumed here since queuing it
+// after the EP was already re-armed would load it twice
+bool audiod_xfer_isr_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) port_num;
+  (void) result;
+  (void) xferred_bytes;
+  #if AUDIOD_LATENCY_STATS
+  // taken by usbd when dcd reported the completion, includes interrupt entry and dispatch
+  uint32_t const t_start = usbd_xfer_isr_timestamp();
+  #endif
+
+  for (uint8_t func_id = 0; func_id < CFG_TUD_AUDIO; func_id++) {
+    audiod_function_t *audio = &_audiod_fct[func_id];
+
+  #if CFG_TUD_AUDIO_ENABLE_EP_IN
+    if (audio->ep_in == ep_addr) {
+      tud_audio_tx_block_isr_cb(func_id, audiod_tx_block_size(audio));
+    #if AUDIOD_LATENCY_STATS
+      audiod_latency_record(&audio->latency_tx, t_start);
+    #endif
+      audiod_tx_done_cb(rhport, audio);
+      return true;
+    }
+  #endif
+
+  #if CFG_TUD_AUDIO_ENABLE_EP_OUT
+    if (audio->ep_out == ep_addr) {
+      if (audiod_rx_done_cb(rhport, audio, (uint16_t) xferred_bytes, true)) {
+    #if AUDIOD_LATENCY_STATS
+        audiod_latency_record(&audio->latency_rx, t_start);
+    #endif
+        tud_audio_rx_block_isr_cb(func_id, audiod_rx_block_size(audio, (uint16_t) xferred_bytes));
+      }
+      return true;
+    }
+  #endif
+  }
+
+  return false;
+}
+
+  #if CFG_TUD_XFER_COALESCE
+// Packets already handled by audiod_xfer_isr_cb(), merged by usbd until tud_task() got to them
+void audiod_xfer_coalesced_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes, uint16_t count) {
+  (void) rhport;
+  (void) port_num;
+  (void) result;
+
+  for (uint8_t func_id = 0; func_id < CFG_TUD_AUDIO; func_id++) {
+    audiod_function_t const *audio = &_audiod_fct[func_id];
+    if (false
+    #if CFG_TUD_AUDIO_ENABLE_EP_IN
+        || audio->ep_in == ep_addr
+    #endif
+    #if CFG_TUD_AUDIO_ENABLE_EP_OUT
+        || audio->ep_out == ep_addr
+    #endif
+    ) {
+      tud_audio_xfer_coalesced_cb(func_id, ep_addr, count, xferred_bytes);
+      return;
+    }
+  }
+}
+  #endif
+
+bool tud_audio_n_get_latency_stats(uint8_t func_id, audio_latency_stats_t *rx, audio_latency_stats_t *tx) {
+  TU_VERIFY(func_id < CFG_TUD_AUDIO);
+  #if AUDIOD_LATENCY_STATS
+  if (rx) *rx = _audiod_fct[func_id].latency_rx;
+  if (tx) *tx = _audiod_fct[func_id].latency_tx;
+  return true;
+  #else
+  (void) rx;
+  (void) tx;
+  return false;
+  #endif
+}
+
+bool tud_audio_n_clear_latency_stats(uint8_t func_id) {
+  TU_VERIFY(func_id < CFG_TUD_AUDIO);
+  #if AUDIOD_LATENCY_STATS
+  tu_memclr(&_audiod_fct[func_id].latency_rx, sizeof(audio_latency_stats_t));
+  tu_memclr(&_audiod_fct[func_id].latency_tx, sizeof(audio_latency_stats_t));
+  return true;
+  #else
+  return false;
+  #endif
+}
+
+#endif// CFG_TUD_AUDIO_LOW_LATENCY
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 
 static bool audiod_set_fb_params_freq(audiod_function_t *audio, uint32_t sample_freq, uint32_t mclk_freq) {
@@ -2278,34 +3053,144 @@ static bool audiod_set_fb_params_freq(audiod_function_t *audio, uint32_t sample_
   return true;
 }
 
-static void audiod_fb_fifo_count_update(audiod_function_t *audio, uint16_t lvl_new) {
+// Called on every received packet with current RX FIFO level: collects statistics and computes feedback value for FIFO based methods
+static void audiod_fb_fifo_count_update(audiod_function_t *audio, uint16_t lvl_new, bool in_isr) {
+  // Mean and variance weighted over approx. the last 256 packets, avoids divisions and overflow on long streams
+  if (audio->fb_stats.lvl_count == 0) {
+    audio->fb_stats.lvl_min = lvl_new;
+    audio->fb_stats.lvl_max = lvl_new;
+    audio->fb_stats.lvl_mean = (uint32_t) lvl_new << 16;
+    audio->fb_stats.lvl_var = 0;
+  } else {
+    int64_t const dev = ((int64_t) lvl_new << 16) - (int64_t) audio->fb_stats.lvl_mean;
+    int64_t const dev_sq = (dev * dev) >> 24;
+    audio->fb_stats.lvl_mean = (uint32_t) ((int64_t) audio->fb_stats.lvl_mean + dev / 256);
+    audio->fb_stats.lvl_var = (uint64_t) ((int64_t) audio->fb_stats.lvl_var + (dev_sq - (int64_t) audio->fb_stats.lvl_var) / 256);
+    audio->fb_stats.lvl_min = tu_min16(audio->fb_stats.lvl_min, lvl_new);
+    audio->fb_stats.lvl_max = tu_max16(audio->fb_stats.lvl_max, lvl_new);
+  }
+  audio->fb_stats.lvl_count++;
+
+  uint8_t const method = audio->feedback.compute_method;
+  if (method != AUDIO_FEEDBACK_METHOD_FIFO_COUNT && method != AUDIO_FEEDBACK_METHOD_FIFO_PI) return;
+
   /* Low-pass (averaging) filter */
   uint32_t lvl = audio->feedback.compute.fifo_count.fifo_lvl_avg;
   lvl = (uint32_t) (((uint64_t) lvl * 63 + ((uint32_t) lvl_new << 16)) >> 6);
   audio->feedback.compute.fifo_count.fifo_lvl_avg = lvl;
 
-  uint32_t const ff_lvl = lvl >> 16;
   uint16_t const ff_thr = audio->feedback.compute.fifo_count.fifo_lvl_thr;
-  uint16_t const *rate = audio->feedback.compute.fifo_count.rate_const;
+  uint32_t const nominal = audio->feedback.compute.fifo_count.nom_value;
 
   uint32_t feedback;
 
-  if (ff_lvl < ff_thr) {
-    feedback = audio->feedback.compute.fifo_count.nom_value + (ff_thr - ff_lvl) * rate[0];
+  if (method == AUDIO_FEEDBACK_METHOD_FIFO_PI) {
+    // Error in 16.16 format relative to threshold, positive if FIFO is below target i.e. host has to send more
+    int32_t const err = (int32_t) (((int64_t) ff_thr * 65536 - (int64_t) lvl) / ff_thr);
+
+    // Integral part with anti-windup, limited to the max. deviation of feedback value
+    int32_t integral = audio->feedback.compute.fifo_count.integral + (int32_t) (((int64_t) audio->feedback.compute.fifo_count.ki * err) / 65536);
+    if (integral > 65536) integral = 65536;
+    if (integral < -65536) integral = -65536;
+    audio->feedback.compute.fifo_count.integral = integral;
+
+    int64_t const ctrl = ((int64_t) audio->feedback.compute.fifo_count.kp * err) / 65536 + integral;
+    int64_t const span = (ctrl >= 0) ? (int64_t) (audio->feedback.max_value - nominal) : (int64_t) (nominal - audio->feedback.min_value);
+    int64_t fb = (int64_t) nominal + ctrl * span / 65536;
+
+    if (fb > audio->feedback.max_value) fb = audio->feedback.max_value;
+    if (fb < audio->feedback.min_value) fb = audio->feedback.min_value;
+    feedback = (uint32_t) fb;
   } else {
-    feedback = audio->feedback.compute.fifo_count.nom_value - (ff_lvl - ff_thr) * rate[1];
+    uint32_t const ff_lvl = lvl >> 16;
+    uint16_t const *rate = audio->feedback.compute.fifo_count.rate_const;
+
+    if (ff_lvl < ff_thr) {
+      feedback = nominal + (ff_thr - ff_lvl) * rate[0];
+    } else {
+      feedback = nominal - (ff_lvl - ff_thr) * rate[1];
+    }
+
+    if (feedback > audio->feedback.max_value) feedback = audio->feedback.max_value;
+    if (feedback < audio->feedback.min_value) feedback = audio->feedback.min_value;
   }
 
-  if (feedback > audio->feedback.max_value) feedback = audio->feedback.max_value;
-  if (feedback < audio->feedback.min_value) feedback = audio->feedback.min_value;
-  audio->feedback.value = feedback;
+  audiod_fb_set_value(audio, feedback);
 
-  // Schedule a transmit with the new value if EP is not busy - this triggers repetitive scheduling of the feedback value
-  if (usbd_edpt_claim(audio->rhport, audio->ep_fb)) {
+  // Schedule a transmit with the new value if EP is not busy - this triggers repetitive scheduling of the feedback value.
+  // Claiming takes the usbd mutex, in ISR (low latency mode) the transmit is deferred to usbd task
+  if (in_isr) {
+    if (!audio->feedback.send_deferred && !usbd_edpt_busy(audio->rhport, audio->ep_fb)) {
+      audio->feedback.send_deferred = true;
+      usbd_defer_func(audiod_fb_send_deferred, audio, true);
+    }
+  } else if (usbd_edpt_claim(audio->rhport, audio->ep_fb)) {
+    audiod_fb_send(audio);
+  }
+}
+
+// Feedback transmit deferred from ISR by audiod_fb_fifo_count_update()
+static void audiod_fb_send_deferred(void *param) {
+  audiod_function_t *audio = (audiod_function_t *) param;
+  audio->feedback.send_deferred = false;
+
+  if (audio->ep_fb != 0 && usbd_edpt_claim(audio->rhport, audio->ep_fb)) {
     audiod_fb_send(audio);
   }
 }
 
+static void audiod_fb_set_value(audiod_function_t *audio, uint32_t feedback) {
+  audio->feedback.value = feedback;
+
+  // Low-pass filtered value for drift estimation, seeded with the first value. Regulation of FIFO methods jitters and
+  // runs in limit cycles of about a second since packets carry whole samples, so it is weighted over approx. 2 s of
+  // packets. Kept with 16 more fraction bits, else the division truncates and the average stalls away from the value
+  int64_t const fb_avg = (int64_t) feedback << 16;
+  if (audio->fb_stats.value_avg == 0) {
+    audio->fb_stats.value_avg = (uint64_t) fb_avg;
+  } else {
+    int64_t const weight = (TUSB_SPEED_HIGH == tud_speed_get()) ? 16384 : 2048;
+    audio->fb_stats.value_avg = (uint64_t) ((int64_t) audio->fb_stats.value_avg + (fb_avg - (int64_t) audio->fb_stats.value_avg) / weight);
+  }
+}
+
+bool tud_audio_n_fb_get_stats(uint8_t func_id, audio_feedback_stats_t *stats) {
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && stats != NULL);
+  audiod_function_t const *audio = &_audiod_fct[func_id];
+
+  tu_memclr(stats, sizeof(audio_feedback_stats_t));
+  stats->feedback = audio->feedback.value;
+  stats->underrun_count = audio->fb_stats.underrun_count;
+  stats->overrun_count = audio->fb_stats.overrun_count;
+
+  uint32_t const nominal = audio->fb_stats.nom_value;
+  if (nominal != 0 && audio->fb_stats.value_avg != 0) {
+    int64_t const nominal_avg = (int64_t) nominal << 16;
+    stats->drift_ppm = (int32_t) (((int64_t) audio->fb_stats.value_avg - nominal_avg) * 1000000 / nominal_avg);
+  }
+
+  if (audio->fb_stats.lvl_count != 0) {
+    stats->fifo_lvl_mean = (uint16_t) ((audio->fb_stats.lvl_mean + (1UL << 15)) >> 16);
+    stats->fifo_lvl_var = (uint32_t) ((audio->fb_stats.lvl_var + (1U << 7)) >> 8);
+    stats->fifo_lvl_min = audio->fb_stats.lvl_min;
+    stats->fifo_lvl_max = audio->fb_stats.lvl_max;
+  }
+
+  return true;
+}
+
+bool tud_audio_n_fb_clear_stats(uint8_t func_id) {
+  TU_VERIFY(func_id < CFG_TUD_AUDIO);
+  audiod_function_t *audio = &_audiod_fct[func_id];
+
+  // Keep nominal and filtered feedback value, these are no counters
+  audio->fb_stats.lvl_count = 0;
+  audio->fb_stats.underrun_count = 0;
+  audio->fb_stats.overrun_count = 0;
+
+  return true;
+}
+
 uint32_t tud_audio_feedback_update(uint8_t func_id, uint32_t cycles) {
   audiod_function_t *audio = &_audiod_fct[func_id];
   uint32_t feedback;
@@ -2343,7 +3228,7 @@ uint32_t tud_audio_feedback_update(uint8_t func_id, uint32_t cycles) {
 bool tud_audio_n_fb_set(uint8_t func_id, uint32_t feedback) {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
 
-  _audiod_fct[func_id].feedback.value = feedback;
+  audiod_fb_set_value(&_audiod_fct[func_id], feedback);
 
   // Schedule a transmit with the new value if EP is not busy - this triggers repetitive scheduling of the feedback value
   if (usbd_edpt_claim(_audiod_fct[func_id].rhport, _audiod_fct[func_id].ep_fb)) {
@@ -2616,12 +3501,18 @@ static void audiod_parse_for_AS_params(audiod_function_t *audio, uint8_t const *
     #if CFG_TUD_AUDIO_ENABLE_EP_IN
       if (as_itf == audio->ep_in_as_intf_num) {
         audio->n_bytes_per_sample_tx = ((audio_desc_type_I_format_t const *) p_desc)->bSubslotSize;
+      #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+        audio->bit_resolution_tx = ((audio_desc_type_I_format_t const *) p_desc)->bBitResolution;
+      #endif
       }
     #endif
 
     #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
       if (as_itf == audio->ep_out_as_intf_num) {
         audio->n_bytes_per_sample_rx = ((audio_desc_type_I_format_t const *) p_desc)->bSubslotSize;
+      #if CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+        audio->bit_resolution_rx = ((audio_desc_type_I_format_t const *) p_desc)->bBitResolution;
+      #endif
       }
     #endif
     }
@@ -198,6 +198,20 @@
 #define CFG_TUD_AUDIO_ENABLE_FEEDBACK_FORMAT_CORRECTION     0                             // 0 or 1
 #endif
 
+// Low latency mode: isochronous data EPs are serviced in the transfer complete interrupt instead of tud_task(), i.e
+// encoding/decoding and the block callbacks tud_audio_rx_block_isr_cb()/tud_audio_tx_block_isr_cb() run in ISR context
+// once per (micro)frame. Round trip is then about two (micro)frames. Requires CFG_TUD_XFER_ISR.
+// The block callbacks and tud_audio_rx_done_pre/post_read_cb(), tud_audio_tx_done_pre/post_load_cb() of data EPs
+// then must not block nor call RTOS APIs that may. With an RTOS the FIFO mutexes are only taken by the
+// application side (writing IN FIFOs, reading OUT FIFOs), the driver side of a FIFO is lock free single producer/consumer
+#ifndef CFG_TUD_AUDIO_LOW_LATENCY
+#define CFG_TUD_AUDIO_LOW_LATENCY                           0                             // 0 or 1
+#endif
+
+#if CFG_TUD_AUDIO_LOW_LATENCY && !CFG_TUD_XFER_ISR
+  #error CFG_TUD_AUDIO_LOW_LATENCY requires CFG_TUD_XFER_ISR
+#endif
+
 // Enable/disable interrupt EP (required for notifying host of control changes)
 #ifndef CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP
 #define CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP                   0                             // Feedback - 0 or 1
@@ -270,6 +284,13 @@
 #define CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING                0
 #endif
 
+// Convert samples between USB format of active alternate setting (PCM, PCM8 or IEEE_FLOAT and bSubslotSize/bBitResolution from
+// Type I Format descriptor) and an application format of the support FIFOs while encoding/decoding, see tud_audio_n_set_rx_format().
+// Support FIFO sizes must take the application sample size into account.
+#ifndef CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+#define CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION              0
+#endif
+
 // Type I Coding parameters not given within UAC2 descriptors
 // It would be possible to allow for a more flexible setting and not fix this parameter as done below. However, this is most often not needed and kept for later if really necessary. The more flexible setting could be implemented within set_interface(), however, how the values are saved per alternate setting is to be determined!
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
@@ -395,6 +416,29 @@ uint16_t tud_audio_n_write_support_ff             (uint8_t func_id, uint8_t ff_i
 tu_fifo_t* tud_audio_n_get_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+// Sample format of support FIFOs, conversion is fused into encoding/decoding (one pass over the data)
+typedef enum {
+  AUDIO_SAMPLE_FORMAT_USB = 0,  // Same as on USB, no conversion (default)
+  AUDIO_SAMPLE_FORMAT_INT16,    // int16_t
+  AUDIO_SAMPLE_FORMAT_INT24,    // int32_t holding a 24-bit sample right-justified (sign extended)
+  AUDIO_SAMPLE_FORMAT_Q31,      // int32_t left-justified, full scale
+  AUDIO_SAMPLE_FORMAT_FLOAT32,  // float in [-1, +1), samples outside are always clipped
+} audio_sample_format_t;
+
+// Conversion options
+enum {
+  AUDIO_SAMPLE_CONV_DITHER   = 0x01, // Add TPDF dither of +-1 LSB when resolution is reduced e.g Q31 to 16-bit USB samples,
+                                     // dither never wraps around full scale
+  AUDIO_SAMPLE_CONV_SATURATE = 0x02, // Clip INT24 application samples outside of 24-bit range instead of wrapping around
+};
+
+// Set application sample format of RX/TX support FIFOs (after tud_init()), takes effect when host selects the next alternate
+// setting e.g call it in tud_audio_set_itf_close_EP_cb(). USB formats not supported (e.g A-law) are passed as they are.
+bool     tud_audio_n_set_rx_format                (uint8_t func_id, audio_sample_format_t format, uint8_t options);
+bool     tud_audio_n_set_tx_format                (uint8_t func_id, audio_sample_format_t format, uint8_t options);
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP
 bool    tud_audio_int_n_write                     (uint8_t func_id, const audio_interrupt_data_t * data);
 #endif
@@ -437,6 +481,11 @@ static inline uint16_t tud_audio_write_support_ff           (uint8_t ff_idx, con
 static inline tu_fifo_t* tud_audio_get_tx_support_ff        (uint8_t ff_idx);
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+static inline bool tud_audio_set_rx_format                  (audio_sample_format_t format, uint8_t options);
+static inline bool tud_audio_set_tx_format                  (audio_sample_format_t format, uint8_t options);
+#endif
+
 // INT CTR API
 
 #if CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP
@@ -455,6 +504,7 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
 // Application Callback API
 //--------------------------------------------------------------------+
 
+// Invoked in ISR context if CFG_TUD_AUDIO_LOW_LATENCY is enabled, otherwise in tud_task()
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
 bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t func_id, uint8_t ep_in, uint8_t cur_alt_setting);
 bool tud_audio_tx_done_post_load_cb(uint8_t rhport, uint16_t n_bytes_copied, uint8_t func_id, uint8_t ep_in, uint8_t cur_alt_setting);
@@ -465,6 +515,39 @@ bool tud_audio_rx_done_pre_read_cb(uint8_t rhport, uint16_t n_bytes_received, ui
 bool tud_audio_rx_done_post_read_cb(uint8_t rhport, uint16_t n_bytes_received, uint8_t func_id, uint8_t ep_out, uint8_t cur_alt_setting);
 #endif
 
+#if CFG_TUD_AUDIO_LOW_LATENCY
+// Block callbacks of low latency mode, invoked in ISR context and should return quickly. Block size n is in audio frames
+// (one sample of each channel) if type I decoding/encoding is enabled, otherwise in bytes of EP FIFO.
+
+// Invoked once per received packet after it was decoded into support FIFOs (or copied into EP OUT FIFO),
+// application consumes the block of n frames right away
+void tud_audio_rx_block_isr_cb(uint8_t func_id, uint16_t n);
+
+// Invoked once per IN packet before next packet is encoded from support FIFOs (or taken from EP IN FIFO),
+// application provides the block right away. n is the nominal packet size if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+// is enabled and sample rate is known, otherwise 0 and application writes its own block size
+void tud_audio_tx_block_isr_cb(uint8_t func_id, uint16_t n);
+
+  #if CFG_TUD_XFER_COALESCE
+// Invoked in task context after data EP packets were handled in ISR, with number of packets and their bytes in total
+// since previous invocation. Lets the application refill or drain its FIFOs once per batch instead of polling
+void tud_audio_xfer_coalesced_cb(uint8_t func_id, uint8_t ep_addr, uint16_t n_xfers, uint32_t n_bytes);
+  #endif
+
+// Time from dcd reporting transfer complete to invoking block callback, in ticks of CFG_TUSB_TRACE_TIMESTAMP().
+// Only collected if CFG_TUSB_TRACE is enabled
+typedef struct {
+  uint32_t count;
+  uint32_t last;
+  uint32_t min;
+  uint32_t max;
+  uint32_t avg; // weighted over approx. the last 16 blocks
+}audio_latency_stats_t;
+
+bool tud_audio_n_get_latency_stats(uint8_t func_id, audio_latency_stats_t* rx, audio_latency_stats_t* tx);
+bool tud_audio_n_clear_latency_stats(uint8_t func_id);
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 void tud_audio_fb_done_cb(uint8_t func_id);
 
@@ -477,6 +560,12 @@ void tud_audio_fb_done_cb(uint8_t func_id);
 // (Windows, Linux, OSX) with a reliable result so far.
 // Disadvantage: A FIFO of minimal 4 frames is needed to compensate for jitter, an average delay of 2 frames is introduced.
 //
+// Option 1b - AUDIO_FEEDBACK_METHOD_FIFO_PI
+// Same input as option 1 but regulated by a proportional-integral controller with gains set in audio_feedback_params_t.
+// Advantage: The integral part removes the steady-state level offset of option 1 which is proportional to the clock drift,
+// hence the FIFO stays at its target level and latency is constant. Target level can be set below half fill.
+// Disadvantage: Slower settling, a too high integral gain makes the level oscillate.
+//
 // Option 2 - AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED / AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT
 // Feedback value is calculated within the audio driver by use of SOF interrupt. The driver needs information about the master clock f_m from
 // which the audio sample frequency f_s is derived, f_s itself, and the cycle count of f_m at time of the SOF interrupt (e.g. by use of a hardware counter).
@@ -525,7 +614,8 @@ enum {
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2, // For driver internal use only
-  AUDIO_FEEDBACK_METHOD_FIFO_COUNT
+  AUDIO_FEEDBACK_METHOD_FIFO_COUNT,
+  AUDIO_FEEDBACK_METHOD_FIFO_PI
 };
 
 typedef struct {
@@ -537,9 +627,30 @@ typedef struct {
       uint32_t mclk_freq; // Main clock frequency in Hz i.e. master clock to which sample clock is based on
     }frequency;
 
+    struct {
+      uint32_t kp;        // Proportional gain in 16.16 format, 1.0 deviates feedback by one sample per frame at empty/full FIFO
+      uint32_t ki;        // Integral gain in 16.16 format, applied per received packet
+      uint16_t target_lvl;// FIFO level to regulate to in bytes, 0 for half fill
+    }fifo_pi;             // All zero selects kp = 1.0, ki = 1/256
+
   };
 }audio_feedback_params_t;
 
+// Clock drift and FIFO statistics of a streaming OUT endpoint with feedback, reset when host opens the stream
+typedef struct {
+  int32_t  drift_ppm;      // Sample clock of device relative to nominal sample rate as seen by host, derived from averaged feedback value
+  uint32_t feedback;       // Current feedback value in 16.16 format
+  uint16_t fifo_lvl_mean;  // Level in bytes of (first support) RX FIFO sampled on each received packet, mean and
+  uint32_t fifo_lvl_var;   // variance in bytes^2 are weighted over approx. the last 256 packets
+  uint16_t fifo_lvl_min;
+  uint16_t fifo_lvl_max;
+  uint32_t underrun_count; // Application reads which found the (first support) RX FIFO empty
+  uint32_t overrun_count;  // Received packets (partially) dropped since FIFO was full
+}audio_feedback_stats_t;
+
+bool tud_audio_n_fb_get_stats(uint8_t func_id, audio_feedback_stats_t* stats);
+bool tud_audio_n_fb_clear_stats(uint8_t func_id);
+
 // Invoked when needed to set feedback parameters
 void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt_itf, audio_feedback_params_t* feedback_param);
 
@@ -686,6 +797,20 @@ static inline tu_fifo_t* tud_audio_get_tx_support_ff(uint8_t ff_idx)
 
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION
+
+static inline bool tud_audio_set_rx_format(audio_sample_format_t format, uint8_t options)
+{
+  return tud_audio_n_set_rx_format(0, format, options);
+}
+
+static inline bool tud_audio_set_tx_format(audio_sample_format_t format, uint8_t options)
+{
+  return tud_audio_n_set_tx_format(0, format, options);
+}
+
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP
 static inline bool tud_audio_int_write(const audio_interrupt_data_t * data)
 {
@@ -700,6 +825,30 @@ static inline bool tud_audio_fb_set(uint32_t feedback)
   return tud_audio_n_fb_set(0, feedback);
 }
 
+static inline bool tud_audio_fb_get_stats(audio_feedback_stats_t* stats)
+{
+  return tud_audio_n_fb_get_stats(0, stats);
+}
+
+static inline bool tud_audio_fb_clear_stats(void)
+{
+  return tud_audio_n_fb_clear_stats(0);
+}
+
+#endif
+
+#if CFG_TUD_AUDIO_LOW_LATENCY
+
+static inline bool tud_audio_get_latency_stats(audio_latency_stats_t* rx, audio_latency_stats_t* tx)
+{
+  return tud_audio_n_get_latency_stats(0, rx, tx);
+}
+
+static inline bool tud_audio_clear_latency_stats(void)
+{
+  return tud_audio_n_clear_latency_stats(0);
+}
+
 #endif
 
 //--------------------------------------------------------------------+
@@ -711,6 +860,8 @@ void     audiod_reset          (uint8_t rhport);
 uint16_t audiod_open           (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     audiod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     audiod_xfer_cb        (uint8_t rhport, uint8_t edpt_addr, xfer_result_t result, uint32_t xferred_bytes);
+bool     audiod_xfer_isr_cb    (uint8_t rhport, uint8_t port_num, uint8_t edpt_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     audiod_xfer_coalesced_cb(uint8_t rhport, uint8_t port_num, uint8_t edpt_addr, xfer_result_t result, uint32_t xferred_bytes, uint16_t count);
 void     audiod_sof_isr        (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
@@ -54,6 +54,12 @@ typedef struct {
   // Bit 0:  DTR (Data Terminal Ready), Bit 1: RTS (Request to Send)
   uint8_t line_state;
 
+  uint16_t ep_out_mps;
+  uint8_t rx_buf_idx; // OUT buffer armed, alternates with CFG_TUD_CDC_RX_PINGPONG
+
+  // rx_ff region written by the OUT transfer in progress when receiving directly into fifo
+  tu_fifo_buffer_info_t rx_xfer_info;
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
   char wanted_char;
   TU_ATTR_ALIGNED(4) cdc_line_coding_t line_coding;
@@ -74,6 +80,9 @@ typedef struct {
 typedef struct {
   TUD_EPBUF_DEF(epout, CFG_TUD_CDC_EP_BUFSIZE);
   TUD_EPBUF_DEF(epin, CFG_TUD_CDC_EP_BUFSIZE);
+#if CFG_TUD_CDC_RX_PINGPONG
+  TUD_EPBUF_DEF(epout_alt, CFG_TUD_CDC_EP_BUFSIZE);
+#endif
 } cdcd_epbuf_t;
 
 //--------------------------------------------------------------------+
@@ -84,10 +93,71 @@ CFG_TUD_MEM_SECTION static cdcd_epbuf_t _cdcd_epbuf[CFG_TUD_CDC];
 
 static tud_cdc_configure_t _cdcd_cfg = TUD_CDC_CONFIGURE_DEFAULT();
 
-static bool _prep_out_transaction(uint8_t itf) {
+// Invoke wanted char callback for each occurrence in received data, 4 bytes are compared at a time
+static void _scan_wanted_char(uint8_t itf, uint8_t const* buf, uint32_t len) {
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  uint8_t const wanted = (uint8_t) p_cdc->wanted_char;
+  uint32_t const pattern = 0x01010101u * wanted;
+
+  uint32_t i = 0;
+  while (i < len) {
+    if (i + 4 <= len) {
+      // wanted char is in this word only if (word ^ pattern) has a zero byte
+      uint32_t const v = tu_unaligned_read32(buf + i) ^ pattern;
+      if (0 == ((v - 0x01010101u) & ~v & 0x80808080u)) {
+        i += 4;
+        continue;
+      }
+    }
+
+    // check matching word (or the tail) byte by byte
+    uint32_t const end = TU_MIN(i + 4, len);
+    for (; i < end; i++) {
+      if ((wanted == buf[i]) && !tu_fifo_empty(&p_cdc->rx_ff)) {
+        tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
+      }
+    }
+  }
+}
+
+// Controller transfers directly from/to fifo
+TU_ATTR_ALWAYS_INLINE static inline bool _xfer_fifo(void) {
+  return CFG_TUD_CDC_XFER_FIFO && usbd_edpt_xfer_fifo_supported();
+}
+
+// Controller can read directly from TX fifo, but not while it is overwritable since writer may then move read index
+TU_ATTR_ALWAYS_INLINE static inline bool _tx_xfer_fifo(const cdcd_interface_t* p_cdc) {
+  return _xfer_fifo() && !p_cdc->tx_ff.overwritable;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* _rx_buf(uint8_t itf, uint8_t idx) {
+#if CFG_TUD_CDC_RX_PINGPONG
+  if (idx) {
+    return _cdcd_epbuf[itf].epout_alt;
+  }
+#else
+  (void) idx;
+#endif
+  return _cdcd_epbuf[itf].epout;
+}
+
+// Size of next OUT transfer for free fifo space, 0 if there is not enough space
+static uint16_t _rx_xfer_size(const cdcd_interface_t* p_cdc, uint16_t available) {
+#if CFG_TUD_CDC_RX_MULTI_PACKET
+  const uint16_t mps = p_cdc->ep_out_mps;
+  const uint16_t size = TU_MIN(available, _xfer_fifo() ? UINT16_MAX : CFG_TUD_CDC_EP_BUFSIZE);
+  return mps ? (uint16_t) (size - (size % mps)) : 0;
+#else
+  (void) p_cdc;
+  return (available >= CFG_TUD_CDC_EP_BUFSIZE) ? CFG_TUD_CDC_EP_BUFSIZE : 0;
+#endif
+}
+
+// Arm OUT endpoint. Reserved fifo space is kept for data received in the other (ping-pong) buffer
+// which is not yet written to fifo.
+static bool _prep_out_transaction(uint8_t itf, uint16_t reserved) {
   const uint8_t rhport = 0;
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  cdcd_epbuf_t* p_epbuf = &_cdcd_epbuf[itf];
 
   // Skip if usb is not ready yet
   TU_VERIFY(tud_ready() && p_cdc->ep_out);
@@ -98,16 +168,22 @@ static bool _prep_out_transaction(uint8_t itf) {
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
   // and slowly move it to the FIFO when read().
   // This pre-check reduces endpoint claiming
-  TU_VERIFY(available >= CFG_TUD_CDC_EP_BUFSIZE);
+  TU_VERIFY(available >= reserved && _rx_xfer_size(p_cdc, available - reserved));
 
   // claim endpoint
   TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_out));
 
   // fifo can be changed before endpoint is claimed
   available = tu_fifo_remaining(&p_cdc->rx_ff);
+  const uint16_t xfer_size = (available >= reserved) ? _rx_xfer_size(p_cdc, available - reserved) : 0;
 
-  if (available >= CFG_TUD_CDC_EP_BUFSIZE) {
-    return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_epbuf->epout, CFG_TUD_CDC_EP_BUFSIZE);
+  if (xfer_size) {
+    if (_xfer_fifo()) {
+      // receive directly into fifo, remember where data goes for wanted char search
+      tu_fifo_get_write_info(&p_cdc->rx_ff, &p_cdc->rx_xfer_info);
+      return usbd_edpt_xfer_fifo(rhport, p_cdc->ep_out, &p_cdc->rx_ff, xfer_size);
+    }
+    return usbd_edpt_xfer(rhport, p_cdc->ep_out, _rx_buf(itf, p_cdc->rx_buf_idx), xfer_size);
   } else {
     // Release endpoint since we don't make any transfer
     usbd_edpt_release(rhport, p_cdc->ep_out);
@@ -156,7 +232,7 @@ uint32_t tud_cdc_n_available(uint8_t itf) {
 uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize) {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
   uint32_t num_read = tu_fifo_read_n(&p_cdc->rx_ff, buffer, (uint16_t) TU_MIN(bufsize, UINT16_MAX));
-  _prep_out_transaction(itf);
+  _prep_out_transaction(itf, 0);
   return num_read;
 }
 
@@ -166,8 +242,13 @@ bool tud_cdc_n_peek(uint8_t itf, uint8_t* chr) {
 
 void tud_cdc_n_read_flush(uint8_t itf) {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  tu_fifo_clear(&p_cdc->rx_ff);
-  _prep_out_transaction(itf);
+  if (_xfer_fifo()) {
+    // OUT transfer in progress writes into fifo, only consume what is there
+    tu_fifo_advance_read_pointer(&p_cdc->rx_ff, tu_fifo_count(&p_cdc->rx_ff));
+  } else {
+    tu_fifo_clear(&p_cdc->rx_ff);
+  }
+  _prep_out_transaction(itf, 0);
 }
 
 //--------------------------------------------------------------------+
@@ -206,11 +287,22 @@ uint32_t tud_cdc_n_write_flush(uint8_t itf) {
   // Claim the endpoint
   TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_in), 0);
 
+  const bool xfer_fifo = _tx_xfer_fifo(p_cdc);
+
   // Pull data from FIFO
-  const uint16_t count = tu_fifo_read_n(&p_cdc->tx_ff, p_epbuf->epin, CFG_TUD_CDC_EP_BUFSIZE);
+  uint16_t count;
+  if (xfer_fifo) {
+    count = TU_MIN(tu_fifo_count(&p_cdc->tx_ff), CFG_TUD_CDC_EP_BUFSIZE);
+  } else {
+    count = tu_fifo_read_n(&p_cdc->tx_ff, p_epbuf->epin, CFG_TUD_CDC_EP_BUFSIZE);
+  }
 
   if (count) {
-    TU_ASSERT(usbd_edpt_xfer(rhport, p_cdc->ep_in, p_epbuf->epin, count), 0);
+    if (xfer_fifo) {
+      TU_ASSERT(usbd_edpt_xfer_fifo(rhport, p_cdc->ep_in, &p_cdc->tx_ff, count), 0);
+    } else {
+      TU_ASSERT(usbd_edpt_xfer(rhport, p_cdc->ep_in, p_epbuf->epin, count), 0);
+    }
     return count;
   } else {
     // Release endpoint since we don't make any transfer
@@ -225,7 +317,18 @@ uint32_t tud_cdc_n_write_available(uint8_t itf) {
 }
 
 bool tud_cdc_n_write_clear(uint8_t itf) {
-  return tu_fifo_clear(&_cdcd_itf[itf].tx_ff);
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  // Controller reads directly from fifo while IN transfer is in progress: only clear when endpoint is idle
+  if (_tx_xfer_fifo(p_cdc) && p_cdc->ep_in) {
+    const uint8_t rhport = 0;
+    TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_in));
+    tu_fifo_clear(&p_cdc->tx_ff);
+    usbd_edpt_release(rhport, p_cdc->ep_in);
+    return true;
+  }
+
+  return tu_fifo_clear(&p_cdc->tx_ff);
 }
 
 //--------------------------------------------------------------------+
@@ -351,11 +454,19 @@ uint16_t cdcd_open(uint8_t rhport, const tusb_desc_interface_t* itf_desc, uint16
     // Open endpoint pair
     TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &p_cdc->ep_out, &p_cdc->ep_in), 0);
 
+    for (uint8_t i = 0; i < 2; i++) {
+      const tusb_desc_endpoint_t* desc_ep = (const tusb_desc_endpoint_t*) p_desc;
+      if (desc_ep->bEndpointAddress == p_cdc->ep_out) {
+        p_cdc->ep_out_mps = tu_edpt_packet_size(desc_ep);
+      }
+      p_desc = tu_desc_next(p_desc);
+    }
+
     drv_len += 2 * sizeof(tusb_desc_endpoint_t);
   }
 
   // Prepare for incoming data
-  _prep_out_transaction(cdc_id);
+  _prep_out_transaction(cdc_id, 0);
 
   return drv_len;
 }
@@ -460,18 +571,36 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     }
   }
   TU_ASSERT(itf < CFG_TUD_CDC);
-  cdcd_epbuf_t* p_epbuf = &_cdcd_epbuf[itf];
 
   // Received new data
   if (ep_addr == p_cdc->ep_out) {
-    tu_fifo_write_n(&p_cdc->rx_ff, p_epbuf->epout, (uint16_t) xferred_bytes);
+    bool const check_wanted = tud_cdc_rx_wanted_cb && (((signed char) p_cdc->wanted_char) != -1);
+
+    if (_xfer_fifo()) {
+      // Data is already in fifo, re-arm right away. Wanted char is searched in linear part then wrapped part
+      // of the region recorded when transfer was queued
+      tu_fifo_buffer_info_t const info = p_cdc->rx_xfer_info;
+      _prep_out_transaction(itf, 0);
+
+      if (check_wanted) {
+        uint32_t const lin = TU_MIN(xferred_bytes, info.len_lin);
+        _scan_wanted_char(itf, (uint8_t const*) info.ptr_lin, lin);
+        _scan_wanted_char(itf, (uint8_t const*) info.ptr_wrap, xferred_bytes - lin);
+      }
+    } else {
+      uint8_t const* rx_buf = _rx_buf(itf, p_cdc->rx_buf_idx);
 
-    // Check for wanted char and invoke callback if needed
-    if (tud_cdc_rx_wanted_cb && (((signed char) p_cdc->wanted_char) != -1)) {
-      for (uint32_t i = 0; i < xferred_bytes; i++) {
-        if ((p_cdc->wanted_char == p_epbuf->epout[i]) && !tu_fifo_empty(&p_cdc->rx_ff)) {
-          tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
-        }
+      #if CFG_TUD_CDC_RX_PINGPONG
+      // re-arm with the other buffer before draining this one
+      p_cdc->rx_buf_idx ^= 1;
+      _prep_out_transaction(itf, (uint16_t) xferred_bytes);
+      #endif
+
+      tu_fifo_write_n(&p_cdc->rx_ff, rx_buf, (uint16_t) xferred_bytes);
+
+      // Check for wanted char and invoke callback if needed
+      if (check_wanted) {
+        _scan_wanted_char(itf, rx_buf, xferred_bytes);
       }
     }
 
@@ -480,8 +609,8 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
       tud_cdc_rx_cb(itf);
     }
 
-    // prepare for OUT transaction
-    _prep_out_transaction(itf);
+    // prepare for OUT transaction if not armed yet
+    _prep_out_transaction(itf, 0);
   }
 
   // Data sent to host, we continue to fetch from tx fifo to send.
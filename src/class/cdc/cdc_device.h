@@ -41,6 +41,26 @@
   #define CFG_TUD_CDC_EP_BUFSIZE    (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// Let controller receive into RX FIFO and send from TX FIFO directly with dcd_edpt_xfer_fifo(), without copying through
+// endpoint buffers. Only enable if controller driver supports it in the mode it runs, e.g dwc2 does not with DMA.
+#ifndef CFG_TUD_CDC_XFER_FIFO
+  #define CFG_TUD_CDC_XFER_FIFO        0
+#endif
+
+// Arm OUT endpoint for as many max packet size units as fit in free RX FIFO space (limited to CFG_TUD_CDC_EP_BUFSIZE
+// unless CFG_TUD_CDC_XFER_FIFO is enabled) instead of exactly CFG_TUD_CDC_EP_BUFSIZE.
+// Note: a transfer only completes with a short packet, host should end each write with a short packet or ZLP
+// otherwise tud_cdc_rx_cb() is delayed until more data arrives.
+#ifndef CFG_TUD_CDC_RX_MULTI_PACKET
+  #define CFG_TUD_CDC_RX_MULTI_PACKET  0
+#endif
+
+// Use a second OUT buffer so that endpoint is re-armed as soon as a transfer completes, before received data is copied
+// into RX FIFO and callbacks are invoked. Not used with CFG_TUD_CDC_XFER_FIFO.
+#ifndef CFG_TUD_CDC_RX_PINGPONG
+  #define CFG_TUD_CDC_RX_PINGPONG      0
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -123,7 +143,7 @@ uint32_t tud_cdc_n_write_flush(uint8_t itf);
 // Return the number of bytes (characters) available for writing to TX FIFO buffer in a single n_write operation.
 uint32_t tud_cdc_n_write_available(uint8_t itf);
 
-// Clear the transmit FIFO
+// Clear the transmit FIFO, fails while controller is sending directly from it (CFG_TUD_CDC_XFER_FIFO)
 bool tud_cdc_n_write_clear(uint8_t itf);
 
 //--------------------------------------------------------------------+
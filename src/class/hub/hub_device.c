@@ -187,7 +187,7 @@ uint16_t hubd_open(uint8_t rhport, uint8_t port_num, tusb_desc_interface_t const
       //TU_LOG_BUF(p_desc, max_len);
 	  //p_desc = tu_desc_next(p_desc);
 	  //TU_ASSERT(0x19 == tu_desc_type(p_desc), 0);
-	  //if(boCU_GetDesc(HUB_POOL_IDX,0x19,0,(uint8_t**)&hub_descriptor,&u8size)==false){
+	  //if(usbd_desc_get(TUD_HUB_PORT_NUM,0x19,0,NULL)==NULL){
 		//  CTRACE("failed to get hub descriptor");
 	  //}
 	  hubd_resetStates();
@@ -251,9 +251,8 @@ bool hubd_control_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t stage, tusb_
 	    case HUB_REQUEST_GET_DESCRIPTOR:
 	    	if (request->wValue==0x2900&&
 	    		request->wIndex==0x0000){
-	    		hub_desc_cs_t* hub_desc = NULL;
-	    	    boCU_GetDesc(HUB_POOL_IDX, 0x19, 0, &hub_desc, NULL);
-	    		tud_control_xfer(rhport, TUD_HUB_PORT_NUM, request, hub_desc, 9);
+	    		uint8_t const* hub_desc = usbd_desc_get(TUD_HUB_PORT_NUM, 0x19, 0, NULL);
+	    		tud_control_xfer(rhport, TUD_HUB_PORT_NUM, request, (void*) (uintptr_t) hub_desc, 9);
 	    	}
 	    	else{
 
@@ -312,8 +311,7 @@ void hubd_connectDevice(uint8_t u8PortNum, uint8_t* usb_desc){
 uint8_t resetResponse = 0x02;
 bool hubd_handle_controll_port_request(uint8_t rhport, const tusb_control_request_t* p_request) {
     TU_LOG_USBD("hub %s request to port %d\r\n",_hub_request_str[p_request->bRequest],p_request->wIndex);
-    hub_desc_cs_t* hub_desc = NULL;
-    boCU_GetDesc(HUB_POOL_IDX, 0x19, 0, &hub_desc, NULL);
+    hub_desc_cs_t const* hub_desc = (hub_desc_cs_t const*) usbd_desc_get(TUD_HUB_PORT_NUM, 0x19, 0, NULL);
 	switch(p_request->bRequest) {
 	case HUB_REQUEST_GET_STATUS: {
 		if (p_request->wIndex == 0) {
@@ -336,6 +334,7 @@ bool hubd_handle_controll_port_request(uint8_t rhport, const tusb_control_reques
 		hub_port_status_response_t* pportStatus = hubd_PortFeature(p_request->wIndex);
 		switch(p_request->wValue){
 		case HUB_FEATURE_PORT_RESET:
+			usbd_hub_port_reset(rhport, (uint8_t) p_request->wIndex);
 			usbd_edpt_xfer(rhport, 0x81, &resetResponse, 1);
 			pportStatus->change.reset = 1;
 			pportStatus->status.reset = 0;
@@ -58,7 +58,8 @@ typedef enum
 {
   MSC_PROTOCOL_CBI              = 0 ,  ///< Control/Bulk/Interrupt protocol (with command completion interrupt)
   MSC_PROTOCOL_CBI_NO_INTERRUPT = 1 ,  ///< Control/Bulk/Interrupt protocol (without command completion interrupt)
-  MSC_PROTOCOL_BOT              = 0x50 ///< Bulk-Only Transport
+  MSC_PROTOCOL_BOT              = 0x50,///< Bulk-Only Transport
+  MSC_PROTOCOL_UAS              = 0x62 ///< USB Attached SCSI
 }msc_protocol_type_t;
 
 /// MassStorage Class-Specific Control Request
@@ -121,8 +122,18 @@ typedef enum
   SCSI_CMD_READ_FORMAT_CAPACITY         = 0x23, ///< The command allows the Host to request a list of the possible format capacities for an installed writable media. This command also has the capability to report the writable capacity for a media when it is installed
   SCSI_CMD_READ_10                      = 0x28, ///< The READ (10) command requests that the device server read the specified logical block(s) and transfer them to the data-in buffer.
   SCSI_CMD_WRITE_10                     = 0x2A, ///< The WRITE (10) command requests that the device server transfer the specified logical block(s) from the data-out buffer and write them.
+  SCSI_CMD_SYNCHRONIZE_CACHE_10         = 0x35, ///< Write cached data of the specified logical blocks (all if block count is zero) to the medium
+  SCSI_CMD_READ_16                      = 0x88, ///< READ (16) with 64-bit LBA and 32-bit transfer length, required for medium larger than 2 TiB (512-byte blocks)
+  SCSI_CMD_WRITE_16                     = 0x8A, ///< WRITE (16) with 64-bit LBA and 32-bit transfer length
+  SCSI_CMD_SYNCHRONIZE_CACHE_16         = 0x91, ///< SYNCHRONIZE CACHE with 64-bit LBA
+  SCSI_CMD_SERVICE_ACTION_IN_16         = 0x9E, ///< Service action in byte 1, \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16
 }scsi_cmd_type_t;
 
+/// Service Action of \ref SCSI_CMD_SERVICE_ACTION_IN_16
+enum {
+  SCSI_SERVICE_ACTION_READ_CAPACITY_16 = 0x10,
+};
+
 /// SCSI Sense Key
 typedef enum
 {
@@ -274,6 +285,30 @@ typedef struct TU_ATTR_PACKED
 
 TU_VERIFY_STATIC( sizeof(scsi_mode_sense6_resp_t) == 4, "size is not correct");
 
+enum {
+  SCSI_MODE_PAGE_CACHING = 0x08,
+  SCSI_MODE_PAGE_ALL     = 0x3F,
+};
+
+/// Caching mode page, follows the mode parameter header
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t page_code : 6; ///< \ref SCSI_MODE_PAGE_CACHING
+  uint8_t : 1;
+  uint8_t ps : 1;
+
+  uint8_t page_length;   ///< 0x12
+
+  bool read_cache_disable : 1;
+  uint8_t : 1;
+  bool write_cache_enable : 1;
+  uint8_t : 5;
+
+  uint8_t reserved[17];
+} scsi_mode_page_caching_t;
+
+TU_VERIFY_STATIC( sizeof(scsi_mode_page_caching_t) == 20, "size is not correct");
+
 typedef struct TU_ATTR_PACKED
 {
   uint8_t cmd_code; ///< SCSI OpCode for \ref SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL
@@ -375,6 +410,182 @@ typedef struct TU_ATTR_PACKED
 TU_VERIFY_STATIC(sizeof(scsi_read10_t) == 10, "size is not correct");
 TU_VERIFY_STATIC(sizeof(scsi_write10_t) == 10, "size is not correct");
 
+/// SCSI Read Capacity 16 Command: Service Action In (16) with \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code       ; ///< SCSI OpCode for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+  uint8_t  service_action ; ///< bit 4:0 service action
+  uint32_t lba_hi         ; ///< Obsolete Logical Block Address
+  uint32_t lba_lo         ;
+  uint32_t alloc_length   ; ///< Maximum bytes of response data
+  uint8_t  pmi            ; ///< Obsolete partial medium indicator
+  uint8_t  control        ;
+} scsi_read_capacity16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Response Data
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t last_lba_hi   ; ///< The last Logical Block Address of the device, upper 32 bits
+  uint32_t last_lba_lo   ; ///< lower 32 bits
+  uint32_t block_size    ; ///< Block size in bytes
+  uint8_t  prot          ; ///< Protection information, 0 if not supported
+  uint8_t  lbppbe        ; ///< Logical blocks per physical block exponent
+  uint16_t lowest_aligned; ///< Lowest aligned LBA
+  uint8_t  reserved[16]  ;
+} scsi_read_capacity16_resp_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_resp_t) == 32, "size is not correct");
+
+/// SCSI Read 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode
+  uint8_t  flags       ;
+  uint32_t lba_hi      ; ///< The first Logical Block Address (LBA) accessed by this command, upper 32 bits
+  uint32_t lba_lo      ; ///< lower 32 bits
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  group       ;
+  uint8_t  control     ;
+} scsi_read16_t, scsi_write16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read16_t) == 16, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write16_t) == 16, "size is not correct");
+
+/// SCSI Status, returned in UAS Sense IU
+typedef enum
+{
+  SCSI_STATUS_GOOD            = 0x00,
+  SCSI_STATUS_CHECK_CONDITION = 0x02, ///< sense data is available
+  SCSI_STATUS_BUSY            = 0x08,
+  SCSI_STATUS_TASK_SET_FULL   = 0x28,
+}scsi_status_t;
+
+//--------------------------------------------------------------------+
+// USB Attached SCSI (UAS)
+//--------------------------------------------------------------------+
+
+/// Pipe Usage class-specific endpoint descriptor, follows each UAS endpoint descriptor
+enum {
+  UAS_DESC_PIPE_USAGE = 0x24
+};
+
+/// Pipe ID in Pipe Usage descriptor
+typedef enum
+{
+  UAS_PIPE_ID_COMMAND  = 1,
+  UAS_PIPE_ID_STATUS   = 2,
+  UAS_PIPE_ID_DATA_IN  = 3,
+  UAS_PIPE_ID_DATA_OUT = 4,
+}uas_pipe_id_t;
+
+/// Information Unit ID
+typedef enum
+{
+  UAS_IU_COMMAND     = 0x01,
+  UAS_IU_SENSE       = 0x03,
+  UAS_IU_RESPONSE    = 0x04,
+  UAS_IU_TASK_MGMT   = 0x05,
+  UAS_IU_READ_READY  = 0x06,
+  UAS_IU_WRITE_READY = 0x07,
+}uas_iu_id_t;
+
+/// Task Management function
+typedef enum
+{
+  UAS_TMF_ABORT_TASK         = 0x01,
+  UAS_TMF_ABORT_TASK_SET     = 0x02,
+  UAS_TMF_CLEAR_TASK_SET     = 0x04,
+  UAS_TMF_LOGICAL_UNIT_RESET = 0x08,
+  UAS_TMF_IT_NEXUS_RESET     = 0x10,
+  UAS_TMF_CLEAR_ACA          = 0x40,
+  UAS_TMF_QUERY_TASK         = 0x80,
+  UAS_TMF_QUERY_TASK_SET     = 0x81,
+  UAS_TMF_QUERY_ASYNC_EVENT  = 0x82,
+}uas_tmf_t;
+
+/// Response code of Response IU
+typedef enum
+{
+  UAS_RC_TMF_COMPLETE          = 0x00,
+  UAS_RC_INVALID_IU            = 0x02,
+  UAS_RC_TMF_NOT_SUPPORTED     = 0x04,
+  UAS_RC_TMF_FAILED            = 0x05,
+  UAS_RC_TMF_SUCCEEDED         = 0x08,
+  UAS_RC_INCORRECT_LUN         = 0x09,
+  UAS_RC_OVERLAPPED_TAG        = 0x0A,
+}uas_response_code_t;
+
+// Multiple bytes fields of Information Units are big endian
+
+/// Command IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id;
+  uint8_t  reserved1;
+  uint16_t tag;
+  uint8_t  task_attribute; ///< bit 2:0 task attribute, bit 6:3 command priority
+  uint8_t  reserved2;
+  uint8_t  add_cdb_len;    ///< bit 7:2 additional CDB length in dwords
+  uint8_t  reserved3;
+  uint8_t  lun[8];
+  uint8_t  cdb[16];
+} uas_command_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_command_iu_t) == 32, "size is not correct");
+
+/// Task Management IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id;
+  uint8_t  reserved1;
+  uint16_t tag;
+  uint8_t  function;       ///< \ref uas_tmf_t
+  uint8_t  reserved2;
+  uint16_t task_tag;       ///< tag of the task to be managed
+  uint8_t  lun[8];
+} uas_task_mgmt_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_task_mgmt_iu_t) == 16, "size is not correct");
+
+/// Sense IU, sense data is in fixed format
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id;
+  uint8_t  reserved1;
+  uint16_t tag;
+  uint16_t status_qualifier;
+  uint8_t  status;         ///< \ref scsi_status_t
+  uint8_t  reserved2[7];
+  uint16_t sense_len;
+  scsi_sense_fixed_resp_t sense;
+} uas_sense_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_sense_iu_t) == 34, "size is not correct");
+
+/// Response IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id;
+  uint8_t  reserved1;
+  uint16_t tag;
+  uint8_t  add_response_info[3];
+  uint8_t  response_code;  ///< \ref uas_response_code_t
+} uas_response_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_response_iu_t) == 8, "size is not correct");
+
+/// Read Ready and Write Ready IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id;
+  uint8_t  reserved1;
+  uint16_t tag;
+} uas_ready_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_ready_iu_t) == 4, "size is not correct");
+
 #ifdef __cplusplus
  }
 #endif
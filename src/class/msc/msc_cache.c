@@ -0,0 +1,451 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUD_ENABLED && CFG_TUD_MSC && CFG_TUD_MSC_CACHE)
+
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+
+#include "msc_device.h"
+#include "msc_cache.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUD_MSC_LOG_LEVEL
+  #define CFG_TUD_MSC_LOG_LEVEL   CFG_TUD_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUD_MSC_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+#define LINE_SIZE   CFG_TUD_MSC_CACHE_LINE_SIZE
+#define LINE_COUNT  CFG_TUD_MSC_CACHE_LINE_COUNT
+
+enum {
+  LINE_NONE = 0xFF
+};
+
+typedef struct {
+  uint64_t addr;        // byte address on media, multiple of LINE_SIZE
+  uint32_t age;         // last use for LRU
+  uint32_t filled;      // bytes valid from start of line (read from media or written by host), complete once full
+  uint32_t flushed;     // bytes programmed by a flush in progress
+  uint32_t flush_start; // time in ms a flush is started
+  uint16_t block_size;
+  uint8_t  lun;
+  bool     used;        // line holds media data (or is being filled)
+  bool     dirty;       // modified by host, not yet programmed
+} cache_line_t;
+
+typedef struct {
+  cache_line_t line[LINE_COUNT];
+  uint64_t next_addr[CFG_TUD_MSC_MAXLUN]; // address following last read of each LUN, for sequential detection
+  uint32_t age;
+
+  // read-ahead requested while current data is on the wire
+  bool     pf_pending;
+  uint8_t  pf_lun;
+  uint16_t pf_block_size;
+  uint64_t pf_addr;
+
+  // idle flush, counted in SOF interrupt
+  volatile bool     idle_armed;  // dirty lines are waiting for host to be idle
+  volatile bool     idle_queued; // flush is deferred to usbd task
+  volatile uint16_t idle_ms;
+  uint32_t idle_frame;
+
+  tud_msc_cache_stats_t stats;
+} msc_cache_t;
+
+static msc_cache_t _cache;
+TU_ATTR_ALIGNED(4) static uint8_t _cache_data[LINE_COUNT][LINE_SIZE];
+
+//--------------------------------------------------------------------+
+// Line management
+//--------------------------------------------------------------------+
+static uint8_t line_find(uint8_t lun, uint64_t line_addr) {
+  for (uint8_t i = 0; i < LINE_COUNT; i++) {
+    cache_line_t const* line = &_cache.line[i];
+    if (line->used && line->lun == lun && line->addr == line_addr) {
+      return i;
+    }
+  }
+  return LINE_NONE;
+}
+
+// Unused line first, then least recently used clean line, then least recently used line
+static uint8_t line_victim(void) {
+  uint8_t victim = LINE_NONE;
+  bool victim_clean = false;
+
+  for (uint8_t i = 0; i < LINE_COUNT; i++) {
+    cache_line_t const* line = &_cache.line[i];
+    if (!line->used) {
+      return i;
+    }
+
+    bool const clean = !line->dirty;
+    if (victim == LINE_NONE || (clean && !victim_clean) ||
+        (clean == victim_clean && (int32_t) (line->age - _cache.line[victim].age) < 0)) {
+      victim = i;
+      victim_clean = clean;
+    }
+  }
+
+  return victim;
+}
+
+// Read line from media after its valid part. Return 1 if done, TUD_MSC_RET_BUSY (progress is kept) or TUD_MSC_RET_ERROR
+static int32_t line_fill(uint8_t idx) {
+  cache_line_t* line = &_cache.line[idx];
+
+  while (line->filled < LINE_SIZE) {
+    uint64_t const addr = line->addr + line->filled;
+    int32_t result = mscd_media_read(line->lun, addr / line->block_size, (uint32_t) (addr % line->block_size),
+                                     _cache_data[idx] + line->filled, LINE_SIZE - line->filled);
+
+    if (result == TUD_MSC_RET_ASYNC) {
+      TU_LOG_DRV("  MSC cache does not support async read\r\n");
+      result = TUD_MSC_RET_ERROR;
+    }
+
+    if (result < 0) {
+      // host data of a dirty line is kept
+      if (!line->dirty) {
+        line->used = false;
+      }
+      return TUD_MSC_RET_ERROR;
+    } else if (result == 0) {
+      return TUD_MSC_RET_BUSY;
+    }
+
+    line->filled += tu_min32((uint32_t) result, LINE_SIZE - line->filled);
+  }
+
+  return 1;
+}
+
+// Program whole line to media. Return 1 if done, TUD_MSC_RET_BUSY (progress is kept) or TUD_MSC_RET_ERROR
+static int32_t line_flush(uint8_t idx) {
+  cache_line_t* line = &_cache.line[idx];
+
+  if (!line->used || !line->dirty) {
+    return 1;
+  }
+
+  // host wrote only the start of the line: rest is read from media first
+  int32_t result = line_fill(idx);
+  if (result <= 0) {
+    return result;
+  }
+
+  if (line->flushed == 0) {
+    line->flush_start = tusb_time_millis_api();
+  }
+
+  while (line->flushed < LINE_SIZE) {
+    uint64_t const addr = line->addr + line->flushed;
+    result = mscd_media_write(line->lun, addr / line->block_size, (uint32_t) (addr % line->block_size),
+                                      _cache_data[idx] + line->flushed, LINE_SIZE - line->flushed);
+
+    if (result == TUD_MSC_RET_ASYNC) {
+      TU_LOG_DRV("  MSC cache does not support async write\r\n");
+      result = TUD_MSC_RET_ERROR;
+    }
+
+    if (result < 0) {
+      // media failed: line stays dirty so that data is not lost silently, whole line is programmed again on retry.
+      // Sense = Medium error, write error unless set by callback
+      line->flushed = 0;
+      if (!mscd_sense_is_set(line->lun)) {
+        tud_msc_set_sense(line->lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00);
+      }
+      return TUD_MSC_RET_ERROR;
+    } else if (result == 0) {
+      return TUD_MSC_RET_BUSY;
+    }
+
+    line->flushed += tu_min32((uint32_t) result, LINE_SIZE - line->flushed);
+  }
+
+  uint32_t const duration = tusb_time_millis_api() - line->flush_start;
+  tud_msc_cache_stats_t* stats = &_cache.stats;
+  stats->media_write_bytes += LINE_SIZE;
+  stats->flush_count++;
+  stats->flush_ms_total += duration;
+  stats->flush_ms_max = tu_max32(stats->flush_ms_max, duration);
+
+  line->dirty   = false;
+  line->flushed = 0;
+  return 1;
+}
+
+// Get line holding addr, evicting as needed. Line is filled from media unless fill is false, then only the part
+// already valid can be used. Return 1 with line index, TUD_MSC_RET_BUSY or TUD_MSC_RET_ERROR
+static int32_t line_get(uint8_t lun, uint16_t block_size, uint64_t addr, bool fill, uint8_t* p_idx) {
+  uint64_t const line_addr = addr - (addr % LINE_SIZE);
+  uint8_t idx = line_find(lun, line_addr);
+
+  if (idx == LINE_NONE) {
+    idx = line_victim();
+
+    int32_t const result = line_flush(idx);
+    if (result <= 0) {
+      return result;
+    }
+
+    cache_line_t* line = &_cache.line[idx];
+    line->addr       = line_addr;
+    line->lun        = lun;
+    line->block_size = block_size;
+    line->used       = true;
+    line->dirty      = false;
+    line->filled     = 0;
+    line->flushed    = 0;
+  }
+
+  if (fill) {
+    int32_t const result = line_fill(idx);
+    if (result <= 0) {
+      return result;
+    }
+  }
+
+  _cache.line[idx].age = ++_cache.age;
+  *p_idx = idx;
+  return 1;
+}
+
+// Read-ahead in usbd task, after current data is queued on the wire
+static void cache_prefetch(void* param) {
+  (void) param;
+
+  if (!_cache.pf_pending) {
+    return;
+  }
+  _cache.pf_pending = false;
+
+  // only evict clean lines, programming media is left to demand
+  uint8_t const victim = line_victim();
+  if (line_find(_cache.pf_lun, _cache.pf_addr) != LINE_NONE || _cache.line[victim].dirty) {
+    return;
+  }
+
+  // skip beyond end of media
+  uint64_t block_count;
+  uint16_t block_size;
+  if (!mscd_capacity(_cache.pf_lun, &block_count, &block_size) ||
+      _cache.pf_addr + LINE_SIZE > block_count * block_size) {
+    return;
+  }
+
+  uint8_t idx;
+  if (line_get(_cache.pf_lun, _cache.pf_block_size, _cache.pf_addr, true, &idx) > 0) {
+    _cache.stats.prefetch++;
+  }
+}
+
+#if CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS
+// Program dirty lines in usbd task once host stopped writing
+static void cache_idle_flush(void* param) {
+  (void) param;
+  bool busy = false;
+
+  _cache.idle_queued = false;
+  if (_cache.idle_ms < CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS) {
+    return; // host wrote again in the meantime
+  }
+
+  for (uint8_t i = 0; i < LINE_COUNT; i++) {
+    if (line_flush(i) == TUD_MSC_RET_BUSY) {
+      busy = true;
+    }
+  }
+
+  if (busy) {
+    // media busy: try again after another idle period
+    _cache.idle_ms = 0;
+  } else {
+    // failed lines stay dirty, they are programmed again on next write, eviction or SYNCHRONIZE CACHE
+    _cache.idle_armed = false;
+    usbd_sof_enable(0, SOF_CONSUMER_MSC_CACHE, false);
+  }
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Internal API
+//--------------------------------------------------------------------+
+void mscd_cache_init(void) {
+  tu_memclr(&_cache, sizeof(_cache));
+}
+
+void mscd_cache_sof(uint32_t frame_count) {
+#if CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS
+  // SOF may be raised per microframe: count frame number changes as ms
+  if (!_cache.idle_armed || frame_count == _cache.idle_frame) {
+    return;
+  }
+  _cache.idle_frame = frame_count;
+
+  if (_cache.idle_ms < UINT16_MAX) {
+    _cache.idle_ms++;
+  }
+
+  if (_cache.idle_ms >= CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS && !_cache.idle_queued) {
+    _cache.idle_queued = true;
+    usbd_defer_func(cache_idle_flush, NULL, true);
+  }
+#else
+  (void) frame_count;
+#endif
+}
+
+int32_t mscd_cache_read(uint8_t lun, uint16_t block_size, uint64_t addr, uint8_t* buffer, uint32_t bufsize) {
+  if (LINE_SIZE % block_size) {
+    return mscd_media_read(lun, addr / block_size, (uint32_t) (addr % block_size), buffer, bufsize);
+  }
+
+  uint64_t const line_addr = addr - (addr % LINE_SIZE);
+  uint8_t idx = line_find(lun, line_addr);
+  bool const hit = (idx != LINE_NONE) && (_cache.line[idx].filled == LINE_SIZE);
+
+  int32_t const result = line_get(lun, block_size, addr, true, &idx);
+  if (result <= 0) {
+    return result;
+  }
+
+  if (hit) {
+    _cache.stats.read_hit++;
+  } else {
+    _cache.stats.read_miss++;
+  }
+
+  uint32_t const offset = (uint32_t) (addr - line_addr);
+  uint32_t const nbytes = tu_min32(bufsize, LINE_SIZE - offset);
+  memcpy(buffer, _cache_data[idx] + offset, nbytes);
+
+  // sequential access: fill next line while this data is on the wire
+  if ((LINE_COUNT > 1) && (addr == _cache.next_addr[lun]) && !_cache.pf_pending &&
+      (line_find(lun, line_addr + LINE_SIZE) == LINE_NONE)) {
+    _cache.pf_pending     = true;
+    _cache.pf_lun         = lun;
+    _cache.pf_block_size  = block_size;
+    _cache.pf_addr        = line_addr + LINE_SIZE;
+    usbd_defer_func(cache_prefetch, NULL, false);
+  }
+  _cache.next_addr[lun] = addr + nbytes;
+
+  return (int32_t) nbytes;
+}
+
+int32_t mscd_cache_write(uint8_t lun, uint16_t block_size, uint64_t addr, uint8_t const* buffer, uint32_t bufsize) {
+  if (LINE_SIZE % block_size) {
+    return mscd_media_write(lun, addr / block_size, (uint32_t) (addr % block_size), (uint8_t*) (uintptr_t) buffer,
+                            bufsize);
+  }
+
+  uint32_t const offset = (uint32_t) (addr % LINE_SIZE);
+
+  uint8_t idx;
+  int32_t result = line_get(lun, block_size, addr, false, &idx);
+  if (result <= 0) {
+    return result;
+  }
+
+  // Host data contiguous to the valid part extends it without reading media, e.g a line written sequentially in
+  // endpoint buffer sized chunks is never read. Rest of the line is read before a gap is written or line is flushed
+  cache_line_t* line = &_cache.line[idx];
+  if (offset > line->filled) {
+    result = line_fill(idx);
+    if (result <= 0) {
+      return result;
+    }
+  }
+
+  uint32_t const nbytes = tu_min32(bufsize, LINE_SIZE - offset);
+  memcpy(_cache_data[idx] + offset, buffer, nbytes);
+  line->filled = tu_max32(line->filled, offset + nbytes);
+  line->dirty  = true;
+  _cache.stats.host_write_bytes += nbytes;
+
+  #if CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS
+  // restart idle time, SOF may have been disabled by bus reset in the meantime
+  _cache.idle_ms    = 0;
+  _cache.idle_armed = true;
+  usbd_sof_enable(0, SOF_CONSUMER_MSC_CACHE, true);
+  #endif
+
+  return (int32_t) nbytes;
+}
+
+int32_t mscd_cache_sync(uint8_t lun) {
+  for (uint8_t i = 0; i < LINE_COUNT; i++) {
+    if (_cache.line[i].lun == lun) {
+      int32_t const result = line_flush(i);
+      if (result <= 0) {
+        return result;
+      }
+    }
+  }
+  return 1;
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tud_msc_cache_flush(uint8_t lun) {
+  return mscd_cache_sync(lun) > 0;
+}
+
+void tud_msc_cache_invalidate(uint8_t lun) {
+  for (uint8_t i = 0; i < LINE_COUNT; i++) {
+    if (_cache.line[i].lun == lun) {
+      _cache.line[i].used  = false;
+      _cache.line[i].dirty = false;
+    }
+  }
+
+  if (_cache.pf_lun == lun) {
+    _cache.pf_pending = false;
+  }
+  if (lun < CFG_TUD_MSC_MAXLUN) {
+    _cache.next_addr[lun] = 0;
+  }
+}
+
+void tud_msc_cache_get_stats(tud_msc_cache_stats_t* stats) {
+  *stats = _cache.stats;
+}
+
+void tud_msc_cache_clear_stats(void) {
+  tu_memclr(&_cache.stats, sizeof(_cache.stats));
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_MSC_CACHE_H_
+#define _TUSB_MSC_CACHE_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Optional read-ahead/write-back cache between MSC (BOT and UAS) driver and application read/write callbacks.
+// A cache line is one media erase unit: application callbacks are invoked with whole, aligned lines, host writes
+// smaller than a line are merged in RAM and programmed once when the line is evicted or flushed. Sequential reads
+// fill the next line in usbd task while current data is on the wire.
+//
+// Dirty lines are flushed on SYNCHRONIZE CACHE, START STOP UNIT with eject, tud_msc_cache_flush() and once host has
+// not written for CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS. Application should also flush e.g in tud_umount_cb(). A line that
+// fails to program stays dirty and the failure is reported with MEDIUM ERROR sense. MODE SENSE reports the write
+// cache as enabled. Callbacks must not return TUD_MSC_RET_ASYNC when cache is enabled. Flush statistics are timed
+// with tusb_time_millis_api(), which application must implement.
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+#ifndef CFG_TUD_MSC_CACHE
+  #define CFG_TUD_MSC_CACHE  0
+#endif
+
+#if CFG_TUD_MSC_CACHE
+
+// Size of a cache line in bytes, should be the erase unit of the media and a multiple of block size.
+// Media with a block size which does not divide it bypass the cache.
+#ifndef CFG_TUD_MSC_CACHE_LINE_SIZE
+  #define CFG_TUD_MSC_CACHE_LINE_SIZE   4096
+#endif
+
+// Number of cache lines, read-ahead requires at least 2
+#ifndef CFG_TUD_MSC_CACHE_LINE_COUNT
+  #define CFG_TUD_MSC_CACHE_LINE_COUNT  2
+#endif
+
+// Flush dirty lines once host has not written for this many ms, counted with SOF. 0 to disable
+#ifndef CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS
+  #define CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS  500
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_CACHE_LINE_SIZE >= 512 && CFG_TUD_MSC_CACHE_LINE_SIZE % 512 == 0, "Line size is not correct");
+TU_VERIFY_STATIC(CFG_TUD_MSC_CACHE_LINE_COUNT >= 1 && CFG_TUD_MSC_CACHE_LINE_COUNT <= UINT8_MAX, "Line count is not correct");
+
+typedef struct {
+  uint32_t read_hit;          // read callbacks served from a filled line
+  uint32_t read_miss;         // read callbacks which had to fill a line from media
+  uint32_t prefetch;          // lines filled ahead on sequential read
+  uint64_t host_write_bytes;  // bytes written by host
+  uint64_t media_write_bytes; // bytes programmed to media, write amplification = media / host
+  uint32_t flush_count;       // lines programmed to media
+  uint32_t flush_ms_max;      // longest line program, measured with tusb_time_millis_api()
+  uint32_t flush_ms_total;
+} tud_msc_cache_stats_t;
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Program dirty lines of lun to media, return false if media is busy or failed
+bool tud_msc_cache_flush(uint8_t lun);
+
+// Drop all lines of lun without programming them, e.g after application modified the media directly
+void tud_msc_cache_invalidate(uint8_t lun);
+
+// Get/clear statistics counters
+void tud_msc_cache_get_stats(tud_msc_cache_stats_t* stats);
+void tud_msc_cache_clear_stats(void);
+
+//--------------------------------------------------------------------+
+// Internal API used by MSC driver
+//--------------------------------------------------------------------+
+void    mscd_cache_init  (void);
+
+// Same semantics as read/write callbacks with byte address = lba * block_size + offset
+int32_t mscd_cache_read  (uint8_t lun, uint16_t block_size, uint64_t addr, uint8_t* buffer, uint32_t bufsize);
+int32_t mscd_cache_write (uint8_t lun, uint16_t block_size, uint64_t addr, uint8_t const* buffer, uint32_t bufsize);
+
+// Program dirty lines of lun: return 1 if done, TUD_MSC_RET_BUSY or TUD_MSC_RET_ERROR
+int32_t mscd_cache_sync  (uint8_t lun);
+
+// Invoked by BOT and UAS drivers on SOF in ISR context, for idle flush
+void    mscd_cache_sof   (uint32_t frame_count);
+
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_MSC_CACHE_H_ */
@@ -28,7 +28,6 @@
 
 #if (CFG_TUD_ENABLED && CFG_TUD_MSC)
 
-#include "device/dcd.h"         // for faking dcd_event_xfer_complete
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
 
@@ -52,10 +51,19 @@ enum {
   MSC_STAGE_NEED_RESET,
 };
 
+// Per LUN state
+typedef struct {
+  // Sense Response Data
+  uint8_t sense_key;
+  uint8_t add_sense_code;
+  uint8_t add_sense_qualifier;
+} mscd_lun_t;
+
 typedef struct {
   TU_ATTR_ALIGNED(4) msc_cbw_t cbw;
   TU_ATTR_ALIGNED(4) msc_csw_t csw;
 
+  uint8_t  rhport;
   uint8_t  itf_num;
   uint8_t  ep_in;
   uint8_t  ep_out;
@@ -66,42 +74,69 @@ typedef struct {
   uint32_t total_len;   // byte to be transferred, can be smaller than total_bytes in cbw
   uint32_t xferred_len; // numbered of bytes transferred so far in the Data Stage
 
-  // Sense Response Data
-  uint8_t sense_key;
-  uint8_t add_sense_code;
-  uint8_t add_sense_qualifier;
+  // READ/WRITE (10/16) buffer ring: buffers are filled then sent (read), or received then drained (write) in order
+  uint32_t io_len;       // read: bytes filled by application, write: bytes received from host
+  uint16_t buf_len[CFG_TUD_MSC_EP_BUFCOUNT];
+  uint16_t buf_offset;   // write: bytes of oldest buffer already consumed by application
+  uint8_t  buf_rd;       // oldest buffer holding data
+  uint8_t  buf_count;    // number of buffers holding data, including the one being sent
+  bool     xfer_busy;    // a data buffer is on the wire
+  bool     io_failed;    // callback failed, command is failed once nothing is on the wire
+  bool     async_pending; // callback returned TUD_MSC_RET_ASYNC, waiting for tud_msc_async_io_done()
+  volatile bool parked;   // application not ready and nothing on the wire, callback is retried after park_sof SOFs
+  volatile uint16_t park_sof; // SOFs left before retry
+  uint16_t park_interval;     // retry interval, doubled each time callback is still busy
+
+  mscd_lun_t lun[CFG_TUD_MSC_MAXLUN];
 }mscd_interface_t;
 
 static mscd_interface_t _mscd_itf;
 
+// Buffer 0 is also used for CBW, CSW and data of other commands
 CFG_TUD_MEM_SECTION static struct {
-  TUD_EPBUF_DEF(buf, CFG_TUD_MSC_EP_BUFSIZE);
+  TUD_EPBUF_DEF(buf, CFG_TUD_MSC_EP_BUFSIZE) ring[CFG_TUD_MSC_EP_BUFCOUNT];
 } _mscd_epbuf;
 
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
 static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize);
-static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_read_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_read_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static void proc_read_pump(uint8_t rhport, mscd_interface_t* p_msc, bool ready);
+static bool read_filled(mscd_interface_t* p_msc, int32_t nbytes);
+
+static void proc_write_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_write_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static void proc_write_pump(uint8_t rhport, mscd_interface_t* p_msc, bool ready);
+static bool write_drained(mscd_interface_t* p_msc, int32_t nbytes);
 
-static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
-static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static bool proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc);
 
 TU_ATTR_ALWAYS_INLINE static inline bool is_data_in(uint8_t dir) {
   return tu_bit_test(dir, 7);
 }
 
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* mscd_buf(uint8_t idx) {
+  return _mscd_epbuf.ring[idx].buf;
+}
+
+// lun is verified against CFG_TUD_MSC_MAXLUN when command is received
+TU_ATTR_ALWAYS_INLINE static inline bool sense_is_set(uint8_t lun) {
+  return _mscd_itf.lun[lun].sense_key != 0;
+}
+
 static inline bool send_csw(uint8_t rhport, mscd_interface_t* p_msc) {
   // Data residue is always = host expect - actual transferred
   p_msc->csw.data_residue = p_msc->cbw.total_bytes - p_msc->xferred_len;
   p_msc->stage = MSC_STAGE_STATUS_SENT;
-  memcpy(_mscd_epbuf.buf, &p_msc->csw, sizeof(msc_csw_t));
-  return usbd_edpt_xfer(rhport, p_msc->ep_in , _mscd_epbuf.buf, sizeof(msc_csw_t));
+  memcpy(mscd_buf(0), &p_msc->csw, sizeof(msc_csw_t));
+  return usbd_edpt_xfer(rhport, p_msc->ep_in , mscd_buf(0), sizeof(msc_csw_t));
 }
 
 static inline bool prepare_cbw(uint8_t rhport, mscd_interface_t* p_msc) {
   p_msc->stage = MSC_STAGE_CMD;
-  return usbd_edpt_xfer(rhport, p_msc->ep_out,  _mscd_epbuf.buf, sizeof(msc_cbw_t));
+  return usbd_edpt_xfer(rhport, p_msc->ep_out,  mscd_buf(0), sizeof(msc_cbw_t));
 }
 
 static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status) {
@@ -113,7 +148,7 @@ static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status
   p_msc->stage        = MSC_STAGE_STATUS;
 
   // failed but sense key is not set: default to Illegal Request
-  if (p_msc->sense_key == 0) {
+  if (!sense_is_set(p_cbw->lun)) {
     tud_msc_set_sense(p_cbw->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
   }
 
@@ -127,29 +162,32 @@ static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status
   }
 }
 
-static inline uint32_t rdwr10_get_lba(uint8_t const command[]) {
-  // use offsetof to avoid pointer to the odd/unaligned address
-  const uint32_t lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
-  return tu_ntohl(lba); // lba is in Big Endian
+static void rdwr_ring_reset(mscd_interface_t* p_msc) {
+  p_msc->io_len     = 0;
+  p_msc->buf_offset = 0;
+  p_msc->buf_rd     = 0;
+  p_msc->buf_count  = 0;
+  p_msc->xfer_busy  = false;
+  p_msc->io_failed  = false;
 }
 
-static inline uint16_t rdwr10_get_blockcount(msc_cbw_t const* cbw) {
-  uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
-  return tu_ntohs(block_count);
+// Buffer to be filled (read) or received into (write) next
+TU_ATTR_ALWAYS_INLINE static inline uint8_t rdwr_buf_next(mscd_interface_t const* p_msc) {
+  return (uint8_t) ((p_msc->buf_rd + p_msc->buf_count) % CFG_TUD_MSC_EP_BUFCOUNT);
 }
 
-static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw) {
+static inline uint16_t rdwr_get_blocksize(msc_cbw_t const* cbw) {
   // first extract block count in the command
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = mscd_rdwr_blockcount(cbw->command);
   if (block_count == 0) {
     return 0; // invalid block count
   }
   return (uint16_t) (cbw->total_bytes / block_count);
 }
 
-static uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw) {
+static uint8_t rdwr_validate_cmd(msc_cbw_t const* cbw) {
   uint8_t status = MSC_CSW_STATUS_PASSED;
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = mscd_rdwr_blockcount(cbw->command);
 
   if (cbw->total_bytes == 0) {
     if (block_count) {
@@ -159,16 +197,16 @@ static uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw) {
       // no data transfer, only exist in complaint test suite
     }
   } else {
-    if (SCSI_CMD_READ_10 == cbw->command[0] && !is_data_in(cbw->dir)) {
+    if (mscd_is_read_cmd(cbw->command[0]) && !is_data_in(cbw->dir)) {
       TU_LOG_DRV("  SCSI case 10 (Ho <> Di)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
-    } else if (SCSI_CMD_WRITE_10 == cbw->command[0] && is_data_in(cbw->dir)) {
+    } else if (mscd_is_write_cmd(cbw->command[0]) && is_data_in(cbw->dir)) {
       TU_LOG_DRV("  SCSI case 8 (Hi <> Do)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     } else if (0 == block_count) {
       TU_LOG_DRV("  SCSI case 4 Hi > Dn (READ10) or case 9 Ho > Dn (WRITE10) \r\n");
       status = MSC_CSW_STATUS_FAILED;
-    } else if (cbw->total_bytes / block_count == 0) {
+    } else if (cbw->total_bytes / block_count == 0 || cbw->total_bytes / block_count > UINT16_MAX) {
       TU_LOG_DRV(" Computed block size = 0. SCSI case 7 Hi < Di (READ10) or case 13 Ho < Do (WRIT10)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
@@ -193,7 +231,12 @@ TU_ATTR_UNUSED tu_static tu_lookup_entry_t const _msc_scsi_cmd_lookup[] = {
   { .key = SCSI_CMD_REQUEST_SENSE                , .data = "Request Sense" },
   { .key = SCSI_CMD_READ_FORMAT_CAPACITY         , .data = "Read Format Capacity" },
   { .key = SCSI_CMD_READ_10                      , .data = "Read10" },
-  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" }
+  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" },
+  { .key = SCSI_CMD_READ_16                      , .data = "Read16" },
+  { .key = SCSI_CMD_WRITE_16                     , .data = "Write16" },
+  { .key = SCSI_CMD_SERVICE_ACTION_IN_16         , .data = "Service Action In16" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_10         , .data = "Synchronize Cache10" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_16         , .data = "Synchronize Cache16" }
 };
 
 TU_ATTR_UNUSED tu_static tu_lookup_table_t const _msc_scsi_cmd_table = {
@@ -207,10 +250,11 @@ TU_ATTR_UNUSED tu_static tu_lookup_table_t const _msc_scsi_cmd_table = {
 // APPLICATION API
 //--------------------------------------------------------------------+
 bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, uint8_t add_sense_qualifier) {
-  (void) lun;
-  _mscd_itf.sense_key           = sense_key;
-  _mscd_itf.add_sense_code      = add_sense_code;
-  _mscd_itf.add_sense_qualifier = add_sense_qualifier;
+  TU_VERIFY(lun < CFG_TUD_MSC_MAXLUN);
+  mscd_lun_t* p_lun = &_mscd_itf.lun[lun];
+  p_lun->sense_key           = sense_key;
+  p_lun->add_sense_code      = add_sense_code;
+  p_lun->add_sense_qualifier = add_sense_qualifier;
   return true;
 }
 
@@ -219,11 +263,76 @@ static inline void set_sense_medium_not_present(uint8_t lun) {
   tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
 }
 
+// Resume READ/WRITE in usbd task after an async callback completes
+static void proc_async_io_done(void* param) {
+  mscd_interface_t* p_msc = &_mscd_itf;
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+  int32_t const nbytes = (int32_t) (intptr_t) param;
+
+  // command may be aborted by bus/BOT reset in the meantime
+  if (!p_msc->async_pending) {
+    return;
+  }
+  p_msc->async_pending = false;
+
+  if (p_msc->stage == MSC_STAGE_DATA) {
+    if (mscd_is_read_cmd(p_cbw->command[0])) {
+      proc_read_pump(p_msc->rhport, p_msc, read_filled(p_msc, nbytes));
+    } else if (mscd_is_write_cmd(p_cbw->command[0])) {
+      proc_write_pump(p_msc->rhport, p_msc, write_drained(p_msc, nbytes));
+    }
+  }
+
+  proc_stage_status(p_msc->rhport, p_msc);
+}
+
+// Retry callback of a parked READ/WRITE in usbd task
+static void proc_parked_retry(void* param) {
+  (void) param;
+  mscd_interface_t* p_msc = &_mscd_itf;
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+
+  if (p_msc->stage == MSC_STAGE_DATA) {
+    if (mscd_is_read_cmd(p_cbw->command[0])) {
+      proc_read_pump(p_msc->rhport, p_msc, true);
+    } else if (mscd_is_write_cmd(p_cbw->command[0])) {
+      proc_write_pump(p_msc->rhport, p_msc, true);
+    }
+  }
+
+  // still not ready: keep SOF enabled for next retry
+  if (!p_msc->parked) {
+    p_msc->park_interval = 0;
+    usbd_sof_enable(p_msc->rhport, SOF_CONSUMER_MSC, false);
+  }
+
+  proc_stage_status(p_msc->rhport, p_msc);
+}
+
+// Application is not ready and nothing is on the wire: wait for SOF instead of spinning usbd task, backing off
+// exponentially while application stays busy
+static void park(uint8_t rhport, mscd_interface_t* p_msc) {
+  uint32_t const interval = p_msc->park_interval ? 2u * p_msc->park_interval : 1u;
+  p_msc->park_interval = (uint16_t) tu_min32(interval, CFG_TUD_MSC_BUSY_RETRY_MAX);
+  p_msc->park_sof = p_msc->park_interval;
+  p_msc->parked = true;
+  usbd_sof_enable(rhport, SOF_CONSUMER_MSC, true);
+}
+
+bool tud_msc_async_io_done(int32_t bytes_io, bool in_isr) {
+  TU_VERIFY(_mscd_itf.async_pending);
+  usbd_defer_func(proc_async_io_done, (void*) (intptr_t) bytes_io, in_isr);
+  return true;
+}
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
 void mscd_init(void) {
   tu_memclr(&_mscd_itf, sizeof(mscd_interface_t));
+  #if CFG_TUD_MSC_CACHE
+  mscd_cache_init();
+  #endif
 }
 
 bool mscd_deinit(void) {
@@ -231,10 +340,28 @@ bool mscd_deinit(void) {
 }
 
 void mscd_reset(uint8_t rhport) {
-  (void) rhport;
+  if (_mscd_itf.parked) {
+    usbd_sof_enable(rhport, SOF_CONSUMER_MSC, false);
+  }
   tu_memclr(&_mscd_itf, sizeof(mscd_interface_t));
 }
 
+// SOF handler in ISR context
+void mscd_sof(uint8_t rhport, uint8_t port_num, uint32_t frame_count) {
+  (void) rhport;
+  (void) port_num;
+  (void) frame_count;
+
+  #if CFG_TUD_MSC_CACHE
+  mscd_cache_sof(frame_count);
+  #endif
+
+  if (_mscd_itf.parked && --_mscd_itf.park_sof == 0) {
+    _mscd_itf.parked = false;
+    usbd_defer_func(proc_parked_retry, NULL, true);
+  }
+}
+
 uint16_t mscd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len) {
   // only support SCSI's BOT protocol
   TU_VERIFY(TUSB_CLASS_MSC    == itf_desc->bInterfaceClass &&
@@ -244,6 +371,7 @@ uint16_t mscd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(max_len >= drv_len, 0); // Max length must be at least 1 interface + 2 endpoints
 
   mscd_interface_t * p_msc = &_mscd_itf;
+  p_msc->rhport  = rhport;
   p_msc->itf_num = itf_desc->bInterfaceNumber;
 
   // Open endpoint pair
@@ -259,9 +387,15 @@ static void proc_bot_reset(mscd_interface_t* p_msc) {
   p_msc->stage       = MSC_STAGE_CMD;
   p_msc->total_len   = 0;
   p_msc->xferred_len = 0;
-  p_msc->sense_key           = 0;
-  p_msc->add_sense_code      = 0;
-  p_msc->add_sense_qualifier = 0;
+  p_msc->async_pending = false;
+  tu_memclr(p_msc->lun, sizeof(p_msc->lun));
+  rdwr_ring_reset(p_msc);
+
+  if (p_msc->parked) {
+    p_msc->parked = false;
+    usbd_sof_enable(p_msc->rhport, SOF_CONSUMER_MSC, false);
+  }
+  p_msc->park_interval = 0;
 }
 
 // Invoked when a control transfer occurred on an interface of this class
@@ -325,6 +459,10 @@ bool mscd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
         maxlun = tud_msc_get_maxlun_cb();
       }
       TU_VERIFY(maxlun);
+      if (maxlun > CFG_TUD_MSC_MAXLUN) {
+        TU_LOG_DRV("  MSC only %u LUNs supported, increase CFG_TUD_MSC_MAXLUN\r\n", CFG_TUD_MSC_MAXLUN);
+        maxlun = CFG_TUD_MSC_MAXLUN;
+      }
       maxlun--; // MAX LUN is minus 1 by specs
       tud_control_xfer(rhport, request, &maxlun, 1);
       break;
@@ -351,9 +489,11 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         return true;
       }
 
-      const uint32_t signature = tu_le32toh(tu_unaligned_read32(_mscd_epbuf.buf));
+      const uint32_t signature = tu_le32toh(tu_unaligned_read32(mscd_buf(0)));
 
-      if (!(xferred_bytes == sizeof(msc_cbw_t) && signature == MSC_CBW_SIGNATURE)) {
+      // LUN beyond CFG_TUD_MSC_MAXLUN is not reported by GET_MAX_LUN, CBW is not meaningful
+      if (!(xferred_bytes == sizeof(msc_cbw_t) && signature == MSC_CBW_SIGNATURE &&
+            ((msc_cbw_t const*) mscd_buf(0))->lun < CFG_TUD_MSC_MAXLUN)) {
         // BOT 6.6.1 If CBW is not valid stall both endpoints until reset recovery
         TU_LOG_DRV("  SCSI CBW is not valid\r\n");
         p_msc->stage = MSC_STAGE_NEED_RESET;
@@ -362,7 +502,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         return false;
       }
 
-      memcpy(p_cbw, _mscd_epbuf.buf, sizeof(msc_cbw_t));
+      memcpy(p_cbw, mscd_buf(0), sizeof(msc_cbw_t));
 
       TU_LOG_DRV("  SCSI Command [Lun%u]: %s\r\n", p_cbw->lun, tu_lookup_find(&_msc_scsi_cmd_table, p_cbw->command[0]));
       // TU_LOG_MEM(p_cbw, xferred_bytes, 2);
@@ -376,18 +516,19 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
       p_msc->stage = MSC_STAGE_DATA;
       p_msc->total_len = p_cbw->total_bytes;
       p_msc->xferred_len = 0;
+      rdwr_ring_reset(p_msc);
 
-      // Read10 or Write10
-      if ((SCSI_CMD_READ_10 == p_cbw->command[0]) || (SCSI_CMD_WRITE_10 == p_cbw->command[0])) {
-        uint8_t const status = rdwr10_validate_cmd(p_cbw);
+      // Read or Write (10/16)
+      if (mscd_is_read_cmd(p_cbw->command[0]) || mscd_is_write_cmd(p_cbw->command[0])) {
+        uint8_t const status = rdwr_validate_cmd(p_cbw);
 
         if (status != MSC_CSW_STATUS_PASSED) {
           fail_scsi_op(rhport, p_msc, status);
         } else if (p_cbw->total_bytes) {
-          if (SCSI_CMD_READ_10 == p_cbw->command[0]) {
-            proc_read10_cmd(rhport, p_msc);
+          if (mscd_is_read_cmd(p_cbw->command[0])) {
+            proc_read_cmd(rhport, p_msc);
           } else {
-            proc_write10_cmd(rhport, p_msc);
+            proc_write_cmd(rhport, p_msc);
           }
         } else {
           // no data transfer, only exist in complaint test suite
@@ -399,20 +540,20 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // 2. IN & Zero: Process if is built-in, else Invoke app callback. Skip DATA if zero length
         if ((p_cbw->total_bytes > 0) && !is_data_in(p_cbw->dir)) {
           if (p_cbw->total_bytes > CFG_TUD_MSC_EP_BUFSIZE) {
-            TU_LOG_DRV("  SCSI reject non READ10/WRITE10 with large data\r\n");
+            TU_LOG_DRV("  SCSI reject non READ/WRITE with large data\r\n");
             fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
           } else {
             // Didn't check for case 9 (Ho > Dn), which requires examining scsi command first
             // but it is OK to just receive data then responded with failed status
-            TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_epbuf.buf, (uint16_t) p_msc->total_len));
+            TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_out, mscd_buf(0), (uint16_t) p_msc->total_len));
           }
         } else {
           // First process if it is a built-in commands
-          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, CFG_TUD_MSC_EP_BUFSIZE);
+          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, mscd_buf(0), CFG_TUD_MSC_EP_BUFSIZE);
 
           // Invoke user callback if not built-in
-          if ((resplen < 0) && (p_msc->sense_key == 0)) {
-            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, (uint16_t)p_msc->total_len);
+          if ((resplen < 0) && !sense_is_set(p_cbw->lun)) {
+            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, mscd_buf(0), (uint16_t)p_msc->total_len);
           }
 
           if (resplen < 0) {
@@ -436,7 +577,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
             } else {
               // cannot return more than host expect
               p_msc->total_len = tu_min32((uint32_t)resplen, p_cbw->total_bytes);
-              TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_epbuf.buf, (uint16_t) p_msc->total_len));
+              TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_in, mscd_buf(0), (uint16_t) p_msc->total_len));
             }
           }
         }
@@ -446,25 +587,18 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
     case MSC_STAGE_DATA:
       TU_LOG_DRV("  SCSI Data [Lun%u]\r\n", p_cbw->lun);
       TU_ASSERT(xferred_bytes <= CFG_TUD_MSC_EP_BUFSIZE); // sanity check to avoid buffer overflow
-      // TU_LOG_MEM(_mscd_epbuf.buf, xferred_bytes, 2);
+      // TU_LOG_MEM(mscd_buf(0), xferred_bytes, 2);
 
-      if (SCSI_CMD_READ_10 == p_cbw->command[0]) {
-        p_msc->xferred_len += xferred_bytes;
-
-        if ( p_msc->xferred_len >= p_msc->total_len ) {
-          // Data Stage is complete
-          p_msc->stage = MSC_STAGE_STATUS;
-        }else {
-          proc_read10_cmd(rhport, p_msc);
-        }
-      } else if (SCSI_CMD_WRITE_10 == p_cbw->command[0]) {
-        proc_write10_new_data(rhport, p_msc, xferred_bytes);
+      if (mscd_is_read_cmd(p_cbw->command[0])) {
+        proc_read_xfer_done(rhport, p_msc, xferred_bytes);
+      } else if (mscd_is_write_cmd(p_cbw->command[0])) {
+        proc_write_new_data(rhport, p_msc, xferred_bytes);
       } else {
         p_msc->xferred_len += xferred_bytes;
 
         // OUT transfer, invoke callback if needed
         if ( !is_data_in(p_cbw->dir) ) {
-          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, (uint16_t) p_msc->total_len);
+          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, mscd_buf(0), (uint16_t) p_msc->total_len);
 
           if ( cb_result < 0 ) {
             // unsupported command
@@ -500,12 +634,14 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // if complete_cb() is invoked after queuing the status.
         switch (p_cbw->command[0]) {
           case SCSI_CMD_READ_10:
+          case SCSI_CMD_READ_16:
             if (tud_msc_read10_complete_cb) {
               tud_msc_read10_complete_cb(p_cbw->lun);
             }
             break;
 
           case SCSI_CMD_WRITE_10:
+          case SCSI_CMD_WRITE_16:
             if (tud_msc_write10_complete_cb) {
               tud_msc_write10_complete_cb(p_cbw->lun);
             }
@@ -528,6 +664,13 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
     default: break;
   }
 
+  return proc_stage_status(rhport, p_msc);
+}
+
+// Send CSW if Data Stage is complete
+static bool proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc) {
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+
   if (p_msc->stage == MSC_STAGE_STATUS) {
     // skip status if epin is currently stalled, will do it when received Clear Stall request
     if (!usbd_edpt_stalled(rhport, p_msc->ep_in)) {
@@ -558,14 +701,134 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
 /* SCSI Command Process
  *------------------------------------------------------------------*/
 
+static void sense_fill(mscd_lun_t const* p_lun, scsi_sense_fixed_resp_t* sense_rsp) {
+  tu_memclr(sense_rsp, sizeof(scsi_sense_fixed_resp_t));
+  sense_rsp->response_code = 0x70; // current, fixed format
+  sense_rsp->valid = 1;
+
+  sense_rsp->add_sense_len = sizeof(scsi_sense_fixed_resp_t) - 8;
+  sense_rsp->sense_key = (uint8_t)(p_lun->sense_key & 0x0F);
+  sense_rsp->add_sense_code = p_lun->add_sense_code;
+  sense_rsp->add_sense_qualifier = p_lun->add_sense_qualifier;
+}
+
+int32_t mscd_scsi_cmd(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize) {
+  // First process if it is a built-in commands
+  int32_t resplen = proc_builtin_scsi(lun, scsi_cmd, buffer, bufsize);
+
+  // Invoke user callback if not built-in
+  if ((resplen < 0) && !sense_is_set(lun)) {
+    resplen = tud_msc_scsi_cb(lun, scsi_cmd, buffer, (uint16_t) bufsize);
+  }
+
+  return resplen;
+}
+
+bool mscd_sense_is_set(uint8_t lun) {
+  return (lun < CFG_TUD_MSC_MAXLUN) && sense_is_set(lun);
+}
+
+bool mscd_sense_read(uint8_t lun, scsi_sense_fixed_resp_t* sense_rsp) {
+  bool const has_sense = sense_is_set(lun);
+
+  sense_fill(&_mscd_itf.lun[lun], sense_rsp);
+  tud_msc_set_sense(lun, 0, 0, 0);
+
+  return has_sense;
+}
+
+#if CFG_TUD_MSC_CACHE
+// Program cached data of lun, sense is set if media is busy or failed
+static bool cache_sync(uint8_t lun) {
+  int32_t const result = mscd_cache_sync(lun);
+
+  if (result == TUD_MSC_RET_BUSY) {
+    // Sense = Not ready, in process of becoming ready: host retries later
+    tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x04, 0x01);
+  } else if (result < 0) {
+    // Sense = Medium error, write error
+    tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00);
+  }
+
+  return result > 0;
+}
+#endif
+
+bool mscd_capacity(uint8_t lun, uint64_t* block_count, uint16_t* block_size) {
+  *block_count = 0;
+  *block_size  = 0;
+
+  if (tud_msc_capacity16_cb) {
+    tud_msc_capacity16_cb(lun, block_count, block_size);
+  } else {
+    uint32_t block_count_u32 = 0;
+    tud_msc_capacity_cb(lun, &block_count_u32, block_size);
+    *block_count = block_count_u32;
+  }
+
+  if (*block_count == 0 || *block_size == 0) {
+    // set default sense if not set by callback
+    if (!sense_is_set(lun)) {
+      set_sense_medium_not_present(lun);
+    }
+    return false;
+  }
+
+  return true;
+}
+
+int32_t mscd_read_cb(uint8_t lun, uint16_t block_size, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+#if CFG_TUD_MSC_CACHE
+  return mscd_cache_read(lun, block_size, lba * block_size + offset, (uint8_t*) buffer, bufsize);
+#else
+  (void) block_size;
+  return mscd_media_read(lun, lba, offset, buffer, bufsize);
+#endif
+}
+
+int32_t mscd_write_cb(uint8_t lun, uint16_t block_size, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+#if CFG_TUD_MSC_CACHE
+  return mscd_cache_write(lun, block_size, lba * block_size + offset, buffer, bufsize);
+#else
+  (void) block_size;
+  return mscd_media_write(lun, lba, offset, buffer, bufsize);
+#endif
+}
+
+int32_t mscd_media_read(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  if (tud_msc_read16_cb) {
+    return tud_msc_read16_cb(lun, lba, offset, buffer, bufsize);
+  }
+
+  if (lba > UINT32_MAX) {
+    // Sense = LBA out of range
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+    return TUD_MSC_RET_ERROR;
+  }
+
+  return tud_msc_read10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+int32_t mscd_media_write(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  if (tud_msc_write16_cb) {
+    return tud_msc_write16_cb(lun, lba, offset, buffer, bufsize);
+  }
+
+  if (lba > UINT32_MAX) {
+    // Sense = LBA out of range
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+    return TUD_MSC_RET_ERROR;
+  }
+
+  return tud_msc_write10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
 // return response's length (copied to buffer). Negative if it is not an built-in command or indicate Failed status (CSW)
 // In case of a failed status, sense key must be set for reason of failure
 static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize) {
   (void)bufsize; // TODO refractor later
   int32_t resplen;
 
-  mscd_interface_t* p_msc = &_mscd_itf;
-
   switch (scsi_cmd[0]) {
     case SCSI_CMD_TEST_UNIT_READY:
       resplen = 0;
@@ -574,28 +837,37 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
         resplen = -1;
 
         // set default sense if not set by callback
-        if (p_msc->sense_key == 0) {
+        if (!sense_is_set(lun)) {
           set_sense_medium_not_present(lun);
         }
       }
       break;
 
-    case SCSI_CMD_START_STOP_UNIT:
+    case SCSI_CMD_START_STOP_UNIT: {
+      scsi_start_stop_unit_t const* start_stop = (scsi_start_stop_unit_t const*)scsi_cmd;
       resplen = 0;
 
+      #if CFG_TUD_MSC_CACHE
+      // program cached data before medium is ejected
+      if (start_stop->load_eject && !start_stop->start && !cache_sync(lun)) {
+        resplen = -1;
+        break;
+      }
+      #endif
+
       if (tud_msc_start_stop_cb) {
-        scsi_start_stop_unit_t const* start_stop = (scsi_start_stop_unit_t const*)scsi_cmd;
         if (!tud_msc_start_stop_cb(lun, start_stop->power_condition, start_stop->start, start_stop->load_eject)) {
           // Failed status response
           resplen = -1;
 
           // set default sense if not set by callback
-          if (p_msc->sense_key == 0) {
+          if (!sense_is_set(lun)) {
             set_sense_medium_not_present(lun);
           }
         }
       }
-      break;
+    }
+    break;
 
     case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
       resplen = 0;
@@ -607,7 +879,7 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
           resplen = -1;
 
           // set default sense if not set by callback
-          if (p_msc->sense_key == 0) {
+          if (!sense_is_set(lun)) {
             set_sense_medium_not_present(lun);
           }
         }
@@ -616,27 +888,19 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 
 
     case SCSI_CMD_READ_CAPACITY_10: {
-      uint32_t block_count;
-      uint32_t block_size;
-      uint16_t block_size_u16;
-
-      tud_msc_capacity_cb(lun, &block_count, &block_size_u16);
-      block_size = (uint32_t)block_size_u16;
+      uint64_t block_count;
+      uint16_t block_size;
 
       // Invalid block size/count from callback, possibly unit is not ready
       // stall this request, set sense key to NOT READY
-      if (block_count == 0 || block_size == 0) {
+      if (!mscd_capacity(lun, &block_count, &block_size)) {
         resplen = -1;
-
-        // set default sense if not set by callback
-        if (p_msc->sense_key == 0) {
-          set_sense_medium_not_present(lun);
-        }
       } else {
         scsi_read_capacity10_resp_t read_capa10;
 
-        read_capa10.last_lba = tu_htonl(block_count-1);
-        read_capa10.block_size = tu_htonl(block_size);
+        // last LBA does not fit: host should use READ CAPACITY (16)
+        read_capa10.last_lba = tu_htonl((block_count - 1 > UINT32_MAX) ? UINT32_MAX : (uint32_t) (block_count - 1));
+        read_capa10.block_size = tu_htonl((uint32_t) block_size);
 
         resplen = sizeof(read_capa10);
         TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &read_capa10, (size_t) resplen));
@@ -644,6 +908,40 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     }
     break;
 
+    #if CFG_TUD_MSC_CACHE
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+    case SCSI_CMD_SYNCHRONIZE_CACHE_16:
+      // whole LUN is programmed regardless of LBA range
+      resplen = cache_sync(lun) ? 0 : -1;
+      break;
+    #endif
+
+    case SCSI_CMD_SERVICE_ACTION_IN_16: {
+      scsi_read_capacity16_t const* read_capa16_cmd = (scsi_read_capacity16_t const*) scsi_cmd;
+      uint64_t block_count;
+      uint16_t block_size;
+
+      if ((read_capa16_cmd->service_action & 0x1F) != SCSI_SERVICE_ACTION_READ_CAPACITY_16) {
+        resplen = -1; // other service actions are up to application
+      } else if (!mscd_capacity(lun, &block_count, &block_size)) {
+        resplen = -1;
+      } else {
+        scsi_read_capacity16_resp_t read_capa16;
+        tu_memclr(&read_capa16, sizeof(read_capa16));
+
+        uint64_t const last_lba = block_count - 1;
+        read_capa16.last_lba_hi = tu_htonl((uint32_t) (last_lba >> 32));
+        read_capa16.last_lba_lo = tu_htonl((uint32_t) last_lba);
+        read_capa16.block_size  = tu_htonl((uint32_t) block_size);
+
+        // response is truncated to allocation length
+        uint32_t const alloc_len = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_read_capacity16_t, alloc_length)));
+        resplen = (int32_t) tu_min32(sizeof(read_capa16), alloc_len);
+        TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &read_capa16, (size_t) resplen));
+      }
+    }
+    break;
+
     case SCSI_CMD_READ_FORMAT_CAPACITY: {
       scsi_read_format_capacity_data_t read_fmt_capa =
       {
@@ -664,7 +962,7 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
         resplen = -1;
 
         // set default sense if not set by callback
-        if (p_msc->sense_key == 0) {
+        if (!sense_is_set(lun)) {
           set_sense_medium_not_present(lun);
         }
       } else {
@@ -699,38 +997,42 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     break;
 
     case SCSI_CMD_MODE_SENSE_6: {
-      scsi_mode_sense6_resp_t mode_resp =
-      {
-        .data_len = 3,
-        .medium_type = 0,
-        .write_protected = false,
-        .reserved = 0,
-        .block_descriptor_len = 0 // no block descriptor are included
-      };
+      scsi_mode_sense6_t const* mode_cmd = (scsi_mode_sense6_t const*) scsi_cmd;
+      struct TU_ATTR_PACKED {
+        scsi_mode_sense6_resp_t  header;
+        scsi_mode_page_caching_t caching;
+      } mode_resp;
+      tu_memclr(&mode_resp, sizeof(mode_resp));
 
       bool writable = true;
       if (tud_msc_is_writable_cb) {
         writable = tud_msc_is_writable_cb(lun);
       }
 
-      mode_resp.write_protected = !writable;
+      mode_resp.header.write_protected = !writable;
+      uint8_t len = sizeof(scsi_mode_sense6_resp_t); // no block descriptor are included
 
-      resplen = sizeof(mode_resp);
+      #if CFG_TUD_MSC_CACHE
+      // Write back cache: host issues SYNCHRONIZE CACHE before removal. No field is changeable
+      if (mode_cmd->page_code == SCSI_MODE_PAGE_CACHING || mode_cmd->page_code == SCSI_MODE_PAGE_ALL) {
+        mode_resp.caching.page_code          = SCSI_MODE_PAGE_CACHING;
+        mode_resp.caching.page_length        = sizeof(scsi_mode_page_caching_t) - 2;
+        mode_resp.caching.write_cache_enable = (mode_cmd->page_control != 1);
+        len += sizeof(scsi_mode_page_caching_t);
+      }
+      #endif
+
+      mode_resp.header.data_len = (uint8_t) (len - 1);
+
+      // response is truncated to allocation length
+      resplen = (int32_t) tu_min32(len, mode_cmd->alloc_length);
       TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &mode_resp, (size_t) resplen));
     }
     break;
 
     case SCSI_CMD_REQUEST_SENSE: {
-      scsi_sense_fixed_resp_t sense_rsp =
-      {
-        .response_code = 0x70, // current, fixed format
-        .valid = 1
-      };
-
-      sense_rsp.add_sense_len = sizeof(scsi_sense_fixed_resp_t) - 8;
-      sense_rsp.sense_key = (uint8_t)(p_msc->sense_key & 0x0F);
-      sense_rsp.add_sense_code = p_msc->add_sense_code;
-      sense_rsp.add_sense_qualifier = p_msc->add_sense_qualifier;
+      scsi_sense_fixed_resp_t sense_rsp;
+      sense_fill(&_mscd_itf.lun[lun], &sense_rsp);
 
       resplen = sizeof(sense_rsp);
       TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &sense_rsp, (size_t) resplen));
@@ -752,39 +1054,112 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
   return resplen;
 }
 
-static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc) {
-  msc_cbw_t const* p_cbw = &p_msc->cbw;
-
-  // block size already verified not zero
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
+//--------------------------------------------------------------------+
+// READ10/READ16
+//--------------------------------------------------------------------+
 
-  // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+static void proc_read_cmd(uint8_t rhport, mscd_interface_t* p_msc) {
+  proc_read_pump(rhport, p_msc, true);
+}
 
-  // remaining bytes capped at class buffer
-  int32_t nbytes = (int32_t)tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_cbw->total_bytes - p_msc->xferred_len);
+// Put oldest filled buffer on the wire if endpoint is idle
+static bool read_send(uint8_t rhport, mscd_interface_t* p_msc) {
+  if (p_msc->xfer_busy || p_msc->buf_count == 0) {
+    return true;
+  }
 
-  // Application can consume smaller bytes
-  uint32_t const offset = p_msc->xferred_len % block_sz;
-  nbytes = tud_msc_read10_cb(p_cbw->lun, lba, offset, _mscd_epbuf.buf, (uint32_t)nbytes);
+  p_msc->xfer_busy = true;
+  return usbd_edpt_xfer(rhport, p_msc->ep_in, mscd_buf(p_msc->buf_rd), p_msc->buf_len[p_msc->buf_rd]);
+}
 
+// Apply result of read callback for the next buffer, return false if buffer is not filled
+static bool read_filled(mscd_interface_t* p_msc, int32_t nbytes) {
   if (nbytes < 0) {
     // negative means error -> endpoint is stalled & status in CSW set to failed
     TU_LOG_DRV("  tud_msc_read10_cb() return -1\r\n");
 
-    // set sense
-    set_sense_medium_not_present(p_cbw->lun);
+    // set default sense if not set by callback
+    if (!sense_is_set(p_msc->cbw.lun)) {
+      set_sense_medium_not_present(p_msc->cbw.lun);
+    }
 
-    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-  } else if (nbytes == 0) {
-    // zero means not ready -> simulate an transfer complete so that this driver callback will fired again
-    dcd_event_xfer_complete(rhport, p_msc->ep_in, 0, XFER_RESULT_SUCCESS, false);
+    // data filled before the error is still sent
+    p_msc->io_failed = true;
+    return false;
+  }
+
+  if (nbytes == 0) {
+    return false; // not ready
+  }
+  p_msc->park_interval = 0; // progress, next busy is retried on next SOF
+
+  uint8_t const idx = rdwr_buf_next(p_msc);
+  p_msc->buf_len[idx] = (uint16_t) tu_min32((uint32_t) nbytes, CFG_TUD_MSC_EP_BUFSIZE);
+  p_msc->io_len += p_msc->buf_len[idx];
+  p_msc->buf_count++;
+
+  return true;
+}
+
+// Fill free buffers while the oldest one is on the wire. ready is false if application is not ready
+static void proc_read_pump(uint8_t rhport, mscd_interface_t* p_msc, bool ready) {
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+
+  // block size already verified not zero
+  uint16_t const block_sz = rdwr_get_blocksize(p_cbw);
+
+  TU_ASSERT(read_send(rhport, p_msc),);
+
+  while (ready && !p_msc->io_failed && !p_msc->async_pending &&
+         (p_msc->io_len < p_msc->total_len) && (p_msc->buf_count < CFG_TUD_MSC_EP_BUFCOUNT)) {
+    // Adjust lba with filled bytes
+    uint64_t const lba = mscd_rdwr_lba(p_cbw->command) + (p_msc->io_len / block_sz);
+
+    // remaining bytes capped at class buffer in whole blocks, application can consume smaller bytes
+    uint32_t const offset = p_msc->io_len % block_sz;
+    uint32_t const nbytes = mscd_rdwr_chunk(p_msc->io_len, p_msc->total_len, block_sz, CFG_TUD_MSC_EP_BUFSIZE);
+
+    // set before callback: async completion may be signaled before it returns
+    p_msc->async_pending = true;
+    int32_t const result = mscd_read_cb(p_cbw->lun, block_sz, lba, offset, mscd_buf(rdwr_buf_next(p_msc)), nbytes);
+
+    // otherwise resumed by tud_msc_async_io_done()
+    if (result != TUD_MSC_RET_ASYNC) {
+      p_msc->async_pending = false;
+      ready = read_filled(p_msc, result);
+      TU_ASSERT(read_send(rhport, p_msc),);
+    }
+  }
+
+  if (!p_msc->xfer_busy) {
+    if (p_msc->io_failed) {
+      fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    } else if (!ready && !p_msc->async_pending) {
+      park(rhport, p_msc);
+    }
+  }
+}
+
+static void proc_read_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes) {
+  // buffer on the wire is sent, release it
+  p_msc->xfer_busy = false;
+  p_msc->xferred_len += xferred_bytes;
+  p_msc->buf_rd = (uint8_t) ((p_msc->buf_rd + 1) % CFG_TUD_MSC_EP_BUFCOUNT);
+  p_msc->buf_count--;
+
+  if (p_msc->xferred_len >= p_msc->total_len) {
+    // Data Stage is complete
+    p_msc->stage = MSC_STAGE_STATUS;
   } else {
-    TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_epbuf.buf, (uint16_t) nbytes),);
+    proc_read_pump(rhport, p_msc, true);
   }
 }
 
-static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc) {
+//--------------------------------------------------------------------+
+// WRITE10/WRITE16
+//--------------------------------------------------------------------+
+
+static void proc_write_cmd(uint8_t rhport, mscd_interface_t* p_msc) {
   msc_cbw_t const* p_cbw = &p_msc->cbw;
   bool writable = true;
 
@@ -800,60 +1175,121 @@ static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc) {
     return;
   }
 
-  // remaining bytes capped at class buffer
-  uint16_t nbytes = (uint16_t)tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_cbw->total_bytes - p_msc->xferred_len);
-
-  // Write10 callback will be called later when usb transfer complete
-  TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_epbuf.buf, nbytes),);
+  // Write callback will be called later when usb transfer complete
+  proc_write_pump(rhport, p_msc, true);
 }
 
-// process new data arrived from WRITE10
-static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes) {
-  msc_cbw_t const* p_cbw = &p_msc->cbw;
+// Receive into next free buffer if endpoint is idle
+static bool write_receive(uint8_t rhport, mscd_interface_t* p_msc) {
+  if (p_msc->xfer_busy || p_msc->io_failed || (p_msc->buf_count >= CFG_TUD_MSC_EP_BUFCOUNT) ||
+      (p_msc->io_len >= p_msc->total_len)) {
+    return true;
+  }
 
-  // block size already verified not zero
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
+  // remaining bytes capped at class buffer in whole blocks
+  uint16_t const block_sz = rdwr_get_blocksize(&p_msc->cbw);
+  uint16_t const nbytes = (uint16_t) mscd_rdwr_chunk(p_msc->io_len, p_msc->total_len, block_sz, CFG_TUD_MSC_EP_BUFSIZE);
 
-  // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  p_msc->xfer_busy = true;
+  return usbd_edpt_xfer(rhport, p_msc->ep_out, mscd_buf(rdwr_buf_next(p_msc)), nbytes);
+}
 
-  // Invoke callback to consume new data
-  uint32_t const offset = p_msc->xferred_len % block_sz;
-  int32_t nbytes = tud_msc_write10_cb(p_cbw->lun, lba, offset, _mscd_epbuf.buf, xferred_bytes);
+// Apply result of write callback for the oldest buffer, return false if application consumed nothing
+static bool write_drained(mscd_interface_t* p_msc, int32_t nbytes) {
+  uint8_t const idx = p_msc->buf_rd;
+  uint16_t const remaining = (uint16_t) (p_msc->buf_len[idx] - p_msc->buf_offset);
 
   if (nbytes < 0) {
     // negative means error -> failed this scsi op
     TU_LOG_DRV("  tud_msc_write10_cb() return -1\r\n");
 
     // update actual byte before failed
-    p_msc->xferred_len += xferred_bytes;
+    p_msc->xferred_len += remaining;
 
-    set_sense_medium_not_present(p_cbw->lun);
-    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-  } else {
-    if ((uint32_t)nbytes < xferred_bytes) {
-      // Application consume less than what we got (including zero)
-      const uint32_t left_over = xferred_bytes - (uint32_t)nbytes;
-      if (nbytes > 0) {
-        p_msc->xferred_len += (uint16_t)nbytes;
-        memmove(_mscd_epbuf.buf, _mscd_epbuf.buf + nbytes, left_over);
-      }
+    // set default sense if not set by callback
+    if (!sense_is_set(p_msc->cbw.lun)) {
+      set_sense_medium_not_present(p_msc->cbw.lun);
+    }
+    p_msc->io_failed = true;
+    return false;
+  }
 
-      // simulate a transfer complete with adjusted parameters --> callback will be invoked with adjusted parameter
-      dcd_event_xfer_complete(rhport, p_msc->ep_out, left_over, XFER_RESULT_SUCCESS, false);
-    } else {
-      // Application consume all bytes in our buffer
-      p_msc->xferred_len += xferred_bytes;
+  uint16_t const consumed = (uint16_t) tu_min32((uint32_t) nbytes, remaining);
+  p_msc->xferred_len += consumed;
+  if (consumed) {
+    p_msc->park_interval = 0; // progress, next busy is retried on next SOF
+  }
 
-      if (p_msc->xferred_len >= p_msc->total_len) {
-        // Data Stage is complete
-        p_msc->stage = MSC_STAGE_STATUS;
-      } else {
-        // prepare to receive more data from host
-        proc_write10_cmd(rhport, p_msc);
-      }
+  if (consumed < remaining) {
+    // Application consume less than what we got, invoked again with the rest
+    p_msc->buf_offset = (uint16_t) (p_msc->buf_offset + consumed);
+    return consumed > 0;
+  }
+
+  // Application consume all bytes in this buffer
+  p_msc->buf_offset = 0;
+  p_msc->buf_rd = (uint8_t) ((p_msc->buf_rd + 1) % CFG_TUD_MSC_EP_BUFCOUNT);
+  p_msc->buf_count--;
+
+  return true;
+}
+
+// Drain received buffers while host data for the next one is on the wire. ready is false if application is not ready
+static void proc_write_pump(uint8_t rhport, mscd_interface_t* p_msc, bool ready) {
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+
+  // block size already verified not zero
+  uint16_t const block_sz = rdwr_get_blocksize(p_cbw);
+
+  // prepare to receive more data from host
+  TU_ASSERT(write_receive(rhport, p_msc),);
+
+  while (ready && !p_msc->io_failed && !p_msc->async_pending && p_msc->buf_count) {
+    uint8_t const idx = p_msc->buf_rd;
+
+    // Adjust lba with consumed bytes
+    uint64_t const lba = mscd_rdwr_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+
+    // Invoke callback to consume new data, async completion may be signaled before it returns
+    uint32_t const offset = p_msc->xferred_len % block_sz;
+    p_msc->async_pending = true;
+    int32_t const result = mscd_write_cb(p_cbw->lun, block_sz, lba, offset, mscd_buf(idx) + p_msc->buf_offset,
+                                         (uint32_t) (p_msc->buf_len[idx] - p_msc->buf_offset));
+
+    // otherwise resumed by tud_msc_async_io_done()
+    if (result != TUD_MSC_RET_ASYNC) {
+      p_msc->async_pending = false;
+      ready = write_drained(p_msc, result);
+      TU_ASSERT(write_receive(rhport, p_msc),);
     }
   }
+
+  // wait for data on the wire before completing the Data Stage
+  if (p_msc->xfer_busy) {
+    return;
+  }
+
+  if (p_msc->io_failed) {
+    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+  } else if (!p_msc->async_pending) {
+    if (p_msc->xferred_len >= p_msc->total_len) {
+      // Data Stage is complete
+      p_msc->stage = MSC_STAGE_STATUS;
+    } else if (!ready) {
+      park(rhport, p_msc);
+    }
+  }
+}
+
+// process new data arrived from WRITE10/WRITE16
+static void proc_write_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes) {
+  uint8_t const idx = rdwr_buf_next(p_msc);
+  p_msc->xfer_busy = false;
+  p_msc->buf_len[idx] = (uint16_t) xferred_bytes;
+  p_msc->io_len += xferred_bytes;
+  p_msc->buf_count++;
+
+  proc_write_pump(rhport, p_msc, true);
 }
 
 #endif
@@ -50,6 +50,37 @@
 
 TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 
+// Number of CFG_TUD_MSC_EP_BUFSIZE buffers used for READ10/WRITE10 data stage. With more than one buffer, transfers
+// are pipelined: tud_msc_read10_cb() fills the next buffer (or tud_msc_write10_cb() drains the previous one) while
+// another buffer is on the wire.
+#ifndef CFG_TUD_MSC_EP_BUFCOUNT
+  #define CFG_TUD_MSC_EP_BUFCOUNT 1
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFCOUNT >= 1 && CFG_TUD_MSC_EP_BUFCOUNT <= UINT8_MAX, "Buffer count is not correct");
+
+// Max number of LUNs, each has its own sense data. GET_MAX_LUN response is capped at this value
+#ifndef CFG_TUD_MSC_MAXLUN
+  #define CFG_TUD_MSC_MAXLUN  4
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_MAXLUN >= 1 && CFG_TUD_MSC_MAXLUN <= 16, "Max LUN is not correct");
+
+// Max number of SOFs between retries of a read10/write10 callback returning TUD_MSC_RET_BUSY. Retry interval starts
+// at one SOF and doubles while the callback stays busy.
+#ifndef CFG_TUD_MSC_BUSY_RETRY_MAX
+  #define CFG_TUD_MSC_BUSY_RETRY_MAX  32
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_BUSY_RETRY_MAX >= 1 && CFG_TUD_MSC_BUSY_RETRY_MAX <= UINT16_MAX, "Busy retry is not correct");
+
+// Return value of tud_msc_read10_cb() and tud_msc_write10_cb() other than number of bytes
+enum {
+  TUD_MSC_RET_BUSY  = 0,   // not ready, callback is invoked again on a later SOF with the same parameters
+  TUD_MSC_RET_ERROR = -1,  // failed, request is STALLed and CSW status is failed
+  TUD_MSC_RET_ASYNC = -16, // operation continues in background, complete it with tud_msc_async_io_done()
+};
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -57,37 +88,58 @@ TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 // Set SCSI sense response
 bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, uint8_t add_sense_qualifier);
 
+// Complete a read10/write10 callback that returned TUD_MSC_RET_ASYNC, bytes_io is what the callback would have
+// returned otherwise (number of bytes, TUD_MSC_RET_BUSY or TUD_MSC_RET_ERROR). Can be called from ISR e.g DMA
+// complete interrupt with in_isr = true, also before the callback has returned. Buffer passed to the callback must
+// not be accessed afterwards.
+bool tud_msc_async_io_done(int32_t bytes_io, bool in_isr);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
 
-// Invoked when received SCSI READ10 command
+// Invoked when received SCSI READ10 command, also READ16 if tud_msc_read16_cb() is not implemented
 // - Address = lba * BLOCK_SIZE + offset
 //   - offset is only needed if CFG_TUD_MSC_EP_BUFSIZE is smaller than BLOCK_SIZE.
+//   - bufsize is whole blocks if CFG_TUD_MSC_EP_BUFSIZE is at least BLOCK_SIZE, e.g 4096 for 4K blocks.
 //
 // - Application fill the buffer (up to bufsize) with address contents and return number of read byte. If
 //   - read < bufsize : These bytes are transferred first and callback invoked again for remaining data.
 //
 //   - read == 0      : Indicate application is not ready yet e.g disk I/O busy.
-//                      Callback invoked again with the same parameters later on.
+//                      Callback invoked again with the same parameters on a later SOF (polling with
+//                      backoff up to CFG_TUD_MSC_BUSY_RETRY_MAX SOFs), slow media should
+//                      rather use TUD_MSC_RET_ASYNC.
 //
 //   - read < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                      and return failed status in command status wrapper phase.
+//
+//   - TUD_MSC_RET_ASYNC : Buffer is filled in background, application calls tud_msc_async_io_done() later.
+//
+// With CFG_TUD_MSC_EP_BUFCOUNT > 1 callback can be invoked for the next address while previous data is still
+// being transferred.
 int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
 
-// Invoked when received SCSI WRITE10 command
+// Invoked when received SCSI WRITE10 command, also WRITE16 if tud_msc_write16_cb() is not implemented
 // - Address = lba * BLOCK_SIZE + offset
 //   - offset is only needed if CFG_TUD_MSC_EP_BUFSIZE is smaller than BLOCK_SIZE.
+//   - bufsize is whole blocks if CFG_TUD_MSC_EP_BUFSIZE is at least BLOCK_SIZE, e.g 4096 for 4K blocks.
 //
 // - Application write data from buffer to address contents (up to bufsize) and return number of written byte. If
-//   - write < bufsize : callback invoked again with remaining data later on.
+//   - write < bufsize : callback invoked again with remaining data.
 //
 //   - write == 0      : Indicate application is not ready yet e.g disk I/O busy.
-//                       Callback invoked again with the same parameters later on.
+//                       Callback invoked again with the same parameters on a later SOF (polling with
+//                       backoff up to CFG_TUD_MSC_BUSY_RETRY_MAX SOFs), slow media should
+//                       rather use TUD_MSC_RET_ASYNC.
 //
 //   - write < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                       and return failed status in command status wrapper phase.
 //
+//   - TUD_MSC_RET_ASYNC : Buffer is written in background, application calls tud_msc_async_io_done() later.
+//
+// With CFG_TUD_MSC_EP_BUFCOUNT > 1 host data for the next address is received while callback is processing.
+//
 // TODO change buffer to const uint8_t*
 int32_t tud_msc_write10_cb (uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
 
@@ -149,6 +201,19 @@ TU_ATTR_WEAK void tud_msc_scsi_complete_cb(uint8_t lun, uint8_t const scsi_cmd[1
 // Invoked to check if device is writable as part of SCSI WRITE10
 TU_ATTR_WEAK bool tud_msc_is_writable_cb(uint8_t lun);
 
+/*------------- Optional callbacks for medium larger than 2^32 blocks -------------*/
+
+// Invoked instead of tud_msc_capacity_cb() for READ CAPACITY (10/16). READ CAPACITY (10) reports 0xFFFFFFFF
+// as last LBA when block count does not fit, host then switches to READ CAPACITY (16) and READ16/WRITE16.
+TU_ATTR_WEAK void tud_msc_capacity16_cb(uint8_t lun, uint64_t* block_count, uint16_t* block_size);
+
+// Invoked instead of tud_msc_read10_cb() for both READ10 and READ16, same return value.
+// Without it READ16 beyond 2^32 blocks fails with LBA out of range.
+TU_ATTR_WEAK int32_t tud_msc_read16_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+
+// Invoked instead of tud_msc_write10_cb() for both WRITE10 and WRITE16, same return value.
+TU_ATTR_WEAK int32_t tud_msc_write16_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
@@ -158,9 +223,66 @@ void     mscd_reset           (uint8_t rhport);
 uint16_t mscd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     mscd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * p_request);
 bool     mscd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void     mscd_sof             (uint8_t rhport, uint8_t port_num, uint32_t frame_count);
+
+// Shared with UAS driver: process a SCSI command other than READ10/WRITE10, built-in commands first then
+// tud_msc_scsi_cb(). Return response length or negative if failed (sense is set)
+int32_t  mscd_scsi_cmd        (uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize);
+
+// Shared with UAS driver: get sense data in fixed format then clear it, return false if no sense is set
+bool     mscd_sense_read      (uint8_t lun, scsi_sense_fixed_resp_t* sense_rsp);
+
+// Shared with cache: true if sense is set e.g by application callback
+bool     mscd_sense_is_set    (uint8_t lun);
+
+// Shared with UAS driver: READ/WRITE (10/16) data through cache if enabled, else directly to media callbacks
+// Sense is set if the command cannot be served.
+bool     mscd_capacity        (uint8_t lun, uint64_t* block_count, uint16_t* block_size);
+int32_t  mscd_read_cb         (uint8_t lun, uint16_t block_size, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+int32_t  mscd_write_cb        (uint8_t lun, uint16_t block_size, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
+
+// Media access dispatched to tud_msc_read16_cb() or tud_msc_read10_cb() etc.
+int32_t  mscd_media_read      (uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+int32_t  mscd_media_write     (uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
+
+TU_ATTR_ALWAYS_INLINE static inline bool mscd_is_read_cmd(uint8_t cmd_code) {
+  return (SCSI_CMD_READ_10 == cmd_code) || (SCSI_CMD_READ_16 == cmd_code);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool mscd_is_write_cmd(uint8_t cmd_code) {
+  return (SCSI_CMD_WRITE_10 == cmd_code) || (SCSI_CMD_WRITE_16 == cmd_code);
+}
+
+// LBA and block count of READ/WRITE (10/16), all are Big Endian. Use offsetof to avoid unaligned access
+TU_ATTR_ALWAYS_INLINE static inline uint64_t mscd_rdwr_lba(uint8_t const cdb[]) {
+  if ((SCSI_CMD_READ_16 == cdb[0]) || (SCSI_CMD_WRITE_16 == cdb[0])) {
+    uint32_t const hi = tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read16_t, lba_hi)));
+    uint32_t const lo = tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read16_t, lba_lo)));
+    return ((uint64_t) hi << 32) | lo;
+  }
+  return tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read10_t, lba)));
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t mscd_rdwr_blockcount(uint8_t const cdb[]) {
+  if ((SCSI_CMD_READ_16 == cdb[0]) || (SCSI_CMD_WRITE_16 == cdb[0])) {
+    return tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read16_t, block_count)));
+  }
+  return tu_ntohs(tu_unaligned_read16(cdb + offsetof(scsi_read10_t, block_count)));
+}
+
+// Bytes for next callback of a READ/WRITE data stage: capped at bufsize and ends at block boundary when possible,
+// so that callbacks are not split within a block
+TU_ATTR_ALWAYS_INLINE static inline uint32_t mscd_rdwr_chunk(uint32_t pos, uint32_t total, uint16_t block_size,
+                                                             uint32_t bufsize) {
+  uint32_t const end = pos + tu_min32(bufsize, total - pos);
+  uint32_t const aligned_end = end - (end % block_size);
+  return ((end < total) && (aligned_end > pos)) ? (aligned_end - pos) : (end - pos);
+}
 
 #ifdef __cplusplus
  }
 #endif
 
+#include "msc_cache.h"
+
 #endif /* _TUSB_MSC_DEVICE_H_ */
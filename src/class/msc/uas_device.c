@@ -0,0 +1,820 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUD_ENABLED && CFG_TUD_UAS)
+
+#include "device/usbd.h"
+#include "device/usbd_pvt.h"
+
+#include "msc_device.h"
+#include "uas_device.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUD_UAS_LOG_LEVEL
+  #define CFG_TUD_UAS_LOG_LEVEL   CFG_TUD_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUD_UAS_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// Command IU is 32 bytes, additional CDB bytes if any are ignored
+#define UAS_CMD_BUFSIZE   64
+
+enum {
+  UAS_NO_CMD = 0xFF
+};
+
+enum {
+  UAS_CMD_FREE = 0,
+  UAS_CMD_QUEUED,   // waiting for its data pipe
+  UAS_CMD_READY,    // Read Ready/Write Ready IU to be sent
+  UAS_CMD_DATA,     // data stage on data pipe
+  UAS_CMD_SENSE,    // Sense IU to be sent
+  UAS_CMD_RESPONSE, // Response IU to be sent (task management or invalid IU)
+};
+
+typedef struct {
+  uint8_t  state;
+  uint8_t  lun;
+  bool     data_out;    // data-out command, otherwise data-in or no data
+  uint8_t  status;      // SCSI status of Sense IU or response code of Response IU
+  uint16_t tag;
+  uint16_t block_size;  // READ/WRITE (10/16)
+  uint8_t  cdb[16];
+
+  uint32_t total_len;   // bytes of data stage
+  uint32_t xferred_len; // bytes processed so far in the data stage
+
+  scsi_sense_fixed_resp_t sense;
+} uasd_cmd_t;
+
+typedef struct {
+  uint8_t rhport;
+  uint8_t itf_num;
+  uint8_t ep_cmd;
+  uint8_t ep_status;
+  uint8_t ep_data_in;
+  uint8_t ep_data_out;
+
+  uint8_t status_cmd;   // command whose IU is on the status pipe
+  uint8_t data_in_cmd;  // command owning data-in pipe
+  uint8_t data_out_cmd; // command owning data-out pipe
+  uint8_t next_cmd;     // round robin when handing data pipes to queued commands
+
+  bool cmd_armed;
+  bool data_in_busy;
+  bool data_out_busy;
+  volatile bool parked; // application not ready, callback is retried on next SOF
+
+  uint16_t data_out_len;    // bytes received in data-out buffer
+  uint16_t data_out_offset; // bytes of data-out buffer consumed by application
+
+  uasd_cmd_t cmd[CFG_TUD_UAS_CMD_QUEUE_DEPTH];
+} uasd_interface_t;
+
+static uasd_interface_t _uasd_itf;
+
+CFG_TUD_MEM_SECTION static struct {
+  TUD_EPBUF_DEF(cmd, UAS_CMD_BUFSIZE);
+  TUD_EPBUF_DEF(status, sizeof(uas_sense_iu_t));
+  TUD_EPBUF_DEF(data_in, CFG_TUD_UAS_EP_BUFSIZE);
+  TUD_EPBUF_DEF(data_out, CFG_TUD_UAS_EP_BUFSIZE);
+} _uasd_epbuf;
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+static void proc_data_in(uint8_t rhport, uasd_interface_t* p_uas);
+static void proc_data_out(uint8_t rhport, uasd_interface_t* p_uas);
+static void schedule(uint8_t rhport, uasd_interface_t* p_uas);
+
+#define UAS_DATA_OUT_UNSUPPORTED  UINT32_MAX
+
+// Parameter list length of data-out commands other than WRITE, 0 if command has no data-out.
+// UAS_DATA_OUT_UNSUPPORTED for other data-out commands: they are failed instead of being run as data-in
+static uint32_t data_out_len(uint8_t const cdb[]) {
+  switch (cdb[0]) {
+    case SCSI_CMD_MODE_SELECT_6: return cdb[4];
+    case 0x55: return tu_ntohs(tu_unaligned_read16(cdb + 7)); // MODE SELECT 10
+
+    case 0x04: // FORMAT UNIT
+    case 0x07: // REASSIGN BLOCKS
+    case 0x0A: // WRITE 6
+    case 0x1D: // SEND DIAGNOSTIC
+    case 0x2E: // WRITE AND VERIFY 10
+    case 0x3B: // WRITE BUFFER
+    case 0x3F: // WRITE LONG 10
+    case 0x41: // WRITE SAME 10
+    case 0x42: // UNMAP
+    case 0x4C: // LOG SELECT
+    case 0x5F: // PERSISTENT RESERVE OUT
+    case 0x8E: // WRITE AND VERIFY 16
+    case 0x93: // WRITE SAME 16
+    case 0xA4: // MAINTENANCE OUT
+    case 0xAA: // WRITE 12
+    case 0xAE: // WRITE AND VERIFY 12
+    case 0xB5: // SECURITY PROTOCOL OUT
+      return UAS_DATA_OUT_UNSUPPORTED;
+
+    default: return 0;
+  }
+}
+
+// Allocation length of data-in commands other than READ, UINT32_MAX if not known. Unlike BOT there is no
+// transfer length outside of the CDB: response must not be longer than what host allocated
+static uint32_t data_in_alloc_len(uint8_t const cdb[]) {
+  switch (cdb[0]) {
+    case SCSI_CMD_REQUEST_SENSE:
+    case SCSI_CMD_MODE_SENSE_6:         return cdb[4];
+    case SCSI_CMD_INQUIRY:              return tu_ntohs(tu_unaligned_read16(cdb + 3));
+    case SCSI_CMD_READ_FORMAT_CAPACITY:
+    case 0x5A:                          return tu_ntohs(tu_unaligned_read16(cdb + 7)); // MODE SENSE 10
+    case SCSI_CMD_SERVICE_ACTION_IN_16: return tu_ntohl(tu_unaligned_read32(cdb + 10));
+    case 0xA0:                          return tu_ntohl(tu_unaligned_read32(cdb + 6)); // REPORT LUNS
+    default:                            return UINT32_MAX;
+  }
+}
+
+static uint8_t find_free(uasd_interface_t const* p_uas) {
+  for (uint8_t i = 0; i < CFG_TUD_UAS_CMD_QUEUE_DEPTH; i++) {
+    if (p_uas->cmd[i].state == UAS_CMD_FREE) {
+      return i;
+    }
+  }
+  return UAS_NO_CMD;
+}
+
+static uint8_t find_tag(uasd_interface_t const* p_uas, uint16_t tag) {
+  for (uint8_t i = 0; i < CFG_TUD_UAS_CMD_QUEUE_DEPTH; i++) {
+    if (p_uas->cmd[i].state != UAS_CMD_FREE && p_uas->cmd[i].tag == tag) {
+      return i;
+    }
+  }
+  return UAS_NO_CMD;
+}
+
+static void release_data_pipe(uasd_interface_t* p_uas, uint8_t idx) {
+  if (p_uas->data_in_cmd == idx) {
+    p_uas->data_in_cmd = UAS_NO_CMD;
+  }
+  if (p_uas->data_out_cmd == idx) {
+    p_uas->data_out_cmd = UAS_NO_CMD;
+  }
+}
+
+// Complete a command, Sense IU is sent with status
+static void cmd_complete(uasd_interface_t* p_uas, uint8_t idx, uint8_t status) {
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  cmd->state  = UAS_CMD_SENSE;
+  cmd->status = status;
+  release_data_pipe(p_uas, idx);
+
+  TU_LOG_DRV("  UAS Status [Lun%u] tag %u = %u\r\n", cmd->lun, cmd->tag, status);
+}
+
+// Complete a command with check condition, sense_key and add_sense_code are used if sense is not set
+static void cmd_fail(uasd_interface_t* p_uas, uint8_t idx, uint8_t sense_key, uint8_t add_sense_code) {
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  if (cmd->lun >= CFG_TUD_MSC_MAXLUN || !mscd_sense_read(cmd->lun, &cmd->sense)) {
+    cmd->sense.response_code       = 0x70; // current, fixed format
+    cmd->sense.valid               = 1;
+    cmd->sense.add_sense_len       = sizeof(scsi_sense_fixed_resp_t) - 8;
+    cmd->sense.sense_key           = sense_key;
+    cmd->sense.add_sense_code      = add_sense_code;
+    cmd->sense.add_sense_qualifier = 0;
+  }
+
+  cmd_complete(p_uas, idx, SCSI_STATUS_CHECK_CONDITION);
+}
+
+// Byte count of READ/WRITE (10/16) data stage, false if block size is not known or count is too large
+static bool rdwr_data_len(uasd_cmd_t* cmd) {
+  uint64_t block_count = 0;
+  uint16_t block_size  = 0;
+
+  if (!mscd_capacity(cmd->lun, &block_count, &block_size)) {
+    return false;
+  }
+
+  uint64_t const total_len = (uint64_t) mscd_rdwr_blockcount(cmd->cdb) * block_size;
+  if (total_len > UINT32_MAX) {
+    // Sense = Invalid field in CDB
+    tud_msc_set_sense(cmd->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00);
+    return false;
+  }
+
+  cmd->block_size = block_size;
+  cmd->total_len  = (uint32_t) total_len;
+  return true;
+}
+
+// Abort a command which data stage is not started yet and its IU is not on the status pipe
+static bool cmd_abort(uasd_interface_t* p_uas, uint8_t idx) {
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  if (p_uas->status_cmd == idx) {
+    return false;
+  }
+
+  if (cmd->state == UAS_CMD_QUEUED || cmd->state == UAS_CMD_READY || cmd->state == UAS_CMD_SENSE) {
+    release_data_pipe(p_uas, idx);
+    cmd->state = UAS_CMD_FREE;
+    return true;
+  }
+
+  return false;
+}
+
+static void park(uint8_t rhport, uasd_interface_t* p_uas) {
+  p_uas->parked = true;
+  usbd_sof_enable(rhport, SOF_CONSUMER_UAS, true);
+}
+
+// Retry callback of parked data stage in usbd task
+static void proc_parked_retry(void* param) {
+  (void) param;
+  uasd_interface_t* p_uas = &_uasd_itf;
+
+  if (p_uas->data_in_cmd != UAS_NO_CMD && p_uas->cmd[p_uas->data_in_cmd].state == UAS_CMD_DATA &&
+      !p_uas->data_in_busy) {
+    proc_data_in(p_uas->rhport, p_uas);
+  }
+
+  if (p_uas->data_out_cmd != UAS_NO_CMD && p_uas->cmd[p_uas->data_out_cmd].state == UAS_CMD_DATA &&
+      !p_uas->data_out_busy && p_uas->data_out_len) {
+    proc_data_out(p_uas->rhport, p_uas);
+  }
+
+  // still not ready: keep SOF enabled for next retry
+  if (!p_uas->parked) {
+    usbd_sof_enable(p_uas->rhport, SOF_CONSUMER_UAS, false);
+  }
+
+  schedule(p_uas->rhport, p_uas);
+}
+
+//--------------------------------------------------------------------+
+// Command & Task Management IU
+//--------------------------------------------------------------------+
+
+// Command pipe is armed only if there is a free command slot, host is NAKed otherwise
+static bool cmd_arm(uint8_t rhport, uasd_interface_t* p_uas) {
+  if (p_uas->cmd_armed || find_free(p_uas) == UAS_NO_CMD) {
+    return true;
+  }
+
+  p_uas->cmd_armed = true;
+  return usbd_edpt_xfer(rhport, p_uas->ep_cmd, _uasd_epbuf.cmd, UAS_CMD_BUFSIZE);
+}
+
+static uint8_t proc_task_mgmt(uasd_interface_t* p_uas, uint8_t const* iu) {
+  uint8_t  const function = iu[offsetof(uas_task_mgmt_iu_t, function)];
+  uint16_t const task_tag = tu_ntohs(tu_unaligned_read16(iu + offsetof(uas_task_mgmt_iu_t, task_tag)));
+  uint8_t  const lun      = iu[offsetof(uas_task_mgmt_iu_t, lun) + 1];
+
+  TU_LOG_DRV("  UAS Task Management [Lun%u]: %02X tag %u\r\n", lun, function, task_tag);
+
+  switch (function) {
+    case UAS_TMF_ABORT_TASK: {
+      // function is complete if task does not exist (anymore)
+      uint8_t const idx = find_tag(p_uas, task_tag);
+      if (idx != UAS_NO_CMD && p_uas->cmd[idx].state != UAS_CMD_RESPONSE && !cmd_abort(p_uas, idx)) {
+        return UAS_RC_TMF_FAILED; // data stage in progress, command completes normally
+      }
+      return UAS_RC_TMF_COMPLETE;
+    }
+
+    case UAS_TMF_ABORT_TASK_SET:
+    case UAS_TMF_CLEAR_TASK_SET:
+    case UAS_TMF_LOGICAL_UNIT_RESET:
+    case UAS_TMF_IT_NEXUS_RESET:
+      // commands in data stage complete normally
+      for (uint8_t i = 0; i < CFG_TUD_UAS_CMD_QUEUE_DEPTH; i++) {
+        uasd_cmd_t const* cmd = &p_uas->cmd[i];
+        if (cmd->state != UAS_CMD_RESPONSE && (function == UAS_TMF_IT_NEXUS_RESET || cmd->lun == lun)) {
+          (void) cmd_abort(p_uas, i);
+        }
+      }
+      return UAS_RC_TMF_COMPLETE;
+
+    case UAS_TMF_QUERY_TASK:
+      return (find_tag(p_uas, task_tag) != UAS_NO_CMD) ? UAS_RC_TMF_SUCCEEDED : UAS_RC_TMF_COMPLETE;
+
+    case UAS_TMF_QUERY_TASK_SET:
+      for (uint8_t i = 0; i < CFG_TUD_UAS_CMD_QUEUE_DEPTH; i++) {
+        uasd_cmd_t const* cmd = &p_uas->cmd[i];
+        if (cmd->state != UAS_CMD_FREE && cmd->state != UAS_CMD_RESPONSE && cmd->lun == lun) {
+          return UAS_RC_TMF_SUCCEEDED;
+        }
+      }
+      return UAS_RC_TMF_COMPLETE;
+
+    default:
+      return UAS_RC_TMF_NOT_SUPPORTED;
+  }
+}
+
+static void proc_cmd_received(uasd_interface_t* p_uas, uint32_t xferred_bytes) {
+  uint8_t const* iu = _uasd_epbuf.cmd;
+  uint16_t const tag = tu_ntohs(tu_unaligned_read16(iu + offsetof(uas_command_iu_t, tag)));
+
+  // command pipe is only armed with a free slot
+  uint8_t const idx = find_free(p_uas);
+  TU_ASSERT(idx != UAS_NO_CMD,);
+
+  uint8_t const overlapped = find_tag(p_uas, tag);
+
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+  tu_memclr(cmd, sizeof(uasd_cmd_t));
+  cmd->tag = tag;
+
+  if (overlapped != UAS_NO_CMD) {
+    TU_LOG_DRV("  UAS overlapped tag %u\r\n", tag);
+    cmd->state  = UAS_CMD_RESPONSE;
+    cmd->status = UAS_RC_OVERLAPPED_TAG;
+  } else if (iu[0] == UAS_IU_COMMAND && xferred_bytes >= sizeof(uas_command_iu_t)) {
+    cmd->lun = iu[offsetof(uas_command_iu_t, lun) + 1]; // single level LUN
+    memcpy(cmd->cdb, iu + offsetof(uas_command_iu_t, cdb), sizeof(cmd->cdb));
+    cmd->data_out = mscd_is_write_cmd(cmd->cdb[0]) || (data_out_len(cmd->cdb) > 0);
+    cmd->state = UAS_CMD_QUEUED;
+
+    TU_LOG_DRV("  UAS Command [Lun%u] tag %u: %02X\r\n", cmd->lun, tag, cmd->cdb[0]);
+
+    if (cmd->lun >= CFG_TUD_MSC_MAXLUN) {
+      // Sense = Logical unit not supported
+      cmd_fail(p_uas, idx, SCSI_SENSE_ILLEGAL_REQUEST, 0x25);
+    }
+  } else if (iu[0] == UAS_IU_TASK_MGMT && xferred_bytes >= sizeof(uas_task_mgmt_iu_t)) {
+    cmd->lun    = iu[offsetof(uas_task_mgmt_iu_t, lun) + 1];
+    cmd->status = proc_task_mgmt(p_uas, iu);
+    cmd->state  = UAS_CMD_RESPONSE;
+  } else {
+    TU_LOG_DRV("  UAS invalid IU %02X\r\n", iu[0]);
+    cmd->state  = UAS_CMD_RESPONSE;
+    cmd->status = UAS_RC_INVALID_IU;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Status pipe
+//--------------------------------------------------------------------+
+
+// Send next IU on the status pipe: Sense and Response first so that command slots are released early, then
+// Read Ready/Write Ready
+static bool status_send(uint8_t rhport, uasd_interface_t* p_uas) {
+  if (p_uas->status_cmd != UAS_NO_CMD) {
+    return true;
+  }
+
+  uint8_t idx = UAS_NO_CMD;
+  for (uint8_t i = 0; i < CFG_TUD_UAS_CMD_QUEUE_DEPTH; i++) {
+    uint8_t const state = p_uas->cmd[i].state;
+    if (state == UAS_CMD_SENSE || state == UAS_CMD_RESPONSE) {
+      idx = i;
+      break;
+    } else if (state == UAS_CMD_READY && idx == UAS_NO_CMD) {
+      idx = i;
+    }
+  }
+
+  if (idx == UAS_NO_CMD) {
+    return true;
+  }
+
+  uasd_cmd_t const* cmd = &p_uas->cmd[idx];
+  uint8_t* buf = _uasd_epbuf.status;
+  uint16_t len;
+
+  switch (cmd->state) {
+    case UAS_CMD_READY: {
+      uas_ready_iu_t const iu = {
+        .iu_id = cmd->data_out ? UAS_IU_WRITE_READY : UAS_IU_READ_READY,
+        .tag   = tu_htons(cmd->tag)
+      };
+      len = sizeof(iu);
+      memcpy(buf, &iu, len);
+      break;
+    }
+
+    case UAS_CMD_SENSE: {
+      uas_sense_iu_t iu;
+      tu_memclr(&iu, sizeof(iu));
+      iu.iu_id  = UAS_IU_SENSE;
+      iu.tag    = tu_htons(cmd->tag);
+      iu.status = cmd->status;
+
+      // sense data only with check condition
+      len = offsetof(uas_sense_iu_t, sense);
+      if (cmd->status == SCSI_STATUS_CHECK_CONDITION) {
+        iu.sense_len = tu_htons(sizeof(scsi_sense_fixed_resp_t));
+        iu.sense     = cmd->sense;
+        len          = sizeof(uas_sense_iu_t);
+      }
+      memcpy(buf, &iu, len);
+      break;
+    }
+
+    default: {
+      uas_response_iu_t iu;
+      tu_memclr(&iu, sizeof(iu));
+      iu.iu_id         = UAS_IU_RESPONSE;
+      iu.tag           = tu_htons(cmd->tag);
+      iu.response_code = cmd->status;
+      len = sizeof(iu);
+      memcpy(buf, &iu, len);
+      break;
+    }
+  }
+
+  p_uas->status_cmd = idx;
+  return usbd_edpt_xfer(rhport, p_uas->ep_status, buf, len);
+}
+
+static void proc_status_sent(uint8_t rhport, uasd_interface_t* p_uas) {
+  uint8_t const idx = p_uas->status_cmd;
+  TU_VERIFY(idx != UAS_NO_CMD,);
+  p_uas->status_cmd = UAS_NO_CMD;
+
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  if (cmd->state == UAS_CMD_READY) {
+    // host now queues the data transfer for this tag
+    cmd->state = UAS_CMD_DATA;
+    if (cmd->data_out) {
+      proc_data_out(rhport, p_uas);
+    } else {
+      proc_data_in(rhport, p_uas);
+    }
+  } else {
+    cmd->state = UAS_CMD_FREE;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Data-In
+//--------------------------------------------------------------------+
+
+// Command got data-in pipe: run it, data stage starts after Read Ready IU
+static void data_in_start(uasd_interface_t* p_uas, uint8_t idx) {
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  if (mscd_is_read_cmd(cmd->cdb[0])) {
+    if (!rdwr_data_len(cmd)) {
+      cmd_fail(p_uas, idx, SCSI_SENSE_NOT_READY, 0x3A);
+      return;
+    }
+  } else {
+    int32_t const resplen = mscd_scsi_cmd(cmd->lun, cmd->cdb, _uasd_epbuf.data_in, CFG_TUD_UAS_EP_BUFSIZE);
+    if (resplen < 0) {
+      TU_LOG_DRV("  SCSI unsupported or failed command\r\n");
+      cmd_fail(p_uas, idx, SCSI_SENSE_ILLEGAL_REQUEST, 0x20);
+      return;
+    }
+    cmd->total_len = tu_min32(tu_min32((uint32_t) resplen, data_in_alloc_len(cmd->cdb)), CFG_TUD_UAS_EP_BUFSIZE);
+  }
+
+  if (cmd->total_len == 0) {
+    cmd_complete(p_uas, idx, SCSI_STATUS_GOOD);
+  } else {
+    cmd->state = UAS_CMD_READY;
+  }
+}
+
+static void proc_data_in(uint8_t rhport, uasd_interface_t* p_uas) {
+  uint8_t const idx = p_uas->data_in_cmd;
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+  uint16_t nbytes;
+
+  if (mscd_is_read_cmd(cmd->cdb[0])) {
+    uint64_t const lba     = mscd_rdwr_lba(cmd->cdb) + (cmd->xferred_len / cmd->block_size);
+    uint32_t const offset  = cmd->xferred_len % cmd->block_size;
+    uint32_t const bufsize = mscd_rdwr_chunk(cmd->xferred_len, cmd->total_len, cmd->block_size, CFG_TUD_UAS_EP_BUFSIZE);
+
+    int32_t const result = mscd_read_cb(cmd->lun, cmd->block_size, lba, offset, _uasd_epbuf.data_in, bufsize);
+
+    if (result == 0) {
+      park(rhport, p_uas);
+      return;
+    } else if (result < 0) {
+      TU_LOG_DRV("  tud_msc_read10_cb() return %ld\r\n", (long) result);
+      cmd_fail(p_uas, idx, SCSI_SENSE_NOT_READY, 0x3A);
+      return;
+    }
+
+    nbytes = (uint16_t) tu_min32((uint32_t) result, bufsize);
+  } else {
+    // response is already in buffer
+    nbytes = (uint16_t) cmd->total_len;
+  }
+
+  p_uas->data_in_busy = true;
+  TU_ASSERT(usbd_edpt_xfer(rhport, p_uas->ep_data_in, _uasd_epbuf.data_in, nbytes),);
+}
+
+static void proc_data_in_sent(uint8_t rhport, uasd_interface_t* p_uas, uint32_t xferred_bytes) {
+  uint8_t const idx = p_uas->data_in_cmd;
+  TU_VERIFY(idx != UAS_NO_CMD,);
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  p_uas->data_in_busy = false;
+  cmd->xferred_len += xferred_bytes;
+
+  if (cmd->xferred_len >= cmd->total_len) {
+    cmd_complete(p_uas, idx, SCSI_STATUS_GOOD);
+  } else {
+    proc_data_in(rhport, p_uas);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Data-Out
+//--------------------------------------------------------------------+
+
+// Command got data-out pipe: check it, data stage starts after Write Ready IU
+static void data_out_start(uasd_interface_t* p_uas, uint8_t idx) {
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  p_uas->data_out_len    = 0;
+  p_uas->data_out_offset = 0;
+
+  if (mscd_is_write_cmd(cmd->cdb[0])) {
+    if (tud_msc_is_writable_cb && !tud_msc_is_writable_cb(cmd->lun)) {
+      // Sense = Write protected
+      cmd_fail(p_uas, idx, SCSI_SENSE_DATA_PROTECT, 0x27);
+      return;
+    }
+
+    if (!rdwr_data_len(cmd)) {
+      cmd_fail(p_uas, idx, SCSI_SENSE_NOT_READY, 0x3A);
+      return;
+    }
+  } else {
+    cmd->total_len = data_out_len(cmd->cdb);
+    if (cmd->total_len == UAS_DATA_OUT_UNSUPPORTED) {
+      TU_LOG_DRV("  SCSI unsupported data-out command\r\n");
+      cmd_fail(p_uas, idx, SCSI_SENSE_ILLEGAL_REQUEST, 0x20);
+      return;
+    } else if (cmd->total_len > CFG_TUD_UAS_EP_BUFSIZE) {
+      TU_LOG_DRV("  SCSI reject non WRITE with large data\r\n");
+      cmd_fail(p_uas, idx, SCSI_SENSE_ILLEGAL_REQUEST, 0x20);
+      return;
+    }
+  }
+
+  if (cmd->total_len == 0) {
+    cmd_complete(p_uas, idx, SCSI_STATUS_GOOD);
+  } else {
+    cmd->state = UAS_CMD_READY;
+  }
+}
+
+// Drain data-out buffer into application, then receive more data from host
+static void proc_data_out(uint8_t rhport, uasd_interface_t* p_uas) {
+  uint8_t const idx = p_uas->data_out_cmd;
+  uasd_cmd_t* cmd = &p_uas->cmd[idx];
+
+  if (mscd_is_write_cmd(cmd->cdb[0])) {
+    while (p_uas->data_out_offset < p_uas->data_out_len) {
+      uint64_t const lba    = mscd_rdwr_lba(cmd->cdb) + (cmd->xferred_len / cmd->block_size);
+      uint32_t const offset = cmd->xferred_len % cmd->block_size;
+      uint32_t const remaining = (uint32_t) (p_uas->data_out_len - p_uas->data_out_offset);
+
+      int32_t const result = mscd_write_cb(cmd->lun, cmd->block_size, lba, offset,
+                                           _uasd_epbuf.data_out + p_uas->data_out_offset, remaining);
+
+      if (result == 0) {
+        park(rhport, p_uas);
+        return;
+      } else if (result < 0) {
+        TU_LOG_DRV("  tud_msc_write10_cb() return %ld\r\n", (long) result);
+        cmd_fail(p_uas, idx, SCSI_SENSE_NOT_READY, 0x3A);
+        return;
+      }
+
+      uint32_t const consumed = tu_min32((uint32_t) result, remaining);
+      p_uas->data_out_offset = (uint16_t) (p_uas->data_out_offset + consumed);
+      cmd->xferred_len += consumed;
+    }
+  } else if (p_uas->data_out_len) {
+    if (tud_msc_scsi_cb(cmd->lun, cmd->cdb, _uasd_epbuf.data_out, p_uas->data_out_len) < 0) {
+      TU_LOG_DRV("  SCSI unsupported or failed command\r\n");
+      cmd_fail(p_uas, idx, SCSI_SENSE_ILLEGAL_REQUEST, 0x20);
+      return;
+    }
+    cmd->xferred_len += p_uas->data_out_len;
+  }
+
+  p_uas->data_out_len    = 0;
+  p_uas->data_out_offset = 0;
+
+  if (cmd->xferred_len >= cmd->total_len) {
+    cmd_complete(p_uas, idx, SCSI_STATUS_GOOD);
+  } else {
+    // receive more data from host, capped at buffer in whole blocks. Non WRITE data is received in one transfer
+    uint16_t const nbytes = mscd_is_write_cmd(cmd->cdb[0]) ?
+        (uint16_t) mscd_rdwr_chunk(cmd->xferred_len, cmd->total_len, cmd->block_size, CFG_TUD_UAS_EP_BUFSIZE) :
+        (uint16_t) (cmd->total_len - cmd->xferred_len);
+    p_uas->data_out_busy = true;
+    TU_ASSERT(usbd_edpt_xfer(rhport, p_uas->ep_data_out, _uasd_epbuf.data_out, nbytes),);
+  }
+}
+
+static void proc_data_out_received(uint8_t rhport, uasd_interface_t* p_uas, uint32_t xferred_bytes) {
+  TU_VERIFY(p_uas->data_out_cmd != UAS_NO_CMD,);
+
+  p_uas->data_out_busy   = false;
+  p_uas->data_out_len    = (uint16_t) xferred_bytes;
+  p_uas->data_out_offset = 0;
+
+  if (xferred_bytes) {
+    proc_data_out(rhport, p_uas);
+  } else {
+    // host ended data stage early
+    cmd_complete(p_uas, p_uas->data_out_cmd, SCSI_STATUS_GOOD);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Scheduler
+//--------------------------------------------------------------------+
+
+// Hand free data pipes to queued commands in round robin, then keep status and command pipes busy
+static void schedule(uint8_t rhport, uasd_interface_t* p_uas) {
+  for (uint8_t i = 0; i < CFG_TUD_UAS_CMD_QUEUE_DEPTH; i++) {
+    uint8_t const idx = (uint8_t) ((p_uas->next_cmd + i) % CFG_TUD_UAS_CMD_QUEUE_DEPTH);
+    uasd_cmd_t const* cmd = &p_uas->cmd[idx];
+
+    if (cmd->state != UAS_CMD_QUEUED) {
+      continue;
+    }
+
+    if (cmd->data_out) {
+      if (p_uas->data_out_cmd == UAS_NO_CMD) {
+        p_uas->data_out_cmd = idx;
+        p_uas->next_cmd = (uint8_t) ((idx + 1) % CFG_TUD_UAS_CMD_QUEUE_DEPTH);
+        data_out_start(p_uas, idx);
+      }
+    } else {
+      if (p_uas->data_in_cmd == UAS_NO_CMD) {
+        p_uas->data_in_cmd = idx;
+        p_uas->next_cmd = (uint8_t) ((idx + 1) % CFG_TUD_UAS_CMD_QUEUE_DEPTH);
+        data_in_start(p_uas, idx);
+      }
+    }
+  }
+
+  TU_ASSERT(status_send(rhport, p_uas),);
+  TU_ASSERT(cmd_arm(rhport, p_uas),);
+}
+
+//--------------------------------------------------------------------+
+// USBD Driver API
+//--------------------------------------------------------------------+
+static void uasd_state_reset(void) {
+  tu_memclr(&_uasd_itf, sizeof(uasd_interface_t));
+  _uasd_itf.status_cmd   = UAS_NO_CMD;
+  _uasd_itf.data_in_cmd  = UAS_NO_CMD;
+  _uasd_itf.data_out_cmd = UAS_NO_CMD;
+}
+
+void uasd_init(uint8_t port_num) {
+  (void) port_num;
+  uasd_state_reset();
+}
+
+bool uasd_deinit(uint8_t port_num) {
+  (void) port_num;
+  return true; // nothing to do
+}
+
+void uasd_reset(uint8_t rhport, uint8_t port_num) {
+  (void) port_num;
+  if (_uasd_itf.parked) {
+    usbd_sof_enable(rhport, SOF_CONSUMER_UAS, false);
+  }
+  uasd_state_reset();
+}
+
+uint16_t uasd_open(uint8_t rhport, uint8_t port_num, tusb_desc_interface_t const * itf_desc, uint16_t max_len) {
+  (void) port_num;
+
+  TU_VERIFY(TUSB_CLASS_MSC    == itf_desc->bInterfaceClass &&
+            MSC_SUBCLASS_SCSI == itf_desc->bInterfaceSubClass &&
+            MSC_PROTOCOL_UAS  == itf_desc->bInterfaceProtocol, 0);
+
+  // interface + 4 * (endpoint + pipe usage)
+  uint16_t const drv_len = sizeof(tusb_desc_interface_t) + 4*(sizeof(tusb_desc_endpoint_t) + 4);
+  TU_ASSERT(itf_desc->bNumEndpoints == 4 && max_len >= drv_len, 0);
+
+  uasd_interface_t* p_uas = &_uasd_itf;
+  p_uas->rhport  = rhport;
+  p_uas->itf_num = itf_desc->bInterfaceNumber;
+
+  uint8_t const* p_desc = tu_desc_next(itf_desc);
+  for (uint8_t i = 0; i < 4; i++) {
+    TU_ASSERT(TUSB_DESC_ENDPOINT == tu_desc_type(p_desc), 0);
+    tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+    TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer && usbd_edpt_open(rhport, desc_ep), 0);
+
+    // Pipe Usage descriptor follows endpoint
+    p_desc = tu_desc_next(p_desc);
+    TU_ASSERT(UAS_DESC_PIPE_USAGE == tu_desc_type(p_desc), 0);
+
+    switch (p_desc[2]) {
+      case UAS_PIPE_ID_COMMAND:  p_uas->ep_cmd      = desc_ep->bEndpointAddress; break;
+      case UAS_PIPE_ID_STATUS:   p_uas->ep_status   = desc_ep->bEndpointAddress; break;
+      case UAS_PIPE_ID_DATA_IN:  p_uas->ep_data_in  = desc_ep->bEndpointAddress; break;
+      case UAS_PIPE_ID_DATA_OUT: p_uas->ep_data_out = desc_ep->bEndpointAddress; break;
+      default: return 0;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_uas->ep_cmd && p_uas->ep_status && p_uas->ep_data_in && p_uas->ep_data_out, 0);
+
+  // Prepare for Command IU
+  TU_ASSERT(cmd_arm(rhport, p_uas), drv_len);
+
+  return drv_len;
+}
+
+// UAS has no class specific request, standard requests are handled by usbd
+bool uasd_control_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t stage, tusb_control_request_t const * request) {
+  (void) rhport;
+  (void) port_num;
+  (void) stage;
+  (void) request;
+  return false;
+}
+
+bool uasd_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  (void) port_num;
+  (void) event;
+
+  uasd_interface_t* p_uas = &_uasd_itf;
+
+  if (ep_addr == p_uas->ep_cmd) {
+    p_uas->cmd_armed = false;
+    proc_cmd_received(p_uas, xferred_bytes);
+  } else if (ep_addr == p_uas->ep_status) {
+    proc_status_sent(rhport, p_uas);
+  } else if (ep_addr == p_uas->ep_data_in) {
+    proc_data_in_sent(rhport, p_uas, xferred_bytes);
+  } else if (ep_addr == p_uas->ep_data_out) {
+    proc_data_out_received(rhport, p_uas, xferred_bytes);
+  } else {
+    return false;
+  }
+
+  schedule(rhport, p_uas);
+  return true;
+}
+
+// SOF handler in ISR context
+void uasd_sof(uint8_t rhport, uint8_t port_num, uint32_t frame_count) {
+  (void) rhport;
+  (void) port_num;
+  (void) frame_count;
+
+  #if CFG_TUD_MSC_CACHE
+  mscd_cache_sof(frame_count);
+  #endif
+
+  if (_uasd_itf.parked) {
+    _uasd_itf.parked = false;
+    usbd_defer_func(proc_parked_retry, NULL, true);
+  }
+}
+
+#endif
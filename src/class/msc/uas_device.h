@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_UAS_DEVICE_H_
+#define _TUSB_UAS_DEVICE_H_
+
+#include "common/tusb_common.h"
+#include "msc.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// USB Attached SCSI (UAS) without USB 3 streams: Read Ready/Write Ready IUs on the status pipe tell host which
+// command the next data transfer belongs to. Commands are queued and executed out of order: one data-in and one
+// data-out command are on the data pipes at the same time while others wait.
+//
+// UAS uses the same application callbacks as MSC BOT (tud_msc_read10_cb(), tud_msc_scsi_cb() etc.) and shares its
+// built-in SCSI command handling, therefore CFG_TUD_MSC must be enabled as well. A device can expose BOT and UAS
+// interfaces in different configurations. Callback returning TUD_MSC_RET_ASYNC is not supported by UAS.
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+#if !CFG_TUD_MSC
+  #error CFG_TUD_UAS requires CFG_TUD_MSC
+#endif
+
+// Number of commands host can have outstanding, command pipe is NAKed when all are in use
+#ifndef CFG_TUD_UAS_CMD_QUEUE_DEPTH
+  #define CFG_TUD_UAS_CMD_QUEUE_DEPTH   4
+#endif
+
+// Size of data-in and data-out buffer each
+#ifndef CFG_TUD_UAS_EP_BUFSIZE
+  #define CFG_TUD_UAS_EP_BUFSIZE    CFG_TUD_MSC_EP_BUFSIZE
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_UAS_CMD_QUEUE_DEPTH >= 1 && CFG_TUD_UAS_CMD_QUEUE_DEPTH < UINT8_MAX, "Queue depth is not correct");
+TU_VERIFY_STATIC(CFG_TUD_UAS_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void     uasd_init            (uint8_t port_num);
+bool     uasd_deinit          (uint8_t port_num);
+void     uasd_reset           (uint8_t rhport, uint8_t port_num);
+uint16_t uasd_open            (uint8_t rhport, uint8_t port_num, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
+bool     uasd_control_xfer_cb (uint8_t rhport, uint8_t port_num, uint8_t stage, tusb_control_request_t const * request);
+bool     uasd_xfer_cb         (uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void     uasd_sof             (uint8_t rhport, uint8_t port_num, uint32_t frame_count);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_UAS_DEVICE_H_ */
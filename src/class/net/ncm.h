@@ -30,6 +30,12 @@
 
 #include "common/tusb_common.h"
 
+// Support 32-bit NTBs (NTH32/NDP32) in addition to 16-bit ones, host selects the format with SET_NTB_FORMAT.
+// Required for NTB buffers larger than 64 KiB which amortize per transfer overhead on high-speed links.
+#ifndef CFG_TUD_NCM_NTB32
+  #define CFG_TUD_NCM_NTB32 0
+#endif
+
 // NTB buffers size for reception side, must be >> MTU to avoid TCP retransmission (driver issue ?)
 // Linux use 2048 as minimal size
 #ifndef CFG_TUD_NCM_OUT_NTB_MAX_SIZE
@@ -78,6 +84,44 @@
   #define CFG_TUD_NCM_OUT_MAX_DATAGRAMS_PER_NTB 6
 #endif
 
+// Hand all datagrams of a received NTB to the glue logic with one tud_network_recv_batch_cb() instead of
+// tud_network_recv_cb() per datagram, the NTB is released with tud_network_recv_batch_release()
+#ifndef CFG_TUD_NCM_RECV_BATCH
+  #define CFG_TUD_NCM_RECV_BATCH 0
+#endif
+
+// Time in microseconds a partly filled transmission NTB may wait for further datagrams while the IN endpoint is idle.
+// 0 sends it immediately. Time is counted in SOFs: 1 ms on full-speed, 125 us on high-speed if the controller reports
+// every microframe.
+#ifndef CFG_TUD_NCM_IN_AGGREGATION_US
+  #define CFG_TUD_NCM_IN_AGGREGATION_US 0
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_NCM_NTB32 || (CFG_TUD_NCM_IN_NTB_MAX_SIZE <= UINT16_MAX && CFG_TUD_NCM_OUT_NTB_MAX_SIZE <= UINT16_MAX),
+                 "NTB larger than 64 KiB requires CFG_TUD_NCM_NTB32");
+
+// Zero-copy transmission: only NTB header is kept in driver buffers, datagrams are sent in place from the buffers
+// passed to tud_network_xmit_sg() which replaces tud_network_xmit()/tud_network_xmit_cb().
+// CFG_TUD_NCM_IN_NTB_MAX_SIZE still limits the NTB length announced to host but costs no RAM.
+// An NTB takes several transfers (header, segments, bounce buffer for unaligned or short parts). Use CFG_TUD_XFER_ISR
+// to submit the next one from transfer complete interrupt, otherwise endpoint idles (NAKs) while waiting for tud_task().
+// Per-transfer overhead still costs more CPU than copying when memcpy is cheap (about 5x in test/ncm_loopback), it is
+// worth it when RAM for NTBs is scarce or copying is slow.
+#ifndef CFG_TUD_NCM_XMIT_SG
+  #define CFG_TUD_NCM_XMIT_SG 0
+#endif
+
+// How many buffer segments (e.g pbufs of a chain) all datagrams of a transmission NTB may consist of
+#ifndef CFG_TUD_NCM_IN_MAX_SEGMENTS_PER_NTB
+  #define CFG_TUD_NCM_IN_MAX_SEGMENTS_PER_NTB (2 * CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB)
+#endif
+
+// Segments must be accessible by the USB controller. Parts of a segment which start at this alignment are given to
+// the controller directly, remaining bytes (up to one endpoint packet per segment) are copied into a bounce buffer
+#ifndef CFG_TUD_NCM_XMIT_SG_ALIGN
+  #define CFG_TUD_NCM_XMIT_SG_ALIGN 4
+#endif
+
 // Table 6.2 Class-Specific Request Codes for Network Control Model subclass
 typedef enum
 {
@@ -99,10 +143,20 @@ typedef enum
   NCM_SET_CRC_MODE                                 = 0x8A,
 } ncm_request_code_t;
 
+// Table 6-3 NTB format
+enum {
+  NCM_NTB_FORMAT_16 = 0x00,
+  NCM_NTB_FORMAT_32 = 0x01,
+};
+
 #define NTH16_SIGNATURE 0x484D434E
 #define NDP16_SIGNATURE_NCM0 0x304D434E
 #define NDP16_SIGNATURE_NCM1 0x314D434E
 
+#define NTH32_SIGNATURE 0x686D636E
+#define NDP32_SIGNATURE_NCM0 0x306D636E
+#define NDP32_SIGNATURE_NCM1 0x316D636E
+
 typedef struct TU_ATTR_PACKED {
   uint16_t wLength;
   uint16_t bmNtbFormatsSupported;
@@ -138,13 +192,52 @@ typedef struct TU_ATTR_PACKED {
   //ndp16_datagram_t datagram[];
 } ndp16_t;
 
+typedef struct TU_ATTR_PACKED {
+  uint32_t dwSignature;
+  uint16_t wHeaderLength;
+  uint16_t wSequence;
+  uint32_t dwBlockLength;
+  uint32_t dwNdpIndex;
+} nth32_t;
+
+typedef struct TU_ATTR_PACKED {
+  uint32_t dwDatagramIndex;
+  uint32_t dwDatagramLength;
+} ndp32_datagram_t;
+
+typedef struct TU_ATTR_PACKED {
+  uint32_t dwSignature;
+  uint16_t wLength;
+  uint16_t wReserved6;
+  uint32_t dwNextNdpIndex;
+  uint32_t dwReserved12;
+  //ndp32_datagram_t datagram[];
+} ndp32_t;
+
+// Table 6-5 NTB input size, wNtbInMaxDatagrams and wReserved are optional
+typedef struct TU_ATTR_PACKED {
+  uint32_t dwNtbInMaxSize;
+  uint16_t wNtbInMaxDatagrams;
+  uint16_t wReserved;
+} ntb_input_size_t;
+
 typedef union TU_ATTR_PACKED {
   struct {
     nth16_t nth;
     ndp16_t ndp;
     ndp16_datagram_t ndp_datagram[CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB + 1];
   };
+  struct {
+    nth32_t nth32;
+    ndp32_t ndp32;
+    ndp32_datagram_t ndp32_datagram[CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB + 1];
+  };
+#if CFG_TUD_NCM_XMIT_SG
+  // header only, datagrams are referenced
+  uint8_t data[sizeof(nth16_t) + sizeof(ndp16_t) + (CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t)];
+#else
   uint8_t data[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
+#endif
 } xmit_ntb_t;
 
 typedef union TU_ATTR_PACKED {
@@ -152,6 +245,7 @@ typedef union TU_ATTR_PACKED {
     nth16_t nth;
     // only the header is at a guaranteed position
   };
+  nth32_t nth32;
   uint8_t data[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
 } recv_ntb_t;
 
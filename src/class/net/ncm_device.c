@@ -71,6 +71,10 @@
 #define TUD_NCM_ALIGNMENT   4
 // calculate alignment of xmit datagrams within an NTB
 #define XMIT_ALIGN_OFFSET(x) ((TUD_NCM_ALIGNMENT - ((x) & (TUD_NCM_ALIGNMENT - 1))) & (TUD_NCM_ALIGNMENT - 1))
+// largest multiple of the packet size which fits into one usbd_edpt_xfer(), longer NTBs are split
+#define NCM_XFER_MAX (UINT16_MAX - UINT16_MAX % CFG_TUD_NET_ENDPOINT_SIZE)
+// minimum of dwNtbInMaxSize the host may set (spec, chapter 6.2.7)
+#define NCM_NTB_IN_MIN_SIZE 2048
 
 //-----------------------------------------------------------------------------
 //
@@ -79,6 +83,27 @@
 #define XMIT_NTB_N CFG_TUD_NCM_IN_NTB_N
 #define RECV_NTB_N CFG_TUD_NCM_OUT_NTB_N
 
+#if CFG_TUD_NCM_RECV_BATCH
+// max datagrams handed to the glue logic at once, NTBs with more datagrams are handed in several batches
+#define RECV_BATCH_N (CFG_TUD_NCM_OUT_MAX_DATAGRAMS_PER_NTB ? CFG_TUD_NCM_OUT_MAX_DATAGRAMS_PER_NTB : 8)
+#endif
+
+#if CFG_TUD_NCM_XMIT_SG
+// pieces of an NTB in transmission order: header, datagram segments and alignment padding (buf == NULL)
+#define XMIT_SG_PIECE_N (1 + CFG_TUD_NCM_IN_MAX_SEGMENTS_PER_NTB + CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB)
+TU_VERIFY_STATIC(XMIT_SG_PIECE_N <= UINT8_MAX, "Too many segments per NTB");
+
+// bounce buffer, every transfer but the last of an NTB is a multiple of it so that host sees no short packet
+#define XMIT_SG_STAGE_SIZE CFG_TUD_NET_ENDPOINT_SIZE
+
+typedef struct {
+  tud_network_seg_t piece[XMIT_SG_PIECE_N];
+  void *ref[CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB];      // handed back with tud_network_xmit_done_cb()
+  uint8_t piece_count;
+  uint8_t ref_count;
+} xmit_sg_t;
+#endif
+
 typedef struct {
   // general
   uint8_t ep_in;        // endpoint for outgoing datagrams (naming is a little bit confusing)
@@ -88,12 +113,24 @@ typedef struct {
   uint8_t itf_data_alt; // ==0 -> no endpoints, i.e. no network traffic, ==1 -> normal operation with two endpoints (spec, chapter 5.3)
   uint8_t rhport;       // storage of \a rhport because some callbacks are done without it
 
+  // NTB settings selected by host
+  uint16_t ntb_format;                                  // NCM_NTB_FORMAT_16 or NCM_NTB_FORMAT_32
+  uint32_t ntb_in_max_size;                             // max size of xmit NTBs
+  uint16_t ntb_in_max_datagrams;                        // max datagrams in an xmit NTB
+  ntb_input_size_t ntb_input_size;                      // buffer for SET_NTB_INPUT_SIZE/GET_NTB_INPUT_SIZE
+
   // recv handling
   recv_ntb_t *recv_free_ntb[RECV_NTB_N];                // free list of recv NTBs
   recv_ntb_t *recv_ready_ntb[RECV_NTB_N];               // NTBs waiting for transmission to glue logic
   recv_ntb_t *recv_tinyusb_ntb;                         // buffer for the running transfer TinyUSB -> driver
   recv_ntb_t *recv_glue_ntb;                            // buffer for the running transfer driver -> glue logic
   uint16_t recv_glue_ntb_datagram_ndx;                  // index into \a recv_glue_ntb_datagram
+  uint32_t recv_tinyusb_len;                            // bytes of the running transfer received so far
+#if CFG_TUD_NCM_RECV_BATCH
+  tud_network_seg_t recv_batch[RECV_BATCH_N];           // datagrams of \a recv_glue_ntb handed to glue logic
+  uint16_t recv_batch_count;                            // !=0 -> glue logic holds the batch
+#endif
+  uint16_t recv_xfer_len;                               // size of the running usbd_edpt_xfer()
 
   // xmit handling
   xmit_ntb_t *xmit_free_ntb[XMIT_NTB_N];                // free list of xmit NTBs
@@ -102,6 +139,16 @@ typedef struct {
   xmit_ntb_t *xmit_glue_ntb;                            // buffer for the running transfer glue logic -> driver
   uint16_t xmit_sequence;                               // NTB sequence counter
   uint16_t xmit_glue_ntb_datagram_ndx;                  // index into \a xmit_glue_ntb_datagram
+  uint32_t xmit_sent;                                   // bytes of the running transfer already submitted
+#if CFG_TUD_NCM_XMIT_SG
+  xmit_sg_t xmit_sg[XMIT_NTB_N];                        // gather list of each xmit NTB
+  uint8_t xmit_sg_piece;                                // running transfer: current piece
+  uint16_t xmit_sg_offset;                              // running transfer: offset within current piece
+#endif
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+  volatile uint32_t xmit_glue_ntb_age_us;               // time the glue NTB is waiting, counted in SOF
+  volatile bool xmit_aggregation_sof;                   // SOF is enabled for aggregation
+#endif
 
   // notification handling
   enum {
@@ -126,6 +173,10 @@ typedef struct {
   } xmit[XMIT_NTB_N];
 
   TUD_EPBUF_TYPE_DEF(ncm_notify_t, epnotif);
+
+#if CFG_TUD_NCM_XMIT_SG
+  TUD_EPBUF_DEF(xmit_stage, XMIT_SG_STAGE_SIZE);
+#endif
 } ncm_epbuf_t;
 
 static ncm_interface_t ncm_interface;
@@ -139,7 +190,7 @@ CFG_TUD_MEM_SECTION static ncm_epbuf_t ncm_epbuf;
  */
 TU_ATTR_ALIGNED(4) static const ntb_parameters_t ntb_parameters = {
   .wLength                  = sizeof(ntb_parameters_t),
-  .bmNtbFormatsSupported    = 0x01,// 16-bit NTB supported
+  .bmNtbFormatsSupported    = CFG_TUD_NCM_NTB32 ? 0x03 : 0x01,// 16-bit NTB supported, 32-bit optional
   .dwNtbInMaxSize           = CFG_TUD_NCM_IN_NTB_MAX_SIZE,
   .wNdbInDivisor            = 1,
   .wNdbInPayloadRemainder   = 0,
@@ -163,6 +214,13 @@ TU_ATTR_ALIGNED(4) static const ntb_parameters_t ntb_parameters = {
 //      sysview:  SYSTICKS_PER_SEC=35000, IDLE_US=1000, PRINT_MOD=1000
 //
 
+/**
+ * Check if host has selected 32-bit NTBs (for both directions)
+ */
+static inline bool ntb_is_32(void) {
+  return CFG_TUD_NCM_NTB32 && ncm_interface.ntb_format == NCM_NTB_FORMAT_32;
+}
+
 //-----------------------------------------------------------------------------
 //
 // everything about notifications
@@ -240,6 +298,30 @@ static void notification_xmit(uint8_t rhport, bool force_next) {
 // everything about packet transmission (driver -> TinyUSB)
 //
 
+/**
+ * Length of an xmit NTB
+ */
+static uint32_t xmit_ntb_len(xmit_ntb_t const *ntb) {
+  return ntb_is_32() ? ntb->nth32.dwBlockLength : ntb->nth.wBlockLength;
+} // xmit_ntb_len
+
+/**
+ * Length of NTH and NDP with room for all datagram entries, the first datagram follows.
+ */
+static uint16_t xmit_ntb_header_len(void) {
+  if (ntb_is_32()) {
+    return sizeof(nth32_t) + sizeof(ndp32_t) + (CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp32_datagram_t);
+  }
+  return sizeof(nth16_t) + sizeof(ndp16_t) + (CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t);
+} // xmit_ntb_header_len
+
+/**
+ * Max length of an xmit NTB as accepted by host
+ */
+static uint32_t xmit_ntb_max_len(void) {
+  return ntb_is_32() ? ncm_interface.ntb_in_max_size : tu_min32(ncm_interface.ntb_in_max_size, UINT16_MAX);
+} // xmit_ntb_max_len
+
 /**
  * Put NTB into the transmitter free list.
  */
@@ -279,7 +361,7 @@ static xmit_ntb_t *xmit_get_free_ntb(void) {
  * Put a filled NTB into the ready list
  */
 static void xmit_put_ntb_into_ready_list(xmit_ntb_t *ready_ntb) {
-  TU_LOG_DRV("xmit_put_ntb_into_ready_list(%p) %d\n", ready_ntb, ready_ntb->nth.wBlockLength);
+  TU_LOG_DRV("xmit_put_ntb_into_ready_list(%p) %u\n", ready_ntb, (unsigned) xmit_ntb_len(ready_ntb));
 
   for (int i = 0; i < XMIT_NTB_N; ++i) {
     if (ncm_interface.xmit_ready_ntb[i] == NULL) {
@@ -334,6 +416,107 @@ static bool xmit_insert_required_zlp(uint8_t rhport, uint32_t xferred_bytes) {
   return true;
 } // xmit_insert_required_zlp
 
+#if CFG_TUD_NCM_XMIT_SG
+/**
+ * Get the gather list belonging to an NTB
+ */
+static xmit_sg_t *xmit_sg_get(xmit_ntb_t const *ntb) {
+  for (int i = 0; i < XMIT_NTB_N; ++i) {
+    if (ntb == &ncm_epbuf.xmit[i].ntb) {
+      return &ncm_interface.xmit_sg[i];
+    }
+  }
+  return NULL;
+} // xmit_sg_get
+
+/**
+ * Hand the datagrams of an NTB back to the glue logic and empty its gather list.
+ */
+static void xmit_sg_release(xmit_ntb_t const *ntb) {
+  xmit_sg_t *sg = xmit_sg_get(ntb);
+
+  for (uint8_t i = 0; i < sg->ref_count; ++i) {
+    tud_network_xmit_done_cb(sg->ref[i]);
+  }
+  sg->piece_count = 0;
+  sg->ref_count = 0;
+} // xmit_sg_release
+
+/**
+ * Advance the position of the running transfer by \a len bytes.
+ */
+static void xmit_sg_advance(xmit_sg_t const *sg, uint16_t len) {
+  ncm_interface.xmit_sent += len;
+  ncm_interface.xmit_sg_offset += len;
+  if (ncm_interface.xmit_sg_offset == sg->piece[ncm_interface.xmit_sg_piece].len) {
+    ncm_interface.xmit_sg_piece += 1;
+    ncm_interface.xmit_sg_offset = 0;
+  }
+} // xmit_sg_advance
+#endif
+
+/**
+ * Submit the next part of the running NTB, NTBs longer than \a NCM_XFER_MAX are split.
+ * With CFG_TUD_NCM_XMIT_SG a piece which is aligned and has at least \a XMIT_SG_STAGE_SIZE bytes left is given to
+ * the controller in place, everything else is gathered into the bounce buffer.
+ */
+static bool xmit_submit_next(uint8_t rhport) {
+#if CFG_TUD_NCM_XMIT_SG
+  xmit_sg_t const *sg = xmit_sg_get(ncm_interface.xmit_tinyusb_ntb);
+  tud_network_seg_t const *piece = &sg->piece[ncm_interface.xmit_sg_piece];
+  uint16_t remain = (uint16_t) (piece->len - ncm_interface.xmit_sg_offset);
+  uint8_t const *src = (uint8_t const *) piece->buf + ncm_interface.xmit_sg_offset;
+
+  if (piece->buf != NULL && remain >= XMIT_SG_STAGE_SIZE && ((uintptr_t) src % CFG_TUD_NCM_XMIT_SG_ALIGN) == 0) {
+    uint16_t len = (uint16_t) (remain - remain % XMIT_SG_STAGE_SIZE);
+    xmit_sg_advance(sg, len);
+    return usbd_edpt_xfer(rhport, ncm_interface.ep_in, (uint8_t *) (uintptr_t) src, len);
+  }
+
+  uint16_t len = 0;
+  while (len < XMIT_SG_STAGE_SIZE && ncm_interface.xmit_sg_piece < sg->piece_count) {
+    piece = &sg->piece[ncm_interface.xmit_sg_piece];
+    uint16_t n = tu_min16((uint16_t) (piece->len - ncm_interface.xmit_sg_offset), (uint16_t) (XMIT_SG_STAGE_SIZE - len));
+
+    if (piece->buf != NULL) {
+      memcpy(ncm_epbuf.xmit_stage + len, (uint8_t const *) piece->buf + ncm_interface.xmit_sg_offset, n);
+    } else {
+      memset(ncm_epbuf.xmit_stage + len, 0, n);
+    }
+    len += n;
+    xmit_sg_advance(sg, n);
+  }
+  return usbd_edpt_xfer(rhport, ncm_interface.ep_in, ncm_epbuf.xmit_stage, len);
+#else
+  xmit_ntb_t *ntb = ncm_interface.xmit_tinyusb_ntb;
+  uint16_t len = (uint16_t) tu_min32(xmit_ntb_len(ntb) - ncm_interface.xmit_sent, NCM_XFER_MAX);
+  uint8_t *src = ntb->data + ncm_interface.xmit_sent;
+
+  ncm_interface.xmit_sent += len;
+  return usbd_edpt_xfer(rhport, ncm_interface.ep_in, src, len);
+#endif
+} // xmit_submit_next
+
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+/**
+ * Check if the partly filled glue NTB is due for transmission.
+ * If not, SOF is enabled to count the time it is waiting for further datagrams.
+ */
+static bool xmit_glue_ntb_is_due(uint8_t rhport) {
+  bool const full = ncm_interface.xmit_glue_ntb_datagram_ndx >= ncm_interface.ntb_in_max_datagrams ||
+                    xmit_ntb_len(ncm_interface.xmit_glue_ntb) + CFG_TUD_NET_MTU + TUD_NCM_ALIGNMENT > xmit_ntb_max_len();
+
+  if (full || ncm_interface.xmit_glue_ntb_age_us >= CFG_TUD_NCM_IN_AGGREGATION_US) {
+    return true;
+  }
+  if (!ncm_interface.xmit_aggregation_sof) {
+    ncm_interface.xmit_aggregation_sof = true;
+    usbd_sof_enable(rhport, SOF_CONSUMER_NCM, true);
+  }
+  return false;
+} // xmit_glue_ntb_is_due
+#endif
+
 /**
  * Start transmission if it there is a waiting packet and if can be done from interface side.
  */
@@ -359,23 +542,34 @@ static void xmit_start_if_possible(uint8_t rhport) {
       // -> really nothing is waiting
       return;
     }
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+    if (!xmit_glue_ntb_is_due(rhport)) {
+      // -> wait for more datagrams
+      return;
+    }
+#endif
     ncm_interface.xmit_tinyusb_ntb = ncm_interface.xmit_glue_ntb;
     ncm_interface.xmit_glue_ntb = NULL;
   }
 
-  #if CFG_TUD_NCM_LOG_LEVEL >= 3
+  #if CFG_TUD_NCM_LOG_LEVEL >= 3 && !CFG_TUD_NCM_XMIT_SG
   {
-    uint16_t len = ncm_interface.xmit_tinyusb_ntb->nth.wBlockLength;
+    uint32_t len = xmit_ntb_len(ncm_interface.xmit_tinyusb_ntb);
     TU_LOG_BUF(3, ncm_interface.xmit_tinyusb_ntb->data[i], len);
   }
   #endif
 
   if (ncm_interface.xmit_glue_ntb_datagram_ndx != 1) {
-    TU_LOG_DRV(">> %d %d\n", ncm_interface.xmit_tinyusb_ntb->nth.wBlockLength, ncm_interface.xmit_glue_ntb_datagram_ndx);
+    TU_LOG_DRV(">> %u %d\n", (unsigned) xmit_ntb_len(ncm_interface.xmit_tinyusb_ntb), ncm_interface.xmit_glue_ntb_datagram_ndx);
   }
 
   // Kick off an endpoint transfer
-  usbd_edpt_xfer(0, ncm_interface.ep_in, ncm_interface.xmit_tinyusb_ntb->data, ncm_interface.xmit_tinyusb_ntb->nth.wBlockLength);
+  ncm_interface.xmit_sent = 0;
+#if CFG_TUD_NCM_XMIT_SG
+  ncm_interface.xmit_sg_piece = 0;
+  ncm_interface.xmit_sg_offset = 0;
+#endif
+  xmit_submit_next(rhport);
 } // xmit_start_if_possible
 
 /**
@@ -387,10 +581,10 @@ static bool xmit_requested_datagram_fits_into_current_ntb(uint16_t datagram_size
   if (ncm_interface.xmit_glue_ntb == NULL) {
     return false;
   }
-  if (ncm_interface.xmit_glue_ntb_datagram_ndx >= CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB) {
+  if (ncm_interface.xmit_glue_ntb_datagram_ndx >= ncm_interface.ntb_in_max_datagrams) {
     return false;
   }
-  if (ncm_interface.xmit_glue_ntb->nth.wBlockLength + datagram_size + XMIT_ALIGN_OFFSET(datagram_size) > CFG_TUD_NCM_IN_NTB_MAX_SIZE) {
+  if (xmit_ntb_len(ncm_interface.xmit_glue_ntb) + datagram_size + XMIT_ALIGN_OFFSET(datagram_size) > xmit_ntb_max_len()) {
     return false;
   }
   return true;
@@ -417,22 +611,108 @@ static bool xmit_setup_next_glue_ntb(void) {
 
   xmit_ntb_t *ntb = ncm_interface.xmit_glue_ntb;
 
-  // Fill in NTB header
-  ntb->nth.dwSignature = NTH16_SIGNATURE;
-  ntb->nth.wHeaderLength = sizeof(ntb->nth);
-  ntb->nth.wSequence = ncm_interface.xmit_sequence++;
-  ntb->nth.wBlockLength = sizeof(ntb->nth) + sizeof(ntb->ndp) + sizeof(ntb->ndp_datagram);
-  ntb->nth.wNdpIndex = sizeof(ntb->nth);
+  if (ntb_is_32()) {
+    // Fill in NTB header
+    ntb->nth32.dwSignature = NTH32_SIGNATURE;
+    ntb->nth32.wHeaderLength = sizeof(ntb->nth32);
+    ntb->nth32.wSequence = ncm_interface.xmit_sequence++;
+    ntb->nth32.dwBlockLength = sizeof(ntb->nth32) + sizeof(ntb->ndp32) + sizeof(ntb->ndp32_datagram);
+    ntb->nth32.dwNdpIndex = sizeof(ntb->nth32);
+
+    // Fill in NDP32 header and terminator
+    ntb->ndp32.dwSignature = NDP32_SIGNATURE_NCM0;
+    ntb->ndp32.wLength = sizeof(ntb->ndp32) + sizeof(ntb->ndp32_datagram);
+    ntb->ndp32.wReserved6 = 0;
+    ntb->ndp32.dwNextNdpIndex = 0;
+    ntb->ndp32.dwReserved12 = 0;
+
+    memset(ntb->ndp32_datagram, 0, sizeof(ntb->ndp32_datagram));
+  } else {
+    // Fill in NTB header
+    ntb->nth.dwSignature = NTH16_SIGNATURE;
+    ntb->nth.wHeaderLength = sizeof(ntb->nth);
+    ntb->nth.wSequence = ncm_interface.xmit_sequence++;
+    ntb->nth.wBlockLength = sizeof(ntb->nth) + sizeof(ntb->ndp) + sizeof(ntb->ndp_datagram);
+    ntb->nth.wNdpIndex = sizeof(ntb->nth);
+
+    // Fill in NDP16 header and terminator
+    ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
+    ntb->ndp.wLength = sizeof(ntb->ndp) + sizeof(ntb->ndp_datagram);
+    ntb->ndp.wNextNdpIndex = 0;
+
+    memset(ntb->ndp_datagram, 0, sizeof(ntb->ndp_datagram));
+  }
 
-  // Fill in NDP16 header and terminator
-  ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
-  ntb->ndp.wLength = sizeof(ntb->ndp) + sizeof(ntb->ndp_datagram);
-  ntb->ndp.wNextNdpIndex = 0;
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+  ncm_interface.xmit_glue_ntb_age_us = 0;
+#endif
 
-  memset(ntb->ndp_datagram, 0, sizeof(ntb->ndp_datagram));
+#if CFG_TUD_NCM_XMIT_SG
+  // header is the first piece, datagrams follow
+  xmit_sg_t *sg = xmit_sg_get(ntb);
+  sg->piece[0].buf = ntb->data;
+  sg->piece[0].len = xmit_ntb_header_len();
+  sg->piece_count = 1;
+  sg->ref_count = 0;
+#endif
   return true;
 } // xmit_setup_next_glue_ntb
 
+/**
+ * Enter a datagram of \a size bytes at the end of the glue NTB into its NDP.
+ */
+static void xmit_append_datagram(uint16_t size) {
+  xmit_ntb_t *ntb = ncm_interface.xmit_glue_ntb;
+  uint16_t ndx = ncm_interface.xmit_glue_ntb_datagram_ndx;
+
+  if (ntb_is_32()) {
+    ntb->ndp32_datagram[ndx].dwDatagramIndex = ntb->nth32.dwBlockLength;
+    ntb->ndp32_datagram[ndx].dwDatagramLength = size;
+    ntb->nth32.dwBlockLength += (uint32_t) (size + XMIT_ALIGN_OFFSET(size));
+  } else {
+    ntb->ndp_datagram[ndx].wDatagramIndex = ntb->nth.wBlockLength;
+    ntb->ndp_datagram[ndx].wDatagramLength = size;
+    ntb->nth.wBlockLength += (uint16_t) (size + XMIT_ALIGN_OFFSET(size));
+  }
+  ncm_interface.xmit_glue_ntb_datagram_ndx += 1;
+} // xmit_append_datagram
+
+/**
+ * Drop the NTBs which are not on the wire yet, e.g because they were built in another format.
+ */
+static void xmit_discard_pending_ntbs(void) {
+  TU_LOG_DRV("xmit_discard_pending_ntbs()\n");
+
+  xmit_ntb_t *ntb;
+  while ((ntb = xmit_get_next_ready_ntb()) != NULL) {
+#if CFG_TUD_NCM_XMIT_SG
+    xmit_sg_release(ntb);
+#endif
+    xmit_put_ntb_into_free_list(ntb);
+  }
+  if (ncm_interface.xmit_glue_ntb != NULL) {
+#if CFG_TUD_NCM_XMIT_SG
+    xmit_sg_release(ncm_interface.xmit_glue_ntb);
+#endif
+    xmit_put_ntb_into_free_list(ncm_interface.xmit_glue_ntb);
+    ncm_interface.xmit_glue_ntb = NULL;
+  }
+} // xmit_discard_pending_ntbs
+
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+/**
+ * Aggregation time of the glue NTB is over, called in usbd task.
+ */
+static void xmit_aggregation_timeout(void *param) {
+  (void) param;
+
+  if (!ncm_interface.xmit_aggregation_sof) {
+    usbd_sof_enable(ncm_interface.rhport, SOF_CONSUMER_NCM, false);
+  }
+  xmit_start_if_possible(ncm_interface.rhport);
+} // xmit_aggregation_timeout
+#endif
+
 //-----------------------------------------------------------------------------
 //
 // all the recv_*() stuff (TinyUSB -> driver -> glue logic)
@@ -490,7 +770,7 @@ static void recv_put_ntb_into_free_list(recv_ntb_t *free_ntb) {
  * put this buffer into the waiting list.
  */
 static void recv_put_ntb_into_ready_list(recv_ntb_t *ready_ntb) {
-  TU_LOG_DRV("recv_put_ntb_into_ready_list(%p) %d\n", ready_ntb, ready_ntb->nth.wBlockLength);
+  TU_LOG_DRV("recv_put_ntb_into_ready_list(%p)\n", ready_ntb);
 
   for (int i = 0; i < RECV_NTB_N; ++i) {
     if (ncm_interface.recv_ready_ntb[i] == NULL) {
@@ -501,6 +781,15 @@ static void recv_put_ntb_into_ready_list(recv_ntb_t *ready_ntb) {
   TU_LOG_DRV("(EE) recv_put_ntb_into_ready_list: ready list full\n");// this should not happen
 } // recv_put_ntb_into_ready_list
 
+/**
+ * Receive the next part of the running NTB, NTBs longer than \a NCM_XFER_MAX are split.
+ */
+static bool recv_submit_next(uint8_t rhport) {
+  ncm_interface.recv_xfer_len = (uint16_t) tu_min32(CFG_TUD_NCM_OUT_NTB_MAX_SIZE - ncm_interface.recv_tinyusb_len, NCM_XFER_MAX);
+  return usbd_edpt_xfer(rhport, ncm_interface.ep_out, ncm_interface.recv_tinyusb_ntb->data + ncm_interface.recv_tinyusb_len,
+                        ncm_interface.recv_xfer_len);
+} // recv_submit_next
+
 /**
  * If possible, start a new reception TinyUSB -> driver.
  */
@@ -524,89 +813,141 @@ static void recv_try_to_start_new_reception(uint8_t rhport) {
 
   // initiate transfer
   TU_LOG_DRV("  start reception\n");
-  bool r = usbd_edpt_xfer(rhport, ncm_interface.ep_out, ncm_interface.recv_tinyusb_ntb->data, CFG_TUD_NCM_OUT_NTB_MAX_SIZE);
+  ncm_interface.recv_tinyusb_len = 0;
+  bool r = recv_submit_next(rhport);
   if (!r) {
     recv_put_ntb_into_free_list(ncm_interface.recv_tinyusb_ntb);
     ncm_interface.recv_tinyusb_ntb = NULL;
   }
 } // recv_try_to_start_new_reception
 
+/**
+ * Check if a received NTB is a 32-bit NTB.
+ * Format is taken from the validated NTB itself, the host may have changed the selection since it was received.
+ */
+static inline bool recv_ntb_is_32(const recv_ntb_t *ntb) {
+  return CFG_TUD_NCM_NTB32 && ntb->nth32.dwSignature == NTH32_SIGNATURE;
+}
+
+/**
+ * Get start and length of datagram \a ndx from the (first) NDP of a received NTB.
+ * A zero entry terminates the list.
+ */
+static void recv_get_datagram(const recv_ntb_t *ntb, uint16_t ndx, uint32_t *index, uint32_t *length) {
+  if (recv_ntb_is_32(ntb)) {
+    const ndp32_datagram_t *ndp32_datagram = (const ndp32_datagram_t *) (ntb->data + ntb->nth32.dwNdpIndex + sizeof(ndp32_t));
+    *index = ndp32_datagram[ndx].dwDatagramIndex;
+    *length = ndp32_datagram[ndx].dwDatagramLength;
+  } else {
+    const ndp16_datagram_t *ndp16_datagram = (const ndp16_datagram_t *) (ntb->data + ntb->nth.wNdpIndex + sizeof(ndp16_t));
+    *index = ndp16_datagram[ndx].wDatagramIndex;
+    *length = ndp16_datagram[ndx].wDatagramLength;
+  }
+} // recv_get_datagram
+
 /**
  * Validate incoming datagram.
+ * NTB-16 or NTB-32 is expected depending on the format selected by the host.
  * \return true if valid
  *
  * \note
- *    \a ndp16->wNextNdpIndex != 0 is not supported
+ *    \a wNextNdpIndex != 0 is not supported
  */
 static bool recv_validate_datagram(const recv_ntb_t *ntb, uint32_t len) {
-  const nth16_t *nth16 = &(ntb->nth);
+  bool const is32 = ntb_is_32();
+  uint32_t const nth_size = is32 ? sizeof(nth32_t) : sizeof(nth16_t);
+  uint32_t const ndp_size = is32 ? sizeof(ndp32_t) : sizeof(ndp16_t);
+  uint32_t const entry_size = is32 ? sizeof(ndp32_datagram_t) : sizeof(ndp16_datagram_t);
 
   TU_LOG_DRV("recv_validate_datagram(%p, %d)\n", ntb, (int) len);
 
   // check header
-  if (nth16->wHeaderLength != sizeof(nth16_t)) {
-    TU_LOG_DRV("(EE) ill nth16 length: %d\n", nth16->wHeaderLength);
+  uint16_t const header_length = is32 ? ntb->nth32.wHeaderLength : ntb->nth.wHeaderLength;
+  uint32_t const signature = is32 ? ntb->nth32.dwSignature : ntb->nth.dwSignature;
+  uint32_t const block_length = is32 ? ntb->nth32.dwBlockLength : ntb->nth.wBlockLength;
+  uint32_t const ndp_index = is32 ? ntb->nth32.dwNdpIndex : ntb->nth.wNdpIndex;
+
+  if (header_length != nth_size) {
+    TU_LOG_DRV("(EE) ill nth length: %d\n", header_length);
     return false;
   }
-  if (nth16->dwSignature != NTH16_SIGNATURE) {
-    TU_LOG_DRV("(EE) ill signature: 0x%08x\n", (unsigned) nth16->dwSignature);
+  if (signature != (is32 ? NTH32_SIGNATURE : NTH16_SIGNATURE)) {
+    TU_LOG_DRV("(EE) ill signature: 0x%08x\n", (unsigned) signature);
     return false;
   }
-  if (len < sizeof(nth16_t) + sizeof(ndp16_t) + 2 * sizeof(ndp16_datagram_t)) {
-    TU_LOG_DRV("(EE) ill min len: %lu\n", len);
+  if (len < nth_size + ndp_size + 2 * entry_size) {
+    TU_LOG_DRV("(EE) ill min len: %" PRIu32 "\n", len);
     return false;
   }
-  if (nth16->wBlockLength > len) {
-    TU_LOG_DRV("(EE) ill block length: %d > %lu\n", nth16->wBlockLength, len);
+  if (block_length > len) {
+    TU_LOG_DRV("(EE) ill block length: %" PRIu32 " > %" PRIu32 "\n", block_length, len);
     return false;
   }
-  if (nth16->wBlockLength > CFG_TUD_NCM_OUT_NTB_MAX_SIZE) {
-    TU_LOG_DRV("(EE) ill block length2: %d > %d\n", nth16->wBlockLength, CFG_TUD_NCM_OUT_NTB_MAX_SIZE);
+  if (block_length > CFG_TUD_NCM_OUT_NTB_MAX_SIZE) {
+    TU_LOG_DRV("(EE) ill block length2: %" PRIu32 " > %d\n", block_length, CFG_TUD_NCM_OUT_NTB_MAX_SIZE);
     return false;
   }
-  if (nth16->wNdpIndex < sizeof(nth16) || nth16->wNdpIndex > len - (sizeof(ndp16_t) + 2 * sizeof(ndp16_datagram_t))) {
-    TU_LOG_DRV("(EE) ill position of first ndp: %d (%lu)\n", nth16->wNdpIndex, len);
+  if (ndp_index < nth_size || ndp_index > len - (ndp_size + 2 * entry_size)) {
+    TU_LOG_DRV("(EE) ill position of first ndp: %" PRIu32 " (%" PRIu32 ")\n", ndp_index, len);
     return false;
   }
 
-  // check (first) NDP(16)
-  const ndp16_t *ndp16 = (const ndp16_t *) (ntb->data + nth16->wNdpIndex);
+  // check (first) NDP
+  uint16_t ndp_length;
+  uint32_t ndp_signature;
+  uint32_t next_ndp_index;
+  if (is32) {
+    const ndp32_t *ndp32 = (const ndp32_t *) (ntb->data + ndp_index);
+    ndp_length = ndp32->wLength;
+    ndp_signature = ndp32->dwSignature;
+    next_ndp_index = ndp32->dwNextNdpIndex;
+  } else {
+    const ndp16_t *ndp16 = (const ndp16_t *) (ntb->data + ndp_index);
+    ndp_length = ndp16->wLength;
+    ndp_signature = ndp16->dwSignature;
+    next_ndp_index = ndp16->wNextNdpIndex;
+  }
 
-  if (ndp16->wLength < sizeof(ndp16_t) + 2 * sizeof(ndp16_datagram_t)) {
-    TU_LOG_DRV("(EE) ill ndp16 length: %d\n", ndp16->wLength);
+  if (ndp_length < ndp_size + 2 * entry_size || ndp_index + ndp_length > len) {
+    TU_LOG_DRV("(EE) ill ndp length: %d\n", ndp_length);
     return false;
   }
-  if (ndp16->dwSignature != NDP16_SIGNATURE_NCM0 && ndp16->dwSignature != NDP16_SIGNATURE_NCM1) {
-    TU_LOG_DRV("(EE) ill signature: 0x%08x\n", (unsigned) ndp16->dwSignature);
+  if (is32 ? (ndp_signature != NDP32_SIGNATURE_NCM0 && ndp_signature != NDP32_SIGNATURE_NCM1)
+           : (ndp_signature != NDP16_SIGNATURE_NCM0 && ndp_signature != NDP16_SIGNATURE_NCM1)) {
+    TU_LOG_DRV("(EE) ill signature: 0x%08x\n", (unsigned) ndp_signature);
     return false;
   }
-  if (ndp16->wNextNdpIndex != 0) {
-    TU_LOG_DRV("(EE) cannot handle wNextNdpIndex!=0 (%d)\n", ndp16->wNextNdpIndex);
+  if (next_ndp_index != 0) {
+    TU_LOG_DRV("(EE) cannot handle wNextNdpIndex!=0 (%" PRIu32 ")\n", next_ndp_index);
     return false;
   }
 
-  const ndp16_datagram_t *ndp16_datagram = (const ndp16_datagram_t *) (ntb->data + nth16->wNdpIndex + sizeof(ndp16_t));
-  int ndx = 0;
-  uint16_t max_ndx = (uint16_t) ((ndp16->wLength - sizeof(ndp16_t)) / sizeof(ndp16_datagram_t));
+  uint16_t ndx = 0;
+  uint16_t max_ndx = (uint16_t) ((ndp_length - ndp_size) / entry_size);
+  uint32_t datagram_index;
+  uint32_t datagram_length;
 
   if (max_ndx > 2) { // number of datagrams in NTB > 1
-    TU_LOG_DRV("<< %d (%d)\n", max_ndx - 1, ntb->nth.wBlockLength);
+    TU_LOG_DRV("<< %d (%" PRIu32 ")\n", max_ndx - 1, block_length);
   }
-  if (ndp16_datagram[max_ndx - 1].wDatagramIndex != 0 || ndp16_datagram[max_ndx - 1].wDatagramLength != 0) {
+  recv_get_datagram(ntb, max_ndx - 1, &datagram_index, &datagram_length);
+  if (datagram_index != 0 || datagram_length != 0) {
     TU_LOG_DRV("  max_ndx != 0\n");
     return false;
   }
-  while (ndp16_datagram[ndx].wDatagramIndex != 0 && ndp16_datagram[ndx].wDatagramLength != 0) {
-    TU_LOG_DRV("  << %d %d\n", ndp16_datagram[ndx].wDatagramIndex, ndp16_datagram[ndx].wDatagramLength);
-    if (ndp16_datagram[ndx].wDatagramIndex > len) {
-      TU_LOG_DRV("(EE) ill start of datagram[%d]: %d (%lu)\n", ndx, ndp16_datagram[ndx].wDatagramIndex, len);
+  recv_get_datagram(ntb, ndx, &datagram_index, &datagram_length);
+  while (datagram_index != 0 && datagram_length != 0) {
+    TU_LOG_DRV("  << %" PRIu32 " %" PRIu32 "\n", datagram_index, datagram_length);
+    if (datagram_index > len) {
+      TU_LOG_DRV("(EE) ill start of datagram[%d]: %" PRIu32 " (%" PRIu32 ")\n", ndx, datagram_index, len);
       return false;
     }
-    if (ndp16_datagram[ndx].wDatagramIndex + ndp16_datagram[ndx].wDatagramLength > len) {
-      TU_LOG_DRV("(EE) ill end of datagram[%d]: %d (%lu)\n", ndx, ndp16_datagram[ndx].wDatagramIndex + ndp16_datagram[ndx].wDatagramLength, len);
+    if (datagram_length > UINT16_MAX || datagram_index + datagram_length > len) {
+      TU_LOG_DRV("(EE) ill end of datagram[%d]: %" PRIu32 " (%" PRIu32 ")\n", ndx, datagram_index + datagram_length, len);
       return false;
     }
     ++ndx;
+    recv_get_datagram(ntb, ndx, &datagram_index, &datagram_length);
   }
 
   #if CFG_TUD_NCM_LOG_LEVEL >= 3
@@ -618,6 +959,58 @@ static bool recv_validate_datagram(const recv_ntb_t *ntb, uint32_t len) {
   return true;
 } // recv_validate_datagram
 
+#if CFG_TUD_NCM_RECV_BATCH
+/**
+ * Transfer the next (pending) datagrams to the glue logic as one batch.
+ * The receive buffer is returned by tud_network_recv_batch_release().
+ */
+static void recv_transfer_batch_to_glue_logic(void) {
+  TU_LOG_DRV("recv_transfer_batch_to_glue_logic()\n");
+
+  if (ncm_interface.recv_batch_count != 0) {
+    // glue logic has not released the previous batch
+    return;
+  }
+
+  if (ncm_interface.recv_glue_ntb == NULL) {
+    ncm_interface.recv_glue_ntb = recv_get_next_ready_ntb();
+    TU_LOG_DRV("  new buffer for glue logic: %p\n", ncm_interface.recv_glue_ntb);
+    ncm_interface.recv_glue_ntb_datagram_ndx = 0;
+  }
+  if (ncm_interface.recv_glue_ntb == NULL) {
+    return;
+  }
+
+  uint16_t count = 0;
+  while (count < RECV_BATCH_N) {
+    uint32_t datagramIndex;
+    uint32_t datagramLength;
+    recv_get_datagram(ncm_interface.recv_glue_ntb, ncm_interface.recv_glue_ntb_datagram_ndx + count, &datagramIndex, &datagramLength);
+    if (datagramIndex == 0 || datagramLength == 0) {
+      break;
+    }
+    ncm_interface.recv_batch[count].buf = ncm_interface.recv_glue_ntb->data + datagramIndex;
+    ncm_interface.recv_batch[count].len = (uint16_t) datagramLength;
+    ++count;
+  }
+  TU_LOG_DRV("  recv[%d] - %d datagrams\n", ncm_interface.recv_glue_ntb_datagram_ndx, count);
+
+  if (count == 0) {
+    // NTB without datagrams: nothing to hand over, the glue logic would never release it
+    recv_put_ntb_into_free_list(ncm_interface.recv_glue_ntb);
+    ncm_interface.recv_glue_ntb = NULL;
+    ncm_interface.tud_network_recv_renew_process_again = true;
+    return;
+  }
+
+  // set before the callback, glue logic may release the batch from within
+  ncm_interface.recv_batch_count = count;
+  if (!tud_network_recv_batch_cb(ncm_interface.recv_batch, count)) {
+    ncm_interface.recv_batch_count = 0;
+  }
+} // recv_transfer_batch_to_glue_logic
+
+#else
 /**
  * Transfer the next (pending) datagram to the glue logic and return receive buffer if empty.
  */
@@ -631,22 +1024,22 @@ static void recv_transfer_datagram_to_glue_logic(void) {
   }
 
   if (ncm_interface.recv_glue_ntb != NULL) {
-    const ndp16_datagram_t *ndp16_datagram = (ndp16_datagram_t *) (ncm_interface.recv_glue_ntb->data + ncm_interface.recv_glue_ntb->nth.wNdpIndex + sizeof(ndp16_t));
-
-    if (ndp16_datagram[ncm_interface.recv_glue_ntb_datagram_ndx].wDatagramIndex == 0) {
-      TU_LOG_DRV("(EE) SOMETHING WENT WRONG 1\n");
-    } else if (ndp16_datagram[ncm_interface.recv_glue_ntb_datagram_ndx].wDatagramLength == 0) {
-      TU_LOG_DRV("(EE) SOMETHING WENT WRONG 2\n");
+    uint32_t datagramIndex;
+    uint32_t datagramLength;
+    recv_get_datagram(ncm_interface.recv_glue_ntb, ncm_interface.recv_glue_ntb_datagram_ndx, &datagramIndex, &datagramLength);
+
+    if (datagramIndex == 0 || datagramLength == 0) {
+      // NTB without datagrams: return it and continue with the next one
+      TU_LOG_DRV("  empty NTB\n");
+      recv_put_ntb_into_free_list(ncm_interface.recv_glue_ntb);
+      ncm_interface.recv_glue_ntb = NULL;
+      ncm_interface.tud_network_recv_renew_process_again = true;
     } else {
-      uint16_t datagramIndex = ndp16_datagram[ncm_interface.recv_glue_ntb_datagram_ndx].wDatagramIndex;
-      uint16_t datagramLength = ndp16_datagram[ncm_interface.recv_glue_ntb_datagram_ndx].wDatagramLength;
-
-      TU_LOG_DRV("  recv[%d] - %d %d\n", ncm_interface.recv_glue_ntb_datagram_ndx, datagramIndex, datagramLength);
-      if (tud_network_recv_cb(ncm_interface.recv_glue_ntb->data + datagramIndex, datagramLength)) {
+      TU_LOG_DRV("  recv[%d] - %" PRIu32 " %" PRIu32 "\n", ncm_interface.recv_glue_ntb_datagram_ndx, datagramIndex, datagramLength);
+      if (tud_network_recv_cb(ncm_interface.recv_glue_ntb->data + datagramIndex, (uint16_t) datagramLength)) {
         // send datagram successfully to glue logic
         TU_LOG_DRV("    OK\n");
-        datagramIndex = ndp16_datagram[ncm_interface.recv_glue_ntb_datagram_ndx + 1].wDatagramIndex;
-        datagramLength = ndp16_datagram[ncm_interface.recv_glue_ntb_datagram_ndx + 1].wDatagramLength;
+        recv_get_datagram(ncm_interface.recv_glue_ntb, ncm_interface.recv_glue_ntb_datagram_ndx + 1, &datagramIndex, &datagramLength);
 
         if (datagramIndex != 0 && datagramLength != 0) {
           // -> next datagram
@@ -660,6 +1053,7 @@ static void recv_transfer_datagram_to_glue_logic(void) {
     }
   }
 } // recv_transfer_datagram_to_glue_logic
+#endif
 
 //-----------------------------------------------------------------------------
 //
@@ -674,7 +1068,7 @@ static void recv_transfer_datagram_to_glue_logic(void) {
 bool tud_network_can_xmit(uint16_t size) {
   TU_LOG_DRV("tud_network_can_xmit(%d)\n", size);
 
-  TU_ASSERT(size <= CFG_TUD_NCM_IN_NTB_MAX_SIZE - (sizeof(nth16_t) + sizeof(ndp16_t) + 2 * sizeof(ndp16_datagram_t)), false);
+  TU_ASSERT(size <= xmit_ntb_max_len() - xmit_ntb_header_len(), false);
 
   if (xmit_requested_datagram_fits_into_current_ntb(size) || xmit_setup_next_glue_ntb()) {
     // -> everything is fine
@@ -685,6 +1079,7 @@ bool tud_network_can_xmit(uint16_t size) {
   return false;
 } // tud_network_can_xmit
 
+#if !CFG_TUD_NCM_XMIT_SG
 /**
  * Put a datagram into a waiting NTB.
  * If currently no transmission is started, then initiate transmission.
@@ -700,16 +1095,12 @@ void tud_network_xmit(void *ref, uint16_t arg) {
   xmit_ntb_t *ntb = ncm_interface.xmit_glue_ntb;
 
   // copy new datagram to the end of the current NTB
-  uint16_t size = tud_network_xmit_cb(ntb->data + ntb->nth.wBlockLength, ref, arg);
+  uint16_t size = tud_network_xmit_cb(ntb->data + xmit_ntb_len(ntb), ref, arg);
 
   // correct NTB internals
-  ntb->ndp_datagram[ncm_interface.xmit_glue_ntb_datagram_ndx].wDatagramIndex = ntb->nth.wBlockLength;
-  ntb->ndp_datagram[ncm_interface.xmit_glue_ntb_datagram_ndx].wDatagramLength = size;
-  ncm_interface.xmit_glue_ntb_datagram_ndx += 1;
-
-  ntb->nth.wBlockLength += (uint16_t) (size + XMIT_ALIGN_OFFSET(size));
+  xmit_append_datagram(size);
 
-  if (ntb->nth.wBlockLength > CFG_TUD_NCM_IN_NTB_MAX_SIZE) {
+  if (xmit_ntb_len(ntb) > xmit_ntb_max_len()) {
     TU_LOG_DRV("(EE) tud_network_xmit: buffer overflow\n"); // must not happen (really)
     return;
   }
@@ -717,6 +1108,53 @@ void tud_network_xmit(void *ref, uint16_t arg) {
   xmit_start_if_possible(ncm_interface.rhport);
 } // tud_network_xmit
 
+#else
+/**
+ * Reference a datagram consisting of \a count segments in a waiting NTB, nothing is copied.
+ * If currently no transmission is started, then initiate transmission.
+ */
+bool tud_network_xmit_sg(void *ref, tud_network_seg_t const *segs, uint8_t count) {
+  TU_LOG_DRV("tud_network_xmit_sg(%p, %d)\n", ref, count);
+
+  // datagrams which never fit into an NTB are refused, not a driver error
+  TU_VERIFY(count <= CFG_TUD_NCM_IN_MAX_SEGMENTS_PER_NTB, false);
+
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    total += segs[i].len;
+  }
+  TU_VERIFY(total > 0 && total <= xmit_ntb_max_len() - xmit_ntb_header_len(), false);
+  uint16_t const size = (uint16_t) total;
+
+  // tud_network_can_xmit() has checked the size, but the gather list of the NTB may be full nevertheless
+  bool fits = xmit_requested_datagram_fits_into_current_ntb(size) &&
+              xmit_sg_get(ncm_interface.xmit_glue_ntb)->piece_count + count + 1 <= XMIT_SG_PIECE_N;
+  if (!fits && !xmit_setup_next_glue_ntb()) {
+    xmit_start_if_possible(ncm_interface.rhport);
+    TU_LOG_DRV("(II) tud_network_xmit_sg: request blocked\n");
+    return false;
+  }
+
+  xmit_sg_t *sg = xmit_sg_get(ncm_interface.xmit_glue_ntb);
+  for (uint8_t i = 0; i < count; ++i) {
+    if (segs[i].len != 0) {
+      sg->piece[sg->piece_count++] = segs[i];
+    }
+  }
+  if (XMIT_ALIGN_OFFSET(size) != 0) {
+    sg->piece[sg->piece_count].buf = NULL;
+    sg->piece[sg->piece_count].len = XMIT_ALIGN_OFFSET(size);
+    sg->piece_count++;
+  }
+  sg->ref[sg->ref_count++] = ref;
+
+  xmit_append_datagram(size);
+
+  xmit_start_if_possible(ncm_interface.rhport);
+  return true;
+} // tud_network_xmit_sg
+#endif
+
 /**
  * Keep the receive logic busy and transfer pending packets to the glue logic.
  * Avoid recursive calls due to wrong expectations of the net glue logic,
@@ -739,12 +1177,42 @@ void tud_network_recv_renew(void) {
     // tud_network_recv_renew_process_again will become true, and the loop will run again
     // Otherwise the loop will not run again
     ncm_interface.tud_network_recv_renew_active = true;
+#if CFG_TUD_NCM_RECV_BATCH
+    recv_transfer_batch_to_glue_logic();
+#else
     recv_transfer_datagram_to_glue_logic();
+#endif
     ncm_interface.tud_network_recv_renew_active = false;
   }
   recv_try_to_start_new_reception(ncm_interface.rhport);
 } // tud_network_recv_renew
 
+#if CFG_TUD_NCM_RECV_BATCH
+/**
+ * Glue logic is done with the batch from tud_network_recv_batch_cb(),
+ * return the NTB to the free list if all of its datagrams are handled and continue.
+ */
+void tud_network_recv_batch_release(void) {
+  TU_LOG_DRV("tud_network_recv_batch_release()\n");
+
+  TU_VERIFY(ncm_interface.recv_glue_ntb != NULL && ncm_interface.recv_batch_count != 0,);
+
+  ncm_interface.recv_glue_ntb_datagram_ndx += ncm_interface.recv_batch_count;
+  ncm_interface.recv_batch_count = 0;
+
+  uint32_t datagramIndex;
+  uint32_t datagramLength;
+  recv_get_datagram(ncm_interface.recv_glue_ntb, ncm_interface.recv_glue_ntb_datagram_ndx, &datagramIndex, &datagramLength);
+  if (datagramIndex == 0 || datagramLength == 0) {
+    // end of datagrams reached
+    recv_put_ntb_into_free_list(ncm_interface.recv_glue_ntb);
+    ncm_interface.recv_glue_ntb = NULL;
+  }
+
+  tud_network_recv_renew();
+} // tud_network_recv_batch_release
+#endif
+
 /**
  * Same as tud_network_recv_renew() but knows \a rhport
  */
@@ -774,6 +1242,10 @@ void netd_init(void) {
   for (int i = 0; i < RECV_NTB_N; ++i) {
     ncm_interface.recv_free_ntb[i] = &ncm_epbuf.recv[i].ntb;
   }
+
+  ncm_interface.ntb_format = NCM_NTB_FORMAT_16;
+  ncm_interface.ntb_in_max_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
+  ncm_interface.ntb_in_max_datagrams = CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB;
 } // netd_init
 
 /**
@@ -790,9 +1262,41 @@ bool netd_deinit(void) {
 void netd_reset(uint8_t rhport) {
   (void) rhport;
 
+#if CFG_TUD_NCM_XMIT_SG
+  // hand back datagrams which are waiting or on the wire
+  for (int i = 0; i < XMIT_NTB_N; ++i) {
+    xmit_sg_release(&ncm_epbuf.xmit[i].ntb);
+  }
+#endif
+
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+  usbd_sof_enable(rhport, SOF_CONSUMER_NCM, false);
+#endif
+
   netd_init();
 } // netd_reset
 
+/**
+ * SOF handler in ISR context, counts the time the glue NTB is waiting for further datagrams.
+ */
+void netd_sof(uint8_t rhport, uint8_t port_num, uint32_t frame_count) {
+  (void) rhport;
+  (void) port_num;
+  (void) frame_count;
+
+#if CFG_TUD_NCM_IN_AGGREGATION_US
+  if (!ncm_interface.xmit_aggregation_sof) {
+    return;
+  }
+
+  ncm_interface.xmit_glue_ntb_age_us += (tud_speed_get(port_num) == TUSB_SPEED_HIGH) ? 125 : 1000;
+  if (ncm_interface.xmit_glue_ntb_age_us >= CFG_TUD_NCM_IN_AGGREGATION_US) {
+    ncm_interface.xmit_aggregation_sof = false;
+    usbd_defer_func(xmit_aggregation_timeout, NULL, true);
+  }
+#endif
+} // netd_sof
+
 /**
  * Open the USB interface.
  * - parse the USB descriptor \a TUD_CDC_NCM_DESCRIPTOR for itfnum and endpoints
@@ -852,10 +1356,21 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 
   if (ep_addr == ncm_interface.ep_out) {
     // new NTB received
+    // - continue reception if the NTB is longer than a single transfer
     // - make the NTB valid
     // - if ready transfer datagrams to the glue logic for further processing
     // - if there is a free receive buffer, initiate reception
-    if (!recv_validate_datagram(ncm_interface.recv_tinyusb_ntb, xferred_bytes)) {
+    ncm_interface.recv_tinyusb_len += xferred_bytes;
+    if (xferred_bytes == ncm_interface.recv_xfer_len && ncm_interface.recv_tinyusb_len < CFG_TUD_NCM_OUT_NTB_MAX_SIZE) {
+      // no short packet yet
+      if (recv_submit_next(rhport)) {
+        return true;
+      }
+      // reception cannot be continued: finish the NTB with what is there, validation drops it if incomplete
+      TU_LOG_DRV("(EE) continuation of NTB failed\n");
+    }
+
+    if (!recv_validate_datagram(ncm_interface.recv_tinyusb_ntb, ncm_interface.recv_tinyusb_len)) {
       // verification failed: ignore NTB and return it to free
       TU_LOG_DRV("Invalid datatagram. Ignoring NTB\n");
       recv_put_ntb_into_free_list(ncm_interface.recv_tinyusb_ntb);
@@ -870,6 +1385,17 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     // - free the transmitted NTB buffer
     // - insert ZLPs when necessary
     // - if there is another transmit NTB waiting, try to start transmission
+    if (ncm_interface.xmit_tinyusb_ntb != NULL) {
+      if (ncm_interface.xmit_sent < xmit_ntb_len(ncm_interface.xmit_tinyusb_ntb)) {
+        // only a part of the NTB is done
+        xmit_submit_next(rhport);
+        return true;
+      }
+#if CFG_TUD_NCM_XMIT_SG
+      xmit_sg_release(ncm_interface.xmit_tinyusb_ntb);
+#endif
+      xferred_bytes = ncm_interface.xmit_sent;// ZLP depends on length of the whole NTB
+    }
     xmit_put_ntb_into_free_list(ncm_interface.xmit_tinyusb_ntb);
     ncm_interface.xmit_tinyusb_ntb = NULL;
     if (!xmit_insert_required_zlp(rhport, xferred_bytes)) {
@@ -883,11 +1409,44 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   return true;
 } // netd_xfer_cb
 
+#if CFG_TUD_NCM_XMIT_SG
+/**
+ * Transfer complete in ISR context (CFG_TUD_XFER_ISR), only ep_in is enabled.
+ * Next part of the running NTB is submitted right away so that the gather list costs no extra round trip through
+ * tud_task(). Completion of the last part is left to netd_xfer_cb() which hands the datagrams back.
+ */
+bool netd_xfer_isr_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) port_num;
+  (void) xferred_bytes;
+
+  if (ep_addr != ncm_interface.ep_in || result != XFER_RESULT_SUCCESS || ncm_interface.xmit_tinyusb_ntb == NULL ||
+      ncm_interface.xmit_sent >= xmit_ntb_len(ncm_interface.xmit_tinyusb_ntb)) {
+    return false;
+  }
+
+  xmit_submit_next(rhport);
+  return true;
+} // netd_xfer_isr_cb
+#endif
+
 /**
  * Respond to TinyUSB control requests.
  * At startup transmission of notification packets are done here.
  */
 bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request) {
+  if (stage == CONTROL_STAGE_DATA && request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
+      request->bRequest == NCM_SET_NTB_INPUT_SIZE) {
+    // host limits the xmit NTBs, wNtbInMaxDatagrams is optional and 0 means no limit
+    uint32_t const size = ncm_interface.ntb_input_size.dwNtbInMaxSize;
+    TU_VERIFY(size >= tu_min32(NCM_NTB_IN_MIN_SIZE, CFG_TUD_NCM_IN_NTB_MAX_SIZE) && size <= CFG_TUD_NCM_IN_NTB_MAX_SIZE, false);
+
+    ncm_interface.ntb_in_max_size = size;
+    ncm_interface.ntb_in_max_datagrams = CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB;
+    if (request->wLength == sizeof(ntb_input_size_t) && ncm_interface.ntb_input_size.wNtbInMaxDatagrams != 0) {
+      ncm_interface.ntb_in_max_datagrams = tu_min16(ncm_interface.ntb_input_size.wNtbInMaxDatagrams, CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB);
+    }
+    return true;
+  }
   if (stage != CONTROL_STAGE_SETUP) {
     return true;
   }
@@ -907,9 +1466,22 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
           ncm_interface.itf_data_alt = (uint8_t) request->wValue;
 
+#if CFG_TUD_NCM_XMIT_SG && CFG_TUD_XFER_ISR
+          // following parts of an NTB are submitted in netd_xfer_isr_cb()
+          usbd_edpt_isr_set(rhport, ncm_interface.ep_in, ncm_interface.itf_data_alt == 1);
+#endif
+
           if (ncm_interface.itf_data_alt == 1) {
             tud_network_recv_renew_r(rhport);
             notification_xmit(rhport, false);
+          } else {
+            // NTB format and input size are back to default (spec, chapter 7.2)
+            if (ncm_interface.ntb_format != NCM_NTB_FORMAT_16) {
+              xmit_discard_pending_ntbs();
+              ncm_interface.ntb_format = NCM_NTB_FORMAT_16;
+            }
+            ncm_interface.ntb_in_max_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
+            ncm_interface.ntb_in_max_datagrams = CFG_TUD_NCM_IN_MAX_DATAGRAMS_PER_NTB;
           }
           tud_control_status(rhport, request);
         } break;
@@ -928,6 +1500,35 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
           tud_control_xfer(rhport, request, (void *) (uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
         } break;
 
+        case NCM_GET_NTB_FORMAT: {
+          tud_control_xfer(rhport, request, &ncm_interface.ntb_format, sizeof(ncm_interface.ntb_format));
+        } break;
+
+        case NCM_SET_NTB_FORMAT: {
+          // format can only be changed while data interface is in alternate setting 0
+          TU_VERIFY(request->wValue == NCM_NTB_FORMAT_16 || (CFG_TUD_NCM_NTB32 && request->wValue == NCM_NTB_FORMAT_32), false);
+          TU_VERIFY(ncm_interface.itf_data_alt == 0, false);
+
+          if (ncm_interface.ntb_format != request->wValue) {
+            xmit_discard_pending_ntbs();
+            ncm_interface.ntb_format = request->wValue;
+          }
+          tud_control_status(rhport, request);
+        } break;
+
+        case NCM_GET_NTB_INPUT_SIZE: {
+          ncm_interface.ntb_input_size.dwNtbInMaxSize = ncm_interface.ntb_in_max_size;
+          ncm_interface.ntb_input_size.wNtbInMaxDatagrams = ncm_interface.ntb_in_max_datagrams;
+          ncm_interface.ntb_input_size.wReserved = 0;
+          tud_control_xfer(rhport, request, &ncm_interface.ntb_input_size, sizeof(ncm_interface.ntb_input_size));
+        } break;
+
+        case NCM_SET_NTB_INPUT_SIZE: {
+          // applied in data stage
+          TU_VERIFY(request->wLength == 4 || request->wLength == sizeof(ntb_input_size_t), false);
+          tud_control_xfer(rhport, request, &ncm_interface.ntb_input_size, request->wLength);
+        } break;
+
           // unsupported request
         default:
           return false;
@@ -55,6 +55,12 @@ typedef enum
  extern "C" {
 #endif
 
+// Buffer segment of a datagram for tud_network_xmit_sg()
+typedef struct {
+  void const *buf;
+  uint16_t len;
+} tud_network_seg_t;
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -62,12 +68,22 @@ typedef enum
 // indicate to network driver that client has finished with the packet provided to network_recv_cb()
 void tud_network_recv_renew(void);
 
+// NCM with CFG_TUD_NCM_RECV_BATCH only: client has finished with all datagrams provided to network_recv_batch_cb(),
+// their NTB is reused for reception
+void tud_network_recv_batch_release(void);
+
 // poll network driver for its ability to accept another packet to transmit
 bool tud_network_can_xmit(uint16_t size);
 
 // if network_can_xmit() returns true, network_xmit() can be called once
 void tud_network_xmit(void *ref, uint16_t arg);
 
+// NCM with CFG_TUD_NCM_XMIT_SG only: if network_can_xmit() returns true, queue a datagram made of count segments
+// which are sent in place. Buffers must stay valid until tud_network_xmit_done_cb(ref) is invoked.
+// Return false (and keep ownership with caller) if the datagram does not fit into any free NTB, or if it has more than
+// CFG_TUD_NCM_IN_MAX_SEGMENTS_PER_NTB segments or is empty or larger than an NTB and never fits.
+bool tud_network_xmit_sg(void *ref, tud_network_seg_t const *segs, uint8_t count);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -75,9 +91,18 @@ void tud_network_xmit(void *ref, uint16_t arg);
 // client must provide this: return false if the packet buffer was not accepted
 bool tud_network_recv_cb(const uint8_t *src, uint16_t size);
 
+// NCM with CFG_TUD_NCM_RECV_BATCH only, client must provide this instead of network_recv_cb(): count datagrams
+// pointing into the received NTB, valid until tud_network_recv_batch_release(). Return false if not accepted,
+// they are offered again on next tud_network_recv_renew()
+bool tud_network_recv_batch_cb(tud_network_seg_t const *datagrams, uint16_t count);
+
 // client must provide this: copy from network stack packet pointer to dst
 uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg);
 
+// NCM with CFG_TUD_NCM_XMIT_SG only, client must provide this: datagram passed to tud_network_xmit_sg() is sent
+// or dropped (e.g bus reset), its buffers are owned by client again
+void tud_network_xmit_done_cb(void *ref);
+
 //------------- ECM/RNDIS -------------//
 
 // client must provide this: initialize any network state back to the beginning
@@ -97,6 +122,8 @@ uint16_t netd_open            (uint8_t rhport, tusb_desc_interface_t const * itf
 bool     netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     netd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 void     netd_report          (uint8_t *buf, uint16_t len);
+void     netd_sof             (uint8_t rhport, uint8_t port_num, uint32_t frame_count); // NCM only
+bool     netd_xfer_isr_cb     (uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes); // NCM with CFG_TUD_NCM_XMIT_SG only
 
 #ifdef __cplusplus
  }
@@ -98,6 +98,18 @@ typedef union {
   tusb_desc_video_frame_framebased_t  frame_based;
 } tusb_desc_cs_video_frm_t;
 
+TU_VERIFY_STATIC(CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH >= 1 && CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH <= UINT8_MAX, "Queue depth is not correct");
+TU_VERIFY_STATIC(CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE <= UINT16_MAX, "Payload size is not correct");
+TU_VERIFY_STATIC(CFG_TUD_VIDEO_STREAMING_XFER_SG || CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE <= CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE,
+                 "Payload larger than endpoint buffer requires CFG_TUD_VIDEO_STREAMING_XFER_SG");
+
+/* queued frame or slice of a frame */
+typedef struct TU_ATTR_PACKED {
+  uint8_t *buffer;      /* assume linear buffer. no support for stride access */
+  uint32_t bufsize;
+  uint8_t  end_of_frame;
+} videod_slice_t;
+
 /* video streaming interface */
 typedef struct TU_ATTR_PACKED {
   uint8_t index_vc;  /* index of bound video control interface */
@@ -108,9 +120,16 @@ typedef struct TU_ATTR_PACKED {
     uint16_t cur;    /* Offset of the current settings */
     uint16_t ep[2];  /* Offset of endpoint descriptors. 0: streaming, 1: still capture */
   } desc;
-  uint8_t *buffer;   /* frame buffer. assume linear buffer. no support for stride access */
-  uint32_t bufsize;  /* frame buffer size */
+  videod_slice_t queue[CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH]; /* frames or slices to be sent */
+  uint8_t  queue_rd;    /* index of the slice in transfer */
+  uint8_t  queue_count; /* number of queued slices, the first one is in transfer */
+  uint8_t  new_frame;   /* next payload begins a new frame */
   uint32_t offset;   /* offset for the next payload transfer */
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+  uint8_t *hdr_in_place; /* header of the running payload written in the queued buffer, NULL if copied */
+  uint8_t  hdr_saved[sizeof(tusb_video_payload_header_t)]; /* bytes of the queued buffer under the header */
+#endif
+  tusb_video_payload_header_t header; /* payload header, FrameID of the running frame */
   uint32_t max_payload_transfer_size;
   uint8_t  error_code;/* error code */
   uint8_t  state;    /* 0:probing 1:committed 2:streaming */
@@ -140,6 +159,15 @@ static videod_interface_t _videod_itf[CFG_TUD_VIDEO];
 static videod_streaming_interface_t _videod_streaming_itf[CFG_TUD_VIDEO_STREAMING];
 CFG_TUD_MEM_SECTION static videod_streaming_epbuf_t _videod_streaming_epbuf[CFG_TUD_VIDEO_STREAMING];
 
+/* Slice queues are appended by application and advanced by videod_xfer_cb() in usbd task */
+#if OSAL_MUTEX_REQUIRED
+static OSAL_MUTEX_DEF(_videod_queue_mutex_def);
+#endif
+static osal_mutex_t _videod_queue_mutex;
+
+#define _queue_lock()   do { (void) osal_mutex_lock(_videod_queue_mutex, OSAL_TIMEOUT_WAIT_FOREVER); } while (0)
+#define _queue_unlock() do { (void) osal_mutex_unlock(_videod_queue_mutex); } while (0)
+
 static uint8_t const _cap_get     = 0x1u; /* support for GET */
 static uint8_t const _cap_get_set = 0x3u; /* support for GET and SET */
 
@@ -512,8 +540,8 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
   uint_fast32_t interval_ms = interval / 10000;
   TU_ASSERT(interval_ms);
   uint_fast32_t payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
-  if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
-    payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
+  if (CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE < payload_size) {
+    payload_size = CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE;
   }
   param->dwMaxPayloadTransferSize = payload_size;
   return true;
@@ -674,8 +702,8 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
       } else {
         payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
       }
-      if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
-        payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
+      if (CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE < payload_size) {
+        payload_size = CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE;
       }
       param->dwMaxPayloadTransferSize = payload_size;
     }
@@ -758,6 +786,36 @@ static bool _init_vs_configuration(videod_streaming_interface_t *stm) {
   return _update_streaming_parameters(stm, param);
 }
 
+/** Return the streaming endpoint descriptor of the current settings, NULL if not opened. */
+static tusb_desc_endpoint_t const* _get_desc_ep(videod_streaming_interface_t const *stm) {
+  uint_fast16_t ofs_ep = stm->desc.ep[0];
+  if (!ofs_ep) return NULL;
+  return (tusb_desc_endpoint_t const*)(_videod_itf[stm->index_vc].beg + ofs_ep);
+}
+
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+/** Put back the bytes of the queued buffer which the header of the last payload was written over. */
+static void _restore_in_place(videod_streaming_interface_t *stm) {
+  if (stm->hdr_in_place) {
+    memcpy(stm->hdr_in_place, stm->hdr_saved, stm->header.bHeaderLength);
+    stm->hdr_in_place = NULL;
+  }
+}
+#endif
+
+/** Drop all queued frames and slices, the next payload begins a new frame. */
+static void _reset_queue(videod_streaming_interface_t *stm) {
+  _queue_lock();
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+  _restore_in_place(stm);
+#endif
+  stm->queue_rd    = 0;
+  stm->queue_count = 0;
+  stm->new_frame   = 1;
+  stm->offset      = 0;
+  _queue_unlock();
+}
+
 /** Set the alternate setting to own video streaming interface.
  *
  * @param[in,out] stm      Streaming interface context.
@@ -768,6 +826,13 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   TU_LOG_DRV("    reopen VS %d\r\n", altnum);
   uint8_t const *desc = _videod_itf[stm->index_vc].beg;
 
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG && CFG_TUD_XFER_ISR
+  tusb_desc_endpoint_t const *ep_prev = _get_desc_ep(stm);
+  if (ep_prev) {
+    usbd_edpt_isr_set(rhport, ep_prev->bEndpointAddress, false);
+  }
+#endif
+
 #ifndef TUP_DCD_EDPT_ISO_ALLOC
   /* Close endpoints of previous settings. */
   for (i = 0; i < TU_ARRAY_SIZE(stm->desc.ep); ++i) {
@@ -784,9 +849,7 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
 #endif
 
   /* clear transfer management information */
-  stm->buffer  = NULL;
-  stm->bufsize = 0;
-  stm->offset  = 0;
+  _reset_queue(stm);
 
   /* Find a alternate interface */
   uint8_t const *beg = desc + stm->desc.beg;
@@ -809,6 +872,7 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
     if (altnum && (TUSB_XFER_ISOCHRONOUS == ep->bmAttributes.xfer)) {
       /* FS must be less than or equal to max packet size */
       TU_VERIFY (tu_edpt_packet_size(ep) >= max_size);
+      TU_VERIFY (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE >= max_size);
 #ifdef TUP_DCD_EDPT_ISO_ALLOC
       usbd_edpt_iso_activate(rhport, ep);
 #else
@@ -816,11 +880,24 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
 #endif
     } else {
       TU_VERIFY(TUSB_XFER_BULK == ep->bmAttributes.xfer);
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+      /* The first payload of a slice is a single packet copied into the endpoint buffer */
+      uint16_t const mps = tu_edpt_packet_size(ep);
+      TU_VERIFY(CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE >= mps);
+      TU_VERIFY(mps > 2 * sizeof(tusb_video_payload_header_t) + CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN);
+#endif
       TU_ASSERT(usbd_edpt_open(rhport, ep));
     }
     stm->desc.ep[i] = (uint16_t) (cur - desc);
     TU_LOG_DRV("    open EP%02x\r\n", _desc_ep_addr(cur));
   }
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG && CFG_TUD_XFER_ISR
+  /* Following payloads of a slice are submitted in videod_xfer_isr_cb() */
+  tusb_desc_endpoint_t const *ep_stm = _get_desc_ep(stm);
+  if (ep_stm) {
+    usbd_edpt_isr_set(rhport, ep_stm->bEndpointAddress, true);
+  }
+#endif
   if (altnum) {
     stm->state = VS_STATE_STREAMING;
   }
@@ -828,24 +905,109 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   return true;
 }
 
-/** Prepare the next packet payload. */
-static uint_fast16_t _prepare_in_payload(videod_streaming_interface_t *stm, uint8_t* ep_buf) {
-  uint_fast16_t remaining = stm->bufsize - stm->offset;
-  uint_fast16_t hdr_len   = ep_buf[0];
-  uint_fast16_t pkt_len   = stm->max_payload_transfer_size;
-  if (hdr_len + remaining < pkt_len) {
-    pkt_len = hdr_len + remaining;
+/** Submit the next packet payload of the slice at the head of the queue.
+ * A payload never spans slices, EndOfFrame is set on the last payload of the last slice of a frame.
+ * With CFG_TUD_VIDEO_STREAMING_XFER_SG only the first payload of a slice is copied into the endpoint buffer, a bulk one
+ * as a single short packet. The header of following payloads is written in place over the end of the previous payload,
+ * which was sent already, and the payload is sent from the queued buffer. Payload boundaries are chosen so that the
+ * in-place payloads start at CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN. */
+static bool _submit_payload(uint8_t rhport, videod_streaming_interface_t *stm) {
+  tusb_desc_endpoint_t const *ep = _get_desc_ep(stm);
+  TU_VERIFY(ep);
+  uint8_t const ep_addr = ep->bEndpointAddress;
+  uint8_t *ep_buf = _videod_streaming_epbuf[stm - _videod_streaming_itf].buf;
+  videod_slice_t const *slice = &stm->queue[stm->queue_rd];
+  uint8_t *src = slice->buffer + stm->offset;
+
+  uint16_t const hdr_len = stm->header.bHeaderLength;
+  TU_ASSERT(stm->max_payload_transfer_size > hdr_len);
+  uint32_t const remaining = slice->bufsize - stm->offset;
+  uint32_t data_len = tu_min32(remaining, stm->max_payload_transfer_size - hdr_len);
+  uint8_t *payload = ep_buf;
+  uint16_t const mps = tu_edpt_packet_size(ep);
+
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+  uint32_t const align = CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN;
+  if (stm->offset >= hdr_len) {
+    /* Keep the next payload aligned as well */
+    if (data_len < remaining && data_len > align) {
+      data_len -= data_len % align;
+    }
+    payload = src - hdr_len;
+    memcpy(stm->hdr_saved, payload, hdr_len);
+    stm->hdr_in_place = payload;
+  } else {
+    if (TUSB_XFER_BULK == ep->bmAttributes.xfer && hdr_len + data_len > mps) {
+      data_len = (uint32_t) (mps - hdr_len - 1);
+    }
+    /* Move the start of the next payload including its header to the alignment */
+    uint32_t const misalign = (uint32_t) (((uintptr_t) src + data_len - hdr_len) % align);
+    if (data_len < remaining && data_len >= hdr_len + misalign) {
+      data_len -= misalign;
+    }
   }
-  TU_ASSERT(pkt_len >= hdr_len);
-  uint_fast16_t data_len = pkt_len - hdr_len;
-  memcpy(&ep_buf[hdr_len], stm->buffer + stm->offset, data_len);
-  stm->offset += data_len;
-  remaining -= data_len;
-  if (!remaining) {
-    tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*) ep_buf;
+#else
+  uint32_t const align = 1;
+#endif
+  /* A bulk payload shorter than the negotiated size must end with a short packet,
+   * otherwise the host takes the following payload as its continuation */
+  if (TUSB_XFER_BULK == ep->bmAttributes.xfer && !((hdr_len + data_len) % mps) &&
+      hdr_len + data_len < stm->max_payload_transfer_size) {
+    uint32_t const cut = (uint32_t) (((uintptr_t) src + data_len - hdr_len) % align);
+    data_len -= cut ? cut : align;
+  }
+
+  /* update the packet header */
+  if (stm->new_frame) {
+    stm->header.FrameID ^= 1;
+    stm->new_frame = 0;
+  }
+  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*) payload;
+  hdr->bHeaderLength = (uint8_t) hdr_len;
+  hdr->bmHeaderInfo  = stm->header.bmHeaderInfo;
+  if (data_len == remaining && slice->end_of_frame) {
     hdr->EndOfFrame = 1;
   }
-  return hdr_len + data_len;
+  /* update the packet data */
+  if (payload == ep_buf) {
+    memcpy(&ep_buf[hdr_len], src, data_len);
+  }
+  stm->offset += data_len;
+  return usbd_edpt_xfer(rhport, ep_addr, payload, (uint16_t) (hdr_len + data_len));
+}
+
+/** Claim the streaming endpoint and submit the next payload. */
+static bool _submit_next(uint8_t rhport, videod_streaming_interface_t *stm) {
+  tusb_desc_endpoint_t const *ep = _get_desc_ep(stm);
+  TU_VERIFY(ep);
+  TU_VERIFY(usbd_edpt_claim(rhport, ep->bEndpointAddress));
+  return _submit_payload(rhport, stm);
+}
+
+/** Queue a frame or slice, start the transfer if the endpoint is idle. */
+static bool _queue_slice(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize, bool end_of_frame) {
+  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
+  if (!stm || !stm->desc.ep[0]) return false;
+  if (stm->state == VS_STATE_PROBING) return false;
+
+  /* count and the decision to start the transfer must not interleave with videod_xfer_cb() */
+  bool ret = true;
+  _queue_lock();
+  if (stm->queue_count >= CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH) {
+    ret = false;
+  } else {
+    videod_slice_t *slice = &stm->queue[(stm->queue_rd + stm->queue_count) % CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH];
+    slice->buffer       = (uint8_t*) buffer;
+    slice->bufsize      = (uint32_t) bufsize;
+    slice->end_of_frame = end_of_frame;
+    /* sent from videod_xfer_cb() after the ones ahead */
+    if (!stm->queue_count++ && !_submit_next(0, stm)) {
+      stm->queue_count = 0;
+      ret = false;
+    }
+  }
+  _queue_unlock();
+  return ret;
 }
 
 /** Handle a standard request to the video control interface. */
@@ -1014,7 +1176,6 @@ static int handle_video_stm_cs_req(uint8_t rhport, uint8_t stage,
                                    uint_fast8_t stm_idx) {
   (void)rhport;
   videod_streaming_interface_t *stm = &_videod_streaming_itf[stm_idx];
-  videod_streaming_epbuf_t *stm_epbuf = &_videod_streaming_epbuf[stm_idx];
 
   uint8_t const ctrl_sel = TU_U16_HIGH(request->wValue);
   TU_LOG_DRV("%s_Control(%s)\r\n", tu_str_video_vs_control_selector[ctrl_sel], tu_lookup_find(&tu_table_video_request, request->bRequest));
@@ -1109,14 +1270,11 @@ static int handle_video_stm_cs_req(uint8_t rhport, uint8_t stage,
               ret = tud_video_commit_cb(stm->index_vc, stm->index_vs, param);
             }
             if (VIDEO_ERROR_NONE == ret) {
-              stm->state   = VS_STATE_COMMITTED;
-              stm->buffer  = NULL;
-              stm->bufsize = 0;
-              stm->offset  = 0;
+              stm->state = VS_STATE_COMMITTED;
+              _reset_queue(stm);
               /* initialize payload header */
-              tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm_epbuf->buf;
-              hdr->bHeaderLength = sizeof(*hdr);
-              hdr->bmHeaderInfo  = 0;
+              stm->header.bHeaderLength = sizeof(stm->header);
+              stm->header.bmHeaderInfo  = 0;
             }
           }
           return VIDEO_ERROR_NONE;
@@ -1217,40 +1375,32 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
   TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
 
   if (!buffer || !bufsize) return false;
-  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
-  videod_streaming_epbuf_t *stm_epbuf = &_videod_streaming_epbuf[ctl_idx];
+  return _queue_slice(ctl_idx, stm_idx, buffer, bufsize, true);
+}
 
-  if (!stm || !stm->desc.ep[0] || stm->buffer) return false;
-  if (stm->state == VS_STATE_PROBING) return false;
+bool tud_video_n_slice_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize, bool end_of_frame) {
+  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
+  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
 
-  /* Find EP address */
-  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
-  uint8_t ep_addr = 0;
-  for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO_STREAMING; ++i) {
-    uint_fast16_t ofs_ep = stm->desc.ep[i];
-    if (!ofs_ep) continue;
-    ep_addr = _desc_ep_addr(desc + ofs_ep);
-    break;
-  }
-  if (!ep_addr) return false;
+  /* only the last slice can be empty, it ends the frame with a header only payload */
+  if (bufsize ? !buffer : !end_of_frame) return false;
+  return _queue_slice(ctl_idx, stm_idx, buffer, bufsize, end_of_frame);
+}
 
-  TU_VERIFY( usbd_edpt_claim(0, ep_addr) );
-  /* update the packet header */
-  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm_epbuf->buf;
-  hdr->FrameID   ^= 1;
-  hdr->EndOfFrame = 0;
-  /* update the packet data */
-  stm->buffer     = (uint8_t*)buffer;
-  stm->bufsize    = bufsize;
-  uint_fast16_t pkt_len = _prepare_in_payload(stm, stm_epbuf->buf);
-  TU_ASSERT( usbd_edpt_xfer(0, ep_addr, stm_epbuf->buf, (uint16_t) pkt_len), 0);
-  return true;
+uint_fast8_t tud_video_n_queue_available(uint_fast8_t ctl_idx, uint_fast8_t stm_idx) {
+  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO, 0);
+  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING, 0);
+  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
+  if (!stm || !stm->desc.ep[0]) return 0;
+  if (stm->state == VS_STATE_PROBING) return 0;
+  return (uint_fast8_t) (CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH - stm->queue_count);
 }
 
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
 void videod_init(void) {
+  _videod_queue_mutex = osal_mutex_create(&_videod_queue_mutex_def);
   for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO; ++i) {
     videod_interface_t* ctl = &_videod_itf[i];
     tu_memclr(ctl, sizeof(*ctl));
@@ -1262,6 +1412,9 @@ void videod_init(void) {
 }
 
 bool videod_deinit(void) {
+#if OSAL_MUTEX_REQUIRED
+  osal_mutex_delete(_videod_queue_mutex);
+#endif
   return true;
 }
 
@@ -1408,22 +1561,69 @@ bool videod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
     if (ep_addr == _desc_ep_addr(desc + ep_ofs)) break;
   }
   TU_ASSERT(itf < CFG_TUD_VIDEO_STREAMING);
-  videod_streaming_epbuf_t *stm_epbuf = &_videod_streaming_epbuf[itf];
 
-  if (stm->offset < stm->bufsize) {
-    /* Claim the endpoint */
-    TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
-    uint_fast16_t pkt_len = _prepare_in_payload(stm, stm_epbuf->buf);
-    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, stm_epbuf->buf, (uint16_t) pkt_len), 0);
-  } else {
-    stm->buffer  = NULL;
-    stm->bufsize = 0;
-    stm->offset  = 0;
-    if (tud_video_frame_xfer_complete_cb) {
-      tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
-    }
+  /* Queue is advanced under lock, callbacks below run without it since they may queue more */
+  _queue_lock();
+  if (!stm->queue_count) {
+    _queue_unlock();
+    return true;
+  }
+
+  videod_slice_t const *slice = &stm->queue[stm->queue_rd];
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+  _restore_in_place(stm);
+#endif
+  if (stm->offset < slice->bufsize) {
+    bool const ret = _submit_next(rhport, stm);
+    _queue_unlock();
+    TU_ASSERT(ret);
+    return true;
+  }
+
+  /* The slice is completed, start the next one before application may queue more in the callbacks */
+  void *buffer = slice->buffer;
+  bool const end_of_frame = slice->end_of_frame;
+  stm->queue_rd = (uint8_t) ((stm->queue_rd + 1) % CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH);
+  stm->queue_count--;
+  stm->offset = 0;
+  if (end_of_frame) {
+    stm->new_frame = 1;
+  }
+  bool const ret = !stm->queue_count || _submit_next(rhport, stm);
+  _queue_unlock();
+  TU_ASSERT(ret);
+
+  if (tud_video_slice_xfer_complete_cb) {
+    tud_video_slice_xfer_complete_cb(stm->index_vc, stm->index_vs, buffer);
+  }
+  if (end_of_frame && tud_video_frame_xfer_complete_cb) {
+    tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
   }
   return true;
 }
 
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+/** Transfer complete in ISR context (CFG_TUD_XFER_ISR), enabled for the streaming endpoint.
+ * The next payload of the running slice is submitted right away instead of waiting for tud_task(). Completion of the
+ * last payload of a slice is left to videod_xfer_cb() which advances the queue and invokes the callbacks. */
+bool videod_xfer_isr_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) port_num;
+  (void) xferred_bytes;
+  if (result != XFER_RESULT_SUCCESS) return false;
+
+  for (uint_fast8_t itf = 0; itf < CFG_TUD_VIDEO_STREAMING; ++itf) {
+    videod_streaming_interface_t *stm = &_videod_streaming_itf[itf];
+    tusb_desc_endpoint_t const *ep = _get_desc_ep(stm);
+    if (!ep || ep_addr != ep->bEndpointAddress) continue;
+
+    /* the application only appends to the queue while a transfer is running */
+    if (!stm->queue_count || stm->offset >= stm->queue[stm->queue_rd].bufsize) return false;
+    _restore_in_place(stm);
+    TU_ASSERT(_submit_payload(rhport, stm), true);
+    return true;
+  }
+  return false;
+}
+#endif
+
 #endif
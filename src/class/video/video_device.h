@@ -35,6 +35,36 @@
 extern "C" {
 #endif
 
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Number of frames or slices which can be queued per streaming interface, the next one is sent right after the
+// previous completes without waiting for the application
+#ifndef CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH
+  #define CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH  1
+#endif
+
+// Zero-copy transmission: only the first payload of a frame or slice is copied into the endpoint buffer (for bulk
+// endpoint a single short packet), following payloads are sent in place from the queued buffer. Their header is
+// written over the last bytes of the previous payload, which were sent already, and these are put back when the
+// payload completes. Queued buffers must be writable and accessible by the USB controller, payload boundaries are
+// chosen so that in-place payloads start at CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN. With CFG_TUD_XFER_ISR payloads of
+// a slice are submitted from the transfer complete interrupt.
+#ifndef CFG_TUD_VIDEO_STREAMING_XFER_SG
+  #define CFG_TUD_VIDEO_STREAMING_XFER_SG  0
+#endif
+
+#ifndef CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN
+  #define CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN  4
+#endif
+
+// Largest dwMaxPayloadTransferSize offered to host. Without CFG_TUD_VIDEO_STREAMING_XFER_SG the whole payload is
+// copied, therefore it must not exceed CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE.
+#ifndef CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE
+  #define CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE  CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Ports)
 // CFG_TUD_VIDEO > 1
@@ -48,14 +78,31 @@ bool tud_video_n_connected(uint_fast8_t ctl_idx);
  * @param[in] stm_idx    Destination streaming interface index */
 bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
-/** Transfer a frame
+/** Transfer a frame, queued behind frames or slices which have not completed yet
  *
  * @param[in] ctl_idx    Destination control interface index
  * @param[in] stm_idx    Destination streaming interface index
  * @param[in] buffer     Frame buffer. The caller must not use this buffer until the operation is completed.
- * @param[in] bufsize    Byte size of the frame buffer */
+ * @param[in] bufsize    Byte size of the frame buffer
+ * @return false if not streaming or the queue is full */
 bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
 
+/** Transfer a part of a frame e.g. some lines or a chunk of compressed data as soon as it is produced
+ *
+ * @param[in] ctl_idx       Destination control interface index
+ * @param[in] stm_idx       Destination streaming interface index
+ * @param[in] buffer        Slice buffer. The caller must not use this buffer until the operation is completed.
+ * @param[in] bufsize       Byte size of the slice buffer, can be 0 only for the last slice
+ * @param[in] end_of_frame  true if this is the last slice of the frame
+ * @return false if not streaming or the queue is full */
+bool tud_video_n_slice_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize, bool end_of_frame);
+
+/** Return the number of frames or slices which can be queued
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index */
+uint_fast8_t tud_video_n_queue_available(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
+
 /*------------- Optional callbacks -------------*/
 /** Invoked when compeletion of a frame transfer
  *
@@ -63,6 +110,13 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
  * @param[in] stm_idx    Destination streaming interface index */
 TU_ATTR_WEAK void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
+/** Invoked when completion of a frame or slice transfer, before tud_video_frame_xfer_complete_cb() for the last one
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] buffer     The buffer which can be reused by the caller */
+TU_ATTR_WEAK void tud_video_slice_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer);
+
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
@@ -92,6 +146,7 @@ void     videod_reset          (uint8_t rhport);
 uint16_t videod_open           (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     videod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     videod_xfer_cb        (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+bool     videod_xfer_isr_cb    (uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes); // CFG_TUD_VIDEO_STREAMING_XFER_SG only
 
 #ifdef __cplusplus
  }
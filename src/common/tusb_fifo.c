@@ -55,6 +55,20 @@ TU_ATTR_ALWAYS_INLINE static inline void _ff_unlock(osal_mutex_t mutex)
 
 #endif
 
+// Memory fences used by single-producer single-consumer API
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+  #include <stdatomic.h>
+  #define _ff_fence_acquire()   atomic_thread_fence(memory_order_acquire)
+  #define _ff_fence_release()   atomic_thread_fence(memory_order_release)
+#elif defined(__GNUC__)
+  #define _ff_fence_acquire()   __sync_synchronize()
+  #define _ff_fence_release()   __sync_synchronize()
+#else
+  // single core MCU: volatile index access is sufficient
+  #define _ff_fence_acquire()
+  #define _ff_fence_release()
+#endif
+
 /** \enum tu_fifo_copy_mode_t
  * \brief Write modes intended to allow special read and write functions to be able to
  *        copy data to and from USB hardware FIFOs as needed for e.g. STM32s and others
@@ -73,6 +87,9 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   // but limits the maximum depth to 2^16/2 = 2^15 and buffer overflows are detectable
   // only if overflow happens once (important for unsupervised DMA applications)
   if (depth > 0x8000) return false;
+#if CFG_TUSB_FIFO_POW2_ONLY
+  if (!tu_is_power_of_two(depth)) return false;
+#endif
 
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
@@ -145,6 +162,53 @@ static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t
 }
 #endif
 
+// Word-by-word copy in _ff_memcpy(), by default on 32-bit targets only. Can be enabled on a 64-bit host to
+// test and benchmark it
+#ifndef CFG_TUSB_FIFO_WORD_COPY
+  #define CFG_TUSB_FIFO_WORD_COPY   (UINTPTR_MAX <= UINT32_MAX)
+#endif
+
+#if CFG_TUSB_FIFO_WORD_COPY
+// Word type used by _ff_memcpy(), may alias any application buffer type
+#if defined(__GNUC__)
+typedef uint32_t __attribute__((__may_alias__)) _ff_word_t;
+#else
+typedef uint32_t _ff_word_t;
+#endif
+
+// Keep the word loop from being recognized as a copy idiom and turned back into a memcpy() call,
+// which GCC does from -O2 (-ftree-loop-distribute-patterns) and clang at any optimization level
+#if defined(__clang__)
+  #define _FF_NO_LOOP_IDIOM   __attribute__((no_builtin("memcpy")))
+#elif defined(__GNUC__)
+  #define _FF_NO_LOOP_IDIOM   __attribute__((optimize("no-tree-loop-distribute-patterns")))
+#else
+  #define _FF_NO_LOOP_IDIOM
+#endif
+
+// Copy between fifo and application buffer. When both are word aligned (typical since buffers
+// are CFG_TUSB_MEM_ALIGN and item size is multiple of 4) copy word-by-word instead of relying on
+// (often byte-wise, size optimized) libc memcpy(). Remaining bytes or unaligned buffers fall back to memcpy().
+_FF_NO_LOOP_IDIOM static void _ff_memcpy(void* dst, void const* src, uint16_t len)
+{
+  if ( (len >= 4) && ((((uintptr_t) dst | (uintptr_t) src) & 0x03) == 0) )
+  {
+    _ff_word_t* dst32 = (_ff_word_t*) dst;
+    _ff_word_t const* src32 = (_ff_word_t const*) src;
+
+    for(; len >= 4; len -= 4) *dst32++ = *src32++;
+
+    dst = dst32;
+    src = src32;
+  }
+
+  if ( len ) memcpy(dst, src, len);
+}
+#else
+// 64-bit host: libc memcpy() is already vectorized and faster than a word loop
+#define _ff_memcpy    memcpy
+#endif
+
 // send one item to fifo WITHOUT updating write pointer
 static inline void _ff_push(tu_fifo_t* f, void const * app_buf, uint16_t rel)
 {
@@ -169,18 +233,18 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
       if(n <= lin_count)
       {
         // Linear only
-        memcpy(ff_buf, app_buf, n*f->item_size);
+        _ff_memcpy(ff_buf, app_buf, n*f->item_size);
       }
       else
       {
         // Wrap around
 
         // Write data to linear part of buffer
-        memcpy(ff_buf, app_buf, lin_bytes);
+        _ff_memcpy(ff_buf, app_buf, lin_bytes);
 
         // Write data wrapped around
         // TU_ASSERT(nWrap_bytes <= f->depth, );
-        memcpy(f->buffer, ((uint8_t const*) app_buf) + lin_bytes, wrap_bytes);
+        _ff_memcpy(f->buffer, ((uint8_t const*) app_buf) + lin_bytes, wrap_bytes);
       }
       break;
 #ifdef TUP_MEM_CONST_ADDR
@@ -257,17 +321,17 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
       if ( n <= lin_count )
       {
         // Linear only
-        memcpy(app_buf, ff_buf, n*f->item_size);
+        _ff_memcpy(app_buf, ff_buf, n*f->item_size);
       }
       else
       {
         // Wrap around
 
         // Read data from linear part of buffer
-        memcpy(app_buf, ff_buf, lin_bytes);
+        _ff_memcpy(app_buf, ff_buf, lin_bytes);
 
         // Read data wrapped part
-        memcpy((uint8_t*) app_buf + lin_bytes, f->buffer, wrap_bytes);
+        _ff_memcpy((uint8_t*) app_buf + lin_bytes, f->buffer, wrap_bytes);
       }
     break;
 #ifdef TUP_MEM_CONST_ADDR
@@ -325,10 +389,27 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
 // Helper
 //--------------------------------------------------------------------+
 
+// Power of two depth: index wrap-around and index to pointer conversion are a single mask
+TU_ATTR_ALWAYS_INLINE static inline
+bool _ff_depth_pow2(uint16_t depth)
+{
+#if CFG_TUSB_FIFO_POW2_ONLY
+  (void) depth;
+  return true;
+#else
+  return (depth & (depth - 1)) == 0;
+#endif
+}
+
 // return only the index difference and as such can be used to determine an overflow i.e overflowable count
 TU_ATTR_ALWAYS_INLINE static inline
 uint16_t _ff_count(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
 {
+  if ( _ff_depth_pow2(depth) )
+  {
+    return (uint16_t) ((wr_idx - rd_idx) & (2*depth - 1));
+  }
+
   // In case we have non-power of two depth we need a further modification
   if (wr_idx >= rd_idx)
   {
@@ -355,6 +436,11 @@ uint16_t _ff_remaining(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
 // "absolute" index is only in the range of [0..2*depth)
 static uint16_t advance_index(uint16_t depth, uint16_t idx, uint16_t offset)
 {
+  if ( _ff_depth_pow2(depth) )
+  {
+    return (uint16_t) ((idx + offset) & (2*depth - 1));
+  }
+
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
@@ -390,6 +476,8 @@ static uint16_t backward_index(uint16_t depth, uint16_t idx, uint16_t offset)
 TU_ATTR_ALWAYS_INLINE static inline
 uint16_t idx2ptr(uint16_t depth, uint16_t idx)
 {
+  if ( _ff_depth_pow2(depth) ) return (uint16_t) (idx & (depth - 1));
+
   // Only run at most 3 times since index is limit in the range of [0..2*depth)
   while ( idx >= depth ) idx -= depth;
   return idx;
@@ -1093,3 +1181,143 @@ void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
     info->ptr_wrap = f->buffer;              // Always start of buffer
   }
 }
+
+//--------------------------------------------------------------------+
+// Single-Producer Single-Consumer API
+//--------------------------------------------------------------------+
+
+/******************************************************************************/
+/*!
+   @brief Reserve space for writing - single producer only
+
+   Lock-free alternative to tu_fifo_write() when there is exactly one writer and one
+   reader context e.g ISR -> task. Index updates are ordered with memory fences instead of
+   mutexes or interrupt masking. Reserved items are filled with tu_fifo_spsc_put() and
+   only become visible to the reader once published with tu_fifo_spsc_commit().
+   Must not be used with overwritable FIFO.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items wanted
+
+   @returns number of items reserved, could be less than n if FIFO is almost full
+ */
+/******************************************************************************/
+uint16_t tu_fifo_spsc_reserve(tu_fifo_t* f, uint16_t n)
+{
+  uint16_t const rd_idx = f->rd_idx;
+
+  // reader must be done with freed slots before we write to them
+  _ff_fence_acquire();
+
+  return tu_min16(n, _ff_remaining(f->depth, f->wr_idx, rd_idx));
+}
+
+/******************************************************************************/
+/*!
+   @brief Copy one item into a reserved slot, WITHOUT updating write index
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       offset
+                    Item offset from current write index, must be less than reserved count
+   @param[in]       data
+                    Item to write
+ */
+/******************************************************************************/
+void tu_fifo_spsc_put(tu_fifo_t* f, uint16_t offset, void const * data)
+{
+  uint16_t const wr_idx = advance_index(f->depth, f->wr_idx, offset);
+  _ff_push(f, data, idx2ptr(f->depth, wr_idx));
+}
+
+/******************************************************************************/
+/*!
+   @brief Publish n reserved items to the reader with a single write index update
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items to publish
+ */
+/******************************************************************************/
+void tu_fifo_spsc_commit(tu_fifo_t* f, uint16_t n)
+{
+  // data must be visible before write index
+  _ff_fence_release();
+  f->wr_idx = advance_index(f->depth, f->wr_idx, n);
+}
+
+/******************************************************************************/
+/*!
+   @brief Write n items - single producer only
+
+   @returns number of items written
+ */
+/******************************************************************************/
+uint16_t tu_fifo_spsc_write_n(tu_fifo_t* f, void const * data, uint16_t n)
+{
+  n = tu_fifo_spsc_reserve(f, n);
+
+  if (n)
+  {
+    _ff_push_n(f, data, n, idx2ptr(f->depth, f->wr_idx), TU_FIFO_COPY_INC);
+    tu_fifo_spsc_commit(f, n);
+  }
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Write one item - single producer only
+
+   @returns TRUE if item is written, FALSE if FIFO is full
+ */
+/******************************************************************************/
+bool tu_fifo_spsc_write(tu_fifo_t* f, void const * data)
+{
+  return tu_fifo_spsc_write_n(f, data, 1) == 1;
+}
+
+/******************************************************************************/
+/*!
+   @brief Read up to n items - single consumer only
+
+   @returns number of items read
+ */
+/******************************************************************************/
+uint16_t tu_fifo_spsc_read_n(tu_fifo_t* f, void * buffer, uint16_t n)
+{
+  uint16_t const wr_idx = f->wr_idx;
+
+  // data written before write index must be visible
+  _ff_fence_acquire();
+
+  uint16_t const rd_idx = f->rd_idx;
+  n = tu_min16(n, _ff_count(f->depth, wr_idx, rd_idx));
+
+  if (n)
+  {
+    _ff_pull_n(f, buffer, n, idx2ptr(f->depth, rd_idx), TU_FIFO_COPY_INC);
+
+    // done with the slots before handing them back to writer
+    _ff_fence_release();
+    f->rd_idx = advance_index(f->depth, rd_idx, n);
+  }
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Read one item - single consumer only
+
+   @returns TRUE if the queue is not empty
+ */
+/******************************************************************************/
+bool tu_fifo_spsc_read(tu_fifo_t* f, void * buffer)
+{
+  return tu_fifo_spsc_read_n(f, buffer, 1) == 1;
+}
@@ -186,6 +186,17 @@ uint16_t tu_fifo_depth(tu_fifo_t* f) {
 void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n);
 void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
 
+// Single-producer single-consumer lock-free API, no mutex or interrupt masking is required as long as
+// there is only one writer and one reader context. Not for overwritable FIFO.
+// Producer can reserve several items, fill them with put() and publish all with one commit().
+uint16_t tu_fifo_spsc_reserve (tu_fifo_t* f, uint16_t n);
+void     tu_fifo_spsc_put     (tu_fifo_t* f, uint16_t offset, void const * data);
+void     tu_fifo_spsc_commit  (tu_fifo_t* f, uint16_t n);
+bool     tu_fifo_spsc_write   (tu_fifo_t* f, void const * data);
+uint16_t tu_fifo_spsc_write_n (tu_fifo_t* f, void const * data, uint16_t n);
+bool     tu_fifo_spsc_read    (tu_fifo_t* f, void * buffer);
+uint16_t tu_fifo_spsc_read_n  (tu_fifo_t* f, void * buffer, uint16_t n);
+
 // If you want to read/write from/to the FIFO by use of a DMA, you may need to conduct two copies
 // to handle a possible wrapping part. These functions deliver a pointer to start
 // reading/writing from/to and a valid linear length along which no wrap occurs.
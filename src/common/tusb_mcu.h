@@ -537,6 +537,14 @@
   #define TUP_RHPORT_HIGHSPEED    1
   #define TUD_ENDPOINT_ONE_DIRECTION_ONLY
 
+//--------------------------------------------------------------------+
+// Virtual
+//--------------------------------------------------------------------+
+#elif TU_CHECK_MCU(OPT_MCU_VIRTUAL)
+  #define TUP_USBIP_VIRTUAL
+  #define TUP_DCD_ENDPOINT_MAX    16
+  #define TUP_RHPORT_HIGHSPEED    1
+
 #endif
 
 //--------------------------------------------------------------------+
@@ -574,7 +582,7 @@
 #endif
 
 // USBIP that support ISO alloc & activate API
-#if defined(TUP_USBIP_DWC2) || defined(TUP_USBIP_FSDEV) || defined(TUP_USBIP_MUSB)
+#if defined(TUP_USBIP_DWC2) || defined(TUP_USBIP_FSDEV) || defined(TUP_USBIP_MUSB) || defined(TUP_USBIP_VIRTUAL)
   #define TUP_DCD_EDPT_ISO_ALLOC
 #endif
 
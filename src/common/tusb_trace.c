@@ -0,0 +1,182 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_TRACE
+
+#include "tusb.h"
+#include "common/tusb_trace.h"
+
+#if CFG_TUSB_TRACE_RTT
+  #include "SEGGER_RTT.h"
+#endif
+
+// Writers from different contexts claim their record with an atomic increment. Without lock-free atomic
+// (e.g Cortex-M0) an ISR preempting the increment may claim the same record, such record is dropped by reader
+// at worst.
+#if defined(__GNUC__) && defined(__GCC_ATOMIC_INT_LOCK_FREE) && (__GCC_ATOMIC_INT_LOCK_FREE == 2)
+  #define _trace_claim()          __atomic_fetch_add(&tu_trace_buf.wr_idx, 1u, __ATOMIC_RELAXED)
+  #define _trace_fence_release()  __atomic_thread_fence(__ATOMIC_RELEASE)
+  #define _trace_fence_acquire()  __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#elif defined(__GNUC__)
+  #define _trace_claim()          (tu_trace_buf.wr_idx++)
+  #define _trace_fence_release()  __asm volatile ("" ::: "memory")
+  #define _trace_fence_acquire()  __asm volatile ("" ::: "memory")
+#else
+  #define _trace_claim()          (tu_trace_buf.wr_idx++)
+  #define _trace_fence_release()
+  #define _trace_fence_acquire()
+#endif
+
+// Sequence of a record being written
+#define TRACE_SEQ_BUSY   UINT32_MAX
+
+#if TU_TRACE_DWT_CYCCNT
+  #define ARM_CM_DEMCR      (*((volatile uint32_t*) 0xE000EDFCUL)) // CoreDebug->DEMCR
+  #define ARM_CM_DWT_CTRL   (*((volatile uint32_t*) 0xE0001000UL)) // DWT->CTRL
+  #define ARM_CM_DWT_CYCCNT (*((volatile uint32_t*) 0xE0001004UL)) // DWT->CYCCNT
+#endif
+
+tu_trace_buffer_t tu_trace_buf = {
+  .magic        = TU_TRACE_MAGIC,
+  .version      = TU_TRACE_VERSION,
+  .record_size  = sizeof(tu_trace_record_t),
+  .depth        = CFG_TUSB_TRACE_DEPTH,
+  .timestamp_hz = CFG_TUSB_TRACE_TIMESTAMP_HZ,
+};
+
+// Next record to read, only used by reader
+static uint32_t _trace_rd_idx;
+
+#if CFG_TUSB_TRACE_RTT
+static uint8_t _trace_rtt_buf[16 * sizeof(tu_trace_record_t)];
+#endif
+
+//--------------------------------------------------------------------+
+// Weak stubs: invoked if no strong implementation is available
+//--------------------------------------------------------------------+
+#if TU_TRACE_DWT_CYCCNT
+TU_ATTR_WEAK uint32_t tu_trace_timestamp_cb(void) {
+  return ARM_CM_DWT_CYCCNT;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+void tu_trace_init(void) {
+#if TU_TRACE_DWT_CYCCNT
+  ARM_CM_DEMCR |= TU_BIT(24);   // TRCENA
+  ARM_CM_DWT_CTRL |= TU_BIT(0); // CYCCNTENA
+#endif
+
+  for (uint32_t i = 0; i < CFG_TUSB_TRACE_DEPTH; i++) {
+    tu_trace_buf.records[i].seq = TRACE_SEQ_BUSY;
+  }
+  tu_trace_buf.wr_idx = 0;
+  _trace_rd_idx = 0;
+
+#if CFG_TUSB_TRACE_RTT
+  SEGGER_RTT_ConfigUpBuffer(CFG_TUSB_TRACE_RTT_CHANNEL, "tusb_trace", _trace_rtt_buf, sizeof(_trace_rtt_buf),
+                            SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+}
+
+TU_ATTR_FAST_FUNC void tu_trace_write(uint8_t id, uint8_t arg, uint8_t port, uint8_t ep_addr, uint32_t len) {
+  uint32_t const timestamp = CFG_TUSB_TRACE_TIMESTAMP();
+  uint32_t const idx = _trace_claim();
+  volatile tu_trace_record_t* rec = &tu_trace_buf.records[idx & (CFG_TUSB_TRACE_DEPTH - 1)];
+
+  // invalidate first so that a reader copying the old record notices the change
+  rec->seq = TRACE_SEQ_BUSY;
+  _trace_fence_release();
+
+  rec->timestamp = timestamp;
+  rec->len       = len;
+  rec->id        = id;
+  rec->arg       = arg;
+  rec->ep_addr   = ep_addr;
+  rec->port      = port;
+
+  _trace_fence_release();
+  rec->seq = idx;
+}
+
+uint32_t tu_trace_read(tu_trace_record_t* records, uint32_t count, uint32_t* lost) {
+  uint32_t n = 0;
+
+  while (n < count) {
+    uint32_t const wr_idx = tu_trace_buf.wr_idx;
+    if (_trace_rd_idx == wr_idx) break;
+
+    // writer lapped us: skip records that are overwritten
+    if (wr_idx - _trace_rd_idx > CFG_TUSB_TRACE_DEPTH) {
+      if (lost) *lost += wr_idx - _trace_rd_idx - CFG_TUSB_TRACE_DEPTH;
+      _trace_rd_idx = wr_idx - CFG_TUSB_TRACE_DEPTH;
+    }
+
+    volatile tu_trace_record_t const* rec = &tu_trace_buf.records[_trace_rd_idx & (CFG_TUSB_TRACE_DEPTH - 1)];
+    tu_trace_record_t* out = &records[n];
+
+    out->seq = rec->seq;
+    _trace_fence_acquire();
+    out->timestamp = rec->timestamp;
+    out->len       = rec->len;
+    out->id        = rec->id;
+    out->arg       = rec->arg;
+    out->ep_addr   = rec->ep_addr;
+    out->port      = rec->port;
+    _trace_fence_acquire();
+
+    if (out->seq == _trace_rd_idx && rec->seq == _trace_rd_idx) {
+      n++;
+    } else if (tu_trace_buf.wr_idx - _trace_rd_idx <= CFG_TUSB_TRACE_DEPTH) {
+      // slot is only reused by index rd + depth: until that one is claimed, record is still being written by a
+      // preempted writer, try again later
+      break;
+    } else {
+      // overwritten while copying
+      if (lost) (*lost)++;
+    }
+
+    _trace_rd_idx++;
+  }
+
+  return n;
+}
+
+#if CFG_TUSB_TRACE_RTT
+void tu_trace_rtt_drain(void) {
+  tu_trace_record_t rec;
+
+  while (SEGGER_RTT_GetAvailWriteSpace(CFG_TUSB_TRACE_RTT_CHANNEL) >= sizeof(rec) && tu_trace_read(&rec, 1, NULL)) {
+    SEGGER_RTT_Write(CFG_TUSB_TRACE_RTT_CHANNEL, &rec, sizeof(rec));
+  }
+}
+#endif
+
+#endif
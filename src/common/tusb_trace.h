@@ -0,0 +1,153 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_TRACE_H_
+#define TUSB_TRACE_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Binary trace (CFG_TUSB_TRACE): stack hot path writes fixed size records into a ring that is overwritten when
+// full. Writing a record takes a timestamp, an index increment and a few stores, cheap enough to be left on in
+// production unlike TU_LOG. Records can be written from both ISR and task context.
+//
+// Records are collected either
+// - over SEGGER RTT: call tu_trace_rtt_drain() periodically (CFG_TUSB_TRACE_RTT), records are sent as raw stream
+// - from a memory dump of tu_trace_buf e.g gdb: dump binary value trace.bin tu_trace_buf
+// and decoded on host by tools/trace_decode.py into per-endpoint latency histograms.
+//
+// Timestamp is taken with CFG_TUSB_TRACE_TIMESTAMP(). On Cortex-M3 and above it defaults to tu_trace_timestamp_cb(),
+// which reads the DWT cycle counter unless overwritten by application. Other MCUs must define
+// CFG_TUSB_TRACE_TIMESTAMP() themselves, e.g. to a free running timer or to their own tu_trace_timestamp_cb(): a
+// millisecond tick is too coarse for transfer latency. Set CFG_TUSB_TRACE_TIMESTAMP_HZ to the counter frequency so
+// that decoder can report time instead of ticks.
+
+// DWT cycle counter is available on Cortex M3, M4, M7, M33, M55
+#if defined(__ARM_ARCH_7M__) || defined (__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8_1M_MAIN__) || \
+    defined(__ARM7M__) || defined (__ARM7EM__) || defined(__ARM8M_MAINLINE__) || defined(__ARM8EM_MAINLINE__)
+  #define TU_TRACE_DWT_CYCCNT  1
+#else
+  #define TU_TRACE_DWT_CYCCNT  0
+#endif
+
+#ifndef CFG_TUSB_TRACE_TIMESTAMP
+  #if TU_TRACE_DWT_CYCCNT
+    #define CFG_TUSB_TRACE_TIMESTAMP()  tu_trace_timestamp_cb()
+  #elif CFG_TUSB_TRACE
+    #error "CFG_TUSB_TRACE requires CFG_TUSB_TRACE_TIMESTAMP() on MCUs without DWT cycle counter"
+  #endif
+#endif
+
+// Frequency of timestamp, 0 if unknown
+#ifndef CFG_TUSB_TRACE_TIMESTAMP_HZ
+  #define CFG_TUSB_TRACE_TIMESTAMP_HZ   0
+#endif
+
+TU_VERIFY_STATIC((CFG_TUSB_TRACE_DEPTH & (CFG_TUSB_TRACE_DEPTH - 1)) == 0, "CFG_TUSB_TRACE_DEPTH must be power of two");
+
+enum {
+  TU_TRACE_MAGIC   = 0x52545554u, // "TUTR"
+  TU_TRACE_VERSION = 1,
+};
+
+// Record id, bit 4 is set for host stack
+typedef enum {
+  TU_TRACE_NONE = 0,
+  TU_TRACE_USBD_EVENT,          // event queued by dcd, arg = event id
+  TU_TRACE_USBD_DISPATCH_START, // tud_task() starts processing an event, arg = event id
+  TU_TRACE_USBD_DISPATCH_END,
+  TU_TRACE_USBD_XFER,           // transfer submitted to dcd
+
+  TU_TRACE_USBH_EVENT = 0x11,   // event queued by hcd, arg = event id
+  TU_TRACE_USBH_DISPATCH_START,
+  TU_TRACE_USBH_DISPATCH_END,
+  TU_TRACE_USBH_XFER,
+} tu_trace_id_t;
+
+typedef struct {
+  uint32_t seq;       // index of record since tu_trace_init(), written last
+  uint32_t timestamp;
+  uint32_t len;
+  uint8_t  id;
+  uint8_t  arg;
+  uint8_t  ep_addr;
+  uint8_t  port;      // hub port (device) or device address (host)
+} tu_trace_record_t;
+
+TU_VERIFY_STATIC(sizeof(tu_trace_record_t) == 16, "size is not correct");
+
+// Trace buffer with a self describing header, layout is what decoder expects from a memory dump
+typedef struct {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  record_size;
+  uint16_t reserved;
+  uint32_t depth;
+  uint32_t timestamp_hz;
+  volatile uint32_t wr_idx; // number of records written
+  tu_trace_record_t records[CFG_TUSB_TRACE_DEPTH];
+} tu_trace_buffer_t;
+
+#if CFG_TUSB_TRACE
+
+extern tu_trace_buffer_t tu_trace_buf;
+
+#define TU_TRACE(_id, _arg, _port, _ep_addr, _len) \
+  tu_trace_write((uint8_t) (_id), (uint8_t) (_arg), (uint8_t) (_port), (uint8_t) (_ep_addr), (uint32_t) (_len))
+
+#else
+
+#define TU_TRACE(_id, _arg, _port, _ep_addr, _len)  do {} while (0)
+
+#endif
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+
+// Discard all records and start timestamp counter if needed, called by tusb_init()
+void tu_trace_init(void);
+
+// Write a record, use TU_TRACE() instead so that it is compiled out when disabled
+void tu_trace_write(uint8_t id, uint8_t arg, uint8_t port, uint8_t ep_addr, uint32_t len);
+
+// Read up to count oldest unread records. Number of records overwritten before they could be read is added to lost
+uint32_t tu_trace_read(tu_trace_record_t* records, uint32_t count, uint32_t* lost);
+
+// Send unread records to RTT up channel CFG_TUSB_TRACE_RTT_CHANNEL, records that do not fit are kept for next call
+void tu_trace_rtt_drain(void);
+
+// Invoked by default CFG_TUSB_TRACE_TIMESTAMP() on Cortex-M3 and above, can be overwritten by application
+uint32_t tu_trace_timestamp_cb(void);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
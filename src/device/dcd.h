@@ -49,12 +49,19 @@ typedef enum {
   DCD_EVENT_SETUP_RECEIVED, // 6
   DCD_EVENT_XFER_COMPLETE,  // 7
   USBD_EVENT_FUNC_CALL,     // 8 Not an DCD event, just a convenient way to defer ISR function
+  USBD_EVENT_PORT_QUEUE,    // 9 Not an DCD event, per-port event queues have pending events
+  USBD_EVENT_XFER_COALESCED, // 10 Not an DCD event, merged completions of an endpoint handled in ISR
   DCD_EVENT_COUNT
 } dcd_eventid_t;
 
+enum {
+  DCD_DEV_ADDR_UNKNOWN = 0xFFu, // controller answers a single address, request is for the root device
+};
+
 typedef struct TU_ATTR_ALIGNED(4) {
   uint8_t rhport;
   uint8_t event_id;
+  uint8_t dev_addr; // SETUP_RECEIVED only: device address the request is sent to, or DCD_DEV_ADDR_UNKNOWN
 
   union {
     // BUS RESET
@@ -74,6 +81,7 @@ typedef struct TU_ATTR_ALIGNED(4) {
     struct {
       uint8_t  ep_addr;
       uint8_t  result;
+      uint16_t count; // number of completions merged into this event, see CFG_TUD_XFER_COALESCE
       uint32_t len;
     }xfer_complete;
 
@@ -217,15 +225,21 @@ TU_ATTR_ALWAYS_INLINE static inline  void dcd_event_bus_reset (uint8_t rhport, t
   dcd_event_handler(&event, in_isr);
 }
 
-// helper to send setup received
-TU_ATTR_ALWAYS_INLINE static inline void dcd_event_setup_received(uint8_t rhport, uint8_t const * setup, bool in_isr) {
+// helper to send setup received by a controller answering several device addresses (e.g. virtual hub ports)
+TU_ATTR_ALWAYS_INLINE static inline void dcd_event_setup_received_addr(uint8_t rhport, uint8_t dev_addr, uint8_t const * setup, bool in_isr) {
   dcd_event_t event;
   event.rhport = rhport;
   event.event_id = DCD_EVENT_SETUP_RECEIVED;
+  event.dev_addr = dev_addr;
   memcpy(&event.setup_received, setup, sizeof(tusb_control_request_t));
   dcd_event_handler(&event, in_isr);
 }
 
+// helper to send setup received
+TU_ATTR_ALWAYS_INLINE static inline void dcd_event_setup_received(uint8_t rhport, uint8_t const * setup, bool in_isr) {
+  dcd_event_setup_received_addr(rhport, DCD_DEV_ADDR_UNKNOWN, setup, in_isr);
+}
+
 // helper to send transfer complete event
 TU_ATTR_ALWAYS_INLINE static inline void dcd_event_xfer_complete (uint8_t rhport, uint8_t ep_addr, uint32_t xferred_bytes, uint8_t result, bool in_isr) {
   dcd_event_t event;
@@ -234,6 +248,7 @@ TU_ATTR_ALWAYS_INLINE static inline void dcd_event_xfer_complete (uint8_t rhport
   event.xfer_complete.ep_addr = ep_addr;
   event.xfer_complete.len     = xferred_bytes;
   event.xfer_complete.result  = result;
+  event.xfer_complete.count   = 1;
   dcd_event_handler(&event, in_isr);
   if((ep_addr & 0x01) == 0x01){
 	  dcd_switch_address(rhport, 0);
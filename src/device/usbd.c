@@ -42,6 +42,18 @@
   #define CFG_TUD_TASK_QUEUE_SZ   16
 #endif
 
+#if CFG_TUD_TASK_PORT_QUEUE
+  // Transfer complete events queued per port
+  #ifndef CFG_TUD_TASK_PORT_QUEUE_SZ
+    #define CFG_TUD_TASK_PORT_QUEUE_SZ  8
+  #endif
+
+  // Max number of per-port events processed by one tud_task_ext() call
+  #ifndef CFG_TUD_TASK_EVENT_BUDGET
+    #define CFG_TUD_TASK_EVENT_BUDGET   (CFG_TUD_TASK_PORT_QUEUE_SZ * (CFG_TUD_HUB_PORT + 1))
+  #endif
+#endif
+
 //--------------------------------------------------------------------+
 // Weak stubs: invoked if no strong implementation is available
 //--------------------------------------------------------------------+
@@ -166,7 +178,20 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = mscd_open,
         .control_xfer_cb  = mscd_control_xfer_cb,
         .xfer_cb          = mscd_xfer_cb,
-        .sof              = NULL
+        .sof              = mscd_sof
+    },
+    #endif
+
+    #if CFG_TUD_UAS
+    {
+        .name             = DRIVER_NAME("UAS"),
+        .init             = uasd_init,
+        .deinit           = uasd_deinit,
+        .reset            = uasd_reset,
+        .open             = uasd_open,
+        .control_xfer_cb  = uasd_control_xfer_cb,
+        .xfer_cb          = uasd_xfer_cb,
+        .sof              = uasd_sof
     },
     #endif
 
@@ -192,7 +217,13 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = audiod_open,
         .control_xfer_cb  = audiod_control_xfer_cb,
         .xfer_cb          = audiod_xfer_cb,
-        .sof              = audiod_sof_isr
+        .sof              = audiod_sof_isr,
+      #if CFG_TUD_AUDIO_LOW_LATENCY
+        .xfer_isr_cb      = audiod_xfer_isr_cb,
+        #if CFG_TUD_XFER_COALESCE
+        .xfer_coalesced_cb = audiod_xfer_coalesced_cb
+        #endif
+      #endif
     },
     #endif
 
@@ -205,7 +236,10 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = videod_open,
         .control_xfer_cb  = videod_control_xfer_cb,
         .xfer_cb          = videod_xfer_cb,
-        .sof              = NULL
+        .sof              = NULL,
+      #if CFG_TUD_VIDEO_STREAMING_XFER_SG && CFG_TUD_XFER_ISR
+        .xfer_isr_cb      = videod_xfer_isr_cb,
+      #endif
     },
     #endif
 
@@ -283,7 +317,14 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = netd_open,
         .control_xfer_cb  = netd_control_xfer_cb,
         .xfer_cb          = netd_xfer_cb,
-        .sof                  = NULL,
+      #if CFG_TUD_NCM
+        .sof              = netd_sof,
+      #else
+        .sof              = NULL,
+      #endif
+      #if CFG_TUD_NCM && CFG_TUD_NCM_XMIT_SG && CFG_TUD_XFER_ISR
+        .xfer_isr_cb      = netd_xfer_isr_cb,
+      #endif
     },
     #endif
 
@@ -310,38 +351,105 @@ tu_static uint8_t _app_driver_count = 0;
 #define TOTAL_DRIVER_COUNT    (_app_driver_count + BUILTIN_DRIVER_COUNT)
 
 // virtually joins built-in and application drivers together.
-// Application is positioned first to allow overwriting built-in ones.
+// Application drivers are positioned after built-in ones since hub driver must stay at TUD_HUB_DRIVER_IDX
 static usbd_class_driver_t const * get_driver(uint8_t drvid) {
   usbd_class_driver_t const * driver = NULL;
-  /*if ( drvid < _app_driver_count ) {
-    // Application drivers
-    driver = &_app_driver[drvid];
-  } else if ( drvid < TOTAL_DRIVER_COUNT && BUILTIN_DRIVER_COUNT > 0 ){
-    driver = &_usbd_driver[drvid - _app_driver_count];
-  }*/
   if ( drvid < BUILTIN_DRIVER_COUNT){
 	  driver = &_usbd_driver[drvid];
+  } else if ( drvid < TOTAL_DRIVER_COUNT ) {
+    // Application drivers
+    driver = &_app_driver[drvid - BUILTIN_DRIVER_COUNT];
   }
   return driver;
 }
 
+//--------------------------------------------------------------------+
+// Endpoint Routing
+//--------------------------------------------------------------------+
+enum { PORT_INVALID = 0xFFu };
+enum { DEV_ADDR_COUNT = 128 };
+
+// device address -> port, maintained on SET_ADDRESS
+tu_static uint8_t _usbd_addr2port[DEV_ADDR_COUNT];
+
+// endpoint -> port which bound it, maintained on SET_CONFIGURATION
+tu_static uint8_t _usbd_ep2port[CFG_TUD_ENDPPOINT_MAX][2];
+
+// endpoint -> port which queued the transfer currently in flight, PORT_INVALID if idle.
+// Controller endpoint can only have one transfer at a time: it is owned by the arming port until the completion is
+// dispatched and arming it for another port meanwhile fails, therefore completion is routed to the right port even
+// if several virtual devices use the same endpoint number.
+tu_static uint8_t _usbd_ep_xfer_port[CFG_TUD_ENDPPOINT_MAX][2];
+
+static void route_reset(void) {
+  memset(_usbd_addr2port, PORT_INVALID, sizeof(_usbd_addr2port));
+  memset(_usbd_ep2port, PORT_INVALID, sizeof(_usbd_ep2port));
+  memset(_usbd_ep_xfer_port, PORT_INVALID, sizeof(_usbd_ep_xfer_port));
+}
+
+// remove all routes pointing to port
+static void route_unbind_port(uint8_t port_num) {
+  uint8_t const addr = _usbd_dev[port_num].address & 0x7Fu;
+  if (_usbd_addr2port[addr] == port_num) {
+    _usbd_addr2port[addr] = PORT_INVALID;
+  }
+
+  for (uint8_t epnum = 0; epnum < CFG_TUD_ENDPPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      if (_usbd_ep2port[epnum][dir] == port_num) _usbd_ep2port[epnum][dir] = PORT_INVALID;
+      if (_usbd_ep_xfer_port[epnum][dir] == port_num) _usbd_ep_xfer_port[epnum][dir] = PORT_INVALID;
+    }
+  }
+}
+
+// bind all endpoints of an opened interface to port and its driver. ep2drv entries hold driver and port like
+// itf2drv, therefore tu_edpt_bind_driver() which writes 8-bit entries can't be used
+static void route_bind_edpt(uint8_t port_num, uint8_t drv_id, tusb_desc_interface_t const* desc_itf, uint16_t desc_len) {
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + desc_len;
+
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      uint8_t const ep_addr = ((tusb_desc_endpoint_t const*) p_desc)->bEndpointAddress;
+      uint8_t const epnum = tu_edpt_number(ep_addr);
+      uint8_t const dir = tu_edpt_dir(ep_addr);
+      _usbd_dev[port_num].ep2drv[epnum][dir] = (uint16_t) (((uint16_t) drv_id << 8) | port_num);
+      _usbd_ep2port[epnum][dir] = port_num;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+}
+
 uint8_t ep2port(uint8_t ep_addr){
-    uint8_t const epnum = tu_edpt_number(ep_addr);
-    uint8_t const ep_dir = tu_edpt_dir(ep_addr);
-	for(uint8_t i=0;i<CFG_TUD_HUB_PORT + 1;i++){
-		if(_usbd_dev[i].ep2drv[epnum][ep_dir] != DRVID_DEVIDX_INVALID){
-			return i;
-		}
-	}
-	return 0;//default fall back
+  uint8_t const port_num = _usbd_ep2port[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  return (port_num == PORT_INVALID) ? 0 : port_num; //default fall back
 }
+
+// port answering a device address, root device if address is unknown (DCD_DEV_ADDR_UNKNOWN) or not assigned
 uint8_t addr2port(uint8_t addr){
-	for(uint8_t i=0;i<CFG_TUD_HUB_PORT + 1;i++){
-		if(_usbd_dev[i].address != addr){
-			return i;
-		}
-	}
-	return 0;
+  if (addr >= DEV_ADDR_COUNT) return 0;
+  uint8_t const port_num = _usbd_addr2port[addr];
+  return (port_num == PORT_INVALID) ? 0 : port_num;
+}
+
+// port which owns the completed transfer on this endpoint
+TU_ATTR_ALWAYS_INLINE static inline uint8_t xfer_ep2port(uint8_t ep_addr) {
+  uint8_t const port_num = _usbd_ep_xfer_port[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  return (port_num == PORT_INVALID) ? ep2port(ep_addr) : port_num;
+}
+
+// Take controller endpoint for a transfer of port_num, false if a transfer of another port is in flight.
+// Transfers of other ports are armed from task context, only the owner re-arms from ISR, no lock is needed.
+static bool xfer_owner_take(uint8_t port_num, uint8_t epnum, uint8_t dir) {
+  uint8_t const owner = _usbd_ep_xfer_port[epnum][dir];
+  TU_VERIFY(owner == PORT_INVALID || owner == port_num);
+  _usbd_ep_xfer_port[epnum][dir] = port_num;
+  return true;
+}
+
+// Completion of the transfer in flight is dispatched, endpoint can be armed by any port
+TU_ATTR_ALWAYS_INLINE static inline void xfer_owner_release(uint8_t epnum, uint8_t dir) {
+  _usbd_ep_xfer_port[epnum][dir] = PORT_INVALID;
 }
 
 //used when function didn't called, but port number required
@@ -366,13 +474,249 @@ tu_static osal_queue_t _usbd_q;
 #else
   #define _usbd_mutex   NULL
 #endif
-TU_ATTR_ALWAYS_INLINE static inline bool queue_event(dcd_event_t const * event, bool in_isr) {
+#if CFG_TUD_TASK_PORT_QUEUE
+// Per-port event queue: non-control transfer complete events are queued by the port owning the endpoint.
+// A single USBD_EVENT_PORT_QUEUE in _usbd_q tells tud_task() to drain them.
+typedef struct {
+  tu_fifo_t ff;
+  uint8_t   weight; // events processed per scheduling round
+  uint16_t  high_water;
+  uint32_t  dropped;
+} usbd_port_queue_t;
+
+tu_static uint8_t _usbd_pq_buf[CFG_TUD_HUB_PORT + 1][CFG_TUD_TASK_PORT_QUEUE_SZ * sizeof(dcd_event_t)];
+tu_static usbd_port_queue_t _usbd_pq[CFG_TUD_HUB_PORT + 1];
+tu_static uint8_t _usbd_pq_next; // next port to serve
+tu_static uint8_t _usbd_pq_served; // events of _usbd_pq_next already processed in current round
+tu_static volatile bool _usbd_pq_notified; // USBD_EVENT_PORT_QUEUE is pending in _usbd_q
+
+static void port_queue_init(void) {
+  for (uint8_t i = 0; i < CFG_TUD_HUB_PORT + 1; i++) {
+    usbd_port_queue_t* pq = &_usbd_pq[i];
+    tu_fifo_config(&pq->ff, _usbd_pq_buf[i], CFG_TUD_TASK_PORT_QUEUE_SZ, sizeof(dcd_event_t), false);
+    pq->weight = 1;
+    pq->high_water = 0;
+    pq->dropped = 0;
+  }
+  _usbd_pq_next = 0;
+  _usbd_pq_served = 0;
+  _usbd_pq_notified = false;
+}
+
+// Post USBD_EVENT_PORT_QUEUE to main queue if not already pending
+static bool port_queue_notify(uint8_t rhport, bool in_isr) {
+  if (!in_isr) usbd_int_set(false);
+  bool const notify = !_usbd_pq_notified;
+  _usbd_pq_notified = true;
+  if (!in_isr) usbd_int_set(true);
+
+  if (notify) {
+    dcd_event_t const event = {.rhport = rhport, .event_id = USBD_EVENT_PORT_QUEUE};
+    TU_ASSERT(osal_queue_send(_usbd_q, &event, in_isr));
+  }
+  return true;
+}
+
+static bool port_queue_send(dcd_event_t const* event, bool in_isr) {
+  if (!in_isr) usbd_int_set(false);
+
+  // transfer keeps its owner until the completion is dispatched from this queue, see xfer_owner_take()
+  usbd_port_queue_t* pq = &_usbd_pq[xfer_ep2port(event->xfer_complete.ep_addr)];
+  bool const success = tu_fifo_spsc_write(&pq->ff, event);
+  if (success) {
+    uint16_t const count = tu_fifo_count(&pq->ff);
+    if (count > pq->high_water) pq->high_water = count;
+  } else {
+    pq->dropped++;
+  }
+  if (!in_isr) usbd_int_set(true);
+
+  // full queue only drops events of this port
+  TU_VERIFY(success);
+  tud_event_hook_cb(event->rhport, event->event_id, in_isr);
+
+  return port_queue_notify(event->rhport, in_isr);
+}
+#endif
+
+#if CFG_TUD_TASK_PORT_QUEUE
+static void port_queue_clear(uint8_t port_num) {
+  usbd_int_set(false);
+  tu_fifo_clear(&_usbd_pq[port_num].ff);
+  usbd_int_set(true);
+  if (port_num == _usbd_pq_next) _usbd_pq_served = 0;
+}
+#endif
+
+static bool queue_event_send(dcd_event_t const * event, bool in_isr) {
+#if CFG_TUD_TASK_PORT_QUEUE
+  // control transfer stays in main queue to keep ordering with SETUP
+  if (event->event_id == DCD_EVENT_XFER_COMPLETE && tu_edpt_number(event->xfer_complete.ep_addr) != 0) {
+    return port_queue_send(event, in_isr);
+  }
+#endif
 
   TU_ASSERT(osal_queue_send(_usbd_q, event, in_isr));
   tud_event_hook_cb(event->rhport, event->event_id, in_isr);
   return true;
 }
 
+#if CFG_TUSB_TRACE
+// Trace an event, with endpoint, port and length for transfer complete
+static void trace_event(uint8_t id, dcd_event_t const * event) {
+  if (event->event_id == DCD_EVENT_XFER_COMPLETE) {
+    uint8_t const ep_addr = event->xfer_complete.ep_addr;
+    TU_TRACE(id, event->event_id, xfer_ep2port(ep_addr), ep_addr, event->xfer_complete.len);
+  } else {
+    TU_TRACE(id, event->event_id, 0, 0, 0);
+  }
+}
+#else
+  #define trace_event(_id, _event)
+#endif
+
+#if CFG_TUD_XFER_COALESCE
+// Completions handled by xfer_isr_cb are forwarded to xfer_coalesced_cb. A queued transfer complete keeps its
+// endpoint busy until tud_task() dispatches it, so only these can pile up for one endpoint: the first one queues a
+// USBD_EVENT_XFER_COALESCED, following ones are added to the endpoint's record until tud_task() takes it.
+typedef struct {
+  uint8_t  port_num;
+  uint16_t count; // 0 if no event is queued
+  uint32_t len;
+} usbd_coalesce_t;
+
+tu_static usbd_coalesce_t _usbd_coalesce[CFG_TUD_ENDPPOINT_MAX][2];
+tu_static tud_xfer_coalesce_stats_t _usbd_coalesce_stats;
+
+// Called from xfer_isr_dispatch() in ISR context
+static void coalesce_post(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, uint32_t len) {
+  usbd_coalesce_t* co = &_usbd_coalesce[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  _usbd_coalesce_stats.events++;
+
+  if (co->count) {
+    if (co->port_num == port_num && co->count < UINT16_MAX) {
+      co->len += len;
+      co->count++;
+      _usbd_coalesce_stats.saved++;
+    } else {
+      // endpoint was closed and opened by another port while queued: restart record for the new owner
+      _usbd_coalesce_stats.dropped += co->count;
+      co->port_num = port_num;
+      co->count    = 1;
+      co->len      = len;
+    }
+    return;
+  }
+
+  co->port_num = port_num;
+  co->count    = 1;
+  co->len      = len;
+
+  dcd_event_t const event = {.rhport = rhport, .event_id = USBD_EVENT_XFER_COALESCED, .xfer_complete.ep_addr = ep_addr};
+  trace_event(TU_TRACE_USBD_EVENT, &event);
+  if (!queue_event_send(&event, true)) {
+    co->count = 0;
+    _usbd_coalesce_stats.dropped++;
+  }
+}
+
+// Take merged completions of an endpoint in task context, count is 0 if they were cleared meanwhile
+static void coalesce_take(dcd_event_t* event, uint8_t* port_num) {
+  usbd_coalesce_t* co = &_usbd_coalesce[tu_edpt_number(event->xfer_complete.ep_addr)][tu_edpt_dir(event->xfer_complete.ep_addr)];
+  usbd_int_set(false);
+  *port_num = co->port_num;
+  event->xfer_complete.result = XFER_RESULT_SUCCESS;
+  event->xfer_complete.count  = co->count;
+  event->xfer_complete.len    = co->len;
+  co->count = 0;
+  usbd_int_set(true);
+}
+
+// Forget completions of a port which is reset, their queued event finds an empty record
+static void coalesce_clear(uint8_t port_num) {
+  usbd_int_set(false);
+  for (uint8_t epnum = 0; epnum < CFG_TUD_ENDPPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      usbd_coalesce_t* co = &_usbd_coalesce[epnum][dir];
+      if (co->count && co->port_num == port_num) {
+        _usbd_coalesce_stats.dropped += co->count;
+        co->count = 0;
+      }
+    }
+  }
+  usbd_int_set(true);
+}
+
+static void process_xfer_coalesced(dcd_event_t* event) {
+  uint8_t port_num;
+  coalesce_take(event, &port_num);
+  if (event->xfer_complete.count == 0) return;
+
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint16_t const drvdev = _usbd_dev[port_num].ep2drv[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  usbd_class_driver_t const* driver = get_driver((uint8_t) (drvdev >> 8));
+  TU_VERIFY(driver && driver->xfer_coalesced_cb,); // endpoint closed meanwhile
+
+  TU_LOG_USBD("on EP %02X %u merged with %lu bytes\r\n", ep_addr, event->xfer_complete.count,
+              (unsigned long) event->xfer_complete.len);
+  driver->xfer_coalesced_cb(event->rhport, port_num, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                            event->xfer_complete.len, event->xfer_complete.count);
+}
+#endif
+
+#if CFG_TUD_XFER_ISR
+  #if CFG_TUSB_TRACE
+// Timestamp of the transfer complete being dispatched to xfer_isr_cb, see usbd_xfer_isr_timestamp()
+static uint32_t _usbd_xfer_isr_ts;
+  #endif
+
+// Dispatch transfer complete to driver in ISR context if endpoint is enabled for it, return true if handled.
+// Traced like a queued event which is dispatched immediately, so that decoder reports its latency as well
+static bool xfer_isr_dispatch(dcd_event_t const * event) {
+  #if CFG_TUSB_TRACE
+  uint32_t const ts = CFG_TUSB_TRACE_TIMESTAMP();
+  #endif
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const ep_dir = tu_edpt_dir(ep_addr);
+  if (epnum == 0 || epnum >= CFG_TUD_ENDPPOINT_MAX) return false;
+
+  uint8_t const port_num = xfer_ep2port(ep_addr);
+  usbd_device_t* dev = &_usbd_dev[port_num];
+  if (!tu_bit_test(dev->ep_isr[ep_dir], epnum)) return false;
+
+  usbd_class_driver_t const* driver = get_driver((uint8_t) (dev->ep2drv[epnum][ep_dir] >> 8));
+  if (!(driver && driver->xfer_isr_cb)) return false;
+
+  trace_event(TU_TRACE_USBD_EVENT, event);
+  trace_event(TU_TRACE_USBD_DISPATCH_START, event);
+
+  dev->ep_status[epnum][ep_dir].busy = 0;
+  dev->ep_status[epnum][ep_dir].claimed = 0;
+  xfer_owner_release(epnum, ep_dir);
+  #if CFG_TUSB_TRACE
+  _usbd_xfer_isr_ts = ts;
+  #endif
+  bool const handled = driver->xfer_isr_cb(event->rhport, port_num, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                                           event->xfer_complete.len);
+
+  trace_event(TU_TRACE_USBD_DISPATCH_END, event);
+
+  #if CFG_TUD_XFER_COALESCE
+  if (handled && driver->xfer_coalesced_cb && event->xfer_complete.result == XFER_RESULT_SUCCESS) {
+    coalesce_post(event->rhport, port_num, ep_addr, event->xfer_complete.len);
+  }
+  #endif
+  return handled;
+}
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline bool queue_event(dcd_event_t const * event, bool in_isr) {
+  trace_event(TU_TRACE_USBD_EVENT, event);
+
+  return queue_event_send(event, in_isr);
+}
+
 //--------------------------------------------------------------------+
 // Prototypes
 //--------------------------------------------------------------------+
@@ -410,7 +754,9 @@ tu_static char const* const _usbd_event_str[DCD_EVENT_COUNT] = {
     "Resume",
     "Setup Received",
     "Xfer Complete",
-    "Func Call"
+    "Func Call",
+    "Port Queue",
+    "Xfer Coalesced"
 };
 
 // for usbd_control to print the name of control complete driver
@@ -476,6 +822,45 @@ void tud_sof_cb_enable(bool en) {
   usbd_sof_enable(_usbd_rhport, SOF_CONSUMER_USER, en);
 }
 
+#if CFG_TUD_TASK_PORT_QUEUE
+bool tud_port_queue_stats_get(uint8_t port_num, tud_port_queue_stats_t* stats) {
+  TU_VERIFY(port_num < CFG_TUD_HUB_PORT + 1 && stats);
+  usbd_port_queue_t* pq = &_usbd_pq[port_num];
+  stats->count = tu_fifo_count(&pq->ff);
+  stats->high_water = pq->high_water;
+  stats->dropped = pq->dropped;
+  return true;
+}
+
+void tud_port_queue_stats_clear(uint8_t port_num) {
+  TU_VERIFY(port_num < CFG_TUD_HUB_PORT + 1,);
+  usbd_int_set(false);
+  _usbd_pq[port_num].high_water = 0;
+  _usbd_pq[port_num].dropped = 0;
+  usbd_int_set(true);
+}
+
+bool tud_port_queue_weight_set(uint8_t port_num, uint8_t weight) {
+  TU_VERIFY(port_num < CFG_TUD_HUB_PORT + 1 && weight > 0);
+  _usbd_pq[port_num].weight = weight;
+  return true;
+}
+#endif
+
+#if CFG_TUD_XFER_COALESCE
+void tud_xfer_coalesce_stats_get(tud_xfer_coalesce_stats_t* stats) {
+  usbd_int_set(false);
+  *stats = _usbd_coalesce_stats;
+  usbd_int_set(true);
+}
+
+void tud_xfer_coalesce_stats_clear(void) {
+  usbd_int_set(false);
+  tu_memclr(&_usbd_coalesce_stats, sizeof(_usbd_coalesce_stats));
+  usbd_int_set(true);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Task
 //--------------------------------------------------------------------+
@@ -496,7 +881,8 @@ bool tud_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
   TU_LOG_INT(sizeof(tu_fifo_t));
   TU_LOG_INT(sizeof(tu_edpt_stream_t));
 
-  for(uint8_t i=0;i<HUB_MAX_PORT_NUM+1;i++){
+  route_reset();
+  for(uint8_t i=0;i<CFG_TUD_HUB_PORT+1;i++){
 	  clear_dev(i);
   }
   _usbd_queued_setup = 0;
@@ -511,6 +897,10 @@ bool tud_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
   _usbd_q = osal_queue_create(&_usbd_qdef);
   TU_ASSERT(_usbd_q);
 
+#if CFG_TUD_TASK_PORT_QUEUE
+  port_queue_init();
+#endif
+
   // Get application driver if available
   if (usbd_app_driver_get_cb) {
     _app_driver = usbd_app_driver_get_cb(&_app_driver_count);
@@ -566,14 +956,33 @@ static void configuration_reset(uint8_t rhport, uint8_t port_num) {
   usbd_class_driver_t const* hubDriver = get_driver(TUD_HUB_DRIVER_IDX);
   hubDriver->reset(rhport, port_num);
 
+  route_unbind_port(port_num);
   clear_dev(port_num);
   memset(_usbd_dev[port_num].itf2drv, DRVID_INVALID, sizeof(_usbd_dev[port_num].itf2drv)); // invalid mapping
   memset(_usbd_dev[port_num].ep2drv, DRVID_INVALID, sizeof(_usbd_dev[port_num].ep2drv)); // invalid mapping
+#if CFG_TUD_XFER_COALESCE
+  coalesce_clear(port_num);
+#endif
+}
+
+// Downstream port of the hub is reset: device behind it is unconfigured and answers the default address
+void usbd_hub_port_reset(uint8_t rhport, uint8_t port_num) {
+  TU_VERIFY(port_num > 0 && port_num <= CFG_TUD_HUB_PORT,);
+  uint8_t const speed = _usbd_dev[0].speed;
+  configuration_reset(rhport, port_num);
+#if CFG_TUD_TASK_PORT_QUEUE
+  port_queue_clear(port_num);
+#endif
+  _usbd_dev[port_num].speed = speed;
+  _usbd_addr2port[0] = port_num;
 }
 
 static void usbd_reset(uint8_t rhport, uint8_t port_num) {
   configuration_reset(rhport, port_num);
   usbd_control_reset();
+#if CFG_TUD_TASK_PORT_QUEUE
+  port_queue_clear(port_num);
+#endif
 }
 
 bool tud_task_event_ready(void) {
@@ -581,97 +990,184 @@ bool tud_task_event_ready(void) {
   return !osal_queue_empty(_usbd_q);
 }
 
+// Invoke the class callback associated with the endpoint address
+static void process_xfer_complete(dcd_event_t* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const ep_dir = tu_edpt_dir(ep_addr);
+  uint8_t const port_num = xfer_ep2port(ep_addr);
+  xfer_owner_release(epnum, ep_dir);
+
+  TU_LOG_USBD("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event->xfer_complete.len);
+
+  _usbd_dev[port_num].ep_status[epnum][ep_dir].busy = 0;
+  _usbd_dev[port_num].ep_status[epnum][ep_dir].claimed = 0;
+
+  if (0 == epnum) {
+    usbd_control_xfer_cb(event->rhport, port_num, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+  } else {
+    uint16_t drvdev = _usbd_dev[port_num].ep2drv[epnum][ep_dir];
+    usbd_class_driver_t const* driver = get_driver(drvdev>>8);
+    TU_ASSERT(driver,);
+
+    TU_LOG_USBD("  %s xfer callback\r\n", driver->name);
+    driver->xfer_cb(event->rhport, port_num, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+  }
+}
+
+#if CFG_TUD_TASK_PORT_QUEUE
+// Drain per-port queues with weighted round-robin: each port processes up to its weight per round.
+// Return false if budget is used up while there are still pending events.
+static bool port_queue_process(uint8_t rhport, uint16_t* budget) {
+  bool pending = true;
+
+  while (pending) {
+    pending = false;
+
+    for (uint8_t n = 0; n < CFG_TUD_HUB_PORT + 1; n++) {
+      usbd_port_queue_t* pq = &_usbd_pq[_usbd_pq_next];
+
+      for (; _usbd_pq_served < pq->weight; _usbd_pq_served++) {
+        if (*budget == 0) {
+          // pick up where we left off in next call, with the rest of this port's weight
+          port_queue_notify(rhport, false);
+          return false;
+        }
+
+        dcd_event_t event;
+        if (!tu_fifo_spsc_read(&pq->ff, &event)) break;
+        (*budget)--;
+
+        TU_LOG_USBD("USBD Port %u Xfer Complete ", _usbd_pq_next);
+        trace_event(TU_TRACE_USBD_DISPATCH_START, &event);
+        process_xfer_complete(&event);
+        trace_event(TU_TRACE_USBD_DISPATCH_END, &event);
+      }
+      _usbd_pq_served = 0;
+
+      if (!tu_fifo_empty(&pq->ff)) pending = true;
+      _usbd_pq_next = (uint8_t) ((_usbd_pq_next + 1) % (CFG_TUD_HUB_PORT + 1));
+    }
+  }
+
+  return true;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Hub Descriptors
+// Built at compile time and served from flash by the descriptor pool
+//--------------------------------------------------------------------+
+enum {
+  HUB_ITF_NUM = 0,
+  HUB_ITF_NUM_TOTAL
+};
+
+enum {
+  HUB_EPNUM_STATUS = 0x81,
+  HUB_EP_STATUS_SIZE = 1, // status change bitmap of hub and up to 7 ports
+};
+
+enum {
+  HUB_STRID_LANGID = 0,
+  HUB_STRID_MAIN,
+  HUB_STRID_PRODUCT,
+  HUB_STRID_MISC,
+};
+
+#define HUB_CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_HUB_DESC_LEN)
+
+TU_VERIFY_STATIC(CFG_TUD_HUB_PORT >= 1 && CFG_TUD_HUB_PORT <= 7, "DeviceRemovable and status change bitmap are one byte");
+
+static tusb_desc_device_t const _hub_desc_device = {
+  .bLength            = sizeof(tusb_desc_device_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = TUSB_CLASS_HUB,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+  .bMaxPacketSize0    = 64,
+  .idVendor           = 0xCafe,
+  .idProduct          = 0x0150,
+  .bcdDevice          = 0x0100,
+  .iManufacturer      = 0x00,
+  .iProduct           = HUB_STRID_MAIN,
+  .iSerialNumber      = 0x00,
+  .bNumConfigurations = 0x01
+};
+
+static tusb_desc_device_qualifier_t const _hub_desc_qualifier = {
+  .bLength            = sizeof(tusb_desc_device_qualifier_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE_QUALIFIER,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = TUSB_CLASS_HUB,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+  .bMaxPacketSize0    = 64,
+  .bNumConfigurations = 0x01,
+  .bReserved          = 0x00
+};
+
+static uint8_t const _hub_desc_configuration[] = {
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, HUB_ITF_NUM_TOTAL, 0, HUB_CONFIG_TOTAL_LEN,
+                        TUSB_DESC_CONFIG_ATT_SELF_POWERED | TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 160),
+
+  // Interface number, string index, EP status change address, size & polling interval
+  TUD_HUB_DESCRIPTOR(HUB_ITF_NUM, 0, HUB_EPNUM_STATUS, HUB_EP_STATUS_SIZE, 0xff)
+};
+
+TU_VERIFY_STATIC(sizeof(_hub_desc_configuration) == HUB_CONFIG_TOTAL_LEN, "wTotalLength mismatch");
+
+// hub class descriptor, looked up by hub driver with type 0x19
+static hub_desc_cs_t const _hub_desc_class = {
+  .bLength             = sizeof(hub_desc_cs_t),
+  .bDescriptorType     = 0x19,
+  .bNbrPorts           = CFG_TUD_HUB_PORT,
+  .wHubCharacteristics = 0x0009,
+  .bPwrOn2PwrGood      = 0x32,
+  .bHubContrCurrent    = 0x64,
+  .DeviceRemovable     = 0x00,
+  .PortPwrCtrlMask     = 0xff
+};
+
+static uint8_t const _hub_desc_langid[] = { TUD_STRING_LANGID_DESCRIPTOR(0x0409) };
+TUD_STRING_DESCRIPTOR_DEF(_hub_desc_str_main, "TinyUSB");
+TUD_STRING_DESCRIPTOR_DEF(_hub_desc_str_product, "TinyUSB Hub");
+TUD_STRING_DESCRIPTOR_DEF(_hub_desc_str_misc, "149");
+
+static void const* const _hub_desc_configuration_arr[] = { _hub_desc_configuration };
+
+static void const* const _hub_desc_string_arr[] = {
+  [HUB_STRID_LANGID ] = _hub_desc_langid,
+  [HUB_STRID_MAIN   ] = &_hub_desc_str_main,
+  [HUB_STRID_PRODUCT] = &_hub_desc_str_product,
+  [HUB_STRID_MISC   ] = &_hub_desc_str_misc,
+};
+
+static tud_desc_template_t const _hub_desc_template = {
+  .device              = &_hub_desc_device,
+  .qualifier           = &_hub_desc_qualifier,
+  .configuration       = _hub_desc_configuration_arr,
+  .configuration_count = TU_ARRAY_SIZE(_hub_desc_configuration_arr),
+  .string              = _hub_desc_string_arr,
+  .string_count        = TU_ARRAY_SIZE(_hub_desc_string_arr),
+};
+
 void configure_hub(void){
-	//fill first descriptor pool with the hub descriptors
-	_usbd_dev[TUD_HUB_PORT_NUM].desc_pool_idx = u8CU_NewDescriptor();
-
-	tusb_desc_device_t descDevice = (tusb_desc_device_t){
-		    .bLength            = 0x12,
-		    .bDescriptorType    = TUSB_DESC_DEVICE,
-		    .bcdUSB             = 0x0200,
-		    .bDeviceClass       = 0x09,
-		    .bDeviceSubClass    = 0x00,
-		    .bDeviceProtocol    = 0x00,
-		    .bMaxPacketSize0    = 64,
-		    .idVendor           = 0xCafe,
-		    .idProduct          = 0x0150,
-		    .bcdDevice          = 0x0100,
-		    .iManufacturer      = 0x00,
-		    .iProduct           = 0x01,
-		    .iSerialNumber      = 0x00,
-		    .bNumConfigurations = 0x01
-		};
-	u8CU_SaveDesc(&descDevice);
-
-	tusb_desc_device_qualifier_t dev_qual_desc = (tusb_desc_device_qualifier_t){
-		.bLength            = 0x0A,
-		.bDescriptorType    = TUSB_DESC_DEVICE_QUALIFIER,
-		.bcdUSB             = 0x0200,
-		.bDeviceClass       = 0x09,
-		.bDeviceSubClass    = 0x00,
-		.bDeviceProtocol    = 0x00,
-		.bMaxPacketSize0    = 64,
-		.bNumConfigurations = 0x01,
-		.bReserved          = 0x00
-	};
-	u8CU_SaveDesc(&dev_qual_desc);
-
-	tusb_desc_configuration_t conf_desc = (tusb_desc_configuration_t){
-			 .bLength            = 0x09,
-			 .bDescriptorType    = TUSB_DESC_CONFIGURATION,
-			 .wTotalLength       = 0x19,
-			 .bNumInterfaces     = 0x01,
-			 .bConfigurationValue= 0x01,
-			 .iConfiguration     = 0x00,
-			 .bmAttributes       = 0xE0,
-			 .bMaxPower          = 0x50
-	};
-	u8CU_SaveDesc(&conf_desc);
-
-	tusb_desc_interface_t itf_desc = (tusb_desc_interface_t){
-			 .bLength            = 0x09,
-			 .bDescriptorType    = TUSB_DESC_INTERFACE,
-			 .bInterfaceNumber   = 0x00,
-			 .bAlternateSetting  = 0x00,
-			 .bNumEndpoints      = 0x01,
-			 .bInterfaceClass    = 0x09,
-			 .bInterfaceSubClass = 0x00,
-			 .bInterfaceProtocol = 0x00,
-			 .iInterface         = 0x00
-	};
-	u8CU_SaveDesc(&itf_desc);
-
-	hub_desc_cs_t hub_desc = (hub_desc_cs_t){
-	  .bLength             = 0x09,
-	  .bDescriptorType     = 0x19,
-	  .bNbrPorts           = CFG_TUD_HUB_PORT,
-	  .wHubCharacteristics = 0x0009,
-	  .bPwrOn2PwrGood      = 0x32,
-	  .bHubContrCurrent    = 0x64,
-	  .DeviceRemovable     = 0x00,
-	  .PortPwrCtrlMask     = 0xff
-	};
-	u8CU_SaveDesc(&hub_desc);
-
-	tusb_desc_endpoint_t ep_desc = (tusb_desc_endpoint_t){
-			 .bLength            = 0x07,
-			 .bDescriptorType    = TUSB_DESC_ENDPOINT,
-			 .bEndpointAddress   = 0x81,
-			 .bmAttributes       = 0x03,
-			 .wMaxPacketSize     = 0x0001,
-			 .bInterval          = 0xff
-	};
-	u8CU_SaveDesc(&ep_desc);
-
-	uint8_t au8StrLang[] = { 2+3, TUSB_DESC_STRING, 0x09, 0x04, '\0'};
-	u8CU_SaveDesc(&au8StrLang);
-	uint8_t au8StrMain[] = { 2+8, TUSB_DESC_STRING, 'T','i','n','y','U','S','B','\0'};
-	u8CU_SaveDesc(&au8StrMain);
-	uint8_t au8StrProd[] = { 2+12, TUSB_DESC_STRING, 'F','u','c','k','i','n','g',' ','H','U','B','\0'};
-	u8CU_SaveDesc(&au8StrProd);
-	uint8_t au8StrIdk[] = { 2+4, TUSB_DESC_STRING, '1','4','9','\0'};
-	u8CU_SaveDesc(&au8StrIdk);
+	//fill first descriptor pool with the hub descriptors, nothing is copied
+	uint8_t const pool = tud_desc_pool_new_template(&_hub_desc_template);
+	TU_ASSERT(pool != TUD_DESC_POOL_INVALID, );
+	TU_ASSERT(tud_desc_pool_add_static(pool, 0, 0, &_hub_desc_class), );
+	_usbd_dev[TUD_HUB_PORT_NUM].desc_pool_idx = pool;
+}
+
+bool tud_desc_pool_bind(uint8_t port_num, uint8_t pool) {
+  TU_VERIFY(port_num <= CFG_TUD_HUB_PORT && pool != TUD_DESC_POOL_INVALID);
+  _usbd_dev[port_num].desc_pool_idx = pool;
+  return true;
 }
+
 /* USB Device Driver task
  * This top level thread manages all device controller event and delegates events to class-specific drivers.
  * This should be called periodically within the mainloop or rtos thread.
@@ -693,6 +1189,11 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
   // Skip if stack is not initialized
   if (!tud_inited()) return;
 
+#if CFG_TUD_TASK_PORT_QUEUE
+  uint16_t budget = CFG_TUD_TASK_EVENT_BUDGET;
+  bool budget_left = true;
+#endif
+
   // Loop until there is no more events in the queue
   while (1) {
     dcd_event_t event;
@@ -703,10 +1204,12 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
     TU_LOG_USBD("USBD %s ", event.event_id < DCD_EVENT_COUNT ? _usbd_event_str[event.event_id] : "CORRUPTED");
 #endif
 
+    trace_event(TU_TRACE_USBD_DISPATCH_START, &event);
+
     switch (event.event_id) {
       case DCD_EVENT_BUS_RESET:
         TU_LOG_USBD(": %s Speed\r\n", tu_str_speed[event.bus_reset.speed]);
-        for(uint8_t i=0;i<HUB_MAX_PORT_NUM+1;i++){
+        for(uint8_t i=0;i<CFG_TUD_HUB_PORT+1;i++){
         	usbd_reset(event.rhport, i);
         	_usbd_dev[i].speed = event.bus_reset.speed;
         }
@@ -714,12 +1217,17 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
 
       case DCD_EVENT_UNPLUGGED:
         TU_LOG_USBD("\r\n");
-        for(uint8_t i=0;i<HUB_MAX_PORT_NUM+1;i++){usbd_reset(event.rhport, i);}
+        for(uint8_t i=0;i<CFG_TUD_HUB_PORT+1;i++){usbd_reset(event.rhport, i);}
         tud_umount_cb();
         break;
 
       case DCD_EVENT_SETUP_RECEIVED:
-        TU_ASSERT(_usbd_queued_setup > 0,);
+        if (_usbd_queued_setup == 0) {
+          // assert, but fall through to DISPATCH_END so that trace stays balanced
+          TU_MESS_FAILED();
+          TU_BREAKPOINT();
+          break;
+        }
         _usbd_queued_setup--;
         TU_LOG_BUF(&event.setup_received, 8);
         if (_usbd_queued_setup) {
@@ -737,6 +1245,10 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         _usbd_dev[lsd].ep_status[0][TUSB_DIR_IN].busy = 0;
         _usbd_dev[lsd].ep_status[0][TUSB_DIR_IN].claimed = 0;
 
+        // SETUP aborts control transfer of any port
+        xfer_owner_release(0, TUSB_DIR_OUT);
+        xfer_owner_release(0, TUSB_DIR_IN);
+
         // Process control request
         if (!process_control_request(event.rhport, lsd, &event.setup_received)) {
           TU_LOG_USBD("  Stall EP0\r\n");
@@ -746,31 +1258,24 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         }
         break;
 
-      case DCD_EVENT_XFER_COMPLETE: {
-        // Invoke the class callback associated with the endpoint address
-        uint8_t const ep_addr = event.xfer_complete.ep_addr;
-        uint8_t const epnum = tu_edpt_number(ep_addr);
-        uint8_t const ep_dir = tu_edpt_dir(ep_addr);
-        uint8_t const port_num = ep2port(ep_addr);
-
-
-        TU_LOG_USBD("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
-
-        _usbd_dev[port_num].ep_status[epnum][ep_dir].busy = 0;
-        _usbd_dev[port_num].ep_status[epnum][ep_dir].claimed = 0;
+      case DCD_EVENT_XFER_COMPLETE:
+        process_xfer_complete(&event);
+        break;
 
-        if (0 == epnum) {
-          usbd_control_xfer_cb(event.rhport, port_num, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
-        } else {
-          uint16_t drvdev = _usbd_dev[port_num].ep2drv[epnum][ep_dir];
-          usbd_class_driver_t const* driver = get_driver(drvdev>>8);
-          TU_ASSERT(driver,);
+#if CFG_TUD_XFER_COALESCE
+      case USBD_EVENT_XFER_COALESCED:
+        process_xfer_coalesced(&event);
+        break;
+#endif
 
-          TU_LOG_USBD("  %s xfer callback\r\n", driver->name);
-          driver->xfer_cb(event.rhport, port_num, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
-        }
+#if CFG_TUD_TASK_PORT_QUEUE
+      case USBD_EVENT_PORT_QUEUE:
+        TU_LOG_USBD("\r\n");
+        _usbd_pq_notified = false;
+        // budget used up: remaining events are processed in next call
+        budget_left = port_queue_process(event.rhport, &budget);
         break;
-      }
+#endif
 
       case DCD_EVENT_SUSPEND:
         // NOTE: When plugging/unplugging device, the D+/D- state are unstable and
@@ -812,6 +1317,12 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         break;
     }
 
+    trace_event(TU_TRACE_USBD_DISPATCH_END, &event);
+
+#if CFG_TUD_TASK_PORT_QUEUE
+    if (!budget_left) return;
+#endif
+
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
     if (osal_queue_empty(_usbd_q)) { return; }
@@ -885,14 +1396,19 @@ static bool process_control_request(uint8_t rhport, uint8_t port_num, tusb_contr
   	TU_LOG_USBD("bRequest %d", p_request->bRequest);
       switch ( p_request->bRequest ) {
         case TUSB_REQ_SET_ADDRESS:
+          TU_VERIFY(p_request->wValue < DEV_ADDR_COUNT);
           // Depending on mcu, status phase could be sent either before or after changing device address,
           // or even require stack to not response with status at all
           // Therefore DCD must take full responsibility to response and include zlp status packet if needed.
           usbd_control_set_request(p_request); // set request since DCD has no access to tud_control_status() API
           dcd_set_address(rhport, (uint8_t) p_request->wValue);
           // skip tud_control_status()
+          if (_usbd_addr2port[_usbd_dev[port_num].address] == port_num) {
+            _usbd_addr2port[_usbd_dev[port_num].address] = PORT_INVALID;
+          }
           _usbd_dev[port_num].addressed = 1;
-          _usbd_dev[port_num].address = p_request->wValue;
+          _usbd_dev[port_num].address = (uint8_t) p_request->wValue;
+          _usbd_addr2port[_usbd_dev[port_num].address] = port_num;
         break;
 
         case TUSB_REQ_GET_CONFIGURATION: {
@@ -1120,8 +1636,8 @@ static bool process_control_request(uint8_t rhport, uint8_t port_num, tusb_contr
 static bool process_set_config(uint8_t rhport, uint8_t port_num, uint8_t cfg_num)
 {
   // index is cfg_num-1
-  tusb_desc_configuration_t const * desc_cfg = NULL;
-  boCU_GetDesc(_usbd_dev[port_num].desc_pool_idx,TUSB_DESC_CONFIGURATION,0,&desc_cfg, NULL);
+  tusb_desc_configuration_t const * desc_cfg = (tusb_desc_configuration_t const *)
+      tud_desc_pool_get(_usbd_dev[port_num].desc_pool_idx, TUSB_DESC_CONFIGURATION, cfg_num - 1, 0, NULL);
   TU_ASSERT(desc_cfg != NULL && desc_cfg->bDescriptorType == TUSB_DESC_CONFIGURATION);
 
   // Parse configuration descriptor
@@ -1203,7 +1719,7 @@ static bool process_set_config(uint8_t rhport, uint8_t port_num, uint8_t cfg_num
         // bind all endpoints to found driver
         TU_LOG_USBD("Drv_id: %d\r\n", drv_id);
         TU_LOG_BUF(desc_itf,sizeof(tusb_desc_interface_t));
-        tu_edpt_bind_driver(_usbd_dev[port_num].ep2drv, desc_itf, drv_len, drv_id);
+        route_bind_edpt(port_num, drv_id, desc_itf, drv_len);
 
         // next Interface
         p_desc += drv_len;
@@ -1219,25 +1735,26 @@ static bool process_set_config(uint8_t rhport, uint8_t port_num, uint8_t cfg_num
 }
 
 // return descriptor's buffer and update desc_len
-static uint16_t _desc_str[MAX_STR_LEN + 1];
 static bool process_get_descriptor(uint8_t rhport, uint8_t port_num, tusb_control_request_t const * p_request)
 {
   tusb_desc_type_t const desc_type = (tusb_desc_type_t) tu_u16_high(p_request->wValue);
   uint8_t const desc_index = tu_u16_low( p_request->wValue );
-  uint8_t* pu8Descriptor = NULL;
-  uint8_t u8DescriptorSize;
+  uint8_t const pool = _usbd_dev[port_num].desc_pool_idx;
+  uint16_t desc_len = 0;
+
   switch(desc_type)
   {
     case TUSB_DESC_DEVICE: {
       TU_LOG_USBD(" Device %u\r\n", port_num);
-      if (boCU_GetDesc(_usbd_dev[port_num].desc_pool_idx,TUSB_DESC_DEVICE,0,&pu8Descriptor,&u8DescriptorSize) == true){
-          TU_LOG_BUF(pu8Descriptor, 18);
+      uint8_t const* desc_device = tud_desc_pool_get(pool, TUSB_DESC_DEVICE, 0, 0, &desc_len);
+      if (desc_device) {
+          TU_LOG_BUF(desc_device, 18);
       }
       else{
           TU_LOG_USBD("No descriptor found");
       }
 
-      TU_ASSERT(pu8Descriptor);
+      TU_ASSERT(desc_device);
 
       // Only response with exactly 1 Packet if: not addressed and host requested more data than device descriptor has.
       // This only happens with the very first get device descriptor and EP0 size = 8 or 16.
@@ -1248,9 +1765,9 @@ static bool process_get_descriptor(uint8_t rhport, uint8_t port_num, tusb_contro
         tusb_control_request_t mod_request = *p_request;
         mod_request.wLength = CFG_TUD_ENDPOINT0_SIZE;
 
-        return tud_control_xfer(rhport, port_num, &mod_request, pu8Descriptor, CFG_TUD_ENDPOINT0_SIZE);
+        return tud_control_xfer(rhport, port_num, &mod_request, (void*) (uintptr_t) desc_device, CFG_TUD_ENDPOINT0_SIZE);
       }else {
-        return tud_control_xfer(rhport, port_num, p_request, pu8Descriptor, u8DescriptorSize);
+        return tud_control_xfer(rhport, port_num, p_request, (void*) (uintptr_t) desc_device, desc_len);
       }
     }
     // break; // unreachable
@@ -1271,45 +1788,38 @@ static bool process_get_descriptor(uint8_t rhport, uint8_t port_num, tusb_contro
 
     case TUSB_DESC_CONFIGURATION:
     case TUSB_DESC_OTHER_SPEED_CONFIG: {
-      uintptr_t desc_config;
-
       if ( desc_type == TUSB_DESC_CONFIGURATION ) {
         TU_LOG_USBD(" Configuration[%u]\r\n", desc_index);
-        boCU_GetDesc(_usbd_dev[port_num].desc_pool_idx,TUSB_DESC_CONFIGURATION,0,&desc_config, NULL);
-        TU_ASSERT(desc_config);
       }else {
         // Host only request this after getting Device Qualifier descriptor
         TU_LOG_USBD(" Other Speed Configuration\r\n");
-        desc_config = (uintptr_t) NULL;
-        TU_VERIFY(desc_config);
       }
 
-      // Use offsetof to avoid pointer to the odd/misaligned address
-      uint16_t const total_len = tu_le16toh( tu_unaligned_read16((const void*) (desc_config + offsetof(tusb_desc_configuration_t, wTotalLength))) );
+      // length is wTotalLength, configuration can be larger than 255 bytes
+      uint8_t const* desc_config = tud_desc_pool_get(pool, desc_type, desc_index, 0, &desc_len);
+      TU_VERIFY(desc_config);
 
-      return tud_control_xfer(rhport, port_num, p_request, (void*) desc_config, total_len);
+      return tud_control_xfer(rhport, port_num, p_request, (void*) (uintptr_t) desc_config, desc_len);
     }
     // break; // unreachable
 
     case TUSB_DESC_STRING:
     {
       TU_LOG_USBD(" String[%u]\r\n", desc_index);
-      boCU_GetDesc(_usbd_dev[port_num].desc_pool_idx,TUSB_DESC_STRING,desc_index,&pu8Descriptor,&u8DescriptorSize);
 
-      // TUSB_DESC_STRING shall be removed from the 2. byte
-      for(uint8_t i=1;i<u8DescriptorSize-1;i++){
-    	  _desc_str[i] = pu8Descriptor[i+1];
-      }
-      _desc_str[0] = u8DescriptorSize-1;
-      return tud_control_xfer(rhport, port_num, p_request, (void*) (uintptr_t) _desc_str, u8DescriptorSize-1);
+      // wIndex is language id, pool stores strings as UTF-16 string descriptors
+      uint8_t const* desc_str = tud_desc_pool_get(pool, TUSB_DESC_STRING, desc_index, p_request->wIndex, &desc_len);
+      TU_VERIFY(desc_str);
+
+      return tud_control_xfer(rhport, port_num, p_request, (void*) (uintptr_t) desc_str, desc_len);
     }
     // break; // unreachable
 
     case TUSB_DESC_DEVICE_QUALIFIER: {
       TU_LOG_USBD(" Device Qualifier\r\n");
-      boCU_GetDesc(_usbd_dev[port_num].desc_pool_idx,TUSB_DESC_DEVICE_QUALIFIER,0,&pu8Descriptor,&u8DescriptorSize);
-      TU_VERIFY(pu8Descriptor);
-      return tud_control_xfer(rhport, port_num, p_request, (void*) (uintptr_t) pu8Descriptor, u8DescriptorSize);
+      uint8_t const* desc_qualifier = tud_desc_pool_get(pool, TUSB_DESC_DEVICE_QUALIFIER, 0, 0, &desc_len);
+      TU_VERIFY(desc_qualifier);
+      return tud_control_xfer(rhport, port_num, p_request, (void*) (uintptr_t) desc_qualifier, desc_len);
     }
     // break; // unreachable
 
@@ -1378,11 +1888,17 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
     	// TODO check where the addr is stored
         TU_LOG_USBD("SETUP: ");
         TU_LOG_BUF(&event->setup_received,8);
-      lsd = addr2port(event->setup_received.bRequest);
+      lsd = addr2port(event->dev_addr);
       _usbd_queued_setup++;
       send = true;
       break;
 
+#if CFG_TUD_XFER_ISR
+    case DCD_EVENT_XFER_COMPLETE:
+      send = !(in_isr && xfer_isr_dispatch(event));
+      break;
+#endif
+
     default:
       send = true;
       break;
@@ -1397,6 +1913,12 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
 // USBD API For Class Driver
 //--------------------------------------------------------------------+
 
+uint8_t const* usbd_desc_get(uint8_t port_num, uint8_t type, uint8_t index, uint16_t* len)
+{
+  TU_VERIFY(port_num <= CFG_TUD_HUB_PORT, NULL);
+  return tud_desc_pool_get(_usbd_dev[port_num].desc_pool_idx, type, index, 0, len);
+}
+
 void usbd_int_set(bool enabled)
 {
   if (enabled)
@@ -1502,9 +2024,13 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev[port_num].ep_status[epnum][dir].busy == 0);
 
+  // Controller endpoint is still used by a transfer of another port
+  TU_VERIFY(xfer_owner_take(port_num, epnum, dir));
+
   // Set busy first since the actual transfer can be complete before dcd_edpt_xfer()
   // could return and USBD task can preempt and clear the busy
   _usbd_dev[port_num].ep_status[epnum][dir].busy = 1;
+  TU_TRACE(TU_TRACE_USBD_XFER, 0, port_num, ep_addr, total_bytes);
   dcd_switch_address(rhport, _usbd_dev[port_num].address);
   if (dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes)) {
     return true;
@@ -1512,6 +2038,46 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
     // DCD error, mark endpoint as ready to allow next transfer
 	_usbd_dev[port_num].ep_status[epnum][dir].busy = 0;
 	_usbd_dev[port_num].ep_status[epnum][dir].claimed = 0;
+	xfer_owner_release(epnum, dir);
+    TU_LOG_USBD("FAILED\r\n");
+    TU_BREAKPOINT();
+    return false;
+  }
+}
+
+bool usbd_edpt_xfer_fifo_supported(void) {
+  return dcd_edpt_xfer_fifo != NULL;
+}
+
+bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+  rhport = _usbd_rhport;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  uint8_t const port_num = ep2port(ep_addr);
+
+  TU_VERIFY(usbd_edpt_xfer_fifo_supported());
+
+  TU_LOG_USBD("  Queue FIFO EP %02X with %u bytes ...\r\n", ep_addr, total_bytes);
+
+  // Attempt to transfer on a busy endpoint, sound like an race condition !
+  TU_ASSERT(_usbd_dev[port_num].ep_status[epnum][dir].busy == 0);
+
+  // Controller endpoint is still used by a transfer of another port
+  TU_VERIFY(xfer_owner_take(port_num, epnum, dir));
+
+  // Set busy first since the actual transfer can be complete before dcd_edpt_xfer_fifo()
+  // could return and USBD task can preempt and clear the busy
+  _usbd_dev[port_num].ep_status[epnum][dir].busy = 1;
+  TU_TRACE(TU_TRACE_USBD_XFER, 0, port_num, ep_addr, total_bytes);
+  dcd_switch_address(rhport, _usbd_dev[port_num].address);
+  if (dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes)) {
+    return true;
+  } else {
+    // DCD error, mark endpoint as ready to allow next transfer
+    _usbd_dev[port_num].ep_status[epnum][dir].busy = 0;
+    _usbd_dev[port_num].ep_status[epnum][dir].claimed = 0;
+    xfer_owner_release(epnum, dir);
     TU_LOG_USBD("FAILED\r\n");
     TU_BREAKPOINT();
     return false;
@@ -1533,9 +2099,13 @@ bool usbd_ctrl_edpt_xfer(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, uint
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev[port_num].ep_status[epnum][dir].busy == 0);
 
+  // Controller endpoint is still used by a transfer of another port
+  TU_VERIFY(xfer_owner_take(port_num, epnum, dir));
+
   // Set busy first since the actual transfer can be complete before dcd_edpt_xfer()
   // could return and USBD task can preempt and clear the busy
   _usbd_dev[port_num].ep_status[epnum][dir].busy = 1;
+  TU_TRACE(TU_TRACE_USBD_XFER, 0, port_num, ep_addr, total_bytes);
   dcd_switch_address(rhport, _usbd_dev[port_num].address);
   if (dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes)) {
     return true;
@@ -1543,6 +2113,7 @@ bool usbd_ctrl_edpt_xfer(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, uint
     // DCD error, mark endpoint as ready to allow next transfer
 	_usbd_dev[port_num].ep_status[epnum][dir].busy = 0;
 	_usbd_dev[port_num].ep_status[epnum][dir].claimed = 0;
+	xfer_owner_release(epnum, dir);
     TU_LOG_USBD("FAILED\r\n");
     TU_BREAKPOINT();
     return false;
@@ -1622,6 +2193,37 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
   return;
 }
 
+bool usbd_edpt_isr_set(uint8_t rhport, uint8_t ep_addr, bool enabled) {
+  (void) rhport;
+#if CFG_TUD_XFER_ISR
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  uint8_t const port_num = ep2port(ep_addr);
+
+  TU_ASSERT(epnum > 0 && epnum < CFG_TUD_ENDPPOINT_MAX);
+
+  usbd_int_set(false);
+  if (enabled) {
+    _usbd_dev[port_num].ep_isr[dir] = (uint16_t) tu_bit_set(_usbd_dev[port_num].ep_isr[dir], epnum);
+  } else {
+    _usbd_dev[port_num].ep_isr[dir] = (uint16_t) tu_bit_clear(_usbd_dev[port_num].ep_isr[dir], epnum);
+  }
+  usbd_int_set(true);
+  return true;
+#else
+  (void) ep_addr; (void) enabled;
+  return false;
+#endif
+}
+
+uint32_t usbd_xfer_isr_timestamp(void) {
+#if CFG_TUD_XFER_ISR && CFG_TUSB_TRACE
+  return _usbd_xfer_isr_ts;
+#else
+  return 0;
+#endif
+}
+
 void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en) {
   rhport = _usbd_rhport;
 
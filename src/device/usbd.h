@@ -31,6 +31,7 @@
 #include "device/dcd.h"
 #include "tusb.h"
 #include "common/tusb_private.h"
+#include "device/usbd_desc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,9 +44,6 @@ extern "C" {
 // Invalid driver ID in itf2drv[] ep2drv[][] mapping
 enum { DRVID_INVALID = 0xFFu };
 enum { DRVID_DEVIDX_INVALID = 0xFFFFu };
-#define MAX_CFG_SIZE 255u
-#define MAX_STRINGS 6u
-#define MAX_STR_LEN 32u
 
 typedef struct {
   struct TU_ATTR_PACKED {
@@ -68,16 +66,12 @@ typedef struct {
 
   tu_edpt_state_t ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
-  // Descriptors
-  uint8_t desc_pool_idx; // pool for descriptors
-  tusb_desc_device_t dev_desc;
-  tusb_desc_device_qualifier_t dev_qual_desc;
-  // uint16_t conf_desc_len; it's in the tusb_desc_configuration_t.wTotalLength
-  uint8_t conf_desc[MAX_CFG_SIZE];
+#if CFG_TUD_XFER_ISR
+  uint16_t ep_isr[2]; // bitmap per direction of endpoints whose transfer complete is handled in ISR
+#endif
 
-  // Strings
-  uint8_t string_count;
-  char strings[MAX_STRINGS][MAX_STR_LEN];
+  // Descriptors and strings are kept in the shared descriptor pool, see usbd_desc.h
+  uint8_t desc_pool_idx;
 
 }usbd_device_t;
 
@@ -120,8 +114,42 @@ void tud_task (void) {
 // Check if there is pending events need processing by tud_task()
 bool tud_task_event_ready(void);
 
+#if CFG_TUD_TASK_PORT_QUEUE
+typedef struct {
+  uint16_t count;      // events currently queued
+  uint16_t high_water; // highest number of queued events seen
+  uint32_t dropped;    // events dropped because queue was full
+} tud_port_queue_stats_t;
+
+// Get event queue statistics of a port
+bool tud_port_queue_stats_get(uint8_t port_num, tud_port_queue_stats_t* stats);
+
+// Reset high-water mark and drop counter of a port
+void tud_port_queue_stats_clear(uint8_t port_num);
+
+// Set maximum number of events processed for a port in each scheduling round (default 1)
+bool tud_port_queue_weight_set(uint8_t port_num, uint8_t weight);
+#endif
+
+#if CFG_TUD_XFER_COALESCE
+typedef struct {
+  uint32_t events;  // completions forwarded from ISR to drivers implementing xfer_coalesced_cb
+  uint32_t saved;   // completions merged into an already queued event instead of being queued
+  uint32_t dropped; // completions lost to a full queue or to a reset of their port
+} tud_xfer_coalesce_stats_t;
+
+// Get transfer complete coalescing statistics
+void tud_xfer_coalesce_stats_get(tud_xfer_coalesce_stats_t* stats);
+
+// Reset transfer complete coalescing statistics
+void tud_xfer_coalesce_stats_clear(void);
+#endif
+
 void configure_hub(void);
 
+// Serve descriptors of a port from a descriptor pool created with tud_desc_pool_new()
+bool tud_desc_pool_bind(uint8_t port_num, uint8_t pool);
+
 #ifndef TUSB_DCD_H_
 extern void dcd_int_handler(uint8_t rhport);
 #endif
@@ -271,6 +299,23 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t stage,
 #define TUD_CONFIG_DESCRIPTOR(config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
   9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, config_num, _stridx, TU_BIT(7) | _attribute, (_power_ma)/2
 
+//--------------------------------------------------------------------+
+// String Descriptor Templates
+//--------------------------------------------------------------------+
+
+// Language ID list with one language
+#define TUD_STRING_LANGID_DESCRIPTOR(_langid) \
+  4, TUSB_DESC_STRING, U16_TO_U8S_LE(_langid)
+
+// Define a const string descriptor _name from a non-empty string literal, encoded as UTF-16 at compile time
+#define TUD_STRING_DESCRIPTOR_DEF(_name, _str) \
+  static const struct TU_ATTR_PACKED { \
+    uint8_t  bLength; \
+    uint8_t  bDescriptorType; \
+    uint16_t unicode_string[sizeof(_str) - 1]; \
+  } _name = { 2*sizeof(_str), TUSB_DESC_STRING, TU_STRCAT(u, _str) }; \
+  TU_VERIFY_STATIC(sizeof(_name) == 2*sizeof(_str) && sizeof(_name) <= 255, "string descriptor is too long")
+
 //--------------------------------------------------------------------+
 // CDC Descriptor Templates
 //--------------------------------------------------------------------+
@@ -318,6 +363,27 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t stage,
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
 
+// Length of template descriptor: 53 bytes
+#define TUD_UAS_DESC_LEN    (9 + 4*(7 + 4))
+
+// UAS interface: interface number, string index, Command Out, Status In, Data In & Data Out EP address, EP size.
+// Each endpoint is followed by its Pipe Usage descriptor
+#define TUD_UAS_DESCRIPTOR(_itfnum, _stridx, _ep_cmd, _ep_status, _ep_data_in, _ep_data_out, _epsize) \
+  /* Interface */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 4, TUSB_CLASS_MSC, MSC_SUBCLASS_SCSI, MSC_PROTOCOL_UAS, _stridx,\
+  /* Command Endpoint Out */\
+  7, TUSB_DESC_ENDPOINT, _ep_cmd, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_PIPE_USAGE, UAS_PIPE_ID_COMMAND, 0,\
+  /* Status Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _ep_status, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_PIPE_USAGE, UAS_PIPE_ID_STATUS, 0,\
+  /* Data-In Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _ep_data_in, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_PIPE_USAGE, UAS_PIPE_ID_DATA_IN, 0,\
+  /* Data-Out Endpoint Out */\
+  7, TUSB_DESC_ENDPOINT, _ep_data_out, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, UAS_DESC_PIPE_USAGE, UAS_PIPE_ID_DATA_OUT, 0
+
 
 //--------------------------------------------------------------------+
 // HID Descriptor Templates
@@ -351,6 +417,20 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t stage,
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_epsize), _ep_interval
 
+//--------------------------------------------------------------------+
+// HUB Descriptor Templates
+//--------------------------------------------------------------------+
+
+// Length of template descriptor: 16 bytes
+#define TUD_HUB_DESC_LEN    (9 + 7)
+
+// Interface number, string index, EP status change address, size & polling interval
+#define TUD_HUB_DESCRIPTOR(_itfnum, _stridx, _epin, _epsize, _ep_interval) \
+  /* Interface */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 1, TUSB_CLASS_HUB, 0, 0, _stridx,\
+  /* Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_epsize), _ep_interval
+
 //--------------------------------------------------------------------+
 // MIDI Descriptor Templates
 // Note: MIDI v1.0 is based on Audio v1.0
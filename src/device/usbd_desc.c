@@ -0,0 +1,369 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUD_ENABLED
+
+#include "device/usbd_desc.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+TU_VERIFY_STATIC((CFG_TUD_DESC_POOL_ENTRIES & (CFG_TUD_DESC_POOL_ENTRIES - 1)) == 0, "entries must be power of 2");
+TU_VERIFY_STATIC(CFG_TUD_DESC_POOL_ENTRIES < 0xFFFE, "too many entries");
+TU_VERIFY_STATIC(CFG_TUD_DESC_POOL_ARENA_SIZE <= UINT16_MAX, "arena too large");
+TU_VERIFY_STATIC(CFG_TUD_DESC_POOL_COUNT <= 32, "too many pools");
+
+enum {
+  SLOT_COUNT   = 2*CFG_TUD_DESC_POOL_ENTRIES, // keep load factor at most 1/2
+  SLOT_EMPTY   = 0,                           // slot.blob is blob index + 1
+  SLOT_DELETED = 0xFFFF,
+  BLOB_ALIGN   = 4,
+  STRING_CHAR_MAX = (255 - 2) / 2,
+};
+
+typedef struct {
+  uint8_t  pool;
+  uint8_t  type;
+  uint8_t  index;
+  uint16_t langid;
+  uint16_t blob;
+} desc_slot_t;
+
+typedef struct {
+  uint8_t const* ext; // descriptor outside of arena (flash) or NULL
+  uint32_t hash;
+  uint16_t offset;
+  uint16_t len;
+  uint16_t cap;  // arena space, 0 if record is unused or descriptor is external
+  uint16_t ref;  // number of slots referencing this blob
+} desc_blob_t;
+
+typedef struct {
+  uint32_t pool_used; // bitmap
+  uint16_t arena_used;
+  uint16_t entry_count;
+  uint16_t blob_count;
+
+  desc_slot_t slot[SLOT_COUNT];
+  desc_blob_t blob[CFG_TUD_DESC_POOL_ENTRIES];
+} desc_pool_t;
+
+tu_static desc_pool_t _desc;
+tu_static TU_ATTR_ALIGNED(4) uint8_t _desc_arena[CFG_TUD_DESC_POOL_ARENA_SIZE];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t slot_hash(uint8_t pool, uint8_t type, uint8_t index, uint16_t langid) {
+  uint32_t const key = ((uint32_t) pool << 24) | ((uint32_t) type << 16) | ((uint32_t) index << 8) |
+                       (uint8_t) (langid ^ (langid >> 8));
+  uint32_t const h = key * 2654435761u; // Knuth multiplicative hash
+  return (uint16_t) ((h ^ (h >> 16)) & (SLOT_COUNT - 1));
+}
+
+// FNV-1a
+static uint32_t content_hash(uint8_t const* data, uint16_t len) {
+  uint32_t h = 2166136261u;
+  for (uint16_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return h;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t const* blob_data(desc_blob_t const* blob) {
+  return blob->ext ? blob->ext : (_desc_arena + blob->offset);
+}
+
+// Configuration, other speed configuration and BOS carry their total length in wTotalLength
+static uint16_t desc_total_len(uint8_t const* desc) {
+  switch (desc[1]) {
+    case TUSB_DESC_CONFIGURATION:
+    case TUSB_DESC_OTHER_SPEED_CONFIG:
+    case TUSB_DESC_BOS:
+      return tu_le16toh(tu_unaligned_read16(desc + 2));
+
+    default:
+      return desc[0];
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool pool_valid(uint8_t pool) {
+  return pool < CFG_TUD_DESC_POOL_COUNT && tu_bit_test(_desc.pool_used, pool);
+}
+
+// return slot index, or SLOT_COUNT if not found
+static uint16_t slot_find(uint8_t pool, uint8_t type, uint8_t index, uint16_t langid) {
+  uint16_t idx = slot_hash(pool, type, index, langid);
+
+  for (uint16_t n = 0; n < SLOT_COUNT; n++) {
+    desc_slot_t const* slot = &_desc.slot[idx];
+    if (slot->blob == SLOT_EMPTY) break;
+
+    if (slot->blob != SLOT_DELETED && slot->pool == pool && slot->type == type &&
+        slot->index == index && slot->langid == langid) {
+      return idx;
+    }
+    idx = (idx + 1) & (SLOT_COUNT - 1);
+  }
+
+  return SLOT_COUNT;
+}
+
+// return first empty or deleted slot in probe sequence
+static uint16_t slot_free(uint8_t pool, uint8_t type, uint8_t index, uint16_t langid) {
+  uint16_t idx = slot_hash(pool, type, index, langid);
+
+  for (uint16_t n = 0; n < SLOT_COUNT; n++) {
+    uint16_t const blob = _desc.slot[idx].blob;
+    if (blob == SLOT_EMPTY || blob == SLOT_DELETED) return idx;
+    idx = (idx + 1) & (SLOT_COUNT - 1);
+  }
+
+  return SLOT_COUNT;
+}
+
+// return index of an existing identical blob or a new one, -1 if out of memory.
+// New blob is copied into arena, or only referenced if data is static.
+static int32_t blob_get(uint8_t const* data, uint16_t len, bool is_static) {
+  uint32_t const hash = content_hash(data, len);
+  uint16_t const cap  = (uint16_t) tu_round_up(len, BLOB_ALIGN);
+  int32_t record = -1;
+  int32_t hole   = -1;
+
+  for (uint16_t i = 0; i < CFG_TUD_DESC_POOL_ENTRIES; i++) {
+    desc_blob_t const* blob = &_desc.blob[i];
+
+    if (blob->ref == 0) {
+      if (blob->cap == 0) {
+        if (record < 0) record = i;
+      } else if (hole < 0 && blob->cap >= cap) {
+        // released blob in the middle of arena, reuse its space if large enough
+        hole = i;
+      }
+    } else if (blob->hash == hash && blob->len == len && 0 == memcmp(blob_data(blob), data, len)) {
+      return i;
+    }
+  }
+
+  desc_blob_t* blob;
+  if (is_static) {
+    TU_VERIFY(record >= 0, -1);
+    blob = &_desc.blob[record];
+    blob->cap = 0;
+    hole = record;
+  } else if (hole >= 0) {
+    blob = &_desc.blob[hole];
+  } else {
+    TU_VERIFY(record >= 0 && (uint32_t) _desc.arena_used + cap <= CFG_TUD_DESC_POOL_ARENA_SIZE, -1);
+    blob = &_desc.blob[record];
+    blob->offset = _desc.arena_used;
+    blob->cap    = cap;
+    _desc.arena_used = (uint16_t) (_desc.arena_used + cap);
+    hole = record;
+  }
+
+  blob->ext  = is_static ? data : NULL;
+  blob->hash = hash;
+  blob->len  = len;
+  blob->ref  = 0;
+  if (!is_static) memcpy(_desc_arena + blob->offset, data, len);
+  _desc.blob_count++;
+
+  return hole;
+}
+
+static void blob_release(uint16_t idx) {
+  desc_blob_t* blob = &_desc.blob[idx];
+  if (--blob->ref) return;
+
+  _desc.blob_count--;
+  blob->ext = NULL;
+
+  // give back space of released blobs at the end of arena
+  bool found = true;
+  while (found) {
+    found = false;
+    for (uint16_t i = 0; i < CFG_TUD_DESC_POOL_ENTRIES; i++) {
+      blob = &_desc.blob[i];
+      if (blob->cap && blob->ref == 0 && blob->offset + blob->cap == _desc.arena_used) {
+        _desc.arena_used = blob->offset;
+        blob->cap = 0;
+        found = true;
+      }
+    }
+  }
+}
+
+static bool pool_add(uint8_t pool, uint8_t index, uint16_t langid, uint8_t const* desc, uint16_t len, bool is_static) {
+  TU_ASSERT(pool_valid(pool) && len >= 2);
+  uint8_t const type = desc[1];
+
+  int32_t const blob = blob_get(desc, len, is_static);
+  TU_ASSERT(blob >= 0);
+  _desc.blob[blob].ref++;
+
+  uint16_t idx = slot_find(pool, type, index, langid);
+  if (idx < SLOT_COUNT) {
+    // replace existing descriptor, release old one after new one is referenced since they may be identical
+    uint16_t const old = (uint16_t) (_desc.slot[idx].blob - 1);
+    _desc.slot[idx].blob = (uint16_t) (blob + 1);
+    blob_release(old);
+    return true;
+  }
+
+  if (_desc.entry_count >= CFG_TUD_DESC_POOL_ENTRIES) {
+    blob_release((uint16_t) blob);
+    TU_BREAKPOINT();
+    return false;
+  }
+
+  idx = slot_free(pool, type, index, langid);
+  desc_slot_t* slot = &_desc.slot[idx];
+  slot->pool   = pool;
+  slot->type   = type;
+  slot->index  = index;
+  slot->langid = langid;
+  slot->blob   = (uint16_t) (blob + 1);
+  _desc.entry_count++;
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Public API
+//--------------------------------------------------------------------+
+
+uint8_t tud_desc_pool_new(void) {
+  for (uint8_t pool = 0; pool < CFG_TUD_DESC_POOL_COUNT; pool++) {
+    if (!tu_bit_test(_desc.pool_used, pool)) {
+      _desc.pool_used = tu_bit_set(_desc.pool_used, pool);
+      return pool;
+    }
+  }
+  return TUD_DESC_POOL_INVALID;
+}
+
+void tud_desc_pool_delete(uint8_t pool) {
+  if (!pool_valid(pool)) return;
+
+  for (uint16_t i = 0; i < SLOT_COUNT; i++) {
+    desc_slot_t* slot = &_desc.slot[i];
+    if (slot->blob != SLOT_EMPTY && slot->blob != SLOT_DELETED && slot->pool == pool) {
+      blob_release((uint16_t) (slot->blob - 1));
+      slot->blob = SLOT_DELETED;
+      _desc.entry_count--;
+    }
+  }
+
+  // no descriptor left: drop tombstones so that probing stays short
+  if (_desc.entry_count == 0) {
+    tu_memclr(_desc.slot, sizeof(_desc.slot));
+  }
+
+  _desc.pool_used = tu_bit_clear(_desc.pool_used, pool);
+}
+
+bool tud_desc_pool_add(uint8_t pool, uint8_t index, uint16_t langid, void const* desc) {
+  TU_ASSERT(desc);
+  return pool_add(pool, index, langid, (uint8_t const*) desc, desc_total_len((uint8_t const*) desc), false);
+}
+
+bool tud_desc_pool_add_static(uint8_t pool, uint8_t index, uint16_t langid, void const* desc) {
+  TU_ASSERT(desc);
+  return pool_add(pool, index, langid, (uint8_t const*) desc, desc_total_len((uint8_t const*) desc), true);
+}
+
+bool tud_desc_pool_add_string(uint8_t pool, uint8_t index, uint16_t langid, char const* str) {
+  TU_ASSERT(str);
+  size_t const count = strlen(str);
+  TU_ASSERT(count <= STRING_CHAR_MAX);
+
+  // convert ASCII to UTF-16
+  uint8_t desc[2 + 2*STRING_CHAR_MAX];
+  desc[0] = (uint8_t) (2 + 2*count);
+  desc[1] = TUSB_DESC_STRING;
+  for (size_t i = 0; i < count; i++) {
+    desc[2 + 2*i] = (uint8_t) str[i];
+    desc[3 + 2*i] = 0;
+  }
+
+  return pool_add(pool, index, langid, desc, desc[0], false);
+}
+
+uint8_t tud_desc_pool_new_template(tud_desc_template_t const* tmpl) {
+  TU_VERIFY(tmpl && tmpl->device, TUD_DESC_POOL_INVALID);
+
+  uint8_t const pool = tud_desc_pool_new();
+  TU_VERIFY(pool != TUD_DESC_POOL_INVALID, TUD_DESC_POOL_INVALID);
+
+  bool ok = tud_desc_pool_add_static(pool, 0, 0, tmpl->device);
+  if (tmpl->qualifier) ok = ok && tud_desc_pool_add_static(pool, 0, 0, tmpl->qualifier);
+
+  for (uint8_t i = 0; i < tmpl->configuration_count; i++) {
+    ok = ok && tud_desc_pool_add_static(pool, i, 0, tmpl->configuration[i]);
+  }
+
+  for (uint8_t i = 0; i < tmpl->string_count; i++) {
+    if (tmpl->string[i]) ok = ok && tud_desc_pool_add_static(pool, i, 0, tmpl->string[i]);
+  }
+
+  if (!ok) {
+    tud_desc_pool_delete(pool);
+    return TUD_DESC_POOL_INVALID;
+  }
+
+  return pool;
+}
+
+uint8_t const* tud_desc_pool_get(uint8_t pool, uint8_t type, uint8_t index, uint16_t langid, uint16_t* len) {
+  TU_VERIFY(pool_valid(pool), NULL);
+
+  uint16_t idx = slot_find(pool, type, index, langid);
+
+  // language independent string
+  if (idx == SLOT_COUNT && type == TUSB_DESC_STRING && langid != 0) {
+    idx = slot_find(pool, type, index, 0);
+  }
+  TU_VERIFY(idx < SLOT_COUNT, NULL);
+
+  desc_blob_t const* blob = &_desc.blob[_desc.slot[idx].blob - 1];
+  if (len) *len = blob->len;
+
+  return blob_data(blob);
+}
+
+void tud_desc_pool_stats_get(tud_desc_pool_stats_t* stats) {
+  stats->arena_used = _desc.arena_used;
+  stats->arena_size = CFG_TUD_DESC_POOL_ARENA_SIZE;
+  stats->entries    = _desc.entry_count;
+  stats->blobs      = _desc.blob_count;
+}
+
+#endif
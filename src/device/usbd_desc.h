@@ -0,0 +1,94 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_USBD_DESC_H_
+#define TUSB_USBD_DESC_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Descriptor pool: each emulated device (hub and downstream ports) owns a pool of descriptors keyed by
+// (type, index, langid). All pools share one arena, identical descriptors are stored only once regardless
+// of which pool they belong to. Lookup is a single hash table probe.
+//
+// Descriptor type is taken from bDescriptorType and its length from wTotalLength (configuration, other speed
+// configuration, BOS) or bLength, therefore configuration descriptors up to 64KB are supported.
+// String descriptors added with langid 0 are returned for any language.
+//
+// Descriptors built at compile time (e.g with TUD_CONFIG_DESCRIPTOR() and TUD_STRING_DESCRIPTOR_DEF()) can be
+// added with tud_desc_pool_add_static() or as a tud_desc_template_t: they are referenced in place (flash) and
+// take no arena space.
+
+enum { TUD_DESC_POOL_INVALID = 0xFFu };
+
+// Create an empty pool, return TUD_DESC_POOL_INVALID if all pools are in use
+uint8_t tud_desc_pool_new(void);
+
+// Remove all descriptors of a pool and release it, arena space is reclaimed once unreferenced
+void tud_desc_pool_delete(uint8_t pool);
+
+// Add (or replace) a descriptor, desc is copied into the arena
+bool tud_desc_pool_add(uint8_t pool, uint8_t index, uint16_t langid, void const* desc);
+
+// Add (or replace) a descriptor without copying it, desc must stay valid as long as it is in the pool
+bool tud_desc_pool_add_static(uint8_t pool, uint8_t index, uint16_t langid, void const* desc);
+
+// Add (or replace) a string descriptor converted from an ASCII string
+bool tud_desc_pool_add_string(uint8_t pool, uint8_t index, uint16_t langid, char const* str);
+
+// Get a descriptor and its length, return NULL if not found
+uint8_t const* tud_desc_pool_get(uint8_t pool, uint8_t type, uint8_t index, uint16_t langid, uint16_t* len);
+
+// Descriptor set of a device, all descriptors must be static
+typedef struct {
+  void const* device;
+  void const* qualifier;            // optional
+  void const* const* configuration; // index 0 is configuration value 1
+  void const* const* string;        // index 0 is supported language list, NULL entries are skipped
+  uint8_t configuration_count;
+  uint8_t string_count;
+} tud_desc_template_t;
+
+// Create a pool referencing all descriptors of a template, return TUD_DESC_POOL_INVALID on failure
+uint8_t tud_desc_pool_new_template(tud_desc_template_t const* tmpl);
+
+typedef struct {
+  uint16_t arena_used;  // bytes of arena in use
+  uint16_t arena_size;
+  uint16_t entries;     // descriptors in all pools
+  uint16_t blobs;       // distinct descriptors, in arena or static
+} tud_desc_pool_stats_t;
+
+void tud_desc_pool_stats_get(tud_desc_pool_stats_t* stats);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
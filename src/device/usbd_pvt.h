@@ -43,6 +43,10 @@
 typedef enum {
   SOF_CONSUMER_USER = 0,
   SOF_CONSUMER_AUDIO,
+  SOF_CONSUMER_MSC,
+  SOF_CONSUMER_UAS,
+  SOF_CONSUMER_NCM,
+  SOF_CONSUMER_MSC_CACHE,
 } sof_consumer_t;
 
 //--------------------------------------------------------------------+
@@ -58,10 +62,19 @@ typedef struct {
   bool     (* control_xfer_cb  ) (uint8_t rhport, uint8_t port_num, uint8_t stage, tusb_control_request_t const * request);
   bool     (* xfer_cb          ) (uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
   void     (* sof              ) (uint8_t rhport, uint8_t port_num, uint32_t frame_count); // optional
+
+  // optional: invoked in ISR context instead of xfer_cb for endpoints enabled with usbd_edpt_isr_set() (CFG_TUD_XFER_ISR).
+  // Return false without submitting a new transfer to have the completion queued for xfer_cb as usual
+  bool     (* xfer_isr_cb      ) (uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+
+  // optional: invoked in task context for successful completions already handled by xfer_isr_cb (CFG_TUD_XFER_COALESCE).
+  // Completions of an endpoint that happen before tud_task() gets to it are merged: xferred_bytes is their total
+  // and count their number. Endpoint is not released here, it may already be running its next transfers
+  void     (* xfer_coalesced_cb) (uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes, uint16_t count);
 } usbd_class_driver_t;
 
 // Invoked when initializing device stack to get additional class drivers.
-// Can be implemented by application to extend/overwrite class driver support.
+// Can be implemented by application to extend class driver support, built-in drivers are tried first when opening.
 // Note: The drivers array must be accessible at all time when stack is active
 usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count) TU_ATTR_WEAK;
 
@@ -69,6 +82,13 @@ typedef bool (*usbd_control_xfer_cb_t)(uint8_t rhport, uint8_t port_num, uint8_t
 
 void usbd_int_set(bool enabled);
 
+// Get a descriptor from the pool bound to a port
+uint8_t const* usbd_desc_get(uint8_t port_num, uint8_t type, uint8_t index, uint16_t* len);
+
+// Called by hub driver when host resets a downstream port: the device behind it is unconfigured and requests sent
+// to the default address are routed to it until SET_ADDRESS
+void usbd_hub_port_reset(uint8_t rhport, uint8_t port_num);
+
 //--------------------------------------------------------------------+
 // USBD Endpoint API
 // Note: rhport should be 0 since device stack only support 1 rhport for now
@@ -85,6 +105,13 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
 
 bool usbd_ctrl_edpt_xfer(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes);
 
+// Submit a usb transfer reading from (IN) or writing to (OUT) a fifo directly, without intermediate buffer.
+// Only available if usbd_edpt_xfer_fifo_supported() i.e controller driver implements dcd_edpt_xfer_fifo()
+bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes);
+
+// Check if controller driver supports usbd_edpt_xfer_fifo()
+bool usbd_edpt_xfer_fifo_supported(void);
+
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr);
@@ -110,6 +137,14 @@ bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packe
 // Configure and enable an ISO endpoint according to descriptor
 bool usbd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpoint_desc);
 
+// Handle transfer complete of endpoint in ISR by driver's xfer_isr_cb (CFG_TUD_XFER_ISR) instead of queuing it for tud_task().
+// Should be disabled again before endpoint is closed
+bool usbd_edpt_isr_set(uint8_t rhport, uint8_t ep_addr, bool enabled);
+
+// Timestamp by CFG_TUSB_TRACE_TIMESTAMP() of the transfer complete, taken when dcd reported it. Only valid within
+// xfer_isr_cb and with CFG_TUSB_TRACE, otherwise 0
+uint32_t usbd_xfer_isr_timestamp(void);
+
 // Check if endpoint is ready (not busy and not stalled)
 TU_ATTR_ALWAYS_INLINE static inline
 bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr) {
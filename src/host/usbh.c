@@ -316,7 +316,21 @@ static void process_removing_device(uint8_t rhport, uint8_t hub_addr, uint8_t hu
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size);
 static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 
+#if CFG_TUSB_TRACE
+// Trace an event, with endpoint and length for transfer complete
+static void trace_event(uint8_t id, hcd_event_t const * event) {
+  if (event->event_id == HCD_EVENT_XFER_COMPLETE) {
+    TU_TRACE(id, event->event_id, event->dev_addr, event->xfer_complete.ep_addr, event->xfer_complete.len);
+  } else {
+    TU_TRACE(id, event->event_id, event->dev_addr, 0, 0);
+  }
+}
+#else
+  #define trace_event(_id, _event)
+#endif
+
 TU_ATTR_ALWAYS_INLINE static inline bool queue_event(hcd_event_t const * event, bool in_isr) {
+  trace_event(TU_TRACE_USBH_EVENT, event);
   TU_ASSERT(osal_queue_send(_usbh_q, event, in_isr));
   tuh_event_hook_cb(event->rhport, event->event_id, in_isr);
   return true;
@@ -522,6 +536,8 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
     hcd_event_t event;
     if (!osal_queue_receive(_usbh_q, &event, timeout_ms)) { return; }
 
+    trace_event(TU_TRACE_USBH_DISPATCH_START, &event);
+
     switch (event.event_id) {
       case HCD_EVENT_DEVICE_ATTACH:
         // due to the shared control buffer, we must complete enumerating one device before enumerating another one.
@@ -631,6 +647,8 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
         break;
     }
 
+    trace_event(TU_TRACE_USBH_DISPATCH_END, &event);
+
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
     if (osal_queue_empty(_usbh_q)) return;
@@ -681,6 +699,7 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
   TU_LOG_BUF(xfer->setup, 8);
 
   if (xfer->complete_cb) {
+    TU_TRACE(TU_TRACE_USBH_XFER, 0, daddr, 0, 8);
     TU_ASSERT(hcd_setup_send(rhport, daddr, (uint8_t const *) &_usbh_epbuf.request));
   }else {
     // blocking if complete callback is not provided
@@ -691,6 +710,7 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
     _ctrl_xfer.user_data   = (uintptr_t) &result;
     _ctrl_xfer.complete_cb = _control_blocking_complete_cb;
 
+    TU_TRACE(TU_TRACE_USBH_XFER, 0, daddr, 0, 8);
     TU_ASSERT(hcd_setup_send(rhport, daddr, (uint8_t *) &_usbh_epbuf.request));
 
     while (result == XFER_RESULT_INVALID) {
@@ -764,6 +784,7 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
         _ctrl_xfer.actual_len = 0; // reset actual_len
         (void) osal_mutex_unlock(_usbh_mutex);
 
+        TU_TRACE(TU_TRACE_USBH_XFER, 0, daddr, 0, 8);
         TU_ASSERT(hcd_setup_send(rhport, daddr, (uint8_t const *) request));
       } else {
         TU_LOG_USBH("[%u:%u] Control FAILED, xferred_bytes = %" PRIu32 "\r\n", rhport, daddr, xferred_bytes);
@@ -778,6 +799,7 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
           if (request->wLength) {
             // DATA stage: initial data toggle is always 1
             _set_control_xfer_stage(CONTROL_STAGE_DATA);
+            TU_TRACE(TU_TRACE_USBH_XFER, 0, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction), request->wLength);
             TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction), _ctrl_xfer.buffer, request->wLength) );
             return true;
           }
@@ -793,6 +815,7 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
 
         // ACK stage: toggle is always 1
         _set_control_xfer_stage(CONTROL_STAGE_ACK);
+        TU_TRACE(TU_TRACE_USBH_XFER, 0, daddr, tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction), 0);
         TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction), NULL, 0) );
         break;
 
@@ -962,6 +985,7 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   dev->ep_callback[epnum][dir].user_data   = user_data;
 #endif
 
+  TU_TRACE(TU_TRACE_USBH_XFER, 0, dev_addr, ep_addr, total_bytes);
   if (hcd_edpt_xfer(dev->rhport, dev_addr, ep_addr, buffer, total_bytes)) {
     TU_LOG_USBH("OK\r\n");
     return true;
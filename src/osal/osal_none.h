@@ -147,14 +147,11 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_delete(osal_queue_t qhdl) {
   return true; // nothing to do
 }
 
+// Queue is only received in task context: ISR and task senders are serialized by interrupt_set() in task,
+// therefore queue is single-producer single-consumer and receive does not need to toggle interrupt
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec) {
   (void) msec; // not used, always behave as msec = 0
-
-  qhdl->interrupt_set(false);
-  const bool success = tu_fifo_read(&qhdl->ff, data);
-  qhdl->interrupt_set(true);
-
-  return success;
+  return tu_fifo_spsc_read(&qhdl->ff, data);
 }
 
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const* data, bool in_isr) {
@@ -162,7 +159,7 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void
     qhdl->interrupt_set(false);
   }
 
-  const bool success = tu_fifo_write(&qhdl->ff, data);
+  const bool success = tu_fifo_spsc_write(&qhdl->ff, data);
 
   if (!in_isr) {
     qhdl->interrupt_set(true);
@@ -0,0 +1,473 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUD_ENABLED && defined(TUP_USBIP_VIRTUAL)
+
+#include "device/dcd.h"
+#include "dcd_virtual.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t* buffer;
+  tu_fifo_t* ff;         // used instead of buffer for dcd_edpt_xfer_fifo()
+  uint16_t total_len;
+  uint16_t actual_len;
+  uint16_t mps;
+  uint16_t iso_alloc;    // packet size allocated by dcd_edpt_iso_alloc()
+  uint8_t  dev_addr;     // address the transfer is armed on
+  uint8_t  seq;          // next expected OUT sequence
+  uint8_t  opened  : 1;
+  uint8_t  busy    : 1;
+  uint8_t  stalled : 1;
+} virtual_edpt_t;
+
+typedef struct {
+  virtual_edpt_t edpt[TUP_DCD_ENDPOINT_MAX][2];
+
+  tusb_speed_t speed;
+  uint8_t cur_addr;      // address set by dcd_set_address()/dcd_switch_address()
+  volatile bool int_enabled;
+  volatile bool connected;
+  volatile bool wakeup_pending; // set by dcd_remote_wakeup(), signalled from dcd_int_handler()
+  bool sof_en;
+
+  tu_fifo_t h2d;         // host -> device ring
+  tu_fifo_t d2h;         // device -> host ring
+
+  // scratch packets, too large for stack
+  dcd_virtual_packet_t rx_pkt;
+  dcd_virtual_packet_t tx_pkt;
+
+  dcd_virtual_stats_t stats;
+} dcd_virtual_t;
+
+static dcd_virtual_t _dcd;
+
+CFG_TUD_MEM_ALIGN static uint8_t _h2d_buf[CFG_TUD_VIRTUAL_RING_DEPTH * sizeof(dcd_virtual_packet_t)];
+CFG_TUD_MEM_ALIGN static uint8_t _d2h_buf[CFG_TUD_VIRTUAL_RING_DEPTH * sizeof(dcd_virtual_packet_t)];
+
+TU_ATTR_ALWAYS_INLINE static inline virtual_edpt_t* edpt_get(uint8_t ep_addr) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if (epnum >= TUP_DCD_ENDPOINT_MAX) return NULL;
+  return &_dcd.edpt[epnum][tu_edpt_dir(ep_addr)];
+}
+
+// close all endpoints except control which is always opened
+static void edpt_reset_all(void) {
+  tu_memclr(_dcd.edpt, sizeof(_dcd.edpt));
+
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    _dcd.edpt[0][dir].mps = CFG_TUD_ENDPOINT0_SIZE;
+    _dcd.edpt[0][dir].opened = 1;
+  }
+}
+
+static bool edpt_open(tusb_desc_endpoint_t const* desc_ep) {
+  virtual_edpt_t* ep = edpt_get(desc_ep->bEndpointAddress);
+  TU_ASSERT(ep != NULL);
+
+  uint16_t const mps = tu_edpt_packet_size(desc_ep);
+  TU_ASSERT(mps <= CFG_TUD_VIRTUAL_PACKET_SIZE);
+
+  ep->mps     = mps;
+  ep->seq     = 0;
+  ep->opened  = 1;
+  ep->busy    = 0;
+  ep->stalled = 0;
+
+  return true;
+}
+
+static bool edpt_xfer(uint8_t ep_addr, uint8_t* buffer, tu_fifo_t* ff, uint16_t total_bytes) {
+  virtual_edpt_t* ep = edpt_get(ep_addr);
+  TU_ASSERT(ep != NULL && ep->opened);
+
+  ep->buffer     = buffer;
+  ep->ff         = ff;
+  ep->total_len  = total_bytes;
+  ep->actual_len = 0;
+  ep->dev_addr   = _dcd.cur_addr;
+  ep->busy       = 1;
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Packet processing
+//--------------------------------------------------------------------+
+
+static void reply(uint8_t pid, dcd_virtual_packet_t const* token, virtual_edpt_t const* ep, uint16_t len) {
+  dcd_virtual_packet_t* tx = &_dcd.tx_pkt;
+  tx->pid      = pid;
+  tx->dev_addr = token->dev_addr;
+  tx->ep_addr  = token->ep_addr;
+  tx->seq      = ep ? ep->seq : 0;
+  tx->len      = len;
+
+  if (pid == DCD_VIRTUAL_PID_NAK) _dcd.stats.nak++;
+  if (pid == DCD_VIRTUAL_PID_STALL) _dcd.stats.stall++;
+
+  // space is reserved before a token is taken from host ring
+  (void) tu_fifo_spsc_write(&_dcd.d2h, tx);
+}
+
+static void xfer_complete(uint8_t rhport, uint8_t ep_addr, virtual_edpt_t* ep) {
+  ep->busy = 0;
+  dcd_event_xfer_complete(rhport, ep_addr, ep->actual_len, XFER_RESULT_SUCCESS, true);
+}
+
+static void handle_setup(uint8_t rhport, dcd_virtual_packet_t const* pkt) {
+  _dcd.stats.setup++;
+
+  // setup clears pending transfer and stall of control endpoint
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    _dcd.edpt[0][dir].busy = 0;
+    _dcd.edpt[0][dir].stalled = 0;
+    _dcd.edpt[0][dir].seq = 0;
+  }
+
+  // device answers the address it is set up with
+  _dcd.cur_addr = pkt->dev_addr;
+
+  reply(DCD_VIRTUAL_PID_ACK, pkt, NULL, 0);
+  dcd_event_setup_received_addr(rhport, pkt->dev_addr, pkt->data, true);
+}
+
+static void handle_out(uint8_t rhport, dcd_virtual_packet_t const* pkt) {
+  _dcd.stats.out++;
+
+  virtual_edpt_t* ep = edpt_get(pkt->ep_addr);
+  if (ep == NULL || !ep->opened) {
+    reply(DCD_VIRTUAL_PID_NAK, pkt, NULL, 0);
+    return;
+  }
+
+  if (ep->stalled) {
+    reply(DCD_VIRTUAL_PID_STALL, pkt, ep, 0);
+    return;
+  }
+
+  // not armed, or out of sequence since an earlier packet was NAKed
+  if (!ep->busy || ep->dev_addr != pkt->dev_addr || ep->seq != pkt->seq) {
+    reply(DCD_VIRTUAL_PID_NAK, pkt, ep, 0);
+    return;
+  }
+
+  uint16_t const len = tu_min16(pkt->len, ep->total_len - ep->actual_len);
+  if (ep->ff) {
+    tu_fifo_write_n(ep->ff, pkt->data, len);
+  } else if (len) {
+    memcpy(ep->buffer + ep->actual_len, pkt->data, len);
+  }
+  ep->actual_len += len;
+  ep->seq++;
+  _dcd.stats.bytes_out += len;
+
+  reply(DCD_VIRTUAL_PID_ACK, pkt, ep, 0);
+
+  // short packet or all requested bytes received
+  if (pkt->len < ep->mps || ep->actual_len == ep->total_len) {
+    xfer_complete(rhport, pkt->ep_addr, ep);
+  }
+}
+
+static void handle_in(uint8_t rhport, dcd_virtual_packet_t const* pkt) {
+  _dcd.stats.in++;
+
+  virtual_edpt_t* ep = edpt_get(pkt->ep_addr);
+  if (ep == NULL || !ep->opened) {
+    reply(DCD_VIRTUAL_PID_NAK, pkt, NULL, 0);
+    return;
+  }
+
+  if (ep->stalled) {
+    reply(DCD_VIRTUAL_PID_STALL, pkt, ep, 0);
+    return;
+  }
+
+  if (!ep->busy || ep->dev_addr != pkt->dev_addr) {
+    reply(DCD_VIRTUAL_PID_NAK, pkt, ep, 0);
+    return;
+  }
+
+  uint16_t const len = tu_min16(ep->mps, ep->total_len - ep->actual_len);
+  if (ep->ff) {
+    tu_fifo_read_n(ep->ff, _dcd.tx_pkt.data, len);
+  } else if (len) {
+    memcpy(_dcd.tx_pkt.data, ep->buffer + ep->actual_len, len);
+  }
+  ep->actual_len += len;
+  _dcd.stats.bytes_in += len;
+
+  reply(DCD_VIRTUAL_PID_DATA, pkt, ep, len);
+
+  // short packet (including zero length) or all bytes sent, ZLP is scheduled by the stack if needed
+  if (len < ep->mps || ep->actual_len == ep->total_len) {
+    xfer_complete(rhport, pkt->ep_addr, ep);
+  }
+}
+
+static void handle_packet(uint8_t rhport, dcd_virtual_packet_t const* pkt) {
+  switch (pkt->pid) {
+    case DCD_VIRTUAL_PID_RESET:
+      edpt_reset_all();
+      _dcd.cur_addr = 0;
+      _dcd.speed = (tusb_speed_t) pkt->data[0];
+      dcd_event_bus_reset(rhport, _dcd.speed, true);
+      break;
+
+    case DCD_VIRTUAL_PID_SOF:
+      if (_dcd.sof_en) dcd_event_sof(rhport, pkt->len, true);
+      break;
+
+    case DCD_VIRTUAL_PID_SUSPEND:
+      dcd_event_bus_signal(rhport, DCD_EVENT_SUSPEND, true);
+      break;
+
+    case DCD_VIRTUAL_PID_RESUME:
+      dcd_event_bus_signal(rhport, DCD_EVENT_RESUME, true);
+      break;
+
+    case DCD_VIRTUAL_PID_UNPLUG:
+      dcd_event_bus_signal(rhport, DCD_EVENT_UNPLUGGED, true);
+      break;
+
+    case DCD_VIRTUAL_PID_SETUP: handle_setup(rhport, pkt); break;
+    case DCD_VIRTUAL_PID_OUT  : handle_out(rhport, pkt)  ; break;
+    case DCD_VIRTUAL_PID_IN   : handle_in(rhport, pkt)   ; break;
+
+    default: break;
+  }
+}
+
+void dcd_int_handler(uint8_t rhport) {
+  if (!_dcd.int_enabled) return;
+
+  // device -> host ring has a single producer: wakeup requested by the stack is sent from here as well
+  if (_dcd.wakeup_pending && tu_fifo_spsc_reserve(&_dcd.d2h, 1)) {
+    _dcd.wakeup_pending = false;
+
+    dcd_virtual_packet_t* tx = &_dcd.tx_pkt;
+    tx->pid      = DCD_VIRTUAL_PID_WAKEUP;
+    tx->dev_addr = _dcd.cur_addr;
+    tx->ep_addr  = 0;
+    tx->seq      = 0;
+    tx->len      = 0;
+    (void) tu_fifo_spsc_write(&_dcd.d2h, tx);
+  }
+
+  // only take a token when there is room for its reply
+  while (tu_fifo_spsc_reserve(&_dcd.d2h, 1)) {
+    if (!tu_fifo_spsc_read(&_dcd.h2d, &_dcd.rx_pkt)) break;
+
+    // tokens are discarded while pull-up is disabled
+    if (_dcd.connected || _dcd.rx_pkt.pid < DCD_VIRTUAL_PID_SETUP) {
+      handle_packet(rhport, &_dcd.rx_pkt);
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Host API
+//--------------------------------------------------------------------+
+
+bool dcd_virtual_host_send(uint8_t rhport, dcd_virtual_packet_t const* pkt) {
+  (void) rhport;
+  TU_VERIFY(pkt->len <= CFG_TUD_VIRTUAL_PACKET_SIZE);
+  return tu_fifo_spsc_write(&_dcd.h2d, pkt);
+}
+
+bool dcd_virtual_host_receive(uint8_t rhport, dcd_virtual_packet_t* pkt) {
+  (void) rhport;
+  return tu_fifo_spsc_read(&_dcd.d2h, pkt);
+}
+
+bool dcd_virtual_connected(uint8_t rhport) {
+  (void) rhport;
+  return _dcd.connected;
+}
+
+void dcd_virtual_stats_get(uint8_t rhport, dcd_virtual_stats_t* stats) {
+  (void) rhport;
+  *stats = _dcd.stats;
+}
+
+void dcd_virtual_stats_clear(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(&_dcd.stats, sizeof(_dcd.stats));
+}
+
+/*------------------------------------------------------------------*/
+/* Device API
+ *------------------------------------------------------------------*/
+
+bool dcd_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
+  (void) rhport;
+
+  tu_memclr(&_dcd, sizeof(_dcd));
+  tu_fifo_config(&_dcd.h2d, _h2d_buf, CFG_TUD_VIRTUAL_RING_DEPTH, sizeof(dcd_virtual_packet_t), false);
+  tu_fifo_config(&_dcd.d2h, _d2h_buf, CFG_TUD_VIRTUAL_RING_DEPTH, sizeof(dcd_virtual_packet_t), false);
+
+  _dcd.speed = rh_init->speed;
+  edpt_reset_all();
+
+  dcd_connect(rhport);
+  return true;
+}
+
+bool dcd_deinit(uint8_t rhport) {
+  dcd_disconnect(rhport);
+  _dcd.int_enabled = false;
+  edpt_reset_all();
+  return true;
+}
+
+void dcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+  _dcd.int_enabled = true;
+}
+
+void dcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+  _dcd.int_enabled = false;
+}
+
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr) {
+  // Response with status on old address, new address takes effect afterward
+  dcd_edpt_xfer(rhport, tu_edpt_addr(0, TUSB_DIR_IN), NULL, 0);
+  _dcd.cur_addr = dev_addr;
+}
+
+void dcd_switch_address(uint8_t rhport, uint8_t dev_addr) {
+  (void) rhport;
+  _dcd.cur_addr = dev_addr;
+}
+
+// Called from task context: only flag the request, dcd_int_handler() is the sole writer of device -> host ring
+void dcd_remote_wakeup(uint8_t rhport) {
+  (void) rhport;
+  _dcd.wakeup_pending = true;
+}
+
+void dcd_connect(uint8_t rhport) {
+  (void) rhport;
+  _dcd.connected = true;
+}
+
+void dcd_disconnect(uint8_t rhport) {
+  (void) rhport;
+  _dcd.connected = false;
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en) {
+  (void) rhport;
+  _dcd.sof_en = en;
+}
+
+#if CFG_TUD_TEST_MODE
+void dcd_enter_test_mode(uint8_t rhport, tusb_feature_test_mode_t test_selector) {
+  (void) rhport;
+  (void) test_selector;
+  // no electrical signalling to test
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Endpoint API
+//--------------------------------------------------------------------+
+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+  return edpt_open(desc_ep);
+}
+
+bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
+  (void) rhport;
+
+  virtual_edpt_t* ep = edpt_get(ep_addr);
+  TU_ASSERT(ep != NULL && largest_packet_size <= CFG_TUD_VIRTUAL_PACKET_SIZE);
+
+  ep->iso_alloc = largest_packet_size;
+  return true;
+}
+
+bool dcd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+
+  virtual_edpt_t* ep = edpt_get(desc_ep->bEndpointAddress);
+  TU_ASSERT(ep != NULL && tu_edpt_packet_size(desc_ep) <= ep->iso_alloc);
+
+  return edpt_open(desc_ep);
+}
+
+void dcd_edpt_close_all(uint8_t rhport) {
+  (void) rhport;
+
+  for (uint8_t epnum = 1; epnum < TUP_DCD_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      _dcd.edpt[epnum][dir].opened = 0;
+      _dcd.edpt[epnum][dir].busy   = 0;
+    }
+  }
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+  (void) rhport;
+  return edpt_xfer(ep_addr, buffer, NULL, total_bytes);
+}
+
+bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+  (void) rhport;
+  return edpt_xfer(ep_addr, NULL, ff, total_bytes);
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+
+  virtual_edpt_t* ep = edpt_get(ep_addr);
+  if (ep == NULL) return;
+
+  // stall removes queued transfer
+  ep->stalled = 1;
+  ep->busy    = 0;
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+
+  virtual_edpt_t* ep = edpt_get(ep_addr);
+  if (ep == NULL) return;
+
+  ep->stalled = 0;
+  ep->seq     = 0;
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_DCD_VIRTUAL_H_
+#define TUSB_DCD_VIRTUAL_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Software only device controller (CFG_TUSB_MCU = OPT_MCU_VIRTUAL). The device stack exchanges packets with an
+// in-process host through two single-producer single-consumer rings:
+// - host -> device: bus signals and SETUP/OUT/IN tokens, written by dcd_virtual_host_send()
+// - device -> host: handshakes and IN data, read by dcd_virtual_host_receive()
+// Rings are processed by dcd_int_handler() i.e tud_int_handler(), which must be called in the same context as
+// tud_task() (or with it masked out by dcd_int_disable()) just like a real interrupt. Host may run in another thread.
+//
+// While connected, device replies to every SETUP/OUT/IN token with exactly one packet: ACK (SETUP/OUT accepted),
+// DATA (IN), NAK (endpoint not ready or not addressed) or STALL. Bus signals have no reply.
+//
+// OUT tokens carry a per-endpoint sequence number (similar to data toggle), an OUT packet is only accepted if it
+// matches the sequence expected by the endpoint. This allows host to queue several OUT packets: once one is NAKed,
+// all following ones are NAKed as well and can be resent in order. Replies to OUT tokens carry the sequence expected
+// next. Sequence is reset to 0 when endpoint is opened or stall is cleared, and for control endpoint on SETUP.
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+// Largest packet payload, 1024 covers high speed isochronous
+#ifndef CFG_TUD_VIRTUAL_PACKET_SIZE
+  #define CFG_TUD_VIRTUAL_PACKET_SIZE   1024
+#endif
+
+// Number of packets in each ring
+#ifndef CFG_TUD_VIRTUAL_RING_DEPTH
+  #define CFG_TUD_VIRTUAL_RING_DEPTH    16
+#endif
+
+// USB/IP server on top of virtual controller, requires POSIX sockets
+#ifndef CFG_TUD_VIRTUAL_USBIP
+  #define CFG_TUD_VIRTUAL_USBIP         0
+#endif
+
+//--------------------------------------------------------------------+
+// Packet
+//--------------------------------------------------------------------+
+
+typedef enum {
+  // host -> device
+  DCD_VIRTUAL_PID_RESET = 0, // bus reset, data[0] is tusb_speed_t
+  DCD_VIRTUAL_PID_SOF,       // start of frame, frame number in len
+  DCD_VIRTUAL_PID_SUSPEND,
+  DCD_VIRTUAL_PID_RESUME,
+  DCD_VIRTUAL_PID_UNPLUG,
+  DCD_VIRTUAL_PID_SETUP,     // 8 bytes setup packet in data
+  DCD_VIRTUAL_PID_OUT,
+  DCD_VIRTUAL_PID_IN,
+
+  // device -> host
+  DCD_VIRTUAL_PID_ACK,
+  DCD_VIRTUAL_PID_NAK,
+  DCD_VIRTUAL_PID_STALL,
+  DCD_VIRTUAL_PID_DATA,      // reply to IN token
+  DCD_VIRTUAL_PID_WAKEUP,    // remote wakeup signalled by device
+} dcd_virtual_pid_t;
+
+typedef struct {
+  uint8_t  pid;
+  uint8_t  dev_addr;
+  uint8_t  ep_addr;
+  uint8_t  seq;              // OUT sequence number, see above
+  uint16_t len;
+  uint8_t  data[CFG_TUD_VIRTUAL_PACKET_SIZE];
+} dcd_virtual_packet_t;
+
+typedef struct {
+  uint32_t setup;
+  uint32_t out;
+  uint32_t in;
+  uint32_t nak;
+  uint32_t stall;
+  uint32_t bytes_out;
+  uint32_t bytes_in;
+} dcd_virtual_stats_t;
+
+//--------------------------------------------------------------------+
+// Host API
+//--------------------------------------------------------------------+
+
+// Queue a packet to device, return false if ring is full
+bool dcd_virtual_host_send(uint8_t rhport, dcd_virtual_packet_t const* pkt);
+
+// Get a reply from device, return false if there is none
+bool dcd_virtual_host_receive(uint8_t rhport, dcd_virtual_packet_t* pkt);
+
+// Check if device pull-up is enabled
+bool dcd_virtual_connected(uint8_t rhport);
+
+// Token and byte counters since dcd_init() or last clear
+void dcd_virtual_stats_get(uint8_t rhport, dcd_virtual_stats_t* stats);
+void dcd_virtual_stats_clear(uint8_t rhport);
+
+//--------------------------------------------------------------------+
+// USB/IP server API
+//--------------------------------------------------------------------+
+#if CFG_TUD_VIRTUAL_USBIP
+
+// Listen on loopback TCP port (3240 is the standard USB/IP port), hub and each of its downstream
+// ports are exported as busid 1-1 and 1-1.<port>
+bool usbip_server_init(uint8_t rhport, uint16_t tcp_port);
+
+// Close all connections and listening socket
+void usbip_server_deinit(void);
+
+// Handle network and exchange packets with device, should be called in the same loop as
+// tud_int_handler() and tud_task()
+void usbip_server_task(void);
+
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -0,0 +1,1418 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUD_ENABLED && defined(TUP_USBIP_VIRTUAL)
+
+#include "device/dcd.h"
+#include "device/usbd_pvt.h"
+#include "class/hub/hub.h"
+#include "dcd_virtual.h"
+
+#if CFG_TUD_VIRTUAL_USBIP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// USB/IP server acting as the host of the virtual controller. Server enumerates the hub and each downstream port
+// itself (bus reset, port reset, SET_ADDRESS, descriptors) then exports them to USB/IP clients such as Linux vhci-hcd.
+// Client's SET_ADDRESS is answered locally since device is already addressed, all other requests are forwarded.
+// Hub and ports are addressed at the same time, this relies on the controller routing SETUP by target address.
+//
+// Each endpoint has its own URB queue: OUT packets of queued URBs are streamed back to back and several IN tokens are
+// kept in flight, so throughput is not limited to one URB per round trip. Control transfers share endpoint 0 of the
+// controller and are executed one at a time. Isochronous URBs are not supported.
+//
+// Sockets are read without blocking: each connection keeps the partially received message across task rounds so
+// that a slow client never stalls the device stack.
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum { USBIP_VERSION = 0x0111 };
+
+enum {
+  USBIP_OP_REQ_IMPORT  = 0x8003,
+  USBIP_OP_REP_IMPORT  = 0x0003,
+  USBIP_OP_REQ_DEVLIST = 0x8005,
+  USBIP_OP_REP_DEVLIST = 0x0005,
+};
+
+enum {
+  USBIP_CMD_SUBMIT = 1,
+  USBIP_CMD_UNLINK = 2,
+  USBIP_RET_SUBMIT = 3,
+  USBIP_RET_UNLINK = 4,
+};
+
+enum {
+  USBIP_DIR_OUT = 0,
+  USBIP_DIR_IN  = 1,
+};
+
+enum {
+  USBIP_SPEED_FULL = 2,
+  USBIP_SPEED_HIGH = 3,
+};
+
+enum {
+  USBIP_URB_ZERO_PACKET = 0x0040,
+  USBIP_BUSNUM          = 1,
+  USBIP_EXPORT_COUNT    = CFG_TUD_HUB_PORT + 1,    // same as _usbd_dev[]
+  USBIP_CONN_MAX        = USBIP_EXPORT_COUNT + 2,  // extra for devlist queries
+  USBIP_ITF_MAX         = 16,
+  USBIP_URB_LEN_MAX     = 1024*1024,
+  USBIP_NAK_LIMIT       = 100000,                  // control transfer timeout in server task rounds
+};
+
+typedef struct TU_ATTR_PACKED {
+  uint16_t version;
+  uint16_t code;
+  uint32_t status;
+} usbip_op_common_t;
+
+typedef struct TU_ATTR_PACKED {
+  char     path[256];
+  char     busid[32];
+  uint32_t busnum;
+  uint32_t devnum;
+  uint32_t speed;
+  uint16_t idVendor;
+  uint16_t idProduct;
+  uint16_t bcdDevice;
+  uint8_t  bDeviceClass;
+  uint8_t  bDeviceSubClass;
+  uint8_t  bDeviceProtocol;
+  uint8_t  bConfigurationValue;
+  uint8_t  bNumConfigurations;
+  uint8_t  bNumInterfaces;
+} usbip_device_info_t;
+
+TU_VERIFY_STATIC(sizeof(usbip_device_info_t) == 312, "size is not correct");
+
+typedef struct TU_ATTR_PACKED {
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t padding;
+} usbip_interface_info_t;
+
+typedef struct TU_ATTR_PACKED {
+  uint32_t command;
+  uint32_t seqnum;
+  uint32_t devid;
+  uint32_t direction;
+  uint32_t ep;
+
+  union {
+    struct TU_ATTR_PACKED {
+      uint32_t transfer_flags;
+      int32_t  transfer_buffer_length;
+      int32_t  start_frame;
+      int32_t  number_of_packets;
+      int32_t  interval;
+      uint8_t  setup[8];
+    } cmd_submit;
+
+    struct TU_ATTR_PACKED {
+      int32_t  status;
+      int32_t  actual_length;
+      int32_t  start_frame;
+      int32_t  number_of_packets;
+      int32_t  error_count;
+      uint8_t  padding[8];
+    } ret_submit;
+
+    struct TU_ATTR_PACKED {
+      uint32_t seqnum;
+      uint8_t  padding[24];
+    } cmd_unlink;
+
+    struct TU_ATTR_PACKED {
+      int32_t  status;
+      uint8_t  padding[24];
+    } ret_unlink;
+  };
+} usbip_header_t;
+
+TU_VERIFY_STATIC(sizeof(usbip_header_t) == 48, "size is not correct");
+
+typedef struct usbip_urb {
+  struct usbip_urb* next;
+  uint32_t seqnum;
+  uint32_t unlink_seqnum;  // CMD_UNLINK received while transfer is in progress
+  uint32_t flags;
+  uint32_t length;
+  uint32_t actual;         // IN: bytes received, OUT: bytes acknowledged
+  uint8_t  dev_addr;
+  uint8_t  ep_addr;
+  bool     internal;       // issued by server for probing
+  bool     started;        // at least one token sent
+  tusb_control_request_t setup;
+  uint8_t  data[];
+} usbip_urb_t;
+
+typedef struct {
+  usbip_urb_t* head;
+  usbip_urb_t* tail;
+
+  usbip_urb_t* send_urb;   // OUT: urb of next packet to send
+  uint32_t send_off;
+  uint8_t  send_seq;
+  uint8_t  ack_seq;        // OUT: sequence of oldest unacknowledged packet
+  uint8_t  gen;            // OUT: bumped when rewinding, NAKs of older packets are ignored
+  uint8_t  in_flight;      // IN: tokens not yet replied
+  uint16_t mps;
+  bool     halted;
+} usbip_pipe_t;
+
+typedef enum {
+  EXPORT_UNKNOWN = 0,
+  EXPORT_PROBING,
+  EXPORT_READY,
+  EXPORT_ABSENT,
+} usbip_export_state_t;
+
+typedef enum {
+  PROBE_PORT_POWER = 0, // downstream port only
+  PROBE_PORT_RESET,     // downstream port only
+  PROBE_SET_ADDRESS,
+  PROBE_GET_DEVICE8,
+  PROBE_GET_DEVICE,
+  PROBE_GET_CONFIG9,
+  PROBE_GET_CONFIG,
+  PROBE_SET_CONFIG,     // hub only, downstream ports are powered once it is configured
+  PROBE_DONE
+} usbip_probe_step_t;
+
+typedef struct {
+  uint8_t state;
+  uint8_t probe_step;
+  uint8_t dev_addr;     // address assigned by server: port number + 1
+  int     fd;           // connection importing this export, -1 if none
+
+  tusb_desc_device_t dev_desc;
+  uint16_t cfg_total_len;
+  uint8_t  cfg_value;
+  uint8_t  itf_count;
+  usbip_interface_info_t itf[USBIP_ITF_MAX];
+
+  usbip_urb_t* ctrl_head;
+  usbip_urb_t* ctrl_tail;
+  usbip_pipe_t pipe[TUP_DCD_ENDPOINT_MAX][2]; // index 0 is unused, control uses ctrl queue
+} usbip_export_t;
+
+typedef enum {
+  CTRL_IDLE = 0,
+  CTRL_SETUP,
+  CTRL_DATA,
+  CTRL_STATUS,
+} usbip_ctrl_stage_t;
+
+typedef struct {
+  usbip_urb_t* urb;
+  uint8_t  export_idx;
+  uint8_t  stage;
+  uint8_t  out_seq;
+  bool     in_flight;
+  uint32_t nak_count;
+} usbip_ctrl_t;
+
+// token waiting for reply, device replies in order
+typedef struct {
+  uint8_t  export_idx;
+  uint8_t  ep_addr;
+  uint8_t  pid;
+  uint8_t  seq;
+  uint8_t  gen;
+  bool     last;
+  uint16_t len;
+} usbip_token_t;
+
+typedef enum {
+  CONN_RX_OP = 0, // operation header, connection is not imported yet
+  CONN_RX_BUSID,  // busid of import request
+  CONN_RX_CMD,    // command header
+  CONN_RX_DATA,   // OUT data of CMD_SUBMIT
+  CONN_RX_ISO,    // isochronous packet descriptors of CMD_SUBMIT, discarded
+} usbip_conn_rx_t;
+
+typedef struct {
+  int fd;
+  int export_idx;       // -1 if not imported
+
+  uint8_t  rx_state;
+  uint32_t rx_len;      // bytes of current message part received so far
+  int32_t  rx_iso;      // isochronous packet descriptors left to discard
+  usbip_urb_t* rx_urb;  // CMD_SUBMIT waiting for the rest of its message
+  union {
+    usbip_op_common_t op;
+    char busid[32];
+    usbip_header_t hdr;
+    uint8_t iso_desc[16];
+  } rx;
+} usbip_conn_t;
+
+static struct {
+  uint8_t rhport;
+  int     listen_fd;
+  bool    bus_reset;
+  uint8_t probe_idx;
+  uint8_t rr_idx;
+
+  usbip_export_t export[USBIP_EXPORT_COUNT];
+  usbip_conn_t   conn[USBIP_CONN_MAX];
+  usbip_ctrl_t   ctrl;
+
+  usbip_token_t  token[CFG_TUD_VIRTUAL_RING_DEPTH];
+  uint8_t        token_rd;
+  uint8_t        token_count;
+
+  dcd_virtual_packet_t pkt; // scratch
+} _usbip = { .listen_fd = -1 };
+
+static void probe_start(uint8_t idx);
+static void probe_xfer_cb(uint8_t idx, usbip_urb_t* urb, int32_t status);
+
+//--------------------------------------------------------------------+
+// Socket helper
+//--------------------------------------------------------------------+
+
+static bool send_all(int fd, void const* buf, size_t len) {
+  uint8_t const* p = (uint8_t const*) buf;
+  while (len) {
+    ssize_t const n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p   += n;
+    len -= (size_t) n;
+  }
+  return true;
+}
+
+// receive a message part without blocking, return 1 once complete, 0 if more data is needed and -1 on error
+static int recv_part(usbip_conn_t* conn, void* buf, uint32_t size) {
+  while (conn->rx_len < size) {
+    ssize_t const n = recv(conn->fd, (uint8_t*) buf + conn->rx_len, size - conn->rx_len, MSG_DONTWAIT);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    if (n <= 0) return -1;
+    conn->rx_len += (uint32_t) n;
+  }
+  conn->rx_len = 0;
+  return 1;
+}
+
+//--------------------------------------------------------------------+
+// URB
+//--------------------------------------------------------------------+
+
+static usbip_urb_t* urb_alloc(uint32_t length) {
+  usbip_urb_t* urb = (usbip_urb_t*) calloc(1, sizeof(usbip_urb_t) + length);
+  if (urb) urb->length = length;
+  return urb;
+}
+
+static void urb_enqueue(usbip_urb_t** head, usbip_urb_t** tail, usbip_urb_t* urb) {
+  urb->next = NULL;
+  if (*tail) {
+    (*tail)->next = urb;
+  } else {
+    *head = urb;
+  }
+  *tail = urb;
+}
+
+// remove urb from queue, return false if not found
+static bool urb_remove(usbip_urb_t** head, usbip_urb_t** tail, usbip_urb_t* urb) {
+  usbip_urb_t* prev = NULL;
+  for (usbip_urb_t* u = *head; u; prev = u, u = u->next) {
+    if (u != urb) continue;
+
+    if (prev) {
+      prev->next = u->next;
+    } else {
+      *head = u->next;
+    }
+    if (*tail == u) *tail = prev;
+    return true;
+  }
+  return false;
+}
+
+static bool ret_unlink(int fd, uint32_t seqnum, int32_t status) {
+  usbip_header_t hdr;
+  tu_memclr(&hdr, sizeof(hdr));
+  hdr.command = htonl(USBIP_RET_UNLINK);
+  hdr.seqnum  = htonl(seqnum);
+  hdr.ret_unlink.status = (int32_t) htonl((uint32_t) status);
+  return send_all(fd, &hdr, sizeof(hdr));
+}
+
+// complete and free urb
+static void urb_complete(uint8_t idx, usbip_urb_t* urb, int32_t status) {
+  usbip_export_t* exp = &_usbip.export[idx];
+
+  if (urb->internal) {
+    probe_xfer_cb(idx, urb, status);
+  } else if (exp->fd >= 0) {
+    bool const dir_in = tu_edpt_dir(urb->ep_addr) == TUSB_DIR_IN;
+    uint32_t const actual = (status == 0 || dir_in) ? urb->actual : 0;
+
+    usbip_header_t hdr;
+    tu_memclr(&hdr, sizeof(hdr));
+    hdr.command   = htonl(USBIP_RET_SUBMIT);
+    hdr.seqnum    = htonl(urb->seqnum);
+    hdr.devid     = htonl((USBIP_BUSNUM << 16) | exp->dev_addr);
+    hdr.direction = htonl(dir_in ? USBIP_DIR_IN : USBIP_DIR_OUT);
+    hdr.ep        = htonl(tu_edpt_number(urb->ep_addr));
+    hdr.ret_submit.status        = (int32_t) htonl((uint32_t) status);
+    hdr.ret_submit.actual_length = (int32_t) htonl(actual);
+    hdr.ret_submit.number_of_packets = (int32_t) htonl(0xFFFFFFFFu);
+
+    bool ok = send_all(exp->fd, &hdr, sizeof(hdr));
+    if (ok && dir_in && urb->actual) ok = send_all(exp->fd, urb->data, urb->actual);
+
+    // unlink came too late, transfer is already done
+    if (ok && urb->unlink_seqnum) ret_unlink(exp->fd, urb->unlink_seqnum, 0);
+  }
+
+  free(urb);
+}
+
+//--------------------------------------------------------------------+
+// Token
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline bool token_available(void) {
+  return _usbip.token_count < CFG_TUD_VIRTUAL_RING_DEPTH;
+}
+
+static bool token_send(uint8_t idx, uint8_t dev_addr, uint8_t ep_addr, uint8_t pid, uint8_t seq, uint8_t gen,
+                       void const* data, uint16_t len, bool last) {
+  dcd_virtual_packet_t* pkt = &_usbip.pkt;
+  pkt->pid      = pid;
+  pkt->dev_addr = dev_addr;
+  pkt->ep_addr  = ep_addr;
+  pkt->seq      = seq;
+  pkt->len      = len;
+  if (data && len) memcpy(pkt->data, data, len);
+
+  TU_VERIFY(dcd_virtual_host_send(_usbip.rhport, pkt));
+
+  uint8_t const wr = (uint8_t) ((_usbip.token_rd + _usbip.token_count) % CFG_TUD_VIRTUAL_RING_DEPTH);
+  usbip_token_t* tok = &_usbip.token[wr];
+  tok->export_idx = idx;
+  tok->ep_addr    = ep_addr;
+  tok->pid        = pid;
+  tok->seq        = seq;
+  tok->gen        = gen;
+  tok->len        = len;
+  tok->last       = last;
+  _usbip.token_count++;
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Control Transfer
+//--------------------------------------------------------------------+
+
+static uint16_t ctrl_mps(usbip_export_t const* exp) {
+  return exp->dev_desc.bMaxPacketSize0 ? exp->dev_desc.bMaxPacketSize0 : CFG_TUD_ENDPOINT0_SIZE;
+}
+
+static void pipes_reset(usbip_export_t* exp) {
+  for (uint8_t epnum = 1; epnum < TUP_DCD_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      exp->pipe[epnum][dir].halted = false;
+    }
+  }
+}
+
+static void ctrl_done(int32_t status) {
+  usbip_ctrl_t* ctrl = &_usbip.ctrl;
+  usbip_urb_t* urb = ctrl->urb;
+  usbip_export_t* exp = &_usbip.export[ctrl->export_idx];
+
+  ctrl->urb   = NULL;
+  ctrl->stage = CTRL_IDLE;
+
+  // keep pipe state in sync with standard requests that reset endpoints
+  if (status == 0 && urb->setup.bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD) {
+    if (urb->setup.bRequest == TUSB_REQ_SET_CONFIGURATION || urb->setup.bRequest == TUSB_REQ_SET_INTERFACE) {
+      pipes_reset(exp);
+    } else if (urb->setup.bRequest == TUSB_REQ_CLEAR_FEATURE &&
+               urb->setup.bmRequestType_bit.recipient == TUSB_REQ_RCPT_ENDPOINT &&
+               urb->setup.wValue == TUSB_REQ_FEATURE_EDPT_HALT) {
+      uint8_t const ep_addr = (uint8_t) urb->setup.wIndex;
+      if (tu_edpt_number(ep_addr) && tu_edpt_number(ep_addr) < TUP_DCD_ENDPOINT_MAX) {
+        exp->pipe[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].halted = false;
+      }
+    }
+  }
+
+  urb_complete(ctrl->export_idx, urb, status);
+}
+
+static void ctrl_reply(dcd_virtual_packet_t const* pkt, usbip_token_t const* tok) {
+  usbip_ctrl_t* ctrl = &_usbip.ctrl;
+  usbip_urb_t* urb = ctrl->urb;
+  ctrl->in_flight = false;
+  if (urb == NULL) return;
+
+  uint16_t const wLength = urb->setup.wLength;
+
+  switch (pkt->pid) {
+    case DCD_VIRTUAL_PID_STALL:
+      ctrl_done(-EPIPE);
+      break;
+
+    case DCD_VIRTUAL_PID_NAK:
+      if (++ctrl->nak_count > USBIP_NAK_LIMIT) {
+        ctrl_done(-ETIMEDOUT);
+      } else if (tok->pid == DCD_VIRTUAL_PID_OUT) {
+        ctrl->out_seq = pkt->seq; // resend with sequence expected by device
+      }
+      break;
+
+    case DCD_VIRTUAL_PID_ACK:
+      ctrl->nak_count = 0;
+      if (ctrl->stage == CTRL_SETUP) {
+        ctrl->out_seq = 0;
+        ctrl->stage = wLength ? CTRL_DATA : CTRL_STATUS;
+      } else if (ctrl->stage == CTRL_DATA) {
+        urb->actual += tok->len;
+        ctrl->out_seq++;
+        if (urb->actual >= wLength) ctrl->stage = CTRL_STATUS;
+      } else {
+        ctrl_done(0);
+      }
+      break;
+
+    case DCD_VIRTUAL_PID_DATA:
+      ctrl->nak_count = 0;
+      if (ctrl->stage == CTRL_DATA) {
+        uint16_t const len = (uint16_t) tu_min32(pkt->len, wLength - urb->actual);
+        memcpy(urb->data + urb->actual, pkt->data, len);
+        urb->actual += len;
+        if (pkt->len < ctrl_mps(&_usbip.export[ctrl->export_idx]) || urb->actual >= wLength) {
+          ctrl->stage = CTRL_STATUS;
+        }
+      } else {
+        ctrl_done(0);
+      }
+      break;
+
+    default: break;
+  }
+}
+
+static void ctrl_schedule(void) {
+  usbip_ctrl_t* ctrl = &_usbip.ctrl;
+  if (ctrl->in_flight || !token_available()) return;
+
+  // pick next queued control transfer, round robin between exports
+  if (ctrl->urb == NULL) {
+    for (uint8_t i = 0; i < USBIP_EXPORT_COUNT && ctrl->urb == NULL; i++) {
+      uint8_t const idx = (uint8_t) ((ctrl->export_idx + 1 + i) % USBIP_EXPORT_COUNT);
+      usbip_export_t* exp = &_usbip.export[idx];
+      if (exp->ctrl_head) {
+        ctrl->urb = exp->ctrl_head;
+        urb_remove(&exp->ctrl_head, &exp->ctrl_tail, ctrl->urb);
+        ctrl->export_idx = idx;
+        ctrl->stage      = CTRL_SETUP;
+        ctrl->out_seq    = 0;
+        ctrl->nak_count  = 0;
+      }
+    }
+    if (ctrl->urb == NULL) return;
+  }
+
+  usbip_urb_t* urb = ctrl->urb;
+  usbip_export_t const* exp = &_usbip.export[ctrl->export_idx];
+  uint8_t const idx = ctrl->export_idx;
+  bool const data_in = urb->setup.bmRequestType_bit.direction == TUSB_DIR_IN;
+  bool sent = false;
+
+  urb->started = true;
+
+  switch (ctrl->stage) {
+    case CTRL_SETUP:
+      sent = token_send(idx, urb->dev_addr, 0, DCD_VIRTUAL_PID_SETUP, 0, 0, &urb->setup, 8, false);
+      break;
+
+    case CTRL_DATA:
+      if (data_in) {
+        sent = token_send(idx, urb->dev_addr, TUSB_DIR_IN_MASK, DCD_VIRTUAL_PID_IN, 0, 0, NULL, 0, false);
+      } else {
+        uint16_t const len = (uint16_t) tu_min32(ctrl_mps(exp), urb->setup.wLength - urb->actual);
+        sent = token_send(idx, urb->dev_addr, 0, DCD_VIRTUAL_PID_OUT, ctrl->out_seq, 0, urb->data + urb->actual, len, false);
+      }
+      break;
+
+    case CTRL_STATUS:
+      // status is in opposite direction of data stage, IN if there is no data stage
+      if (data_in && urb->setup.wLength) {
+        sent = token_send(idx, urb->dev_addr, 0, DCD_VIRTUAL_PID_OUT, ctrl->out_seq, 0, NULL, 0, true);
+      } else {
+        sent = token_send(idx, urb->dev_addr, TUSB_DIR_IN_MASK, DCD_VIRTUAL_PID_IN, 0, 0, NULL, 0, true);
+      }
+      break;
+
+    default: break;
+  }
+
+  ctrl->in_flight = sent;
+}
+
+//--------------------------------------------------------------------+
+// Bulk & Interrupt Pipe
+//--------------------------------------------------------------------+
+
+// pop head urb and complete it
+static void pipe_complete_head(uint8_t idx, usbip_pipe_t* pipe, int32_t status) {
+  usbip_urb_t* urb = pipe->head;
+  if (urb == NULL) return;
+
+  urb_remove(&pipe->head, &pipe->tail, urb);
+  if (pipe->send_urb == urb) {
+    pipe->send_urb = urb->next;
+    pipe->send_off = 0;
+  }
+
+  urb_complete(idx, urb, status);
+}
+
+// Unlinked IN urbs are released once all tokens in flight are answered, so that data already taken from the device
+// ends up in an urb instead of being dropped. Head with data is completed normally, unlink is then answered as late.
+static void pipe_in_drain(uint8_t idx, usbip_pipe_t* pipe) {
+  if (pipe->in_flight) return;
+
+  usbip_export_t* exp = &_usbip.export[idx];
+  for (usbip_urb_t* urb = pipe->head; urb; ) {
+    usbip_urb_t* next = urb->next;
+    if (urb->unlink_seqnum) {
+      if (urb->actual) {
+        pipe_complete_head(idx, pipe, 0); // only head receives data
+      } else {
+        urb_remove(&pipe->head, &pipe->tail, urb);
+        if (exp->fd >= 0) ret_unlink(exp->fd, urb->unlink_seqnum, -ECONNRESET);
+        free(urb);
+      }
+    }
+    urb = next;
+  }
+}
+
+static void pipe_in_reply(uint8_t idx, usbip_pipe_t* pipe, dcd_virtual_packet_t const* pkt) {
+  if (pipe->in_flight) pipe->in_flight--;
+
+  if (pkt->pid == DCD_VIRTUAL_PID_STALL) {
+    if (!pipe->halted) {
+      pipe->halted = true;
+      pipe_complete_head(idx, pipe, -EPIPE);
+    }
+  } else if (pkt->pid == DCD_VIRTUAL_PID_DATA) {
+    usbip_urb_t* urb = pipe->head;
+    if (urb == NULL) return; // connection was released, data is dropped
+
+    uint32_t const len = tu_min32(pkt->len, urb->length - urb->actual);
+    memcpy(urb->data + urb->actual, pkt->data, len);
+    urb->actual += len;
+
+    if (pkt->len > len) {
+      pipe_complete_head(idx, pipe, -EOVERFLOW);
+    } else if (pkt->len < pipe->mps || urb->actual == urb->length) {
+      pipe_complete_head(idx, pipe, 0);
+    }
+  }
+
+  pipe_in_drain(idx, pipe);
+}
+
+static void pipe_out_reply(uint8_t idx, usbip_pipe_t* pipe, dcd_virtual_packet_t const* pkt, usbip_token_t const* tok) {
+  switch (pkt->pid) {
+    case DCD_VIRTUAL_PID_ACK:
+      // device only accepts packet in sequence, regardless of generation
+      // packets of a released connection (older generation) only advance the sequence
+      if (tok->seq == pipe->ack_seq) {
+        pipe->ack_seq++;
+        if (tok->gen == pipe->gen && pipe->head) {
+          pipe->head->actual += tok->len;
+          if (tok->last) pipe_complete_head(idx, pipe, 0);
+        }
+      }
+      break;
+
+    case DCD_VIRTUAL_PID_NAK:
+    case DCD_VIRTUAL_PID_STALL:
+      if (tok->gen != pipe->gen || tok->seq != pipe->ack_seq) break; // following packet of an already handled NAK
+
+      if (pkt->pid == DCD_VIRTUAL_PID_STALL) {
+        if (pipe->halted) break;
+        pipe->halted = true;
+        pipe_complete_head(idx, pipe, -EPIPE);
+      }
+
+      // rewind to oldest unacknowledged packet, use sequence expected by device
+      pipe->gen++;
+      pipe->send_urb = pipe->head;
+      pipe->send_off = pipe->head ? pipe->head->actual : 0;
+      pipe->ack_seq  = pkt->seq;
+      pipe->send_seq = pkt->seq;
+      break;
+
+    default: break;
+  }
+}
+
+static void pipe_schedule(uint8_t idx, uint8_t epnum, uint8_t dir) {
+  usbip_export_t* exp = &_usbip.export[idx];
+  usbip_pipe_t* pipe = &exp->pipe[epnum][dir];
+  if (pipe->halted || pipe->head == NULL) return;
+
+  uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+  uint16_t const mps = pipe->mps;
+
+  if (dir == TUSB_DIR_IN) {
+    // keep as many IN tokens in flight as queued urbs can absorb
+    uint32_t capacity = 0;
+    for (usbip_urb_t* urb = pipe->head; urb; urb = urb->next) {
+      if (urb->unlink_seqnum) return; // draining, see pipe_in_drain()
+      uint32_t const remain = urb->length - urb->actual;
+      capacity += remain ? (remain + mps - 1) / mps : 1;
+    }
+
+    while (pipe->in_flight < capacity && token_available()) {
+      if (!token_send(idx, exp->dev_addr, ep_addr, DCD_VIRTUAL_PID_IN, 0, 0, NULL, 0, false)) break;
+      pipe->head->started = true;
+      pipe->in_flight++;
+    }
+  } else {
+    // stream packets of all queued urbs
+    while (pipe->send_urb && token_available()) {
+      usbip_urb_t* urb = pipe->send_urb;
+      uint16_t const len = (uint16_t) tu_min32(mps, urb->length - pipe->send_off);
+      uint32_t const next_off = pipe->send_off + len;
+
+      // last packet is short or the last full one, unless zero length packet is requested
+      bool const last = (next_off == urb->length) && (len < mps || !(urb->flags & USBIP_URB_ZERO_PACKET));
+
+      if (!token_send(idx, exp->dev_addr, ep_addr, DCD_VIRTUAL_PID_OUT, pipe->send_seq, pipe->gen,
+                      urb->data + pipe->send_off, len, last)) {
+        break;
+      }
+
+      urb->started = true;
+      pipe->send_seq++;
+
+      if (last) {
+        pipe->send_urb = urb->next;
+        pipe->send_off = 0;
+      } else {
+        pipe->send_off = next_off;
+      }
+    }
+  }
+}
+
+static void pipe_enqueue(usbip_pipe_t* pipe, usbip_urb_t* urb) {
+  urb_enqueue(&pipe->head, &pipe->tail, urb);
+  if (tu_edpt_dir(urb->ep_addr) == TUSB_DIR_OUT && pipe->send_urb == NULL) {
+    pipe->send_urb = urb;
+    pipe->send_off = 0;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device reply
+//--------------------------------------------------------------------+
+
+static void reply_process(void) {
+  dcd_virtual_packet_t* pkt = &_usbip.pkt;
+
+  while (dcd_virtual_host_receive(_usbip.rhport, pkt)) {
+    if (pkt->pid == DCD_VIRTUAL_PID_WAKEUP) continue; // not a reply, bus is never suspended by server
+    if (_usbip.token_count == 0) continue;
+
+    usbip_token_t const tok = _usbip.token[_usbip.token_rd];
+    _usbip.token_rd = (uint8_t) ((_usbip.token_rd + 1) % CFG_TUD_VIRTUAL_RING_DEPTH);
+    _usbip.token_count--;
+
+    uint8_t const epnum = tu_edpt_number(tok.ep_addr);
+    if (epnum == 0) {
+      ctrl_reply(pkt, &tok);
+    } else {
+      usbip_pipe_t* pipe = &_usbip.export[tok.export_idx].pipe[epnum][tu_edpt_dir(tok.ep_addr)];
+      if (tu_edpt_dir(tok.ep_addr) == TUSB_DIR_IN) {
+        pipe_in_reply(tok.export_idx, pipe, pkt);
+      } else {
+        pipe_out_reply(tok.export_idx, pipe, pkt, &tok);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Probing
+//--------------------------------------------------------------------+
+
+static void probe_submit(uint8_t idx, uint8_t dev_addr, uint8_t bmRequestType, uint8_t bRequest,
+                         uint16_t wValue, uint16_t wIndex, uint16_t wLength) {
+  usbip_urb_t* urb = urb_alloc(wLength);
+  if (urb == NULL) {
+    _usbip.export[idx].state = EXPORT_ABSENT;
+    return;
+  }
+
+  urb->internal = true;
+  urb->dev_addr = dev_addr;
+  urb->ep_addr  = (bmRequestType & TUSB_DIR_IN_MASK) ? (uint8_t) TUSB_DIR_IN_MASK : 0u;
+  urb->setup.bmRequestType = bmRequestType;
+  urb->setup.bRequest      = bRequest;
+  urb->setup.wValue        = wValue;
+  urb->setup.wIndex        = wIndex;
+  urb->setup.wLength       = wLength;
+
+  urb_enqueue(&_usbip.export[idx].ctrl_head, &_usbip.export[idx].ctrl_tail, urb);
+}
+
+static void probe_step(uint8_t idx) {
+  usbip_export_t* exp = &_usbip.export[idx];
+  uint8_t const hub_addr = _usbip.export[0].dev_addr;
+
+  // skip steps not applicable for hub or downstream port
+  if (idx == 0 && exp->probe_step < PROBE_SET_ADDRESS) exp->probe_step = PROBE_SET_ADDRESS;
+  if (idx != 0 && exp->probe_step == PROBE_SET_CONFIG) exp->probe_step = PROBE_DONE;
+
+  switch (exp->probe_step) {
+    case PROBE_PORT_POWER:
+      probe_submit(idx, hub_addr, 0x23, HUB_REQUEST_SET_FEATURE, HUB_FEATURE_PORT_POWER, idx, 0);
+      break;
+
+    case PROBE_PORT_RESET:
+      probe_submit(idx, hub_addr, 0x23, HUB_REQUEST_SET_FEATURE, HUB_FEATURE_PORT_RESET, idx, 0);
+      break;
+
+    case PROBE_SET_ADDRESS:
+      probe_submit(idx, 0, 0x00, TUSB_REQ_SET_ADDRESS, exp->dev_addr, 0, 0);
+      break;
+
+    case PROBE_GET_DEVICE8:
+      probe_submit(idx, exp->dev_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0, 8);
+      break;
+
+    case PROBE_GET_DEVICE:
+      probe_submit(idx, exp->dev_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0, sizeof(tusb_desc_device_t));
+      break;
+
+    case PROBE_GET_CONFIG9:
+      probe_submit(idx, exp->dev_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0, 9);
+      break;
+
+    case PROBE_GET_CONFIG:
+      probe_submit(idx, exp->dev_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0, exp->cfg_total_len);
+      break;
+
+    case PROBE_SET_CONFIG:
+      probe_submit(idx, exp->dev_addr, 0x00, TUSB_REQ_SET_CONFIGURATION, exp->cfg_value, 0, 0);
+      break;
+
+    default:
+      exp->state = EXPORT_READY;
+      TU_LOG_USBD("USBIP export %u ready: %04X:%04X\r\n", idx, exp->dev_desc.idVendor, exp->dev_desc.idProduct);
+      probe_start((uint8_t) (idx + 1));
+      break;
+  }
+}
+
+static void probe_parse_config(usbip_export_t* exp, uint8_t const* desc, uint16_t len) {
+  uint8_t const* end = desc + len;
+  exp->cfg_value = ((tusb_desc_configuration_t const*) desc)->bConfigurationValue;
+  exp->itf_count = 0;
+
+  for (uint8_t const* p = desc; p + 1 < end && tu_desc_len(p); p = tu_desc_next(p)) {
+    if (tu_desc_type(p) == TUSB_DESC_INTERFACE) {
+      tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p;
+      if (desc_itf->bAlternateSetting == 0 && exp->itf_count < USBIP_ITF_MAX) {
+        usbip_interface_info_t* itf = &exp->itf[exp->itf_count++];
+        itf->bInterfaceClass    = desc_itf->bInterfaceClass;
+        itf->bInterfaceSubClass = desc_itf->bInterfaceSubClass;
+        itf->bInterfaceProtocol = desc_itf->bInterfaceProtocol;
+        itf->padding            = 0;
+      }
+    } else if (tu_desc_type(p) == TUSB_DESC_ENDPOINT) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p;
+      uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+      if (epnum && epnum < TUP_DCD_ENDPOINT_MAX) {
+        // endpoint may be listed in several alternate settings, use the largest size
+        usbip_pipe_t* pipe = &exp->pipe[epnum][tu_edpt_dir(desc_ep->bEndpointAddress)];
+        pipe->mps = tu_max16(pipe->mps, tu_edpt_packet_size(desc_ep));
+      }
+    }
+  }
+}
+
+static void probe_xfer_cb(uint8_t idx, usbip_urb_t* urb, int32_t status) {
+  usbip_export_t* exp = &_usbip.export[idx];
+
+  if (status != 0) {
+    TU_LOG_USBD("USBIP export %u probe step %u failed %ld\r\n", idx, exp->probe_step, (long) status);
+    exp->state = EXPORT_ABSENT;
+
+    // downstream ports can't be probed without hub
+    probe_start(idx == 0 ? USBIP_EXPORT_COUNT : (uint8_t) (idx + 1));
+    return;
+  }
+
+  switch (exp->probe_step) {
+    case PROBE_GET_DEVICE8:
+      exp->dev_desc.bMaxPacketSize0 = ((tusb_desc_device_t const*) urb->data)->bMaxPacketSize0;
+      break;
+
+    case PROBE_GET_DEVICE:
+      memcpy(&exp->dev_desc, urb->data, tu_min32(urb->actual, sizeof(tusb_desc_device_t)));
+      break;
+
+    case PROBE_GET_CONFIG9:
+      exp->cfg_total_len = tu_le16toh(((tusb_desc_configuration_t const*) urb->data)->wTotalLength);
+      if (exp->cfg_total_len < 9) exp->cfg_total_len = 9;
+      break;
+
+    case PROBE_GET_CONFIG:
+      probe_parse_config(exp, urb->data, (uint16_t) urb->actual);
+      break;
+
+    default: break;
+  }
+
+  exp->probe_step++;
+  probe_step(idx);
+}
+
+static void probe_start(uint8_t idx) {
+  _usbip.probe_idx = idx;
+  if (idx >= USBIP_EXPORT_COUNT) return;
+
+  usbip_export_t* exp = &_usbip.export[idx];
+  exp->state      = EXPORT_PROBING;
+  exp->probe_step = PROBE_PORT_POWER;
+  probe_step(idx);
+}
+
+//--------------------------------------------------------------------+
+// Connection
+//--------------------------------------------------------------------+
+
+static void export_fill_info(uint8_t idx, usbip_device_info_t* info) {
+  usbip_export_t const* exp = &_usbip.export[idx];
+
+  tu_memclr(info, sizeof(usbip_device_info_t));
+  if (idx == 0) {
+    snprintf(info->busid, sizeof(info->busid), "%u-1", USBIP_BUSNUM);
+  } else {
+    snprintf(info->busid, sizeof(info->busid), "%u-1.%u", USBIP_BUSNUM, idx);
+  }
+  snprintf(info->path, sizeof(info->path), "/sys/devices/virtual/tinyusb/%s", info->busid);
+
+  info->busnum              = htonl(USBIP_BUSNUM);
+  info->devnum              = htonl(exp->dev_addr);
+  info->speed               = htonl(TUP_RHPORT_HIGHSPEED ? USBIP_SPEED_HIGH : USBIP_SPEED_FULL); // same as bus reset
+  info->idVendor            = htons(exp->dev_desc.idVendor);
+  info->idProduct           = htons(exp->dev_desc.idProduct);
+  info->bcdDevice           = htons(exp->dev_desc.bcdDevice);
+  info->bDeviceClass        = exp->dev_desc.bDeviceClass;
+  info->bDeviceSubClass     = exp->dev_desc.bDeviceSubClass;
+  info->bDeviceProtocol     = exp->dev_desc.bDeviceProtocol;
+  info->bConfigurationValue = exp->cfg_value;
+  info->bNumConfigurations  = exp->dev_desc.bNumConfigurations;
+  info->bNumInterfaces      = exp->itf_count;
+}
+
+static bool exportable(uint8_t idx) {
+  return _usbip.export[idx].state == EXPORT_READY && _usbip.export[idx].fd < 0;
+}
+
+static void export_release(uint8_t idx) {
+  usbip_export_t* exp = &_usbip.export[idx];
+  exp->fd = -1;
+
+  // drop all pending urbs, active control transfer is left to complete without a connection
+  for (usbip_urb_t* urb = exp->ctrl_head; urb; ) {
+    usbip_urb_t* next = urb->next;
+    free(urb);
+    urb = next;
+  }
+  exp->ctrl_head = exp->ctrl_tail = NULL;
+
+  for (uint8_t epnum = 1; epnum < TUP_DCD_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      usbip_pipe_t* pipe = &exp->pipe[epnum][dir];
+      for (usbip_urb_t* urb = pipe->head; urb; ) {
+        usbip_urb_t* next = urb->next;
+        free(urb);
+        urb = next;
+      }
+      pipe->head = pipe->tail = pipe->send_urb = NULL;
+      pipe->send_off = 0;
+      pipe->gen++;
+      pipe->halted = false;
+    }
+  }
+}
+
+static void conn_close(usbip_conn_t* conn) {
+  if (conn->export_idx >= 0) {
+    TU_LOG_USBD("USBIP export %d detached\r\n", conn->export_idx);
+    export_release((uint8_t) conn->export_idx);
+  }
+  close(conn->fd);
+  free(conn->rx_urb);
+  conn->fd = -1;
+  conn->export_idx = -1;
+  conn->rx_urb = NULL;
+}
+
+static bool op_devlist(usbip_conn_t* conn) {
+  uint32_t count = 0;
+  for (uint8_t idx = 0; idx < USBIP_EXPORT_COUNT; idx++) {
+    if (exportable(idx)) count++;
+  }
+
+  usbip_op_common_t const op = {
+    .version = htons(USBIP_VERSION),
+    .code    = htons(USBIP_OP_REP_DEVLIST),
+    .status  = 0
+  };
+  uint32_t const ndev = htonl(count);
+  TU_VERIFY(send_all(conn->fd, &op, sizeof(op)) && send_all(conn->fd, &ndev, sizeof(ndev)));
+
+  for (uint8_t idx = 0; idx < USBIP_EXPORT_COUNT; idx++) {
+    if (!exportable(idx)) continue;
+
+    usbip_device_info_t info;
+    export_fill_info(idx, &info);
+    TU_VERIFY(send_all(conn->fd, &info, sizeof(info)));
+    TU_VERIFY(send_all(conn->fd, _usbip.export[idx].itf, _usbip.export[idx].itf_count * sizeof(usbip_interface_info_t)));
+  }
+
+  return true;
+}
+
+static bool op_import(usbip_conn_t* conn) {
+  char* busid = conn->rx.busid;
+  busid[sizeof(conn->rx.busid) - 1] = 0;
+
+  int found = -1;
+  usbip_device_info_t info;
+  for (uint8_t idx = 0; idx < USBIP_EXPORT_COUNT && found < 0; idx++) {
+    export_fill_info(idx, &info);
+    if (exportable(idx) && 0 == strcmp(busid, info.busid)) found = idx;
+  }
+
+  usbip_op_common_t const op = {
+    .version = htons(USBIP_VERSION),
+    .code    = htons(USBIP_OP_REP_IMPORT),
+    .status  = htonl(found < 0 ? 1u : 0u)
+  };
+  TU_VERIFY(send_all(conn->fd, &op, sizeof(op)));
+  TU_VERIFY(found >= 0);
+
+  export_fill_info((uint8_t) found, &info);
+  TU_VERIFY(send_all(conn->fd, &info, sizeof(info)));
+
+  conn->export_idx = found;
+  _usbip.export[found].fd = conn->fd;
+  TU_LOG_USBD("USBIP export %d imported\r\n", found);
+
+  return true;
+}
+
+// parse CMD_SUBMIT header, urb is queued once its OUT data and isochronous descriptors are received
+static bool cmd_submit(usbip_conn_t* conn) {
+  usbip_header_t const* hdr = &conn->rx.hdr;
+  usbip_export_t* exp = &_usbip.export[conn->export_idx];
+
+  uint8_t const dir    = ntohl(hdr->direction) == USBIP_DIR_IN ? TUSB_DIR_IN : TUSB_DIR_OUT;
+  uint32_t const epnum = ntohl(hdr->ep);
+  int32_t const length = (int32_t) ntohl((uint32_t) hdr->cmd_submit.transfer_buffer_length);
+  int32_t const num_iso = (int32_t) ntohl((uint32_t) hdr->cmd_submit.number_of_packets);
+
+  TU_VERIFY(length >= 0 && length <= USBIP_URB_LEN_MAX);
+
+  usbip_urb_t* urb = urb_alloc((uint32_t) length);
+  TU_VERIFY(urb);
+
+  urb->seqnum   = ntohl(hdr->seqnum);
+  urb->flags    = ntohl(hdr->cmd_submit.transfer_flags);
+  urb->dev_addr = exp->dev_addr;
+  urb->ep_addr  = tu_edpt_addr((uint8_t) epnum, dir);
+  memcpy(&urb->setup, hdr->cmd_submit.setup, 8);
+
+  conn->rx_urb = urb;
+  conn->rx_iso = num_iso > 0 ? num_iso : 0;
+
+  if (dir == TUSB_DIR_OUT && length) {
+    conn->rx_state = CONN_RX_DATA;
+  } else if (conn->rx_iso) {
+    conn->rx_state = CONN_RX_ISO;
+  }
+
+  return true;
+}
+
+// whole CMD_SUBMIT is received
+static void cmd_submit_done(usbip_conn_t* conn, bool iso) {
+  uint8_t const idx = (uint8_t) conn->export_idx;
+  usbip_export_t* exp = &_usbip.export[idx];
+  usbip_urb_t* urb = conn->rx_urb;
+  uint8_t const epnum = tu_edpt_number(urb->ep_addr);
+  uint8_t const dir = tu_edpt_dir(urb->ep_addr);
+
+  conn->rx_urb   = NULL;
+  conn->rx_state = CONN_RX_CMD;
+
+  // isochronous is not supported
+  if (iso) {
+    urb_complete(idx, urb, -EXDEV);
+    return;
+  }
+
+  if (epnum == 0) {
+    urb->setup.wValue  = tu_le16toh(urb->setup.wValue);
+    urb->setup.wIndex  = tu_le16toh(urb->setup.wIndex);
+    urb->setup.wLength = tu_le16toh(urb->setup.wLength);
+
+    if (urb->setup.wLength > urb->length) {
+      urb_complete(idx, urb, -EINVAL);
+    } else if (urb->setup.bmRequestType == 0 && urb->setup.bRequest == TUSB_REQ_SET_ADDRESS) {
+      // device is already addressed by server
+      urb_complete(idx, urb, 0);
+    } else {
+      urb_enqueue(&exp->ctrl_head, &exp->ctrl_tail, urb);
+    }
+  } else if (epnum >= TUP_DCD_ENDPOINT_MAX || exp->pipe[epnum][dir].mps == 0) {
+    urb_complete(idx, urb, -EPIPE);
+  } else {
+    pipe_enqueue(&exp->pipe[epnum][dir], urb);
+  }
+}
+
+static bool cmd_unlink(usbip_conn_t* conn) {
+  usbip_header_t const* hdr = &conn->rx.hdr;
+  uint8_t const idx = (uint8_t) conn->export_idx;
+  usbip_export_t* exp = &_usbip.export[idx];
+  uint32_t const seqnum = ntohl(hdr->seqnum);
+  uint32_t const target = ntohl(hdr->cmd_unlink.seqnum);
+
+  // queued control transfer
+  for (usbip_urb_t* urb = exp->ctrl_head; urb; urb = urb->next) {
+    if (urb->seqnum == target) {
+      urb_remove(&exp->ctrl_head, &exp->ctrl_tail, urb);
+      free(urb);
+      return ret_unlink(conn->fd, seqnum, -ECONNRESET);
+    }
+  }
+
+  // active control transfer, complete it first
+  if (_usbip.ctrl.urb && _usbip.ctrl.export_idx == idx && _usbip.ctrl.urb->seqnum == target) {
+    _usbip.ctrl.urb->unlink_seqnum = seqnum;
+    return true;
+  }
+
+  for (uint8_t epnum = 1; epnum < TUP_DCD_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      usbip_pipe_t* pipe = &exp->pipe[epnum][dir];
+      for (usbip_urb_t* urb = pipe->head; urb; urb = urb->next) {
+        if (urb->seqnum != target) continue;
+
+        // OUT data already (partially) sent to device can't be taken back, IN tokens in flight are drained first
+        if ((dir == TUSB_DIR_OUT && urb->started) || (dir == TUSB_DIR_IN && pipe->in_flight)) {
+          urb->unlink_seqnum = seqnum;
+          return true;
+        }
+
+        if (pipe->send_urb == urb) {
+          pipe->send_urb = urb->next;
+          pipe->send_off = 0;
+        }
+        urb_remove(&pipe->head, &pipe->tail, urb);
+        free(urb);
+        return ret_unlink(conn->fd, seqnum, -ECONNRESET);
+      }
+    }
+  }
+
+  // not found, already completed
+  return ret_unlink(conn->fd, seqnum, 0);
+}
+
+// process received data of connection, return false if connection is to be closed
+static bool conn_process(usbip_conn_t* conn) {
+  while (1) {
+    int ret = 0;
+
+    switch (conn->rx_state) {
+      case CONN_RX_OP:
+        ret = recv_part(conn, &conn->rx.op, sizeof(conn->rx.op));
+        if (ret <= 0) break;
+
+        switch (ntohs(conn->rx.op.code)) {
+          case USBIP_OP_REQ_DEVLIST:
+            op_devlist(conn);
+            return false; // connection is closed after device list
+
+          case USBIP_OP_REQ_IMPORT:
+            conn->rx_state = CONN_RX_BUSID;
+            break;
+
+          default:
+            return false;
+        }
+        break;
+
+      case CONN_RX_BUSID:
+        ret = recv_part(conn, conn->rx.busid, sizeof(conn->rx.busid));
+        if (ret <= 0) break;
+        TU_VERIFY(op_import(conn));
+        conn->rx_state = CONN_RX_CMD;
+        break;
+
+      case CONN_RX_CMD:
+        ret = recv_part(conn, &conn->rx.hdr, sizeof(conn->rx.hdr));
+        if (ret <= 0) break;
+
+        switch (ntohl(conn->rx.hdr.command)) {
+          case USBIP_CMD_SUBMIT:
+            TU_VERIFY(cmd_submit(conn));
+            if (conn->rx_state == CONN_RX_CMD) cmd_submit_done(conn, false);
+            break;
+
+          case USBIP_CMD_UNLINK:
+            TU_VERIFY(cmd_unlink(conn));
+            break;
+
+          default:
+            return false;
+        }
+        break;
+
+      case CONN_RX_DATA:
+        ret = recv_part(conn, conn->rx_urb->data, conn->rx_urb->length);
+        if (ret <= 0) break;
+        if (conn->rx_iso) {
+          conn->rx_state = CONN_RX_ISO;
+        } else {
+          cmd_submit_done(conn, false);
+        }
+        break;
+
+      case CONN_RX_ISO:
+        ret = recv_part(conn, conn->rx.iso_desc, sizeof(conn->rx.iso_desc));
+        if (ret <= 0) break;
+        if (--conn->rx_iso == 0) cmd_submit_done(conn, true);
+        break;
+
+      default:
+        return false;
+    }
+
+    // no more data for now, or connection lost
+    if (ret <= 0) return ret == 0;
+  }
+}
+
+static void net_process(void) {
+  // accept new connection
+  int const fd = accept(_usbip.listen_fd, NULL, NULL);
+  if (fd >= 0) {
+    usbip_conn_t* conn = NULL;
+    for (uint8_t i = 0; i < USBIP_CONN_MAX && conn == NULL; i++) {
+      if (_usbip.conn[i].fd < 0) conn = &_usbip.conn[i];
+    }
+
+    if (conn) {
+      int const one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      conn->fd = fd;
+      conn->export_idx = -1;
+      conn->rx_state = CONN_RX_OP;
+      conn->rx_len   = 0;
+    } else {
+      close(fd);
+    }
+  }
+
+  struct pollfd pfd[USBIP_CONN_MAX];
+  nfds_t count = 0;
+  for (uint8_t i = 0; i < USBIP_CONN_MAX; i++) {
+    if (_usbip.conn[i].fd >= 0) {
+      pfd[count].fd      = _usbip.conn[i].fd;
+      pfd[count].events  = POLLIN;
+      pfd[count].revents = 0;
+      count++;
+    }
+  }
+  if (count == 0 || poll(pfd, count, 0) <= 0) return;
+
+  for (nfds_t n = 0; n < count; n++) {
+    if (!(pfd[n].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+    for (uint8_t i = 0; i < USBIP_CONN_MAX; i++) {
+      usbip_conn_t* conn = &_usbip.conn[i];
+      if (conn->fd == pfd[n].fd && !conn_process(conn)) conn_close(conn);
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Public API
+//--------------------------------------------------------------------+
+
+bool usbip_server_init(uint8_t rhport, uint16_t tcp_port) {
+  tu_memclr(&_usbip, sizeof(_usbip));
+  _usbip.rhport    = rhport;
+  _usbip.listen_fd = -1;
+
+  for (uint8_t i = 0; i < USBIP_CONN_MAX; i++) {
+    _usbip.conn[i].fd = -1;
+    _usbip.conn[i].export_idx = -1;
+  }
+
+  for (uint8_t idx = 0; idx < USBIP_EXPORT_COUNT; idx++) {
+    _usbip.export[idx].fd = -1;
+    _usbip.export[idx].dev_addr = (uint8_t) (idx + 1);
+  }
+
+  int const fd = socket(AF_INET, SOCK_STREAM, 0);
+  TU_ASSERT(fd >= 0);
+
+  int const one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  tu_memclr(&addr, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(tcp_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, USBIP_CONN_MAX) < 0) {
+    close(fd);
+    return false;
+  }
+
+  // accept() must not block the task loop
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  _usbip.listen_fd = fd;
+
+  return true;
+}
+
+void usbip_server_deinit(void) {
+  for (uint8_t i = 0; i < USBIP_CONN_MAX; i++) {
+    if (_usbip.conn[i].fd >= 0) conn_close(&_usbip.conn[i]);
+  }
+
+  free(_usbip.ctrl.urb);
+  _usbip.ctrl.urb = NULL;
+
+  // internal probing urbs are not owned by any connection
+  for (uint8_t idx = 0; idx < USBIP_EXPORT_COUNT; idx++) export_release(idx);
+
+  if (_usbip.listen_fd >= 0) close(_usbip.listen_fd);
+  _usbip.listen_fd = -1;
+}
+
+// drop all connections and enumeration state
+static void bus_lost(void) {
+  for (uint8_t i = 0; i < USBIP_CONN_MAX; i++) {
+    if (_usbip.conn[i].fd >= 0) conn_close(&_usbip.conn[i]);
+  }
+
+  free(_usbip.ctrl.urb);
+  tu_memclr(&_usbip.ctrl, sizeof(_usbip.ctrl));
+
+  for (uint8_t idx = 0; idx < USBIP_EXPORT_COUNT; idx++) {
+    export_release(idx);
+    tu_memclr(_usbip.export[idx].pipe, sizeof(_usbip.export[idx].pipe));
+    tu_memclr(&_usbip.export[idx].dev_desc, sizeof(tusb_desc_device_t));
+    _usbip.export[idx].state = EXPORT_UNKNOWN;
+  }
+
+  _usbip.token_count = 0;
+  _usbip.bus_reset   = false;
+}
+
+void usbip_server_task(void) {
+  if (_usbip.listen_fd < 0) return;
+
+  if (!dcd_virtual_connected(_usbip.rhport)) {
+    // device is gone and pending tokens were discarded, re-enumerate once connected again
+    if (_usbip.bus_reset) bus_lost();
+    return;
+  }
+
+  if (!_usbip.bus_reset) {
+    dcd_virtual_packet_t* pkt = &_usbip.pkt;
+    pkt->pid     = DCD_VIRTUAL_PID_RESET;
+    pkt->len     = 0;
+    pkt->data[0] = TUP_RHPORT_HIGHSPEED ? TUSB_SPEED_HIGH : TUSB_SPEED_FULL;
+    if (!dcd_virtual_host_send(_usbip.rhport, pkt)) return;
+
+    _usbip.bus_reset = true;
+    probe_start(0);
+  }
+
+  reply_process();
+  net_process();
+  ctrl_schedule();
+
+  // round robin between exports so that one busy pipe does not starve the others
+  _usbip.rr_idx = (uint8_t) ((_usbip.rr_idx + 1) % USBIP_EXPORT_COUNT);
+  for (uint8_t i = 0; i < USBIP_EXPORT_COUNT; i++) {
+    uint8_t const idx = (uint8_t) ((_usbip.rr_idx + i) % USBIP_EXPORT_COUNT);
+    if (_usbip.export[idx].fd < 0) continue;
+
+    for (uint8_t epnum = 1; epnum < TUP_DCD_ENDPOINT_MAX; epnum++) {
+      pipe_schedule(idx, epnum, TUSB_DIR_OUT);
+      pipe_schedule(idx, epnum, TUSB_DIR_IN);
+    }
+  }
+}
+
+#endif
+#endif
@@ -2,8 +2,10 @@
 TINYUSB_SRC_C += \
 	src/tusb.c \
 	src/common/tusb_fifo.c \
+	src/common/tusb_trace.c \
 	src/device/usbd.c \
 	src/device/usbd_control.c \
+	src/device/usbd_desc.c \
 	src/typec/usbc.c \
 	src/class/audio/audio_device.c \
 	src/class/cdc/cdc_device.c \
@@ -11,7 +13,9 @@ TINYUSB_SRC_C += \
 	src/class/dfu/dfu_rt_device.c \
 	src/class/hid/hid_device.c \
 	src/class/midi/midi_device.c \
+	src/class/msc/msc_cache.c \
 	src/class/msc/msc_device.c \
+	src/class/msc/uas_device.c \
 	src/class/net/ecm_rndis_device.c \
 	src/class/net/ncm_device.c \
 	src/class/usbtmc/usbtmc_device.c \
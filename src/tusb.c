@@ -59,6 +59,10 @@ TU_ATTR_WEAK void tusb_time_delay_ms_api(uint32_t ms) {
 // Public API
 //--------------------------------------------------------------------+
 bool tusb_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
+  #if CFG_TUSB_TRACE
+  if (!tusb_inited()) tu_trace_init();
+  #endif
+
   //  backward compatible called with tusb_init(void)
   #if defined(TUD_OPT_RHPORT) || defined(TUH_OPT_RHPORT)
   if (rh_init == NULL) {
@@ -37,6 +37,7 @@
 #include "common/tusb_common.h"
 #include "osal/osal.h"
 #include "common/tusb_fifo.h"
+#include "common/tusb_trace.h"
 
 //------------- TypeC -------------//
 #if CFG_TUC_ENABLED
@@ -92,6 +93,10 @@
     #include "class/msc/msc_device.h"
   #endif
 
+  #if CFG_TUD_UAS
+    #include "class/msc/uas_device.h"
+  #endif
+
   #if CFG_TUD_AUDIO
     #include "class/audio/audio_device.h"
   #endif
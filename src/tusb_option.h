@@ -199,6 +199,9 @@
 #define OPT_MCU_MAX32650         2402  ///< ADI MAX32650/1/2
 #define OPT_MCU_MAX78002         2403  ///< ADI MAX78002
 
+// Software only controller, device stack runs in a host process (e.g Linux)
+#define OPT_MCU_VIRTUAL          2500  ///< Virtual DCD with in-process host
+
 // Check if configured MCU is one of listed
 // Apply _TU_CHECK_MCU with || as separator to list of input
 #define _TU_CHECK_MCU(_m)    (CFG_TUSB_MCU == _m)
@@ -415,6 +418,33 @@
   #define CFG_TUSB_MEM_DCACHE_LINE_SIZE CFG_TUSB_MEM_DCACHE_LINE_SIZE_DEFAULT
 #endif
 
+// Only allow power of two depth for tu_fifo: index arithmetic is reduced to masking and the generic
+// wrap-around code is compiled out. tu_fifo_config() fails for other depths. Otherwise power of two
+// depth is detected at runtime and still takes the fast path.
+#ifndef CFG_TUSB_FIFO_POW2_ONLY
+  #define CFG_TUSB_FIFO_POW2_ONLY 0
+#endif
+
+// Binary trace of stack hot path (event queue, task dispatch, transfer submit) into a ring of
+// compact timestamped records, see common/tusb_trace.h
+#ifndef CFG_TUSB_TRACE
+  #define CFG_TUSB_TRACE 0
+#endif
+
+// Number of trace records, must be power of two. Oldest records are overwritten when full
+#ifndef CFG_TUSB_TRACE_DEPTH
+  #define CFG_TUSB_TRACE_DEPTH 256
+#endif
+
+// Drain trace records to a SEGGER RTT up channel with tu_trace_rtt_drain()
+#ifndef CFG_TUSB_TRACE_RTT
+  #define CFG_TUSB_TRACE_RTT 0
+#endif
+
+#ifndef CFG_TUSB_TRACE_RTT_CHANNEL
+  #define CFG_TUSB_TRACE_RTT_CHANNEL 1
+#endif
+
 // OS selection
 #ifndef CFG_TUSB_OS
   #define CFG_TUSB_OS             OPT_OS_NONE
@@ -476,6 +506,43 @@
   #define CFG_TUD_TEST_MODE       0
 #endif
 
+// Give each port of the emulated hub its own bounded event queue for transfer complete events,
+// drained fairly by tud_task() so that a busy port cannot starve the others
+#ifndef CFG_TUD_TASK_PORT_QUEUE
+  #define CFG_TUD_TASK_PORT_QUEUE 0
+#endif
+
+// Let class drivers implementing xfer_isr_cb process transfer complete of selected endpoints directly in the
+// controller interrupt instead of tud_task(), e.g isochronous audio with latency below one millisecond
+#ifndef CFG_TUD_XFER_ISR
+  #define CFG_TUD_XFER_ISR        0
+#endif
+
+// Forward transfer completes handled in ISR to tud_task() as well, merged per endpoint into one event carrying
+// total length and count, for class drivers implementing xfer_coalesced_cb
+#ifndef CFG_TUD_XFER_COALESCE
+  #define CFG_TUD_XFER_COALESCE   0
+#endif
+
+#if CFG_TUD_XFER_COALESCE && !CFG_TUD_XFER_ISR
+  #error "CFG_TUD_XFER_COALESCE requires CFG_TUD_XFER_ISR"
+#endif
+
+// Descriptor pool shared by the hub and its ports (device/usbd_desc.h)
+#ifndef CFG_TUD_DESC_POOL_COUNT
+  #define CFG_TUD_DESC_POOL_COUNT      (CFG_TUD_HUB_PORT + 1)
+#endif
+
+// Bytes of descriptor data for all pools, identical descriptors are stored once
+#ifndef CFG_TUD_DESC_POOL_ARENA_SIZE
+  #define CFG_TUD_DESC_POOL_ARENA_SIZE 1024
+#endif
+
+// Number of descriptors for all pools, must be a power of 2
+#ifndef CFG_TUD_DESC_POOL_ENTRIES
+  #define CFG_TUD_DESC_POOL_ENTRIES    64
+#endif
+
 //------------- Device Class Driver -------------//
 #ifndef CFG_TUD_BTH
   #define CFG_TUD_BTH             0
@@ -493,6 +560,10 @@
   #define CFG_TUD_MSC             0
 #endif
 
+#ifndef CFG_TUD_UAS
+  #define CFG_TUD_UAS             0
+#endif
+
 #ifndef CFG_TUD_HID
   #define CFG_TUD_HID             0
 #endif
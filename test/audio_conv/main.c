@@ -0,0 +1,421 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Type I sample conversion of the audio driver: audiod_interleave_convert() (encoding) and
+// audiod_deinterleave_convert() (decoding) for every pair of USB format (PCM8, PCM 1-4 bytes with and without padding
+// bits, float) and application format are checked for
+//   - USB samples matching a reference encoder, padding bits below bBitResolution zero
+//   - round trip application -> USB -> application of samples within the lower of both resolutions
+//   - clipping: dither never wraps full scale around, SATURATE clips INT24, floats are always clipped
+// Run with: make run
+
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// conversion is file static
+#include "class/audio/audio_device.c"
+
+#define N_CH      2
+#define N_FRAMES  64
+#define N_SAMPLES (N_CH * N_FRAMES)
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+typedef struct {
+  uint32_t formats; // bFormats
+  uint8_t sz;       // bSubslotSize
+  uint8_t bits;     // bBitResolution
+  char const* name;
+} usb_fmt_t;
+
+static usb_fmt_t const usb_fmts[] = {
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM8,       1, 8,  "pcm8"     },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        1, 8,  "s8"       },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        2, 16, "s16"      },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        2, 12, "s12in16"  },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        3, 24, "s24"      },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        3, 20, "s20in24"  },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        4, 32, "s32"      },
+  { AUDIO_DATA_FORMAT_TYPE_I_PCM,        4, 24, "s24in32"  },
+  { AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT, 4, 32, "float"    },
+};
+
+static uint8_t const app_fmts[] = {
+  AUDIO_SAMPLE_FORMAT_INT16, AUDIO_SAMPLE_FORMAT_INT24, AUDIO_SAMPLE_FORMAT_Q31, AUDIO_SAMPLE_FORMAT_FLOAT32,
+};
+
+static char const* const app_name[] = { "usb", "int16", "int24", "q31", "float" };
+
+//--------------------------------------------------------------------+
+// Reference: samples as left-justified Q31
+//--------------------------------------------------------------------+
+
+static bool usb_is_float(usb_fmt_t const* u) {
+  return u->formats == AUDIO_DATA_FORMAT_TYPE_I_IEEE_FLOAT;
+}
+
+// Resolution a sample keeps, float has 24-bit mantissa
+static uint8_t usb_res(usb_fmt_t const* u) {
+  return usb_is_float(u) ? 24 : u->bits;
+}
+
+static uint8_t app_res(uint8_t fmt) {
+  switch (fmt) {
+    case AUDIO_SAMPLE_FORMAT_INT16: return 16;
+    case AUDIO_SAMPLE_FORMAT_Q31: return 32;
+    default: return 24;
+  }
+}
+
+static uint8_t app_size(uint8_t fmt) {
+  return (fmt == AUDIO_SAMPLE_FORMAT_INT16) ? 2 : 4;
+}
+
+static void ref_usb_write(usb_fmt_t const* u, uint8_t* p, int32_t q) {
+  if (u->formats == AUDIO_DATA_FORMAT_TYPE_I_PCM8) {
+    p[0] = (uint8_t) (((uint32_t) q >> 24) + 0x80);
+  } else if (usb_is_float(u)) {
+    float const f = (float) ((double) q / 2147483648.0);
+    memcpy(p, &f, 4);
+  } else {
+    uint32_t const v = (uint32_t) q & (uint32_t) (0xFFFFFFFFull << (32 - u->bits));
+    for (uint8_t i = 0; i < u->sz; i++) p[i] = (uint8_t) (v >> (32 - 8 * u->sz + 8 * i));
+  }
+}
+
+static int32_t ref_usb_read(usb_fmt_t const* u, uint8_t const* p) {
+  if (u->formats == AUDIO_DATA_FORMAT_TYPE_I_PCM8) {
+    return (int32_t) ((uint32_t) (uint8_t) (p[0] - 0x80) << 24);
+  }
+  if (usb_is_float(u)) {
+    float f;
+    memcpy(&f, p, 4);
+    double const d = (double) f * 2147483648.0;
+    return (d >= 2147483647.0) ? INT32_MAX : (d <= -2147483648.0) ? INT32_MIN : (int32_t) d;
+  }
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < u->sz; i++) v |= (uint32_t) p[i] << (32 - 8 * u->sz + 8 * i);
+  return (int32_t) v;
+}
+
+static void ref_app_write(uint8_t fmt, uint8_t* p, int32_t q) {
+  switch (fmt) {
+    case AUDIO_SAMPLE_FORMAT_INT16: {
+      int16_t const s = (int16_t) (q / 65536 - (q < 0 && q % 65536 ? 1 : 0));
+      memcpy(p, &s, 2);
+      break;
+    }
+    case AUDIO_SAMPLE_FORMAT_INT24: {
+      int32_t const s = q / 256 - (q < 0 && q % 256 ? 1 : 0);
+      memcpy(p, &s, 4);
+      break;
+    }
+    case AUDIO_SAMPLE_FORMAT_FLOAT32: {
+      float const f = (float) ((double) q / 2147483648.0);
+      memcpy(p, &f, 4);
+      break;
+    }
+    default:
+      memcpy(p, &q, 4);
+      break;
+  }
+}
+
+static int32_t ref_app_read(uint8_t fmt, uint8_t const* p) {
+  switch (fmt) {
+    case AUDIO_SAMPLE_FORMAT_INT16: {
+      int16_t s;
+      memcpy(&s, p, 2);
+      return s * 65536;
+    }
+    case AUDIO_SAMPLE_FORMAT_INT24: {
+      int32_t s;
+      memcpy(&s, p, 4);
+      return (int32_t) ((int64_t) s * 256);
+    }
+    case AUDIO_SAMPLE_FORMAT_FLOAT32: {
+      float f;
+      memcpy(&f, p, 4);
+      return (int32_t) ((double) f * 2147483648.0);
+    }
+    default: {
+      int32_t q;
+      memcpy(&q, p, 4);
+      return q;
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Driver conversion as used by encoding/decoding: copied if formats match
+//--------------------------------------------------------------------+
+
+static uint32_t _dither_state = 0x2545F491u;
+
+static void conv_setup(audiod_conv_t* conv, usb_fmt_t const* u, uint8_t app_fmt, uint8_t options, bool is_encode) {
+  audiod_conv_init(conv, app_fmt, options, u->formats, u->sz, u->bits, is_encode);
+}
+
+static void encode(audiod_conv_t const* conv, uint8_t* usb, uint8_t* app, uint16_t n_frames) {
+  uint8_t* const src[1] = { app };
+  if (conv->app_format == AUDIO_SAMPLE_FORMAT_USB) {
+    audiod_interleave(usb, src, 1, (uint16_t) (N_CH * conv->usb_sz), n_frames);
+  } else {
+    audiod_interleave_convert(usb, src, 1, N_CH, n_frames, conv, &_dither_state);
+  }
+}
+
+static void decode(audiod_conv_t const* conv, uint8_t* app, uint8_t const* usb, uint16_t n_frames) {
+  uint8_t* const dst[1] = { app };
+  if (conv->app_format == AUDIO_SAMPLE_FORMAT_USB) {
+    audiod_deinterleave(dst, 1, usb, (uint16_t) (N_CH * conv->usb_sz), n_frames);
+  } else {
+    audiod_deinterleave_convert(dst, 1, usb, N_CH, n_frames, conv, &_dither_state);
+  }
+}
+
+static int32_t rand_q31(uint32_t* seed, uint8_t res) {
+  *seed = *seed * 1664525u + 1013904223u;
+  uint32_t const v = (*seed & 0xFFFF0000u) | (((*seed * 2654435761u) >> 16) & 0xFFFFu);
+  return (int32_t) (v & (uint32_t) (0xFFFFFFFFull << (32 - res)));
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+// Encoded samples match reference and decode back to the application samples
+static bool check_pair(usb_fmt_t const* u, uint8_t app_fmt) {
+  uint8_t app[N_SAMPLES * 4], app_back[N_SAMPLES * 4 + 1];
+  uint8_t usb[N_SAMPLES * 4 + 1], usb_ref[N_SAMPLES * 4];
+  uint8_t const asz = app_size(app_fmt);
+  uint8_t const res = TU_MIN(usb_res(u), app_res(app_fmt));
+  uint32_t seed = 0x1234u + app_fmt * 77u + u->sz * 13u + u->bits;
+
+  audiod_conv_t enc, dec;
+  conv_setup(&enc, u, app_fmt, 0, true);
+  conv_setup(&dec, u, app_fmt, 0, false);
+
+  // full scale and zero then random samples representable in both formats
+  for (uint32_t i = 0; i < N_SAMPLES; i++) {
+    int32_t q = rand_q31(&seed, res);
+    if (i == 0) q = (int32_t) (uint32_t) (0xFFFFFFFFull << (32 - res)) & INT32_MAX;
+    if (i == 1) q = INT32_MIN;
+    if (i == 2) q = 0;
+    ref_app_write(app_fmt, app + i * asz, q);
+    ref_usb_write(u, usb_ref + i * u->sz, q);
+  }
+
+  memset(usb, 0xAA, sizeof(usb));
+  encode(&enc, usb, app, N_FRAMES);
+  for (uint32_t i = 0; i < N_SAMPLES; i++) {
+    if (memcmp(usb + i * u->sz, usb_ref + i * u->sz, u->sz)) {
+      printf("  %s -> %s: sample %lu is %08lx, expected %08lx\n", app_name[app_fmt], u->name, (unsigned long) i,
+             (unsigned long) (uint32_t) ref_usb_read(u, usb + i * u->sz), (unsigned long) (uint32_t) ref_usb_read(u, usb_ref + i * u->sz));
+      CHECK(false);
+    }
+  }
+  CHECK(usb[N_SAMPLES * u->sz] == 0xAA);
+
+  memset(app_back, 0xAA, sizeof(app_back));
+  decode(&dec, app_back, usb, N_FRAMES);
+  for (uint32_t i = 0; i < N_SAMPLES; i++) {
+    if (ref_app_read(app_fmt, app_back + i * asz) != ref_app_read(app_fmt, app + i * asz)) {
+      printf("  %s -> %s -> %s: sample %lu is %08lx, expected %08lx\n", app_name[app_fmt], u->name,
+             app_name[app_fmt], (unsigned long) i, (unsigned long) (uint32_t) ref_app_read(app_fmt, app_back + i * asz),
+             (unsigned long) (uint32_t) ref_app_read(app_fmt, app + i * asz));
+      CHECK(false);
+    }
+  }
+  CHECK(app_back[N_SAMPLES * asz] == 0xAA);
+  return true;
+}
+
+static bool test_pairs(void) {
+  for (size_t u = 0; u < TU_ARRAY_SIZE(usb_fmts); u++) {
+    for (size_t a = 0; a < TU_ARRAY_SIZE(app_fmts); a++) {
+      if (!check_pair(&usb_fmts[u], app_fmts[a])) {
+        printf("format pair %s/%s FAIL\n", usb_fmts[u].name, app_name[app_fmts[a]]);
+        return false;
+      }
+    }
+  }
+  printf("format pairs and round trip   OK\n");
+  return true;
+}
+
+// Dither at full scale stays at full scale instead of wrapping to the opposite sign, with and without SATURATE
+static bool check_dither_full_scale(usb_fmt_t const* u, uint8_t app_fmt, uint8_t options) {
+  enum { ROUNDS = 64 };
+  uint8_t app[N_SAMPLES * 4], usb[N_SAMPLES * 4];
+  uint8_t const asz = app_size(app_fmt);
+  audiod_conv_t enc, dec;
+  conv_setup(&enc, u, app_fmt, options, true);
+  conv_setup(&dec, u, app_fmt, options, false);
+
+  // encode: resolution reduced from application to USB
+  if (enc.dither_bits) {
+    for (uint32_t r = 0; r < ROUNDS; r++) {
+      for (uint32_t i = 0; i < N_SAMPLES; i++) ref_app_write(app_fmt, app + i * asz, (i & 1) ? INT32_MIN : INT32_MAX);
+      encode(&enc, usb, app, N_FRAMES);
+      for (uint32_t i = 0; i < N_SAMPLES; i++) {
+        int32_t const q = ref_usb_read(u, usb + i * u->sz);
+        CHECK((i & 1) ? q < 0 : q > 0);
+      }
+    }
+  }
+
+  // decode: resolution reduced from USB to application
+  if (dec.dither_bits) {
+    for (uint32_t r = 0; r < ROUNDS; r++) {
+      for (uint32_t i = 0; i < N_SAMPLES; i++) ref_usb_write(u, usb + i * u->sz, (i & 1) ? INT32_MIN : INT32_MAX);
+      decode(&dec, app, usb, N_FRAMES);
+      for (uint32_t i = 0; i < N_SAMPLES; i++) {
+        int32_t const q = ref_app_read(app_fmt, app + i * asz);
+        CHECK((i & 1) ? q < 0 : q > 0);
+      }
+    }
+  }
+  return true;
+}
+
+// Dither of +-1 LSB of the target resolution: error against truncation stays within 1 LSB and averages out
+static bool check_dither_error(usb_fmt_t const* u, uint8_t app_fmt) {
+  uint8_t app[N_SAMPLES * 4], usb[N_SAMPLES * 4];
+  uint8_t const asz = app_size(app_fmt);
+  audiod_conv_t enc;
+  conv_setup(&enc, u, app_fmt, AUDIO_SAMPLE_CONV_DITHER, true);
+  if (!enc.dither_bits) return true;
+
+  int64_t const lsb = 1ll << (32 - enc.dither_bits);
+  uint32_t seed = 99;
+  int64_t sum = 0;
+  for (uint32_t r = 0; r < 64; r++) {
+    for (uint32_t i = 0; i < N_SAMPLES; i++) ref_app_write(app_fmt, app + i * asz, rand_q31(&seed, app_res(app_fmt)) / 2);
+    encode(&enc, usb, app, N_FRAMES);
+    for (uint32_t i = 0; i < N_SAMPLES; i++) {
+      int64_t const in = ref_app_read(app_fmt, app + i * asz);
+      int64_t const out = ref_usb_read(u, usb + i * u->sz);
+      CHECK(out - in > -2 * lsb && out - in < lsb);
+      sum += out - in;
+    }
+  }
+  // truncation alone is biased by -LSB/2
+  CHECK(llabs(sum / (64 * N_SAMPLES) + lsb / 2) < lsb / 8);
+  return true;
+}
+
+static bool test_dither(void) {
+  for (size_t u = 0; u < TU_ARRAY_SIZE(usb_fmts); u++) {
+    for (size_t a = 0; a < TU_ARRAY_SIZE(app_fmts); a++) {
+      if (!check_dither_full_scale(&usb_fmts[u], app_fmts[a], AUDIO_SAMPLE_CONV_DITHER) ||
+          !check_dither_full_scale(&usb_fmts[u], app_fmts[a], AUDIO_SAMPLE_CONV_DITHER | AUDIO_SAMPLE_CONV_SATURATE) ||
+          !check_dither_error(&usb_fmts[u], app_fmts[a])) {
+        printf("dither %s/%s FAIL\n", usb_fmts[u].name, app_name[app_fmts[a]]);
+        return false;
+      }
+    }
+  }
+  printf("dither without wrap around    OK\n");
+  return true;
+}
+
+// Out of range application samples: INT24 is clipped with SATURATE, float always
+static bool test_clipping(void) {
+  usb_fmt_t const* s32 = &usb_fmts[6];
+  usb_fmt_t const* fl = &usb_fmts[8];
+  audiod_conv_t conv;
+  uint8_t app[N_SAMPLES * 4], usb[N_SAMPLES * 4];
+  memset(app, 0, sizeof(app));
+
+  int32_t const int24[4] = { 0x900000, -0x900000, 0x7FFFFF, -0x800000 };
+  int32_t const int24_q[4] = { 0x7FFFFF00, INT32_MIN, 0x7FFFFF00, INT32_MIN };
+  conv_setup(&conv, s32, AUDIO_SAMPLE_FORMAT_INT24, AUDIO_SAMPLE_CONV_SATURATE, true);
+  memcpy(app, int24, sizeof(int24));
+  encode(&conv, usb, app, 2);
+  for (uint32_t i = 0; i < 4; i++) CHECK(ref_usb_read(s32, usb + 4 * i) == int24_q[i]);
+
+  float const flt[4] = { 1.5f, -2.0f, NAN, 1.0f };
+  int32_t const flt_q[4] = { INT32_MAX, INT32_MIN, INT32_MIN, INT32_MAX };
+  conv_setup(&conv, s32, AUDIO_SAMPLE_FORMAT_FLOAT32, 0, true);
+  memcpy(app, flt, sizeof(flt));
+  encode(&conv, usb, app, 2);
+  for (uint32_t i = 0; i < 4; i++) CHECK(ref_usb_read(s32, usb + 4 * i) == flt_q[i]);
+
+  // float from host into fixed point application format
+  conv_setup(&conv, fl, AUDIO_SAMPLE_FORMAT_Q31, 0, false);
+  memcpy(usb, flt, sizeof(flt));
+  decode(&conv, app, usb, 2);
+  for (uint32_t i = 0; i < 4; i++) CHECK(ref_app_read(AUDIO_SAMPLE_FORMAT_Q31, app + 4 * i) == flt_q[i]);
+
+  printf("clipping                      OK\n");
+  return true;
+}
+
+// Bits below bBitResolution of USB samples are zero for any application sample, also with dither
+static bool test_padding(void) {
+  uint8_t app[N_SAMPLES * 4], usb[N_SAMPLES * 4];
+  for (size_t u = 0; u < TU_ARRAY_SIZE(usb_fmts); u++) {
+    usb_fmt_t const* f = &usb_fmts[u];
+    if (usb_is_float(f) || f->bits == 8 * f->sz) continue;
+    uint32_t const pad = (uint32_t) (0xFFFFFFFFull >> f->bits) & (uint32_t) (0xFFFFFFFFull << (32 - 8 * f->sz));
+
+    for (size_t a = 0; a < TU_ARRAY_SIZE(app_fmts); a++) {
+      for (uint8_t options = 0; options <= AUDIO_SAMPLE_CONV_DITHER; options++) {
+        audiod_conv_t conv;
+        conv_setup(&conv, f, app_fmts[a], options, true);
+        uint32_t seed = 7;
+        for (uint32_t i = 0; i < N_SAMPLES; i++) {
+          ref_app_write(app_fmts[a], app + i * app_size(app_fmts[a]), rand_q31(&seed, 32));
+        }
+        encode(&conv, usb, app, N_FRAMES);
+        for (uint32_t i = 0; i < N_SAMPLES; i++) {
+          if ((uint32_t) ref_usb_read(f, usb + i * f->sz) & pad) {
+            printf("  %s -> %s: padding bits set in %08lx\n", app_name[app_fmts[a]], f->name,
+                   (unsigned long) (uint32_t) ref_usb_read(f, usb + i * f->sz));
+            CHECK(false);
+          }
+        }
+      }
+    }
+  }
+  printf("padding bits zero             OK\n");
+  return true;
+}
+
+int main(void) {
+  test_pairs();
+  test_dither();
+  test_clipping();
+  test_padding();
+  return _fail ? 1 : 0;
+}
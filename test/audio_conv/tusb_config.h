@@ -0,0 +1,37 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          1
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_AUDIO                             1
+#define CFG_TUD_AUDIO_LOG_LEVEL                   2
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN             256
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT             2
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ          64
+
+#define CFG_TUD_AUDIO_ENABLE_EP_IN                1
+#define CFG_TUD_AUDIO_ENABLE_EP_OUT               1
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX         1024
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX        1024
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ      4096
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ     4096
+
+// conversion is only built with encoding/decoding
+#define CFG_TUD_AUDIO_ENABLE_ENCODING             1
+#define CFG_TUD_AUDIO_ENABLE_DECODING             1
+#define CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING      1
+#define CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING      1
+#define CFG_TUD_AUDIO_FUNC_1_CHANNEL_PER_FIFO_TX  2
+#define CFG_TUD_AUDIO_FUNC_1_CHANNEL_PER_FIFO_RX  2
+#define CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO    4
+#define CFG_TUD_AUDIO_FUNC_1_N_RX_SUPP_SW_FIFO    4
+#define CFG_TUD_AUDIO_FUNC_1_TX_SUPP_SW_FIFO_SZ   4096
+#define CFG_TUD_AUDIO_FUNC_1_RX_SUPP_SW_FIFO_SZ   4096
+#define CFG_TUD_AUDIO_ENABLE_TYPE_I_CONVERSION    1
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Clock skew between host and device on the usbd mock: a UAC2 speaker regulates its RX FIFO with the FIFO PI feedback
+// method. Host sends one packet per microframe sized by the feedback value it last read, the application consumes
+// the FIFO every millisecond at the device sample clock which is off by the given ppm. Once settled the FIFO has to
+// stay around its target without underrun or overrun, host rate and reported drift have to match the skew. With the
+// data EP serviced in ISR (isr) the feedback EP must not be claimed there, since usbd takes its mutex for that, and
+// latency is reported from the time usbd took the completion. Run with: make run [ARGS=<seconds>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "usbd_mock.h"
+
+#define EP_OUT      0x01
+#define EP_FB       0x81
+#define EP_SIZE     CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX
+#define SAMPLE_RATE 48000
+#define SAMPLE_SZ   2
+#define UFRAME_MS   8
+#define NOMINAL     ((SAMPLE_RATE / 8000) << 16)                  // samples per microframe in 16.16 format
+#define TARGET_LVL  (CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ / 2)    // default target of FIFO PI method
+#define DRIFT_TOL   5                                             // ppm
+
+static uint8_t const desc_speaker[] = {
+  TUD_AUDIO_SPEAKER_MONO_FB_DESCRIPTOR(0, 0, SAMPLE_SZ, 16, EP_OUT, EP_SIZE, EP_FB, 4)
+};
+
+#if CFG_TUD_AUDIO_LOW_LATENCY
+static bool audio_xfer_isr(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  return audiod_xfer_isr_cb(rhport, 0, ep_addr, result, xferred_bytes);
+}
+
+// latency in ns
+uint32_t tu_trace_timestamp_cb(void) {
+  return (uint32_t) usbd_mock_time_ns();
+}
+#endif
+
+static usbd_mock_driver_t const _driver = {
+  .xfer_cb     = audiod_xfer_cb,
+#if CFG_TUD_AUDIO_LOW_LATENCY
+  .xfer_isr_cb = audio_xfer_isr,
+#endif
+  .sof         = audiod_sof_isr,
+};
+
+void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt_itf, audio_feedback_params_t* feedback_param) {
+  (void) func_id;
+  (void) alt_itf;
+  feedback_param->method      = AUDIO_FEEDBACK_METHOD_FIFO_PI;
+  feedback_param->sample_freq = SAMPLE_RATE;
+}
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+static bool set_interface(uint8_t alt) {
+  tusb_control_request_t const req = {
+    .bmRequestType = 0x01, // standard, interface
+    .bRequest      = TUSB_REQ_SET_INTERFACE,
+    .wValue        = alt,
+    .wIndex        = 1,
+    .wLength       = 0,
+  };
+  usbd_mock_task();
+  return audiod_control_xfer_cb(0, CONTROL_STAGE_SETUP, &req);
+}
+
+static bool mount(void) {
+  usbd_mock_init(&_driver, TUSB_SPEED_HIGH, true);
+  audiod_init();
+
+  uint16_t const len = (uint16_t) (sizeof(desc_speaker) - TUD_AUDIO_DESC_IAD_LEN);
+  CHECK(audiod_open(0, (tusb_desc_interface_t const*) (desc_speaker + TUD_AUDIO_DESC_IAD_LEN), len) > 0);
+  return true;
+}
+
+// Only reads which find the FIFO empty are underruns, a short read is what the application asked for
+static bool check_underrun(void) {
+  static uint8_t pkt[6 * SAMPLE_SZ];
+  uint8_t buf[8 * SAMPLE_SZ];
+  audio_feedback_stats_t stats;
+
+  CHECK(set_interface(0) && set_interface(1));
+  CHECK(usbd_mock_host_out(EP_OUT, pkt, sizeof(pkt)));
+  usbd_mock_task();
+
+  CHECK(tud_audio_read(buf, sizeof(buf)) == sizeof(pkt));
+  CHECK(tud_audio_fb_get_stats(&stats) && stats.underrun_count == 0);
+  CHECK(tud_audio_read(buf, sizeof(buf)) == 0);
+  CHECK(tud_audio_fb_get_stats(&stats) && stats.underrun_count == 1);
+
+  printf("%-4s underrun on empty FIFO only OK\n", AUDIO_FB_NAME);
+  return true;
+}
+
+// Stream for given (simulated) seconds, statistics are taken over the last two thirds
+static bool run_skew(int32_t skew_ppm, uint32_t seconds) {
+  static uint8_t pkt[EP_SIZE];
+  uint8_t buf[64 * SAMPLE_SZ];
+  uint8_t fb_raw[4];
+  audio_feedback_stats_t stats;
+  usbd_mock_stats_t mstats;
+
+  CHECK(set_interface(0) && set_interface(1));
+  usbd_mock_stats_clear();
+#if CFG_TUD_AUDIO_LOW_LATENCY
+  CHECK(tud_audio_clear_latency_stats());
+#endif
+
+  // device consumes 48 * (1 + skew) samples per millisecond, in 32.32 format
+  uint64_t const step = (uint64_t) llround((double) (SAMPLE_RATE / 1000) * (1e6 + skew_ppm) / 1e6 * 4294967296.0);
+  uint64_t dev_acc = 0;
+  uint32_t host_acc = 0;
+  uint32_t fb = NOMINAL;
+  bool playing = false;
+
+  uint32_t const total_ms  = seconds * 1000;
+  uint32_t const settle_ms = total_ms / 3;
+  uint64_t host_samples = 0;
+  uint32_t short_reads = 0, naks = 0;
+
+  for (uint32_t ms = 0; ms < total_ms; ms++) {
+    if (ms == settle_ms) {
+      CHECK(tud_audio_fb_clear_stats());
+      host_samples = 0;
+      short_reads = 0;
+      naks = 0;
+    }
+
+    for (uint32_t u = 0; u < UFRAME_MS; u++) {
+      // feedback EP is polled every microframe, value is 16.16 on high speed
+      if (usbd_mock_host_in(EP_FB, fb_raw, sizeof(fb_raw)) == sizeof(fb_raw)) {
+        fb = tu_unaligned_read32(fb_raw);
+        CHECK(fb >= NOMINAL - (1u << 16) && fb <= NOMINAL + (1u << 16));
+      }
+
+      host_acc += fb;
+      uint16_t const n = (uint16_t) (host_acc >> 16);
+      host_acc &= 0xffff;
+      if (!usbd_mock_host_out(EP_OUT, pkt, (uint16_t) (n * SAMPLE_SZ))) naks++;
+      host_samples += n;
+
+      usbd_mock_task();
+    }
+
+    if (!playing) playing = tud_audio_available() >= TARGET_LVL;
+    if (playing) {
+      dev_acc += step;
+      uint16_t const n = (uint16_t) ((dev_acc >> 32) * SAMPLE_SZ);
+      dev_acc &= 0xffffffffu;
+      if (tud_audio_read(buf, n) < n) short_reads++;
+    }
+  }
+
+  CHECK(tud_audio_fb_get_stats(&stats));
+  usbd_mock_stats_get(&mstats);
+
+  uint32_t const window_ms = total_ms - settle_ms;
+  double const host_ppm = ((double) host_samples / ((double) window_ms * (SAMPLE_RATE / 1000)) - 1.0) * 1e6;
+  double const lvl_std = sqrt((double) stats.fifo_lvl_var);
+
+  printf("%-4s skew %+5ld ppm             drift %+4ld ppm, host %+6.1f ppm, FIFO %4u (%u..%u, std %.1f) bytes\n",
+         AUDIO_FB_NAME, (long) skew_ppm, (long) stats.drift_ppm, host_ppm, stats.fifo_lvl_mean, stats.fifo_lvl_min,
+         stats.fifo_lvl_max, lvl_std);
+
+  CHECK(naks == 0);
+  CHECK(mstats.isr_claims == 0);
+  CHECK(stats.underrun_count == 0 && stats.overrun_count == 0 && short_reads == 0);
+  CHECK(abs(stats.drift_ppm - skew_ppm) <= DRIFT_TOL);
+  CHECK(fabs(host_ppm - skew_ppm) <= DRIFT_TOL);
+  CHECK(abs((int) stats.fifo_lvl_mean - TARGET_LVL) <= 64);
+
+#if CFG_TUD_AUDIO_LOW_LATENCY
+  audio_latency_stats_t rx;
+  CHECK(tud_audio_get_latency_stats(&rx, NULL));
+  CHECK(rx.count >= mstats.completes / 2 && rx.min <= rx.avg && rx.avg <= rx.max);
+  printf("%-4s skew %+5ld ppm             RX block callback %lu ns avg, %lu ns max after completion\n", AUDIO_FB_NAME,
+         (long) skew_ppm, (unsigned long) rx.avg, (unsigned long) rx.max);
+#endif
+
+  printf("%-4s skew %+5ld ppm             OK\n", AUDIO_FB_NAME, (long) skew_ppm);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t const seconds = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 30u;
+  static int32_t const skews[] = { 0, 20, -100, 250, -500, 1000 };
+
+  if (!mount() || !check_underrun()) return 1;
+
+  for (size_t i = 0; i < TU_ARRAY_SIZE(skews); i++) {
+    run_skew(skews[i], seconds);
+  }
+
+  return _fail ? 1 : 0;
+}
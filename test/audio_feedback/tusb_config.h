@@ -0,0 +1,31 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          1
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+// 48 kHz mono 16 bit speaker, 6 samples per microframe
+#define CFG_TUD_AUDIO                             1
+#define CFG_TUD_AUDIO_LOG_LEVEL                   2
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN             TUD_AUDIO_SPEAKER_MONO_FB_DESC_LEN
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT             1
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ          64
+
+#define CFG_TUD_AUDIO_ENABLE_EP_OUT               1
+#define CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP          1
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX        14 // 7 samples, one more than nominal
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ     1024
+
+// data EP serviced in ISR, latency statistics are taken from trace timestamps
+#ifdef AUDIO_FB_isr
+  #define CFG_TUD_XFER_ISR                        1
+  #define CFG_TUD_AUDIO_LOW_LATENCY               1
+  #define CFG_TUSB_TRACE                          1
+  #define CFG_TUSB_TRACE_TIMESTAMP()              tu_trace_timestamp_cb()
+#endif
+
+#endif
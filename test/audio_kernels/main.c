@@ -0,0 +1,255 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// PCM interleave kernels of the audio driver: audiod_interleave() and audiod_deinterleave() are checked against a
+// byte by byte reference for slot sizes 1-16, 1-8 FIFOs, odd frame counts and misaligned buffers. Then the cost per
+// sample of the compiled kernel (Helium/Neon where the compiler targets it, tail and other layouts scalar), the
+// scalar kernel audiod_copy_slots() alone and the reference are reported for common stream layouts. There are no
+// x86 SSE/AVX2 kernels, on x86 hosts the kernel column is the scalar one as the compiler vectorized it.
+// Run with: make run [ARGS=<iterations>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+// kernels are file static
+#include "class/audio/audio_device.c"
+
+#define MAX_FF       8
+#define MAX_SLOT     16
+#define MAX_FRAMES   200
+#define GUARD        8
+
+#if AUDIOD_SIMD_MVE
+  #define KERNEL_NAME "helium"
+#elif AUDIOD_SIMD_NEON
+  #define KERNEL_NAME "neon"
+#else
+  #define KERNEL_NAME "scalar"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define TICK_UNIT "cycles"
+static inline uint64_t ticks(void) { return __rdtsc(); }
+#else
+  // no cycle counter readable from user space
+  #define TICK_UNIT "ns"
+static inline uint64_t ticks(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+#endif
+
+// stream and FIFO linear buffers with guard bytes behind, offset misaligns them
+static uint8_t _stream[MAX_FF * MAX_SLOT * MAX_FRAMES + GUARD + 16] TU_ATTR_ALIGNED(16);
+static uint8_t _stream_ref[sizeof(_stream)] TU_ATTR_ALIGNED(16);
+static uint8_t _ff[MAX_FF][MAX_SLOT * MAX_FRAMES + GUARD + 16] TU_ATTR_ALIGNED(16);
+static uint8_t _ff_ref[MAX_FF][sizeof(_ff[0])] TU_ATTR_ALIGNED(16);
+
+static void fill(uint8_t* buf, size_t len, uint32_t seed) {
+  for (size_t i = 0; i < len; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    buf[i] = (uint8_t) (seed >> 24);
+  }
+}
+
+static void ref_interleave(uint8_t* dst, uint8_t* const src[], uint8_t n_ff, uint16_t slot_sz, uint16_t n_frames) {
+  for (uint16_t f = 0; f < n_frames; f++) {
+    for (uint8_t i = 0; i < n_ff; i++) {
+      for (uint16_t b = 0; b < slot_sz; b++) {
+        dst[(f * n_ff + i) * slot_sz + b] = src[i][f * slot_sz + b];
+      }
+    }
+  }
+}
+
+static void ref_deinterleave(uint8_t* const dst[], uint8_t n_ff, uint8_t const* src, uint16_t slot_sz, uint16_t n_frames) {
+  for (uint16_t f = 0; f < n_frames; f++) {
+    for (uint8_t i = 0; i < n_ff; i++) {
+      for (uint16_t b = 0; b < slot_sz; b++) {
+        dst[i][f * slot_sz + b] = src[(f * n_ff + i) * slot_sz + b];
+      }
+    }
+  }
+}
+
+// Scalar kernel only, as audiod_interleave() without SIMD
+static void scalar_interleave(uint8_t* dst, uint8_t* const src[], uint8_t n_ff, uint16_t slot_sz, uint16_t n_frames) {
+  uint16_t const frame_sz = (uint16_t) (n_ff * slot_sz);
+  for (uint8_t i = 0; i < n_ff; i++) {
+    audiod_copy_slots(dst + i * slot_sz, frame_sz, src[i], slot_sz, slot_sz, n_frames);
+  }
+}
+
+static void scalar_deinterleave(uint8_t* const dst[], uint8_t n_ff, uint8_t const* src, uint16_t slot_sz, uint16_t n_frames) {
+  uint16_t const frame_sz = (uint16_t) (n_ff * slot_sz);
+  for (uint8_t i = 0; i < n_ff; i++) {
+    audiod_copy_slots(dst[i], slot_sz, src + i * slot_sz, frame_sz, slot_sz, n_frames);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Equivalence
+//--------------------------------------------------------------------+
+
+static bool check(uint8_t n_ff, uint16_t slot_sz, uint16_t n_frames, uint8_t offset) {
+  uint8_t* ff[MAX_FF];
+  uint8_t* ff_ref[MAX_FF];
+  size_t const stream_len = (size_t) n_ff * slot_sz * n_frames;
+  size_t const ff_len = (size_t) slot_sz * n_frames;
+  uint32_t const seed = (uint32_t) (n_ff << 24 | slot_sz << 16 | n_frames << 4 | offset);
+
+  for (uint8_t i = 0; i < n_ff; i++) {
+    // FIFOs misaligned against each other as well
+    ff[i] = _ff[i] + (offset ? offset + i : 0);
+    ff_ref[i] = _ff_ref[i] + (offset ? offset + i : 0);
+  }
+  uint8_t* stream = _stream + offset;
+  uint8_t* stream_ref = _stream_ref + offset;
+
+  // encoding
+  fill(_stream, sizeof(_stream), ~seed);
+  memcpy(_stream_ref, _stream, sizeof(_stream));
+  for (uint8_t i = 0; i < n_ff; i++) fill(ff[i], ff_len, seed + i);
+  audiod_interleave(stream, ff, n_ff, slot_sz, n_frames);
+  ref_interleave(stream_ref, ff, n_ff, slot_sz, n_frames);
+  if (0 != memcmp(_stream, _stream_ref, sizeof(_stream))) return false;
+
+  // decoding
+  fill(stream, stream_len, seed);
+  for (uint8_t i = 0; i < n_ff; i++) {
+    fill(_ff[i], sizeof(_ff[i]), ~seed + i);
+    memcpy(_ff_ref[i], _ff[i], sizeof(_ff[i]));
+  }
+  audiod_deinterleave(ff, n_ff, stream, slot_sz, n_frames);
+  ref_deinterleave(ff_ref, n_ff, stream, slot_sz, n_frames);
+  for (uint8_t i = 0; i < n_ff; i++) {
+    if (0 != memcmp(_ff[i], _ff_ref[i], sizeof(_ff[i]))) return false;
+  }
+  return true;
+}
+
+static bool test_equivalence(void) {
+  static uint16_t const frames[] = { 0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 48, 64, 97, MAX_FRAMES };
+  uint32_t cases = 0;
+
+  for (uint16_t slot_sz = 1; slot_sz <= MAX_SLOT; slot_sz++) {
+    for (uint8_t n_ff = 1; n_ff <= MAX_FF; n_ff++) {
+      for (size_t f = 0; f < TU_ARRAY_SIZE(frames); f++) {
+        for (uint8_t offset = 0; offset < 4; offset++) {
+          if (!check(n_ff, slot_sz, frames[f], offset)) {
+            printf("interleave kernels FAIL slot %u bytes, %u FIFOs, %u frames, offset %u\n", slot_sz, n_ff,
+                   frames[f], offset);
+            return false;
+          }
+          cases++;
+        }
+      }
+    }
+  }
+  printf("interleave kernels (%s) OK %lu cases equal to reference\n", KERNEL_NAME, (unsigned long) cases);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Cost per sample
+//--------------------------------------------------------------------+
+
+typedef void (*interleave_fn_t)(uint8_t* dst, uint8_t* const src[], uint8_t n_ff, uint16_t slot_sz, uint16_t n_frames);
+typedef void (*deinterleave_fn_t)(uint8_t* const dst[], uint8_t n_ff, uint8_t const* src, uint16_t slot_sz, uint16_t n_frames);
+
+typedef struct {
+  char const* name;
+  uint8_t n_ff;
+  uint8_t n_ch;       // channels per FIFO
+  uint8_t sample_sz;  // bytes per sample
+} layout_t;
+
+static layout_t const layouts[] = {
+  { "4 x stereo 16-bit" , 4, 2, 2 },
+  { "2 x stereo 16-bit" , 2, 2, 2 },
+  { "4 x mono 16-bit"   , 4, 1, 2 },
+  { "2 x stereo 24-bit" , 2, 2, 3 },
+  { "4 x mono 32-bit"   , 4, 1, 4 },
+  { "3 x stereo 32-bit" , 3, 2, 4 },
+  { "8 x mono 16-bit"   , 8, 1, 2 },
+};
+
+static double cost_interleave(interleave_fn_t fn, layout_t const* l, uint16_t n_frames, uint32_t iterations) {
+  uint8_t* ff[MAX_FF];
+  for (uint8_t i = 0; i < l->n_ff; i++) ff[i] = _ff[i];
+  uint16_t const slot_sz = (uint16_t) (l->n_ch * l->sample_sz);
+
+  uint64_t const t0 = ticks();
+  for (uint32_t it = 0; it < iterations; it++) {
+    fn(_stream, ff, l->n_ff, slot_sz, n_frames);
+    __asm__ volatile("" ::: "memory");
+  }
+  return (double) (ticks() - t0) / ((double) iterations * n_frames * l->n_ff * l->n_ch);
+}
+
+static double cost_deinterleave(deinterleave_fn_t fn, layout_t const* l, uint16_t n_frames, uint32_t iterations) {
+  uint8_t* ff[MAX_FF];
+  for (uint8_t i = 0; i < l->n_ff; i++) ff[i] = _ff[i];
+  uint16_t const slot_sz = (uint16_t) (l->n_ch * l->sample_sz);
+
+  uint64_t const t0 = ticks();
+  for (uint32_t it = 0; it < iterations; it++) {
+    fn(ff, l->n_ff, _stream, slot_sz, n_frames);
+    __asm__ volatile("" ::: "memory");
+  }
+  return (double) (ticks() - t0) / ((double) iterations * n_frames * l->n_ff * l->n_ch);
+}
+
+static void bench(uint32_t iterations) {
+  uint16_t const n_frames = 48; // 1 ms at 48 kHz
+
+  printf("%u frames, %s per sample      encode: %6s %6s %6s   decode: %6s %6s %6s\n", n_frames, TICK_UNIT,
+         KERNEL_NAME, "scalar", "ref", KERNEL_NAME, "scalar", "ref");
+  for (size_t i = 0; i < TU_ARRAY_SIZE(layouts); i++) {
+    layout_t const* l = &layouts[i];
+    printf("  %-30s %6.2f %6.2f %6.2f           %6.2f %6.2f %6.2f\n", l->name,
+           cost_interleave(audiod_interleave, l, n_frames, iterations),
+           cost_interleave(scalar_interleave, l, n_frames, iterations),
+           cost_interleave(ref_interleave, l, n_frames, iterations),
+           cost_deinterleave(audiod_deinterleave, l, n_frames, iterations),
+           cost_deinterleave(scalar_deinterleave, l, n_frames, iterations),
+           cost_deinterleave(ref_deinterleave, l, n_frames, iterations));
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t const iterations = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 20000u;
+
+  if (!test_equivalence()) return 1;
+  bench(iterations);
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// CDC OUT throughput of the receive path selected by VARIANT (see tusb_config.h), driver runs on the usbd mock.
+// Host streams messages of full packets ending with a short one and sends as many packets per round as device
+// accepts, then device task runs once and application reads the RX fifo checking the data: all of it (fast reader)
+// or at most READ_SLOW bytes (slow reader). Reported are packets accepted per round (bus efficiency when task latency
+// dominates), transfers, NAKs and CPU time per MB.
+// Run with: make run [ARGS=<MB>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "usbd_mock.h"
+
+#define EP_NOTIF        0x81
+#define EP_OUT          0x02
+#define EP_IN           0x82
+#define EP_SIZE         512
+#define MSG_LEN         16000 // 31 full packets and a short one
+#define PACKETS_ROUND   13    // more than fit in RX fifo
+#define READ_SLOW       1536
+
+static uint8_t const desc_cdc[] = {
+  TUD_CDC_DESCRIPTOR(0, 0, EP_NOTIF, 8, EP_OUT, EP_IN, EP_SIZE)
+};
+
+static usbd_mock_driver_t const driver = {
+  .xfer_cb = cdcd_xfer_cb,
+};
+
+static uint8_t pattern(uint32_t offset) {
+  return (uint8_t) (offset % 251);
+}
+
+static uint64_t cpu_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static bool run(char const* name, uint32_t total, uint32_t read_max) {
+  usbd_mock_init(&driver, TUSB_SPEED_HIGH, CFG_TUD_CDC_XFER_FIFO);
+  cdcd_init();
+
+  // skip interface association
+  tusb_desc_interface_t const* itf = (tusb_desc_interface_t const*) tu_desc_next(desc_cdc);
+  if (cdcd_open(0, itf, sizeof(desc_cdc) - 8) != sizeof(desc_cdc) - 8) {
+    printf("%-22s FAIL open\n", name);
+    return false;
+  }
+
+  uint8_t packet[EP_SIZE];
+  uint8_t rx[CFG_TUD_CDC_RX_BUFSIZE];
+  uint32_t sent = 0;
+  uint32_t received = 0;
+  uint32_t rounds = 0;
+
+  usbd_mock_stats_clear();
+  uint64_t const t0 = cpu_time_ns();
+
+  while (received < total) {
+    // host: packets until device NAKs
+    for (uint32_t i = 0; i < PACKETS_ROUND && sent < total; i++) {
+      uint32_t const msg_left = MSG_LEN - (sent % MSG_LEN);
+      uint16_t const len = (uint16_t) TU_MIN(TU_MIN(msg_left, EP_SIZE), total - sent);
+      for (uint16_t j = 0; j < len; j++) packet[j] = pattern(sent + j);
+
+      if (!usbd_mock_host_out(EP_OUT, packet, len)) break;
+      sent += len;
+    }
+
+    // device
+    usbd_mock_task();
+    rounds++;
+
+    uint32_t left = read_max;
+    uint32_t count;
+    while (left && (count = tud_cdc_read(rx, TU_MIN(left, sizeof(rx)))) > 0) {
+      for (uint32_t j = 0; j < count; j++) {
+        if (rx[j] != pattern(received + j)) {
+          printf("%-22s FAIL data at %lu\n", name, (unsigned long) (received + j));
+          return false;
+        }
+      }
+      received += count;
+      left -= count;
+    }
+
+    if (rounds > 16u * total / EP_SIZE) {
+      printf("%-22s FAIL stalled at %lu of %lu bytes\n", name, (unsigned long) received, (unsigned long) sent);
+      return false;
+    }
+  }
+
+  uint64_t const t1 = cpu_time_ns();
+  usbd_mock_stats_t stats;
+  usbd_mock_stats_get(&stats);
+
+  double const mb = (double) total / (1024 * 1024);
+  printf("%-22s OK %5.2f packets/round, %6.1f xfers/MB, %6.1f NAK/MB, %7.1f us CPU/MB\n", name,
+         (double) stats.packets / rounds, stats.xfers / mb, stats.naks / mb, (double) (t1 - t0) / 1000.0 / mb);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t const mbytes = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 64u;
+  uint32_t const total = mbytes * 1024u * 1024u;
+
+  bool ok = run(CDC_BENCH_NAME ", fast reader", total, UINT32_MAX);
+  ok = run(CDC_BENCH_NAME ", slow reader", total, READ_SLOW) && ok;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          1
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_CDC             1
+#define CFG_TUD_CDC_EP_BUFSIZE  2048
+#define CFG_TUD_CDC_RX_BUFSIZE  4096
+#define CFG_TUD_CDC_TX_BUFSIZE  512
+
+#if defined(CDC_BENCH_multi)
+  #define CFG_TUD_CDC_RX_MULTI_PACKET  1
+#elif defined(CDC_BENCH_pingpong)
+  #define CFG_TUD_CDC_RX_PINGPONG      1
+#elif defined(CDC_BENCH_fifo)
+  #define CFG_TUD_CDC_RX_MULTI_PACKET  1
+  #define CFG_TUD_CDC_XFER_FIFO        1
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+// Host stand-in for the trace header supplied by the application.
+// Stack logs are discarded unless built with -DTEST_TRACE, then they go to stdout
+
+#ifndef CTRACE_H_
+#define CTRACE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#if TEST_TRACE
+  #define test_trace(...)   printf(__VA_ARGS__)
+#else
+  #define test_trace(...)   do { if (0) printf(__VA_ARGS__); } while (0)
+#endif
+
+#define vUSB_TRACE_PutString(...)       test_trace(__VA_ARGS__)
+#define vUSB_TRACE_PutStringErr(...)    test_trace(__VA_ARGS__)
+#define vUSB_TRACE_PutStringWar(...)    test_trace(__VA_ARGS__)
+#define vUSB_TRACE_PutStringInfo(...)   test_trace(__VA_ARGS__)
+#define vUSBD_TRACE_PutStringErr(...)   test_trace(__VA_ARGS__)
+#define vUSBD_TRACE_PutStringWar(...)   test_trace(__VA_ARGS__)
+#define vUSBD_TRACE_PutStringInfo(...)  test_trace(__VA_ARGS__)
+#define vUSBH_TRACE_PutStringErr(...)   test_trace(__VA_ARGS__)
+#define vUSBH_TRACE_PutStringWar(...)   test_trace(__VA_ARGS__)
+#define vUSBH_TRACE_PutStringInfo(...)  test_trace(__VA_ARGS__)
+
+static inline void vUSB_TRACE_PutBuffer(uint8_t const* buf, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) test_trace("%02X ", buf[i]);
+  test_trace("\n");
+}
+
+#endif
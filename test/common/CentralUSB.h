@@ -0,0 +1,14 @@
+// Host stand-in for the hub configuration header supplied by the application
+
+#ifndef CENTRAL_USB_H
+#define CENTRAL_USB_H
+
+// downstream ports of the emulated hub
+#ifndef CFG_TUD_HUB_PORT
+  #define CFG_TUD_HUB_PORT  4
+#endif
+
+// port number of the hub itself
+#define TUD_HUB_PORT_NUM    0
+
+#endif
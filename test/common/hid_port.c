@@ -0,0 +1,105 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "hid_port.h"
+
+//--------------------------------------------------------------------+
+// HID function
+//--------------------------------------------------------------------+
+
+static uint8_t const _hid_report_desc[] = { TUD_HID_REPORT_DESC_GENERIC_INOUT(HID_PORT_EPSIZE) };
+
+static tusb_desc_device_t const _hid_desc_device = {
+  .bLength            = sizeof(tusb_desc_device_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = 0x00,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+  .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+  .idVendor           = 0xCafe,
+  .idProduct          = HID_PORT_PID,
+  .bcdDevice          = 0x0100,
+  .iManufacturer      = 0x00,
+  .iProduct           = 0x00,
+  .iSerialNumber      = 0x00,
+  .bNumConfigurations = 0x01
+};
+
+#define HID_PORT_CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN)
+
+uint8_t const hid_port_desc_configuration[] = {
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, HID_PORT_CONFIG_TOTAL_LEN, 0, 100),
+  TUD_HID_DESCRIPTOR(0, 0, HID_ITF_PROTOCOL_NONE, sizeof(_hid_report_desc), HID_PORT_EPIN, HID_PORT_EPSIZE, 1)
+};
+
+uint16_t const hid_port_desc_configuration_len = HID_PORT_CONFIG_TOTAL_LEN;
+
+static uint8_t const _hid_desc_langid[] = { TUD_STRING_LANGID_DESCRIPTOR(0x0409) };
+static void const* const _hid_desc_string_arr[] = { _hid_desc_langid };
+
+// per port copy of the configuration with the endpoint of that port
+static uint8_t _hid_desc_configuration[CFG_TUD_HUB_PORT][HID_PORT_CONFIG_TOTAL_LEN];
+static void const* _hid_desc_configuration_arr[CFG_TUD_HUB_PORT][1];
+static tud_desc_template_t _hid_desc_template[CFG_TUD_HUB_PORT];
+
+uint8_t const* tud_hid_descriptor_report_cb(uint8_t instance) {
+  (void) instance;
+  return _hid_report_desc;
+}
+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer,
+                               uint16_t reqlen) {
+  (void) instance; (void) report_id; (void) report_type; (void) buffer; (void) reqlen;
+  return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer,
+                           uint16_t bufsize) {
+  (void) instance; (void) report_id; (void) report_type; (void) buffer; (void) bufsize;
+}
+
+bool hid_port_bind(uint8_t port) {
+  TU_VERIFY(port >= 1 && port <= CFG_TUD_HUB_PORT);
+  uint8_t* config = _hid_desc_configuration[port - 1];
+  memcpy(config, hid_port_desc_configuration, HID_PORT_CONFIG_TOTAL_LEN);
+
+  for (uint8_t* p = config; p < config + HID_PORT_CONFIG_TOTAL_LEN; p = (uint8_t*) (uintptr_t) tu_desc_next(p)) {
+    if (tu_desc_type(p) == TUSB_DESC_ENDPOINT) ((tusb_desc_endpoint_t*) p)->bEndpointAddress = HID_PORT_EPIN_N(port);
+  }
+
+  _hid_desc_configuration_arr[port - 1][0] = config;
+  _hid_desc_template[port - 1] = (tud_desc_template_t) {
+    .device              = &_hid_desc_device,
+    .configuration       = _hid_desc_configuration_arr[port - 1],
+    .configuration_count = 1,
+    .string              = _hid_desc_string_arr,
+    .string_count        = TU_ARRAY_SIZE(_hid_desc_string_arr),
+  };
+
+  uint8_t const pool = tud_desc_pool_new_template(&_hid_desc_template[port - 1]);
+  return pool != TUD_DESC_POOL_INVALID && tud_desc_pool_bind(port, pool);
+}
@@ -0,0 +1,47 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef HID_PORT_H_
+#define HID_PORT_H_
+
+#include "tusb.h"
+
+// Generic in/out HID function to plug on downstream ports of the hub in host tests
+
+#define HID_PORT_EPIN_N(_port)  ((uint8_t) (0x81 + (_port))) // endpoint numbers are unique across hub and ports
+#define HID_PORT_EPIN           HID_PORT_EPIN_N(1)
+#define HID_PORT_EPSIZE         64
+#define HID_PORT_PID            0x4004
+
+// Descriptors of the function on port 1, configuration is returned as the host reads it
+extern uint8_t const hid_port_desc_configuration[];
+extern uint16_t const hid_port_desc_configuration_len;
+
+// Bind descriptors to a downstream port, must be called after tusb_init(). Function on each port has its own
+// endpoint HID_PORT_EPIN_N(port), HID instance is assigned by the order in which ports are configured.
+bool hid_port_bind(uint8_t port);
+
+#endif
@@ -0,0 +1,385 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <time.h>
+
+#define USBD_MOCK_IMPL
+#include "usbd_mock.h"
+
+#define MOCK_EVENT_DEPTH   64
+
+typedef struct {
+  bool opened;
+  bool busy;
+  bool done;     // completed, busy until completion is dispatched
+  bool claimed;
+  bool stalled;
+  bool isr;
+  uint16_t mps;
+  uint8_t* buffer;
+  tu_fifo_t* ff;
+  uint16_t total_len;
+  uint16_t actual_len;
+} mock_edpt_t;
+
+typedef struct {
+  osal_task_func_t func; // NULL for transfer complete
+  void* param;
+  uint8_t ep_addr;
+  uint32_t len;
+} mock_event_t;
+
+static struct {
+  usbd_mock_driver_t const* driver;
+  tusb_speed_t speed;
+  bool xfer_fifo;
+  uint32_t sof_consumers;
+
+  mock_edpt_t ep[TUP_DCD_ENDPOINT_MAX][2];
+
+  mock_event_t event[MOCK_EVENT_DEPTH];
+  uint32_t event_rd;
+  uint32_t event_wr;
+
+  void const* ctrl_data;
+  uint16_t ctrl_len;
+
+  bool in_isr;     // driver's xfer_isr_cb is running
+  uint32_t isr_ts; // timestamp of completion dispatched to xfer_isr_cb
+
+  usbd_mock_stats_t stats;
+} _mock;
+
+TU_ATTR_ALWAYS_INLINE static inline mock_edpt_t* edpt_get(uint8_t ep_addr) {
+  return &_mock.ep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+static void event_push(mock_event_t const* ev) {
+  TU_ASSERT(_mock.event_wr - _mock.event_rd < MOCK_EVENT_DEPTH, );
+  _mock.event[_mock.event_wr++ % MOCK_EVENT_DEPTH] = *ev;
+}
+
+static void edpt_release(mock_edpt_t* ep) {
+  ep->busy    = false;
+  ep->done    = false;
+  ep->claimed = false;
+}
+
+// Like usbd: endpoint stays busy until completion is dispatched to driver
+static void xfer_complete(uint8_t ep_addr, mock_edpt_t* ep) {
+  _mock.stats.completes++;
+
+  if (ep->isr && _mock.driver->xfer_isr_cb) {
+#if CFG_TUSB_TRACE
+    _mock.isr_ts = CFG_TUSB_TRACE_TIMESTAMP();
+#endif
+    edpt_release(ep);
+    _mock.in_isr = true;
+    bool const handled = _mock.driver->xfer_isr_cb(0, ep_addr, XFER_RESULT_SUCCESS, ep->actual_len);
+    _mock.in_isr = false;
+    if (handled) return;
+  }
+
+  ep->done = true;
+  mock_event_t const ev = { .func = NULL, .ep_addr = ep_addr, .len = ep->actual_len };
+  event_push(&ev);
+}
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+
+void usbd_mock_init(usbd_mock_driver_t const* driver, tusb_speed_t speed, bool xfer_fifo) {
+  tu_memclr(&_mock, sizeof(_mock));
+  _mock.driver    = driver;
+  _mock.speed     = speed;
+  _mock.xfer_fifo = xfer_fifo;
+}
+
+bool usbd_mock_host_out(uint8_t ep_addr, void const* data, uint16_t len) {
+  mock_edpt_t* ep = edpt_get(ep_addr);
+  if (!ep->busy || ep->done || ep->stalled) {
+    _mock.stats.naks++;
+    return false;
+  }
+
+  uint16_t const n = tu_min16(len, (uint16_t) (ep->total_len - ep->actual_len));
+  if (ep->ff) {
+    tu_fifo_write_n(ep->ff, data, n);
+  } else {
+    memcpy(ep->buffer + ep->actual_len, data, n);
+  }
+  ep->actual_len += n;
+  _mock.stats.packets++;
+
+  if (len < ep->mps || ep->actual_len == ep->total_len) xfer_complete(ep_addr, ep);
+  return true;
+}
+
+int32_t usbd_mock_host_in(uint8_t ep_addr, void* data, uint16_t len) {
+  mock_edpt_t* ep = edpt_get(ep_addr);
+  if (!ep->busy || ep->done || ep->stalled) {
+    _mock.stats.naks++;
+    return -1;
+  }
+
+  uint16_t const n = tu_min16(tu_min16(len, ep->mps), (uint16_t) (ep->total_len - ep->actual_len));
+  if (ep->ff) {
+    tu_fifo_read_n(ep->ff, data, n);
+  } else {
+    memcpy(data, ep->buffer + ep->actual_len, n);
+  }
+  ep->actual_len += n;
+  _mock.stats.packets++;
+
+  if (n < ep->mps || ep->actual_len == ep->total_len) xfer_complete(ep_addr, ep);
+  return n;
+}
+
+void usbd_mock_sof(uint32_t frame_count) {
+  if (_mock.sof_consumers && _mock.driver->sof) _mock.driver->sof(0, frame_count);
+}
+
+uint32_t usbd_mock_task(void) {
+  uint32_t count = 0;
+  while (_mock.event_rd != _mock.event_wr) {
+    mock_event_t const ev = _mock.event[_mock.event_rd++ % MOCK_EVENT_DEPTH];
+    if (ev.func) {
+      ev.func(ev.param);
+    } else {
+      mock_edpt_t* ep = edpt_get(ev.ep_addr);
+      if (ep->done) edpt_release(ep);
+      _mock.driver->xfer_cb(0, ev.ep_addr, XFER_RESULT_SUCCESS, ev.len);
+    }
+    count++;
+  }
+  return count;
+}
+
+bool usbd_mock_edpt_armed(uint8_t ep_addr) {
+  mock_edpt_t const* ep = edpt_get(ep_addr);
+  return ep->busy && !ep->done;
+}
+
+uint8_t const* usbd_mock_edpt_buffer(uint8_t ep_addr) {
+  return edpt_get(ep_addr)->buffer;
+}
+
+uint16_t usbd_mock_control_data(void const** data) {
+  *data = _mock.ctrl_data;
+  return _mock.ctrl_len;
+}
+
+void usbd_mock_stats_get(usbd_mock_stats_t* stats) {
+  *stats = _mock.stats;
+}
+
+void usbd_mock_stats_clear(void) {
+  tu_memclr(&_mock.stats, sizeof(_mock.stats));
+}
+
+uint64_t usbd_mock_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+uint32_t tusb_time_millis_api(void) {
+  return (uint32_t) (usbd_mock_time_ns() / 1000000u);
+}
+
+//--------------------------------------------------------------------+
+// Device stack API used by class drivers
+//--------------------------------------------------------------------+
+
+bool tud_mounted(uint8_t port_num) {
+  (void) port_num;
+  return _mock.driver != NULL;
+}
+
+bool tud_suspended(uint8_t port_num) {
+  (void) port_num;
+  return false;
+}
+
+bool tud_connected(uint8_t port_num) {
+  (void) port_num;
+  return _mock.driver != NULL;
+}
+
+tusb_speed_t tud_speed_get(uint8_t port_num) {
+  (void) port_num;
+  return _mock.speed;
+}
+
+bool tud_control_xfer(uint8_t rhport, uint8_t port_num, tusb_control_request_t const* request, void* buffer,
+                      uint16_t len) {
+  (void) rhport; (void) port_num; (void) request;
+  _mock.ctrl_data = buffer;
+  _mock.ctrl_len  = len;
+  return true;
+}
+
+bool tud_control_status(uint8_t rhport, uint8_t port_num, tusb_control_request_t const* request) {
+  return tud_control_xfer(rhport, port_num, request, NULL, 0);
+}
+
+bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+  TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < TUP_DCD_ENDPOINT_MAX);
+
+  mock_edpt_t* ep = edpt_get(desc_ep->bEndpointAddress);
+  tu_memclr(ep, sizeof(mock_edpt_t));
+  ep->opened = true;
+  ep->mps    = tu_edpt_packet_size(desc_ep);
+  return true;
+}
+
+void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  tu_memclr(edpt_get(ep_addr), sizeof(mock_edpt_t));
+}
+
+bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
+  (void) rhport; (void) ep_addr; (void) largest_packet_size;
+  return true;
+}
+
+bool usbd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  return usbd_edpt_open(rhport, desc_ep);
+}
+
+bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out,
+                         uint8_t* ep_in) {
+  for (uint8_t i = 0; i < ep_count; i++) {
+    tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+    TU_ASSERT(TUSB_DESC_ENDPOINT == desc_ep->bDescriptorType && xfer_type == desc_ep->bmAttributes.xfer);
+    TU_ASSERT(usbd_edpt_open(rhport, desc_ep));
+
+    if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN) {
+      *ep_in = desc_ep->bEndpointAddress;
+    } else {
+      *ep_out = desc_ep->bEndpointAddress;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+  return true;
+}
+
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  mock_edpt_t* ep = edpt_get(ep_addr);
+  if (_mock.in_isr) _mock.stats.isr_claims++;
+  TU_VERIFY(!ep->busy && !ep->claimed);
+  ep->claimed = true;
+  return true;
+}
+
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  mock_edpt_t* ep = edpt_get(ep_addr);
+  TU_VERIFY(!ep->busy && ep->claimed);
+  ep->claimed = false;
+  return true;
+}
+
+static bool edpt_xfer(uint8_t ep_addr, uint8_t* buffer, tu_fifo_t* ff, uint16_t total_bytes) {
+  mock_edpt_t* ep = edpt_get(ep_addr);
+  TU_ASSERT(ep->opened && !ep->busy);
+
+  ep->busy       = true;
+  ep->buffer     = buffer;
+  ep->ff         = ff;
+  ep->total_len  = total_bytes;
+  ep->actual_len = 0;
+  _mock.stats.xfers++;
+
+  // zero length IN completes with the next token, zero length OUT right away
+  if (total_bytes == 0 && tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) xfer_complete(ep_addr, ep);
+  return true;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+  (void) rhport;
+  return edpt_xfer(ep_addr, buffer, NULL, total_bytes);
+}
+
+bool usbd_edpt_xfer_fifo_supported(void) {
+  return _mock.xfer_fifo;
+}
+
+bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+  (void) rhport;
+  TU_VERIFY(_mock.xfer_fifo);
+  return edpt_xfer(ep_addr, NULL, ff, total_bytes);
+}
+
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  return edpt_get(ep_addr)->busy;
+}
+
+void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  mock_edpt_t* ep = edpt_get(ep_addr);
+  ep->stalled = true;
+  ep->busy    = false;
+}
+
+void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  edpt_get(ep_addr)->stalled = false;
+}
+
+bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  return edpt_get(ep_addr)->stalled;
+}
+
+uint32_t usbd_xfer_isr_timestamp(void) {
+  return _mock.isr_ts;
+}
+
+bool usbd_edpt_isr_set(uint8_t rhport, uint8_t ep_addr, bool enabled) {
+  (void) rhport;
+  edpt_get(ep_addr)->isr = enabled;
+  return true;
+}
+
+void usbd_sof_enable(uint8_t rhport, sof_consumer_t consumer, bool en) {
+  (void) rhport;
+  if (en) {
+    _mock.sof_consumers |= TU_BIT(consumer);
+  } else {
+    _mock.sof_consumers &= ~TU_BIT(consumer);
+  }
+}
+
+void usbd_defer_func(osal_task_func_t func, void* param, bool in_isr) {
+  (void) in_isr;
+  mock_event_t const ev = { .func = func, .param = param };
+  event_push(&ev);
+}
@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef USBD_MOCK_H_
+#define USBD_MOCK_H_
+
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+
+// Stand-in for usbd.c to run a single class driver with its upstream (rhport only) callbacks, without controller.
+// Host side moves packets in and out of the transfers queued by the driver, completions are delivered to the driver
+// by usbd_mock_task() as tud_task() would, or right away from "ISR" for endpoints enabled with usbd_edpt_isr_set().
+
+typedef struct {
+  bool (*xfer_cb    )(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+  bool (*xfer_isr_cb)(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes); // optional
+  void (*sof        )(uint8_t rhport, uint32_t frame_count);                                         // optional
+} usbd_mock_driver_t;
+
+typedef struct {
+  uint32_t xfers;      // transfers queued by driver
+  uint32_t packets;    // packets moved by host
+  uint32_t naks;       // host packets refused since endpoint is not armed
+  uint32_t completes;  // transfer completions
+  uint32_t isr_claims; // endpoint claims from xfer_isr_cb, usbd takes its mutex there
+} usbd_mock_stats_t;
+
+// Device is mounted at given speed, xfer_fifo tells whether usbd_edpt_xfer_fifo() is supported
+void usbd_mock_init(usbd_mock_driver_t const* driver, tusb_speed_t speed, bool xfer_fifo);
+
+// Host sends one packet to OUT endpoint, false if endpoint is not armed (NAK) or stalled
+bool usbd_mock_host_out(uint8_t ep_addr, void const* data, uint16_t len);
+
+// Host receives one packet from IN endpoint, return its length or -1 if endpoint is not armed (NAK) or stalled
+int32_t usbd_mock_host_in(uint8_t ep_addr, void* data, uint16_t len);
+
+// Start of frame for enabled consumers
+void usbd_mock_sof(uint32_t frame_count);
+
+// Invoke driver for completed transfers and deferred functions, return number of events processed
+uint32_t usbd_mock_task(void);
+
+// Transfer queued and not completed
+bool usbd_mock_edpt_armed(uint8_t ep_addr);
+
+// Buffer of the transfer queued on endpoint, NULL for usbd_edpt_xfer_fifo()
+uint8_t const* usbd_mock_edpt_buffer(uint8_t ep_addr);
+
+// Data stage of last tud_control_xfer()
+uint16_t usbd_mock_control_data(void const** data);
+
+void usbd_mock_stats_get(usbd_mock_stats_t* stats);
+void usbd_mock_stats_clear(void);
+
+// Monotonic time in nanoseconds
+uint64_t usbd_mock_time_ns(void);
+
+#endif
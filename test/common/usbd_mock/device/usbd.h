@@ -0,0 +1,42 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Shadows device/usbd.h for class drivers that are not ported to the per-port driver API yet: their calls to the
+// single device API (tud_ready(), tud_control_xfer() without port number ...) are mapped to port 0. Only for tests
+// built with USBD_MOCK, see usbd_mock.h
+
+#include_next "device/usbd.h"
+
+#ifndef USBD_MOCK_IMPL
+
+#define tud_ready()                                  tud_ready(0)
+#define tud_mounted()                                tud_mounted(0)
+#define tud_suspended()                              tud_suspended(0)
+#define tud_speed_get()                              tud_speed_get(0)
+#define tud_control_xfer(_rhport, _req, _buf, _len)  tud_control_xfer(_rhport, 0, _req, _buf, _len)
+#define tud_control_status(_rhport, _req)            tud_control_status(_rhport, 0, _req)
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <string.h>
+#include <time.h>
+
+#include "vhost.h"
+#include "class/hub/hub.h"
+
+// consecutive NAKs before a transfer is given up
+#define VHOST_NAK_LIMIT   100000u
+
+typedef struct {
+  uint8_t  pid;
+  uint8_t  ep_addr;
+  uint8_t  seq;
+  uint8_t  gen;
+  uint16_t len;
+} vhost_token_t;
+
+typedef struct {
+  vhost_token_t token[CFG_TUD_VIRTUAL_RING_DEPTH];
+  uint8_t token_rd;
+  uint8_t token_count;
+
+  uint8_t out_seq[TUP_DCD_ENDPOINT_MAX]; // next OUT sequence of each endpoint number
+  uint8_t ep0_mps[128];                  // per device address, 0 is unknown
+
+  dcd_virtual_packet_t tx;
+  dcd_virtual_packet_t rx;
+
+  vhost_stats_t stats;
+} vhost_t;
+
+static vhost_t _vh;
+
+//--------------------------------------------------------------------+
+// Time
+//--------------------------------------------------------------------+
+
+uint64_t vhost_time_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u;
+}
+
+uint32_t tusb_time_millis_api(void) {
+  return (uint32_t) (vhost_time_us() / 1000u);
+}
+
+#if CFG_TUSB_TRACE
+uint32_t tu_trace_timestamp_cb(void) {
+  return (uint32_t) vhost_time_us();
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Tokens
+//--------------------------------------------------------------------+
+
+void vhost_pump(void) {
+  _vh.stats.pumps++;
+  tud_int_handler(0);
+  tud_task();
+}
+
+static bool packet_send(dcd_virtual_pid_t pid, uint8_t dev_addr, uint8_t ep_addr, uint8_t seq,
+                        void const* data, uint16_t len) {
+  dcd_virtual_packet_t* pkt = &_vh.tx;
+  pkt->pid      = (uint8_t) pid;
+  pkt->dev_addr = dev_addr;
+  pkt->ep_addr  = ep_addr;
+  pkt->seq      = seq;
+  pkt->len      = len;
+  if (data && len) memcpy(pkt->data, data, len);
+
+  // ring only fills up if device is not pumped
+  while (!dcd_virtual_host_send(0, pkt)) vhost_pump();
+  return true;
+}
+
+static bool token_send(dcd_virtual_pid_t pid, uint8_t dev_addr, uint8_t ep_addr, uint8_t seq, uint8_t gen,
+                       void const* data, uint16_t len) {
+  TU_VERIFY(_vh.token_count < CFG_TUD_VIRTUAL_RING_DEPTH);
+  packet_send(pid, dev_addr, ep_addr, seq, data, len);
+
+  vhost_token_t* tok = &_vh.token[(_vh.token_rd + _vh.token_count) % CFG_TUD_VIRTUAL_RING_DEPTH];
+  tok->pid     = (uint8_t) pid;
+  tok->ep_addr = ep_addr;
+  tok->seq     = seq;
+  tok->gen     = gen;
+  tok->len     = len;
+  _vh.token_count++;
+  _vh.stats.tokens++;
+
+  return true;
+}
+
+// Get reply to the oldest token in flight, device is pumped until it answers
+static void reply_get(vhost_token_t* tok, dcd_virtual_packet_t* pkt) {
+  while (1) {
+    if (dcd_virtual_host_receive(0, pkt)) {
+      if (pkt->pid == DCD_VIRTUAL_PID_WAKEUP) {
+        _vh.stats.wakeups++;
+        continue;
+      }
+      break;
+    }
+    vhost_pump();
+  }
+
+  *tok = _vh.token[_vh.token_rd];
+  _vh.token_rd = (uint8_t) ((_vh.token_rd + 1) % CFG_TUD_VIRTUAL_RING_DEPTH);
+  _vh.token_count--;
+
+  if (pkt->pid == DCD_VIRTUAL_PID_NAK) _vh.stats.naks++;
+}
+
+// Discard replies of tokens left in flight by an aborted transfer
+static void reply_drain(void) {
+  vhost_token_t tok;
+  while (_vh.token_count) reply_get(&tok, &_vh.rx);
+}
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+void vhost_bus_reset(tusb_speed_t speed) {
+  uint8_t const data = (uint8_t) speed;
+  packet_send(DCD_VIRTUAL_PID_RESET, 0, 0, 0, &data, 1);
+  memset(_vh.out_seq, 0, sizeof(_vh.out_seq));
+  memset(_vh.ep0_mps, 0, sizeof(_vh.ep0_mps));
+  vhost_pump();
+}
+
+void vhost_bus_signal(dcd_virtual_pid_t pid, uint16_t frame) {
+  packet_send(pid, 0, 0, 0, NULL, frame);
+}
+
+void vhost_init(tusb_speed_t speed) {
+  memset(&_vh, 0, sizeof(_vh));
+
+  tusb_rhport_init_t const dev_init = { .role = TUSB_ROLE_DEVICE, .speed = speed };
+  tusb_init(0, &dev_init);
+  configure_hub();
+
+  vhost_bus_reset(speed);
+}
+
+void vhost_stats_get(vhost_stats_t* stats) {
+  *stats = _vh.stats;
+}
+
+void vhost_stats_clear(void) {
+  memset(&_vh.stats, 0, sizeof(_vh.stats));
+}
+
+//--------------------------------------------------------------------+
+// Control Transfer
+//--------------------------------------------------------------------+
+
+// One control stage token, resent while NAKed. Return reply pid or VHOST_TIMEOUT
+static int32_t ctrl_token(dcd_virtual_pid_t pid, uint8_t dev_addr, uint8_t ep_addr, uint8_t seq,
+                          void const* data, uint16_t len) {
+  vhost_token_t tok;
+  for (uint32_t nak = 0; nak < VHOST_NAK_LIMIT; nak++) {
+    token_send(pid, dev_addr, ep_addr, seq, 0, data, len);
+    reply_get(&tok, &_vh.rx);
+    if (_vh.rx.pid != DCD_VIRTUAL_PID_NAK) return _vh.rx.pid;
+  }
+  return VHOST_TIMEOUT;
+}
+
+int32_t vhost_control(uint8_t dev_addr, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                      uint16_t wLength, void* data) {
+  tusb_control_request_t const setup = {
+    .bmRequestType = bmRequestType,
+    .bRequest      = bRequest,
+    .wValue        = tu_htole16(wValue),
+    .wIndex        = tu_htole16(wIndex),
+    .wLength       = tu_htole16(wLength)
+  };
+  uint16_t const mps = _vh.ep0_mps[dev_addr & 0x7F] ? _vh.ep0_mps[dev_addr & 0x7F] : CFG_TUD_ENDPOINT0_SIZE;
+  bool const data_in = bmRequestType & TUSB_DIR_IN_MASK;
+  uint8_t* buf = (uint8_t*) data;
+  int32_t pid;
+
+  pid = ctrl_token(DCD_VIRTUAL_PID_SETUP, dev_addr, 0, 0, &setup, 8);
+  if (pid != DCD_VIRTUAL_PID_ACK) return (pid == VHOST_TIMEOUT) ? VHOST_TIMEOUT : VHOST_STALL;
+
+  // data stage
+  uint16_t actual = 0;
+  uint8_t seq = 0;
+  while (actual < wLength) {
+    if (data_in) {
+      pid = ctrl_token(DCD_VIRTUAL_PID_IN, dev_addr, TUSB_DIR_IN_MASK, 0, NULL, 0);
+      if (pid != DCD_VIRTUAL_PID_DATA) break;
+
+      uint16_t const len = tu_min16(_vh.rx.len, (uint16_t) (wLength - actual));
+      memcpy(buf + actual, _vh.rx.data, len);
+      actual += len;
+      if (_vh.rx.len < mps) break;
+    } else {
+      uint16_t const len = tu_min16(mps, (uint16_t) (wLength - actual));
+      pid = ctrl_token(DCD_VIRTUAL_PID_OUT, dev_addr, 0, seq, buf + actual, len);
+      if (pid != DCD_VIRTUAL_PID_ACK) break;
+      actual += len;
+      seq++;
+    }
+  }
+  if (wLength && pid != DCD_VIRTUAL_PID_DATA && pid != DCD_VIRTUAL_PID_ACK) {
+    return (pid == VHOST_TIMEOUT) ? VHOST_TIMEOUT : VHOST_STALL;
+  }
+
+  // status stage in opposite direction, IN if there is no data stage
+  if (data_in && wLength) {
+    pid = ctrl_token(DCD_VIRTUAL_PID_OUT, dev_addr, 0, seq, NULL, 0);
+    if (pid != DCD_VIRTUAL_PID_ACK) return (pid == VHOST_TIMEOUT) ? VHOST_TIMEOUT : VHOST_STALL;
+  } else {
+    pid = ctrl_token(DCD_VIRTUAL_PID_IN, dev_addr, TUSB_DIR_IN_MASK, 0, NULL, 0);
+    if (pid != DCD_VIRTUAL_PID_DATA) return (pid == VHOST_TIMEOUT) ? VHOST_TIMEOUT : VHOST_STALL;
+  }
+
+  return actual;
+}
+
+//--------------------------------------------------------------------+
+// Bulk & Interrupt Transfer
+//--------------------------------------------------------------------+
+
+int32_t vhost_out(uint8_t dev_addr, uint8_t ep_addr, void const* data, uint32_t len, uint16_t mps) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const* buf = (uint8_t const*) data;
+  uint32_t const count = len ? (len + mps - 1) / mps : 1;
+
+  // packet i is sent with sequence (first_seq + i)
+  uint8_t first_seq = _vh.out_seq[epnum];
+  uint32_t sent = 0;
+  uint32_t acked = 0;
+  uint32_t nak = 0;
+  uint8_t gen = 0;
+  vhost_token_t tok;
+
+  while (acked < count) {
+    while (sent < count && _vh.token_count < CFG_TUD_VIRTUAL_RING_DEPTH) {
+      uint32_t const offset = sent * mps;
+      uint16_t const plen = (uint16_t) tu_min32(mps, len - offset);
+      token_send(DCD_VIRTUAL_PID_OUT, dev_addr, epnum, (uint8_t) (first_seq + sent), gen, buf + offset, plen);
+      sent++;
+    }
+
+    reply_get(&tok, &_vh.rx);
+    if (tok.gen != gen || tok.seq != (uint8_t) (first_seq + acked)) continue; // follows an already handled NAK
+
+    if (_vh.rx.pid == DCD_VIRTUAL_PID_ACK) {
+      acked++;
+      nak = 0;
+    } else if (_vh.rx.pid == DCD_VIRTUAL_PID_STALL) {
+      reply_drain();
+      return VHOST_STALL;
+    } else {
+      if (++nak > VHOST_NAK_LIMIT) {
+        reply_drain();
+        return VHOST_TIMEOUT;
+      }
+      // rewind to the packet device is waiting for, with its sequence
+      first_seq = (uint8_t) (_vh.rx.seq - acked);
+      sent = acked;
+      gen++;
+    }
+  }
+
+  reply_drain();
+  _vh.out_seq[epnum] = (uint8_t) (first_seq + count);
+  return (int32_t) len;
+}
+
+int32_t vhost_in(uint8_t dev_addr, uint8_t ep_addr, void* data, uint32_t len, uint16_t mps) {
+  uint8_t* buf = (uint8_t*) data;
+  uint32_t actual = 0;
+  uint32_t in_flight = 0;
+  uint32_t nak = 0;
+  int32_t result = VHOST_TIMEOUT;
+  vhost_token_t tok;
+
+  while (1) {
+    // no more tokens than packets still expected
+    uint32_t const remain = len - actual;
+    uint32_t const wanted = remain ? (remain + mps - 1) / mps : 1;
+    while (in_flight < wanted && _vh.token_count < CFG_TUD_VIRTUAL_RING_DEPTH) {
+      token_send(DCD_VIRTUAL_PID_IN, dev_addr, ep_addr | TUSB_DIR_IN_MASK, 0, 0, NULL, 0);
+      in_flight++;
+    }
+
+    reply_get(&tok, &_vh.rx);
+    in_flight--;
+
+    if (_vh.rx.pid == DCD_VIRTUAL_PID_DATA) {
+      uint16_t const plen = (uint16_t) tu_min32(_vh.rx.len, len - actual);
+      memcpy(buf + actual, _vh.rx.data, plen);
+      actual += plen;
+      nak = 0;
+      if (_vh.rx.len < mps || actual >= len) {
+        result = (int32_t) actual;
+        break;
+      }
+    } else if (_vh.rx.pid == DCD_VIRTUAL_PID_STALL) {
+      result = VHOST_STALL;
+      break;
+    } else if (++nak > VHOST_NAK_LIMIT) {
+      break;
+    }
+  }
+
+  reply_drain();
+  return result;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool vhost_enumerate(uint8_t new_addr, uint8_t* config, uint16_t config_size) {
+  tusb_desc_device_t desc_device;
+
+  TU_VERIFY(8 == vhost_control(0, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0, 8, &desc_device));
+  _vh.ep0_mps[0] = desc_device.bMaxPacketSize0;
+
+  TU_VERIFY(0 == vhost_control(0, 0x00, TUSB_REQ_SET_ADDRESS, new_addr, 0, 0, NULL));
+  _vh.ep0_mps[new_addr] = desc_device.bMaxPacketSize0;
+  _vh.ep0_mps[0] = 0;
+
+  TU_VERIFY(sizeof(desc_device) == vhost_control(new_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0,
+                                                 sizeof(desc_device), &desc_device));
+
+  TU_VERIFY(9 == vhost_control(new_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0, 9, config));
+  uint16_t const total_len = tu_le16toh(((tusb_desc_configuration_t const*) config)->wTotalLength);
+  TU_VERIFY(total_len <= config_size);
+  TU_VERIFY(total_len == vhost_control(new_addr, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0,
+                                       total_len, config));
+
+  uint8_t const cfg_value = ((tusb_desc_configuration_t const*) config)->bConfigurationValue;
+  TU_VERIFY(0 == vhost_control(new_addr, 0x00, TUSB_REQ_SET_CONFIGURATION, cfg_value, 0, 0, NULL));
+
+  return true;
+}
+
+bool vhost_hub_port_attach(uint8_t hub_addr, uint8_t port) {
+  TU_VERIFY(0 == vhost_control(hub_addr, 0x23, HUB_REQUEST_SET_FEATURE, HUB_FEATURE_PORT_POWER, port, 0, NULL));
+  TU_VERIFY(0 == vhost_control(hub_addr, 0x23, HUB_REQUEST_SET_FEATURE, HUB_FEATURE_PORT_RESET, port, 0, NULL));
+
+  // hub reports the reset completion on its status change endpoint
+  uint8_t change;
+  TU_VERIFY(1 == vhost_in(hub_addr, 0x81, &change, 1, 1));
+
+  return true;
+}
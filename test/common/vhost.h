@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef VHOST_H_
+#define VHOST_H_
+
+#include "tusb.h"
+#include "portable/virtual/dcd_virtual.h"
+
+// Synchronous fake host for the virtual controller (OPT_MCU_VIRTUAL). Device stack runs in the calling thread:
+// while waiting for replies the host pumps the device with tud_int_handler() and tud_task(). Transfers keep up to
+// CFG_TUD_VIRTUAL_RING_DEPTH tokens in flight and resend NAKed packets, like a host controller does.
+
+enum {
+  VHOST_STALL   = -1,
+  VHOST_TIMEOUT = -2,
+};
+
+typedef struct {
+  uint32_t tokens;  // tokens sent
+  uint32_t naks;    // NAK replies
+  uint32_t wakeups; // remote wakeup signals seen
+  uint32_t pumps;   // device task rounds
+} vhost_stats_t;
+
+// Init device stack on the virtual controller and hub descriptors
+void vhost_init(tusb_speed_t speed);
+
+// Run device interrupt handler and task once
+void vhost_pump(void);
+
+// Bus signals, delivered with the next pump
+void vhost_bus_reset(tusb_speed_t speed);
+void vhost_bus_signal(dcd_virtual_pid_t pid, uint16_t frame);
+
+// Control transfer, return data stage length or VHOST_STALL/VHOST_TIMEOUT
+int32_t vhost_control(uint8_t dev_addr, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                      uint16_t wLength, void* data);
+
+// Bulk/interrupt transfers, return transferred length or VHOST_STALL/VHOST_TIMEOUT.
+// IN stops on a short packet, only as many IN tokens as len needs are sent so that data of a following
+// transfer is never taken
+int32_t vhost_out(uint8_t dev_addr, uint8_t ep_addr, void const* data, uint32_t len, uint16_t mps);
+int32_t vhost_in(uint8_t dev_addr, uint8_t ep_addr, void* data, uint32_t len, uint16_t mps);
+
+// Address and configure a device at address 0, config buffer receives the full configuration descriptor
+bool vhost_enumerate(uint8_t new_addr, uint8_t* config, uint16_t config_size);
+
+// Power and reset a downstream port of the hub, device on it then answers address 0
+bool vhost_hub_port_attach(uint8_t hub_addr, uint8_t port);
+
+void vhost_stats_get(vhost_stats_t* stats);
+void vhost_stats_clear(void);
+
+// Monotonic time in microseconds, also provides tusb_time_millis_api() and, with CFG_TUSB_TRACE, tu_trace_timestamp_cb()
+uint64_t vhost_time_us(void);
+
+#endif
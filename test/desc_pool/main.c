@@ -0,0 +1,316 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Unit test of the descriptor pool (device/usbd_desc.c), built into this file to reach the hash table: colliding
+// keys, removal leaving tombstones in probe chains and re-insert, content sharing with reference counts, reuse of
+// arena space, and exhaustion of pools, entries and arena. Run with: make run
+
+#include <stdio.h>
+#include <string.h>
+
+#include "device/usbd_desc.c"
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+// String descriptor "<tag>" of 2 + 2*len bytes
+static void string_make(uint8_t* desc, char tag, uint8_t len) {
+  desc[0] = (uint8_t) (2 + 2*len);
+  desc[1] = TUSB_DESC_STRING;
+  for (uint8_t i = 0; i < len; i++) {
+    desc[2 + 2*i] = (uint8_t) tag;
+    desc[3 + 2*i] = 0;
+  }
+}
+
+static bool string_check(uint8_t pool, uint8_t index, char tag, uint8_t len) {
+  uint8_t expected[2 + 2*STRING_CHAR_MAX];
+  uint16_t got_len = 0;
+  string_make(expected, tag, len);
+
+  uint8_t const* desc = tud_desc_pool_get(pool, TUSB_DESC_STRING, index, 0, &got_len);
+  CHECK(desc != NULL);
+  CHECK(got_len == expected[0]);
+  CHECK(0 == memcmp(desc, expected, got_len));
+  return true;
+}
+
+static bool string_add(uint8_t pool, uint8_t index, char tag, uint8_t len) {
+  uint8_t desc[2 + 2*STRING_CHAR_MAX];
+  string_make(desc, tag, len);
+  return tud_desc_pool_add(pool, index, 0, desc);
+}
+
+// String indexes of pool whose keys hash to the same slot, return how many were found
+static uint8_t colliding_find(uint8_t pool, uint8_t* index, uint8_t count) {
+  uint16_t const target = slot_hash(pool, TUSB_DESC_STRING, 0, 0);
+  uint8_t n = 0;
+  index[n++] = 0;
+  for (uint16_t i = 1; i < 256 && n < count; i++) {
+    if (slot_hash(pool, TUSB_DESC_STRING, (uint8_t) i, 0) == target) index[n++] = (uint8_t) i;
+  }
+  return n;
+}
+
+static void pool_reset(void) {
+  for (uint8_t p = 0; p < CFG_TUD_DESC_POOL_COUNT; p++) tud_desc_pool_delete(p);
+}
+
+static bool pool_empty(void) {
+  tud_desc_pool_stats_t stats;
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.entries == 0 && stats.blobs == 0 && stats.arena_used == 0);
+  CHECK(_desc.pool_used == 0);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+// Keys hashing to one slot are placed along the probe sequence and all found
+static bool test_collision(void) {
+  uint8_t idx[3];
+  uint8_t const pool = tud_desc_pool_new();
+  CHECK(pool == 0);
+  CHECK(colliding_find(pool, idx, 3) == 3);
+
+  CHECK(string_add(pool, idx[0], 'a', 3));
+  CHECK(string_add(pool, idx[1], 'b', 3));
+  CHECK(string_add(pool, idx[2], 'c', 3));
+
+  uint16_t const home = slot_hash(pool, TUSB_DESC_STRING, idx[0], 0);
+  CHECK(slot_find(pool, TUSB_DESC_STRING, idx[0], 0) == home);
+  CHECK(slot_find(pool, TUSB_DESC_STRING, idx[1], 0) == ((home + 1) & (SLOT_COUNT - 1)));
+  CHECK(slot_find(pool, TUSB_DESC_STRING, idx[2], 0) == ((home + 2) & (SLOT_COUNT - 1)));
+
+  CHECK(string_check(pool, idx[0], 'a', 3));
+  CHECK(string_check(pool, idx[1], 'b', 3));
+  CHECK(string_check(pool, idx[2], 'c', 3));
+
+  // same index with other type or language is another key
+  CHECK(tud_desc_pool_get(pool, TUSB_DESC_CONFIGURATION, idx[0], 0, NULL) == NULL);
+  CHECK(tud_desc_pool_get(pool + 1, TUSB_DESC_STRING, idx[0], 0, NULL) == NULL);
+
+  // string added for language 0 answers any language, a specific language wins over it
+  CHECK(string_check(pool, idx[0], 'a', 3));
+  uint8_t desc[8];
+  string_make(desc, 'd', 3);
+  CHECK(tud_desc_pool_add(pool, idx[0], 0x0407, desc));
+  CHECK(tud_desc_pool_get(pool, TUSB_DESC_STRING, idx[0], 0x0407, NULL)[2] == 'd');
+  CHECK(tud_desc_pool_get(pool, TUSB_DESC_STRING, idx[0], 0x0409, NULL)[2] == 'a');
+
+  pool_reset();
+  CHECK(pool_empty());
+  printf("colliding keys                 OK\n");
+  return true;
+}
+
+// Removing the middle of a probe chain leaves a tombstone which lookups skip and inserts reuse
+static bool test_remove_reinsert(void) {
+  uint8_t idx[3];
+  uint8_t const pool_a = tud_desc_pool_new();
+  uint8_t const pool_b = tud_desc_pool_new();
+  CHECK(pool_a != TUD_DESC_POOL_INVALID && pool_b != TUD_DESC_POOL_INVALID);
+
+  // chain of three keys of pool_a that collide, middle one is moved to pool_b's deletion below
+  CHECK(colliding_find(pool_a, idx, 3) == 3);
+  uint16_t const home = slot_hash(pool_a, TUSB_DESC_STRING, idx[0], 0);
+
+  CHECK(string_add(pool_a, idx[0], 'a', 2));
+  // pool_b key placed at the second slot of the chain
+  uint8_t idx_b = 0;
+  for (uint16_t i = 0; i < 256; i++) {
+    if (slot_hash(pool_b, TUSB_DESC_STRING, (uint8_t) i, 0) == home) {
+      idx_b = (uint8_t) i;
+      break;
+    }
+  }
+  CHECK(slot_hash(pool_b, TUSB_DESC_STRING, idx_b, 0) == home);
+  CHECK(string_add(pool_b, idx_b, 'x', 2));
+  CHECK(string_add(pool_a, idx[1], 'b', 2));
+  uint16_t const slot_x = slot_find(pool_b, TUSB_DESC_STRING, idx_b, 0);
+  CHECK(slot_x == ((home + 1) & (SLOT_COUNT - 1)));
+
+  tud_desc_pool_delete(pool_b);
+  CHECK(_desc.slot[slot_x].blob == SLOT_DELETED);
+  CHECK(tud_desc_pool_get(pool_b, TUSB_DESC_STRING, idx_b, 0, NULL) == NULL);
+
+  // lookup continues past the tombstone
+  CHECK(string_check(pool_a, idx[0], 'a', 2));
+  CHECK(string_check(pool_a, idx[1], 'b', 2));
+
+  // insert takes the tombstone, replacing keeps the slot
+  CHECK(string_add(pool_a, idx[2], 'c', 2));
+  CHECK(slot_find(pool_a, TUSB_DESC_STRING, idx[2], 0) == slot_x);
+  CHECK(string_add(pool_a, idx[2], 'C', 2));
+  CHECK(slot_find(pool_a, TUSB_DESC_STRING, idx[2], 0) == slot_x);
+  CHECK(string_check(pool_a, idx[2], 'C', 2));
+
+  tud_desc_pool_stats_t stats;
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.entries == 3 && stats.blobs == 3);
+
+  // pool number is given out again once free
+  uint8_t const pool_b2 = tud_desc_pool_new();
+  CHECK(pool_b2 == pool_b);
+  CHECK(tud_desc_pool_get(pool_b2, TUSB_DESC_STRING, idx_b, 0, NULL) == NULL);
+
+  // last descriptor gone: tombstones are dropped
+  pool_reset();
+  CHECK(pool_empty());
+  for (uint16_t i = 0; i < SLOT_COUNT; i++) CHECK(_desc.slot[i].blob == SLOT_EMPTY);
+
+  printf("removal and re-insert          OK\n");
+  return true;
+}
+
+// Identical content is stored once, arena space comes back when the last reference is gone
+static bool test_refcount(void) {
+  tud_desc_pool_stats_t stats;
+  uint8_t const p0 = tud_desc_pool_new();
+  uint8_t const p1 = tud_desc_pool_new();
+
+  CHECK(string_add(p0, 1, 's', 5));
+  CHECK(string_add(p1, 1, 's', 5));
+  CHECK(string_add(p1, 2, 's', 5));
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.entries == 3 && stats.blobs == 1);
+  CHECK(stats.arena_used == tu_round_up(12, BLOB_ALIGN));
+  CHECK(tud_desc_pool_get(p0, TUSB_DESC_STRING, 1, 0, NULL) == tud_desc_pool_get(p1, TUSB_DESC_STRING, 2, 0, NULL));
+
+  tud_desc_pool_delete(p0);
+  CHECK(string_check(p1, 1, 's', 5));
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.blobs == 1 && stats.arena_used == 12);
+
+  // replacing with identical content keeps the blob
+  CHECK(string_add(p1, 1, 's', 5));
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.entries == 2 && stats.blobs == 1);
+
+  // released blob in the middle of arena is reused by a descriptor that fits
+  CHECK(string_add(p1, 3, 't', 7));  // arena 12..28
+  CHECK(string_add(p1, 4, 'u', 3));  // arena 28..36
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.arena_used == 36);
+  CHECK(string_add(p1, 3, 's', 5));  // 't' released, hole at 12..28
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.arena_used == 36 && stats.blobs == 2);
+  CHECK(string_add(p1, 6, 'v', 2));  // takes the hole
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.arena_used == 36 && stats.blobs == 3);
+  CHECK(string_check(p1, 6, 'v', 2));
+  CHECK(string_check(p1, 4, 'u', 3));
+
+  // static descriptors take no arena and are returned in place
+  static uint8_t const str_static[] = { 4, TUSB_DESC_STRING, 'z', 0 };
+  CHECK(tud_desc_pool_add_static(p1, 5, 0, str_static));
+  CHECK(tud_desc_pool_get(p1, TUSB_DESC_STRING, 5, 0, NULL) == str_static);
+  tud_desc_pool_stats_get(&stats);
+  CHECK(stats.arena_used == 36 && stats.blobs == 4);
+
+  pool_reset();
+  CHECK(pool_empty());
+  printf("content sharing and refcount   OK\n");
+  return true;
+}
+
+static bool test_exhaustion(void) {
+  tud_desc_pool_stats_t before, after;
+
+  // pools
+  for (uint8_t p = 0; p < CFG_TUD_DESC_POOL_COUNT; p++) CHECK(tud_desc_pool_new() == p);
+  CHECK(tud_desc_pool_new() == TUD_DESC_POOL_INVALID);
+  CHECK(!string_add(CFG_TUD_DESC_POOL_COUNT, 0, 'a', 1));
+  pool_reset();
+
+  // entries: a failed add leaves no blob or arena behind
+  uint8_t const pool = tud_desc_pool_new();
+  for (uint8_t i = 0; i < CFG_TUD_DESC_POOL_ENTRIES; i++) CHECK(string_add(pool, i, 'a', 1));
+  tud_desc_pool_stats_get(&before);
+  CHECK(before.entries == CFG_TUD_DESC_POOL_ENTRIES && before.blobs == 1);
+  CHECK(!string_add(pool, CFG_TUD_DESC_POOL_ENTRIES, 'b', 1));
+  tud_desc_pool_stats_get(&after);
+  CHECK(0 == memcmp(&before, &after, sizeof(before)));
+  CHECK(string_add(pool, 0, 'b', 1)); // replacing still works when full
+  for (uint8_t i = 1; i < CFG_TUD_DESC_POOL_ENTRIES; i++) CHECK(string_check(pool, i, 'a', 1));
+  pool_reset();
+
+  // arena: fill with distinct strings, then one more must fail without changes
+  uint8_t const p = tud_desc_pool_new();
+  uint8_t n = 0;
+  while (string_add(p, n, (char) ('A' + n), STRING_CHAR_MAX)) n++;
+  tud_desc_pool_stats_get(&before);
+  CHECK(n == CFG_TUD_DESC_POOL_ARENA_SIZE / tu_round_up(2 + 2*STRING_CHAR_MAX, BLOB_ALIGN));
+  CHECK(!string_add(p, n, 'z', STRING_CHAR_MAX));
+  tud_desc_pool_stats_get(&after);
+  CHECK(0 == memcmp(&before, &after, sizeof(before)));
+  for (uint8_t i = 0; i < n; i++) CHECK(string_check(p, i, (char) ('A' + i), STRING_CHAR_MAX));
+
+  // space returns after delete
+  tud_desc_pool_delete(p);
+  CHECK(pool_empty());
+  uint8_t const p2 = tud_desc_pool_new();
+  CHECK(string_add(p2, 0, 'z', STRING_CHAR_MAX));
+
+  // template failing half way is rolled back
+  static uint8_t const dev[sizeof(tusb_desc_device_t)] = { sizeof(tusb_desc_device_t), TUSB_DESC_DEVICE };
+  static uint8_t const strings[CFG_TUD_DESC_POOL_ENTRIES + 1][4] = { { 4, TUSB_DESC_STRING, 'q', 0 } };
+  void const* string_arr[CFG_TUD_DESC_POOL_ENTRIES + 1];
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(string_arr); i++) string_arr[i] = strings[0];
+  tud_desc_template_t const tmpl = {
+    .device = dev, .string = string_arr, .string_count = TU_ARRAY_SIZE(string_arr)
+  };
+  tud_desc_pool_stats_get(&before);
+  CHECK(tud_desc_pool_new_template(&tmpl) == TUD_DESC_POOL_INVALID);
+  tud_desc_pool_stats_get(&after);
+  CHECK(0 == memcmp(&before, &after, sizeof(before)));
+  CHECK(_desc.pool_used == TU_BIT(p2));
+
+  pool_reset();
+  CHECK(pool_empty());
+  printf("exhaustion and rollback        OK\n");
+  return true;
+}
+
+int main(void) {
+  // each test starts from an empty table even if the previous one failed half way
+  bool (*const tests[])(void) = { test_collision, test_remove_reinsert, test_refcount, test_exhaustion };
+  for (size_t i = 0; i < TU_ARRAY_SIZE(tests); i++) {
+    pool_reset();
+    tests[i]();
+  }
+
+  return _fail ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#include "CentralUSB.h"
+
+#define CFG_TUSB_OS       OPT_OS_NONE
+#define CFG_TUSB_DEBUG    0
+#define CFG_TUD_ENABLED   1
+
+// small table so that collisions and exhaustion are quick to reach
+#define CFG_TUD_DESC_POOL_COUNT       4
+#define CFG_TUD_DESC_POOL_ENTRIES     16
+#define CFG_TUD_DESC_POOL_ARENA_SIZE  1024
+
+#endif
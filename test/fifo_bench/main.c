@@ -0,0 +1,181 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Throughput of tu_fifo_write_n()/tu_fifo_read_n() in bytes per cycle: power of two depth (masked index) against
+// a depth one item smaller, which takes the compare/subtract wrap-around every depth used before. VARIANT selects
+// the copy of _ff_memcpy(): libc memcpy() (64-bit default) or the word loop (32-bit default). The word variant also
+// checks that aligned runs make no memcpy() call, i.e the compiler did not turn the word loop back into one.
+// Run with: make run [ARGS=<MB per run>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "osal/osal.h"
+#include "common/tusb_fifo.h"
+
+#define FIFO_BYTES  1024
+#define REPEAT      5    // best of, against scheduling noise
+
+static TU_ATTR_ALIGNED(4) uint8_t _ff_buf[FIFO_BYTES];
+static TU_ATTR_ALIGNED(4) uint8_t _tx[FIFO_BYTES];
+static TU_ATTR_ALIGNED(4) uint8_t _rx[FIFO_BYTES];
+
+// memcpy() calls of the fifo are counted with -Wl,--wrap=memcpy
+static uint32_t _memcpy_calls;
+
+void* __real_memcpy(void* dst, void const* src, size_t n);
+void* __wrap_memcpy(void* dst, void const* src, size_t n) {
+  _memcpy_calls++;
+  return __real_memcpy(dst, src, n);
+}
+
+// cycle counter where there is one, nanoseconds otherwise
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define CYCLE_UNIT  "cycle"
+static uint64_t cycles(void) {
+  return __rdtsc();
+}
+#else
+  #define CYCLE_UNIT  "ns"
+static uint64_t cycles(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+#endif
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+// xorshift
+static uint32_t rand_next(uint32_t* s) {
+  uint32_t x = *s;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *s = x;
+  return x;
+}
+
+// Random chunk sizes through both depths, content must come back in order
+static bool check_data(uint16_t item_size) {
+  uint16_t const depths[] = { FIFO_BYTES / item_size, FIFO_BYTES / item_size - 1 };
+  uint32_t seed = 0x12345678u;
+
+  for (uint32_t d = 0; d < TU_ARRAY_SIZE(depths); d++) {
+    tu_fifo_t ff;
+    uint8_t wr_seq = 0;
+    uint8_t rd_seq = 0;
+    CHECK(tu_fifo_config(&ff, _ff_buf, depths[d], item_size, false));
+
+    for (uint32_t i = 0; i < 100000; i++) {
+      uint16_t const n = (uint16_t) (1 + rand_next(&seed) % depths[d]);
+      uint16_t const free_items = tu_fifo_remaining(&ff);
+      uint16_t const wr_n = TU_MIN(n, free_items);
+      for (uint32_t j = 0; j < (uint32_t) wr_n * item_size; j++) _tx[j] = wr_seq++;
+      CHECK(tu_fifo_write_n(&ff, _tx, wr_n) == wr_n);
+
+      uint16_t const rd_n = (uint16_t) (rand_next(&seed) % (tu_fifo_count(&ff) + 1));
+      CHECK(tu_fifo_read_n(&ff, _rx, rd_n) == rd_n);
+      for (uint32_t j = 0; j < (uint32_t) rd_n * item_size; j++) CHECK(_rx[j] == rd_seq++);
+    }
+  }
+
+  printf("item %u, random chunks            OK\n", item_size);
+  return true;
+}
+
+// Stream total bytes through the fifo in chunks, return bytes per cycle of the best of REPEAT runs
+static double stream(uint16_t depth, uint16_t item_size, uint16_t chunk_bytes, uint32_t total) {
+  tu_fifo_t ff;
+  uint16_t const n = (uint16_t) (chunk_bytes / item_size);
+  uint64_t best = UINT64_MAX;
+  tu_fifo_config(&ff, _ff_buf, depth, item_size, false);
+
+  for (uint32_t r = 0; r < REPEAT; r++) {
+    uint64_t const t0 = cycles();
+    for (uint32_t done = 0; done < total; done += chunk_bytes) {
+      tu_fifo_write_n(&ff, _tx, n);
+      tu_fifo_read_n(&ff, _rx, n);
+    }
+    uint64_t const t1 = cycles();
+    best = TU_MIN(best, t1 - t0);
+  }
+
+  return (double) total / (double) best;
+}
+
+static void bench(uint16_t item_size, uint32_t total) {
+  uint16_t const chunks[] = { 4, 16, 64, 256 };
+  uint16_t const pow2 = FIFO_BYTES / item_size;
+
+  for (uint32_t i = 0; i < TU_ARRAY_SIZE(chunks); i++) {
+    double const fast = stream(pow2, item_size, chunks[i], total);
+    double const modulo = stream((uint16_t) (pow2 - 1), item_size, chunks[i], total);
+    printf("item %u, chunk %3u bytes   depth %4u %6.3f B/" CYCLE_UNIT ", depth %4u %6.3f B/" CYCLE_UNIT ", x%.2f\n",
+           item_size, chunks[i], pow2, fast, pow2 - 1, modulo, fast / modulo);
+  }
+}
+
+#if CFG_TUSB_FIFO_WORD_COPY
+// Word copy: aligned runs of whole words, including wrap-around at a word boundary, need no memcpy()
+static bool check_word_copy(void) {
+  tu_fifo_t ff;
+  CHECK(tu_fifo_config(&ff, _ff_buf, FIFO_BYTES / 4, 4, false));
+
+  _memcpy_calls = 0;
+  for (uint32_t i = 0; i < 1000; i++) {
+    CHECK(tu_fifo_write_n(&ff, _tx, 200) == 200);
+    CHECK(tu_fifo_read_n(&ff, _rx, 200) == 200);
+  }
+  CHECK(_memcpy_calls == 0);
+
+  printf("word copy without memcpy()       OK\n");
+  return true;
+}
+#endif
+
+int main(int argc, char** argv) {
+  uint32_t const mbytes = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 8u;
+  uint32_t const total = mbytes * 1024u * 1024u;
+
+  printf("copy: " FIFO_BENCH_NAME "\n");
+  if (!check_data(1) || !check_data(4)) return 1;
+#if CFG_TUSB_FIFO_WORD_COPY
+  if (!check_word_copy()) return 1;
+#endif
+
+  bench(1, total);
+  bench(4, total);
+
+  return _fail ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS       OPT_OS_NONE
+#define CFG_TUD_ENABLED   0
+#define CFG_TUSB_DEBUG    1
+
+#if defined(FIFO_BENCH_word)
+  #define CFG_TUSB_FIFO_WORD_COPY  1
+#else
+  #define CFG_TUSB_FIFO_WORD_COPY  0
+#endif
+
+#endif
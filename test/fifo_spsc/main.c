@@ -0,0 +1,186 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Stress test of the tu_fifo single-producer single-consumer API: one pthread writes a running
+// sequence with reserve/put/commit and write_n, the main thread reads it back with read/read_n and
+// checks that no item is lost, duplicated or torn. Run with: make run [ARGS=<items per case>]
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osal/osal.h"
+#include "common/tusb_fifo.h"
+
+// item wider than a word so that a torn copy is detected
+typedef struct {
+  uint32_t seq;
+  uint32_t inv;
+  uint32_t tag;
+} item_t;
+
+typedef struct {
+  char const* name;
+  uint16_t depth;
+  uint16_t max_batch;
+} test_case_t;
+
+static test_case_t const cases[] = {
+  { "depth 64, single items" , 64 , 1  },
+  { "depth 64, batches"      , 64 , 16 },
+  { "depth 37, batches"      , 37 , 5  },
+  { "depth 3, batches"       , 3  , 3  },
+  { "depth 1000, big batches", 1000, 128 },
+};
+
+static tu_fifo_t _ff;
+static uint32_t _total;
+static uint16_t _max_batch;
+static uint32_t _producer_full;
+
+static item_t make_item(uint32_t seq) {
+  item_t const it = { .seq = seq, .inv = ~seq, .tag = seq * 31u };
+  return it;
+}
+
+// xorshift, each thread has its own state
+static uint32_t rand_next(uint32_t* s) {
+  uint32_t x = *s;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *s = x;
+  return x;
+}
+
+static void* producer(void* arg) {
+  (void) arg;
+  uint32_t rnd = 0x12345678u;
+  uint32_t seq = 0;
+  item_t batch[128];
+
+  while (seq < _total) {
+    uint16_t want = (uint16_t) (1 + rand_next(&rnd) % _max_batch);
+    if (want > _total - seq) want = (uint16_t) (_total - seq);
+
+    uint16_t n;
+    if (rand_next(&rnd) & 1) {
+      // reserve, fill out of order, publish once
+      n = tu_fifo_spsc_reserve(&_ff, want);
+      for (uint16_t i = n; i > 0; i--) {
+        item_t const it = make_item(seq + i - 1);
+        tu_fifo_spsc_put(&_ff, (uint16_t) (i - 1), &it);
+      }
+      if (n) tu_fifo_spsc_commit(&_ff, n);
+    } else {
+      for (uint16_t i = 0; i < want; i++) batch[i] = make_item(seq + i);
+      n = tu_fifo_spsc_write_n(&_ff, batch, want);
+    }
+
+    if (n == 0) {
+      _producer_full++;
+      sched_yield();
+    }
+    seq += n;
+  }
+
+  return NULL;
+}
+
+static bool run_case(test_case_t const* tc) {
+  item_t* buf = malloc(tc->depth * sizeof(item_t));
+  tu_fifo_config(&_ff, buf, tc->depth, sizeof(item_t), false);
+  _max_batch = tc->max_batch;
+  _producer_full = 0;
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, producer, NULL);
+
+  uint32_t rnd = 0x9abcdef0u;
+  uint32_t expected = 0;
+  uint32_t consumer_empty = 0;
+  uint32_t max_count = 0;
+  bool ok = true;
+  item_t batch[64];
+
+  while (ok && expected < _total) {
+    uint16_t n;
+    if (rand_next(&rnd) & 1) {
+      n = tu_fifo_spsc_read(&_ff, batch) ? 1 : 0;
+    } else {
+      n = tu_fifo_spsc_read_n(&_ff, batch, (uint16_t) (1 + rand_next(&rnd) % TU_ARRAY_SIZE(batch)));
+    }
+
+    uint16_t const count = tu_fifo_count(&_ff);
+    if (count > tc->depth) {
+      printf("  FAIL count %u exceeds depth\n", count);
+      ok = false;
+    }
+    if (count > max_count) max_count = count;
+
+    for (uint16_t i = 0; ok && i < n; i++) {
+      item_t const ref = make_item(expected);
+      if (0 != memcmp(&batch[i], &ref, sizeof(item_t))) {
+        printf("  FAIL item %lu: got seq %lu inv %08lx tag %lu\n", (unsigned long) expected,
+               (unsigned long) batch[i].seq, (unsigned long) batch[i].inv, (unsigned long) batch[i].tag);
+        ok = false;
+      }
+      expected++;
+    }
+
+    if (n == 0) {
+      consumer_empty++;
+      sched_yield();
+    }
+  }
+
+  pthread_join(thread, NULL);
+
+  if (ok && !tu_fifo_empty(&_ff)) {
+    printf("  FAIL fifo not empty at end\n");
+    ok = false;
+  }
+
+  printf("%-26s %s (%lu items, max count %lu, full %lu, empty %lu)\n", tc->name, ok ? "OK" : "FAIL",
+         (unsigned long) expected, (unsigned long) max_count, (unsigned long) _producer_full,
+         (unsigned long) consumer_empty);
+
+  free(buf);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  _total = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 2000000u;
+
+  bool ok = true;
+  for (size_t i = 0; i < TU_ARRAY_SIZE(cases); i++) {
+    ok = run_case(&cases[i]) && ok;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS       OPT_OS_NONE
+#define CFG_TUD_ENABLED   0
+#define CFG_TUSB_DEBUG    1
+
+#endif
@@ -0,0 +1,45 @@
+# Common rules for host test executables, included by each test Makefile after setting
+# TEST (executable name), SRC (test sources), TUSB_SRC (stack sources relative to src/) and optionally
+# COMMON_SRC (shared test sources relative to test/common) and MCU. USBD_MOCK=1 runs a class driver that is not
+# ported to the per-port driver API on usbd_mock.c instead of usbd.c
+
+TOP      := $(abspath $(dir $(lastword $(MAKEFILE_LIST)))/..)
+CC       ?= gcc
+CFLAGS   += -std=c11 -O2 -g -Wall -Wextra -Wno-unused-parameter -pthread -MMD -MP
+MCU      ?= OPT_MCU_NONE
+ifeq ($(USBD_MOCK),1)
+CFLAGS   += -I$(TOP)/test/common/usbd_mock
+COMMON_SRC += usbd_mock.c
+TUSB_SRC   := $(sort $(TUSB_SRC) common/tusb_fifo.c)
+endif
+CFLAGS   += -I. -I$(TOP)/test/common -I$(TOP)/src -DCFG_TUSB_MCU=$(MCU)
+LDFLAGS  += -pthread
+BUILD    ?= _build
+
+OBJ := $(addprefix $(BUILD)/,$(SRC:.c=.o)) $(addprefix $(BUILD)/common/,$(COMMON_SRC:.c=.o)) \
+       $(addprefix $(BUILD)/tusb/,$(TUSB_SRC:.c=.o))
+
+$(BUILD)/$(TEST): $(OBJ)
+	$(CC) $(LDFLAGS) -o $@ $^ $(LIBS)
+
+$(BUILD)/%.o: %.c tusb_config.h
+	@mkdir -p $(dir $@)
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(BUILD)/common/%.o: $(TOP)/test/common/%.c tusb_config.h
+	@mkdir -p $(dir $@)
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+$(BUILD)/tusb/%.o: $(TOP)/src/%.c tusb_config.h
+	@mkdir -p $(dir $@)
+	$(CC) $(CFLAGS) -c -o $@ $<
+
+-include $(OBJ:.o=.d)
+
+run: $(BUILD)/$(TEST)
+	./$(BUILD)/$(TEST) $(ARGS)
+
+clean:
+	rm -rf $(BUILD)
+
+.PHONY: run clean
@@ -0,0 +1,216 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Hub descriptors served from flash compared byte by byte against the same descriptors built at runtime, the way
+// configure_hub() used to build them into a descriptor pool. Run with: make run
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vhost.h"
+#include "class/hub/hub.h"
+#include "device/usbd_pvt.h"
+
+#define HUB_ADDR    1
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+//--------------------------------------------------------------------+
+// Reference: runtime built hub descriptors
+//--------------------------------------------------------------------+
+
+// Former configure_hub() body, with the product string renamed
+static uint8_t reference_pool_build(void) {
+  uint8_t const pool = tud_desc_pool_new();
+  if (pool == TUD_DESC_POOL_INVALID) return pool;
+
+  tusb_desc_device_t descDevice = (tusb_desc_device_t){
+    .bLength            = 0x12,
+    .bDescriptorType    = TUSB_DESC_DEVICE,
+    .bcdUSB             = 0x0200,
+    .bDeviceClass       = 0x09,
+    .bDeviceSubClass    = 0x00,
+    .bDeviceProtocol    = 0x00,
+    .bMaxPacketSize0    = 64,
+    .idVendor           = 0xCafe,
+    .idProduct          = 0x0150,
+    .bcdDevice          = 0x0100,
+    .iManufacturer      = 0x00,
+    .iProduct           = 0x01,
+    .iSerialNumber      = 0x00,
+    .bNumConfigurations = 0x01
+  };
+  tud_desc_pool_add(pool, 0, 0, &descDevice);
+
+  tusb_desc_device_qualifier_t dev_qual_desc = (tusb_desc_device_qualifier_t){
+    .bLength            = 0x0A,
+    .bDescriptorType    = TUSB_DESC_DEVICE_QUALIFIER,
+    .bcdUSB             = 0x0200,
+    .bDeviceClass       = 0x09,
+    .bDeviceSubClass    = 0x00,
+    .bDeviceProtocol    = 0x00,
+    .bMaxPacketSize0    = 64,
+    .bNumConfigurations = 0x01,
+    .bReserved          = 0x00
+  };
+  tud_desc_pool_add(pool, 0, 0, &dev_qual_desc);
+
+  tusb_desc_configuration_t conf_desc = (tusb_desc_configuration_t){
+    .bLength             = 0x09,
+    .bDescriptorType     = TUSB_DESC_CONFIGURATION,
+    .wTotalLength        = 0x19,
+    .bNumInterfaces      = 0x01,
+    .bConfigurationValue = 0x01,
+    .iConfiguration      = 0x00,
+    .bmAttributes        = 0xE0,
+    .bMaxPower           = 0x50
+  };
+
+  tusb_desc_interface_t itf_desc = (tusb_desc_interface_t){
+    .bLength            = 0x09,
+    .bDescriptorType    = TUSB_DESC_INTERFACE,
+    .bInterfaceNumber   = 0x00,
+    .bAlternateSetting  = 0x00,
+    .bNumEndpoints      = 0x01,
+    .bInterfaceClass    = 0x09,
+    .bInterfaceSubClass = 0x00,
+    .bInterfaceProtocol = 0x00,
+    .iInterface         = 0x00
+  };
+
+  hub_desc_cs_t hub_desc = (hub_desc_cs_t){
+    .bLength             = 0x09,
+    .bDescriptorType     = 0x19,
+    .bNbrPorts           = CFG_TUD_HUB_PORT,
+    .wHubCharacteristics = 0x0009,
+    .bPwrOn2PwrGood      = 0x32,
+    .bHubContrCurrent    = 0x64,
+    .DeviceRemovable     = 0x00,
+    .PortPwrCtrlMask     = 0xff
+  };
+  tud_desc_pool_add(pool, 0, 0, &hub_desc);
+
+  tusb_desc_endpoint_t ep_desc = (tusb_desc_endpoint_t){
+    .bLength            = 0x07,
+    .bDescriptorType    = TUSB_DESC_ENDPOINT,
+    .bEndpointAddress   = 0x81,
+    .bmAttributes       = { .xfer = TUSB_XFER_INTERRUPT },  // 0x03
+    .wMaxPacketSize     = 0x0001,
+    .bInterval          = 0xff
+  };
+
+  uint8_t desc_cfg[sizeof(conf_desc) + sizeof(itf_desc) + sizeof(ep_desc)];
+  memcpy(desc_cfg, &conf_desc, sizeof(conf_desc));
+  memcpy(desc_cfg + sizeof(conf_desc), &itf_desc, sizeof(itf_desc));
+  memcpy(desc_cfg + sizeof(conf_desc) + sizeof(itf_desc), &ep_desc, sizeof(ep_desc));
+  tud_desc_pool_add(pool, 0, 0, desc_cfg);
+
+  uint8_t const au8StrLang[] = { 4, TUSB_DESC_STRING, 0x09, 0x04 };
+  tud_desc_pool_add(pool, 0, 0, au8StrLang);
+  tud_desc_pool_add_string(pool, 1, 0, "TinyUSB");
+  tud_desc_pool_add_string(pool, 2, 0, "TinyUSB Hub");
+  tud_desc_pool_add_string(pool, 3, 0, "149");
+
+  return pool;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static bool desc_compare(uint8_t ref_pool, uint8_t const* got, int32_t got_len, uint8_t type, uint8_t index) {
+  uint16_t ref_len = 0;
+  uint8_t const* ref = tud_desc_pool_get(ref_pool, type, index, 0, &ref_len);
+  CHECK(ref != NULL);
+  if (got_len != ref_len || 0 != memcmp(got, ref, ref_len)) {
+    printf("  descriptor type 0x%02x index %u: got %ld bytes, expected %u\n", type, index, (long) got_len, ref_len);
+    for (int32_t i = 0; i < got_len; i++) printf(" %02x", got[i]);
+    printf("\n");
+    for (uint16_t i = 0; i < ref_len; i++) printf(" %02x", ref[i]);
+    printf("\n");
+  }
+  CHECK(got_len == ref_len);
+  CHECK(0 == memcmp(got, ref, ref_len));
+  return true;
+}
+
+// Standard descriptors requested by the host
+static bool test_standard(uint8_t ref_pool) {
+  static struct {
+    uint8_t type;
+    uint8_t index;
+  } const list[] = {
+    { TUSB_DESC_DEVICE, 0 },
+    { TUSB_DESC_DEVICE_QUALIFIER, 0 },
+    { TUSB_DESC_CONFIGURATION, 0 },
+    { TUSB_DESC_STRING, 0 },
+    { TUSB_DESC_STRING, 1 },
+    { TUSB_DESC_STRING, 2 },
+    { TUSB_DESC_STRING, 3 },
+  };
+
+  for (size_t i = 0; i < TU_ARRAY_SIZE(list); i++) {
+    uint8_t desc[255];
+    uint16_t const langid = (list[i].type == TUSB_DESC_STRING && list[i].index) ? 0x0409 : 0;
+    int32_t const len = vhost_control(HUB_ADDR, 0x80, TUSB_REQ_GET_DESCRIPTOR,
+                                      (uint16_t) ((list[i].type << 8) | list[i].index), langid, sizeof(desc), desc);
+    CHECK(len > 0);
+    if (!desc_compare(ref_pool, desc, len, list[i].type, list[i].index)) return false;
+  }
+
+  printf("standard descriptors           OK\n");
+  return true;
+}
+
+// Hub class descriptor requested with class GET_DESCRIPTOR
+static bool test_class(uint8_t ref_pool) {
+  uint8_t desc[sizeof(hub_desc_cs_t)];
+  int32_t const len = vhost_control(HUB_ADDR, 0xA0, HUB_REQUEST_GET_DESCRIPTOR, 0x2900, 0, sizeof(desc), desc);
+  CHECK(desc_compare(ref_pool, desc, len, 0x19, 0));
+
+  printf("hub class descriptor           OK\n");
+  return true;
+}
+
+int main(void) {
+  uint8_t config[256];
+
+  vhost_init(TUSB_SPEED_FULL);
+  uint8_t const ref_pool = reference_pool_build();
+  if (ref_pool == TUD_DESC_POOL_INVALID || !vhost_enumerate(HUB_ADDR, config, sizeof(config))) {
+    printf("  FAIL setup\n");
+    return 1;
+  }
+
+  test_standard(ref_pool);
+  test_class(ref_pool);
+
+  return _fail ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#include "CentralUSB.h"
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          3
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_HUB             1
+
+#endif
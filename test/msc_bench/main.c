@@ -0,0 +1,601 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// MSC Bulk-Only RAM disk on the usbd mock: host writes the whole disk with WRITE10 then reads it back with READ10
+// and checks the data, for each way the media callbacks complete:
+//   - sync  : data is copied in the callback
+//   - async : callback returns TUD_MSC_RET_ASYNC and copy completes in the next round, like DMA
+//   - early : callback returns TUD_MSC_RET_ASYNC after signaling completion itself
+// Host sends or takes packets until device NAKs, then device task runs once (a round). Reported are packets per
+// round, NAKs and CPU time per MB. With the block cache (sync only) MODE SENSE must report the write cache, host
+// writes are programmed once (write amplification 1.0) and idle flush must bring the media up to date without
+// SYNCHRONIZE CACHE. Media that stays busy (TUD_MSC_RET_BUSY) must be polled with backoff rather than on every SOF.
+// Addressing and sense are checked on a second LUN: in the lba64 variant it is 3 * 2^31 blocks large (only a window
+// around LBA 2^32 is backed) and accessed with READ16/WRITE16, READ CAPACITY (10) must then report 0xFFFFFFFF. Without
+// the 16-byte callbacks READ16 beyond 2^32 must fail with LBA out of range. Sense data is kept per LUN.
+// Run with: make run [ARGS=<disk MB>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "usbd_mock.h"
+
+#define EP_OUT        0x01
+#define EP_IN         0x81
+#define EP_SIZE       512
+#define BLOCK_SIZE    512
+#define XFER_BLOCKS   128   // 64 KB per command
+#define LUN_COUNT     2
+
+// LUN 1 of lba64 variant: only WINDOW_BLOCKS from WINDOW_LBA are backed by memory
+#define HUGE_BLOCKS   (3ull << 31)
+#define WINDOW_LBA    ((1ull << 32) - 64)
+#define WINDOW_BLOCKS 128u
+
+typedef enum {
+  MODE_SYNC = 0,
+  MODE_ASYNC,
+  MODE_EARLY,
+} io_mode_t;
+
+static char const* const mode_name[] = { "sync", "async", "early" };
+
+static uint8_t const desc_msc[] = {
+  TUD_MSC_DESCRIPTOR(0, 0, EP_OUT, EP_IN, EP_SIZE)
+};
+
+static void msc_sof(uint8_t rhport, uint32_t frame_count) {
+  mscd_sof(rhport, 0, frame_count);
+}
+
+static usbd_mock_driver_t const driver = {
+  .xfer_cb = mscd_xfer_cb,
+  .sof     = msc_sof,
+};
+
+static uint8_t* _disk;
+static uint8_t* _expect; // data written by host
+static uint32_t _block_count;
+static io_mode_t _mode;
+static int32_t _async_result; // pending async completion, 0 if none
+static uint64_t _media_read_bytes;
+static uint32_t _rounds;
+static uint32_t _busy_until; // media is busy until this round
+static uint32_t _busy_calls; // callbacks returned busy
+static uint8_t _window[WINDOW_BLOCKS * BLOCK_SIZE];
+static uint64_t _max_lba;    // highest LBA passed to media callbacks
+
+//--------------------------------------------------------------------+
+// Media callbacks
+//--------------------------------------------------------------------+
+
+static int32_t io_done(int32_t nbytes) {
+  if (_mode == MODE_SYNC) return nbytes;
+
+  if (_mode == MODE_EARLY) {
+    if (!tud_msc_async_io_done(nbytes, false)) return TUD_MSC_RET_ERROR;
+  } else {
+    _async_result = nbytes;
+  }
+  return TUD_MSC_RET_ASYNC;
+}
+
+// Memory backing the blocks, NULL (sense set) if not backed
+static uint8_t* media_addr(uint8_t lun, uint64_t lba, uint32_t offset, uint32_t bufsize) {
+  uint64_t const end = lba + (offset + bufsize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  _max_lba = TU_MAX(_max_lba, lba);
+
+  if (lun == 0 && end <= _block_count) {
+    return _disk + lba * BLOCK_SIZE + offset;
+  }
+  if (lun == 1 && lba >= WINDOW_LBA && end <= WINDOW_LBA + WINDOW_BLOCKS) {
+    return _window + (lba - WINDOW_LBA) * BLOCK_SIZE + offset;
+  }
+  tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+  return NULL;
+}
+
+static int32_t media_read(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  if (_rounds < _busy_until) {
+    _busy_calls++;
+    return TUD_MSC_RET_BUSY;
+  }
+  uint8_t const* addr = media_addr(lun, lba, offset, bufsize);
+  if (!addr) return TUD_MSC_RET_ERROR;
+  memcpy(buffer, addr, bufsize);
+  _media_read_bytes += bufsize;
+  return io_done((int32_t) bufsize);
+}
+
+static int32_t media_write(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t const* buffer, uint32_t bufsize) {
+  if (_rounds < _busy_until) {
+    _busy_calls++;
+    return TUD_MSC_RET_BUSY;
+  }
+  uint8_t* addr = media_addr(lun, lba, offset, bufsize);
+  if (!addr) return TUD_MSC_RET_ERROR;
+  memcpy(addr, buffer, bufsize);
+  return io_done((int32_t) bufsize);
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  return media_read(lun, lba, offset, buffer, bufsize);
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  return media_write(lun, lba, offset, buffer, bufsize);
+}
+
+#ifdef MSC_BENCH_lba64
+int32_t tud_msc_read16_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  return media_read(lun, lba, offset, buffer, bufsize);
+}
+
+int32_t tud_msc_write16_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  return media_write(lun, lba, offset, buffer, bufsize);
+}
+
+void tud_msc_capacity16_cb(uint8_t lun, uint64_t* block_count, uint16_t* block_size) {
+  *block_count = lun ? HUGE_BLOCKS : _block_count;
+  *block_size  = BLOCK_SIZE;
+}
+#endif
+
+uint8_t tud_msc_get_maxlun_cb(void) {
+  return LUN_COUNT;
+}
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]) {
+  (void) lun;
+  memcpy(vendor_id, "TinyUSB ", 8);
+  memcpy(product_id, "RAM disk bench  ", 16);
+  memcpy(product_rev, "1.0 ", 4);
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun) {
+  (void) lun;
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size) {
+  (void) lun;
+  *block_count = _block_count;
+  *block_size  = BLOCK_SIZE;
+}
+
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize) {
+  (void) buffer; (void) bufsize;
+  tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
+  return -1;
+}
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+
+// Device side of a round: pending async I/O completes ("DMA interrupt"), SOF then task
+static void device_round(void) {
+  if (_async_result) {
+    int32_t const result = _async_result;
+    _async_result = 0;
+    tud_msc_async_io_done(result, true);
+  }
+  usbd_mock_sof(_rounds);
+  usbd_mock_task();
+  _rounds++;
+}
+
+static bool host_out(uint8_t const* data, uint32_t len) {
+  uint32_t const limit = _rounds + 1000;
+  while (len) {
+    uint16_t const n = (uint16_t) TU_MIN(len, EP_SIZE);
+    if (usbd_mock_host_out(EP_OUT, data, n)) {
+      data += n;
+      len -= n;
+    } else {
+      device_round();
+      if (_rounds > limit) return false;
+    }
+  }
+  return true;
+}
+
+// CLEAR_FEATURE(ENDPOINT_HALT) as usbd would process it
+static void host_clear_halt(uint8_t ep_addr) {
+  tusb_control_request_t const request = {
+    .bmRequestType = 0x02,
+    .bRequest      = TUSB_REQ_CLEAR_FEATURE,
+    .wValue        = TUSB_REQ_FEATURE_EDPT_HALT,
+    .wIndex        = ep_addr,
+    .wLength       = 0
+  };
+  usbd_edpt_clear_stall(0, ep_addr);
+  mscd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request);
+}
+
+static bool host_in(uint8_t* data, uint32_t len) {
+  uint32_t const limit = _rounds + 1000;
+  while (len) {
+    int32_t const n = usbd_mock_host_in(EP_IN, data, (uint16_t) TU_MIN(len, EP_SIZE));
+    if (n < 0 && usbd_edpt_stalled(0, EP_IN)) {
+      // data-in shorter than host expected (case 5) is followed by STALL before CSW
+      host_clear_halt(EP_IN);
+    } else if (n < 0) {
+      device_round();
+      if (_rounds > limit) return false;
+    } else {
+      data += n;
+      len -= (uint32_t) n;
+      if (n < EP_SIZE) break;
+    }
+  }
+  return len == 0;
+}
+
+// Bulk-Only command to a LUN, return false unless completed with expected status and residue
+static bool host_scsi_lun(uint8_t lun, uint8_t const* cdb, uint8_t cdb_len, bool dir_in, uint8_t* data, uint32_t len,
+                          uint32_t residue, uint8_t status) {
+  static uint32_t tag;
+
+  msc_cbw_t cbw = {
+    .signature   = MSC_CBW_SIGNATURE,
+    .tag         = ++tag,
+    .total_bytes = len,
+    .dir         = dir_in ? TUSB_DIR_IN_MASK : 0,
+    .lun         = lun,
+    .cmd_len     = cdb_len,
+  };
+  memcpy(cbw.command, cdb, cdb_len);
+
+  if (!host_out((uint8_t const*) &cbw, sizeof(cbw))) return false;
+  if (dir_in) {
+    // short packet ends the data stage early
+    if (!host_in(data, len - residue) && !residue) return false;
+  } else {
+    if (!host_out(data, len)) return false;
+  }
+
+  msc_csw_t csw;
+  if (!host_in((uint8_t*) &csw, sizeof(csw))) return false;
+  return csw.signature == MSC_CSW_SIGNATURE && csw.tag == tag && csw.status == status && csw.data_residue == residue;
+}
+
+// Bulk-Only command to LUN 0, return false unless passed with the expected residue
+static bool host_scsi(uint8_t const* cdb, uint8_t cdb_len, bool dir_in, uint8_t* data, uint32_t len, uint32_t residue) {
+  return host_scsi_lun(0, cdb, cdb_len, dir_in, data, len, residue, MSC_CSW_STATUS_PASSED);
+}
+
+static bool host_rdwr(uint8_t opcode, uint32_t lba, uint16_t blocks, uint8_t* data) {
+  uint8_t cdb[10] = { opcode };
+  tu_unaligned_write32(&cdb[2], tu_htonl(lba));
+  tu_unaligned_write16(&cdb[7], tu_htons(blocks));
+  return host_scsi(cdb, sizeof(cdb), opcode == SCSI_CMD_READ_10, data, (uint32_t) blocks * BLOCK_SIZE, 0);
+}
+
+static bool host_rdwr16(uint8_t lun, uint8_t opcode, uint64_t lba, uint32_t blocks, uint8_t* data, uint8_t status) {
+  uint8_t cdb[16] = { opcode };
+  tu_unaligned_write32(&cdb[2], tu_htonl((uint32_t) (lba >> 32)));
+  tu_unaligned_write32(&cdb[6], tu_htonl((uint32_t) lba));
+  tu_unaligned_write32(&cdb[10], tu_htonl(blocks));
+  uint32_t const len = blocks * BLOCK_SIZE;
+  uint32_t const residue = (status == MSC_CSW_STATUS_PASSED) ? 0 : len;
+  return host_scsi_lun(lun, cdb, sizeof(cdb), opcode == SCSI_CMD_READ_16, data, len, residue, status);
+}
+
+// REQUEST SENSE of a LUN matches sense key and additional sense code
+static bool check_sense(uint8_t lun, uint8_t sense_key, uint8_t asc) {
+  uint8_t const cdb[6] = { SCSI_CMD_REQUEST_SENSE, 0, 0, 0, sizeof(scsi_sense_fixed_resp_t), 0 };
+  scsi_sense_fixed_resp_t sense;
+  if (!host_scsi_lun(lun, cdb, sizeof(cdb), true, (uint8_t*) &sense, sizeof(sense), 0, MSC_CSW_STATUS_PASSED)) {
+    return false;
+  }
+  return sense.sense_key == sense_key && sense.add_sense_code == asc;
+}
+
+// Last LBA reported by READ CAPACITY (10) and (16)
+static bool read_capacity(uint8_t lun, uint32_t* last_lba10, uint64_t* last_lba16) {
+  uint8_t const cdb10[10] = { SCSI_CMD_READ_CAPACITY_10 };
+  scsi_read_capacity10_resp_t resp10;
+  if (!host_scsi_lun(lun, cdb10, sizeof(cdb10), true, (uint8_t*) &resp10, sizeof(resp10), 0, MSC_CSW_STATUS_PASSED) ||
+      tu_ntohl(resp10.block_size) != BLOCK_SIZE) {
+    return false;
+  }
+  *last_lba10 = tu_ntohl(resp10.last_lba);
+
+  uint8_t cdb16[16] = { SCSI_CMD_SERVICE_ACTION_IN_16, SCSI_SERVICE_ACTION_READ_CAPACITY_16 };
+  tu_unaligned_write32(&cdb16[10], tu_htonl(sizeof(scsi_read_capacity16_resp_t)));
+  scsi_read_capacity16_resp_t resp16;
+  if (!host_scsi_lun(lun, cdb16, sizeof(cdb16), true, (uint8_t*) &resp16, sizeof(resp16), 0, MSC_CSW_STATUS_PASSED) ||
+      tu_ntohl(resp16.block_size) != BLOCK_SIZE) {
+    return false;
+  }
+  *last_lba16 = ((uint64_t) tu_ntohl(resp16.last_lba_hi) << 32) | tu_ntohl(resp16.last_lba_lo);
+  return true;
+}
+
+#if CFG_TUD_MSC_CACHE
+// All pages: header and caching page with write cache enabled
+static bool check_mode_sense(void) {
+  uint8_t const cdb[6] = { SCSI_CMD_MODE_SENSE_6, 0, SCSI_MODE_PAGE_ALL, 0, 192, 0 };
+  uint8_t resp[192];
+  uint32_t const resp_len = sizeof(scsi_mode_sense6_resp_t) + sizeof(scsi_mode_page_caching_t);
+
+  if (!host_scsi(cdb, sizeof(cdb), true, resp, sizeof(resp), sizeof(resp) - resp_len)) return false;
+
+  scsi_mode_page_caching_t const* page = (scsi_mode_page_caching_t const*) (resp + sizeof(scsi_mode_sense6_resp_t));
+  return resp[0] == resp_len - 1 && page->page_code == SCSI_MODE_PAGE_CACHING && page->write_cache_enable;
+}
+
+// Host stays idle until dirty lines are programmed
+static bool check_idle_flush(void) {
+  for (uint32_t i = 0; i < 2 * CFG_TUD_MSC_CACHE_IDLE_FLUSH_MS; i++) {
+    device_round();
+  }
+  return 0 == memcmp(_disk, _expect, (size_t) _block_count * BLOCK_SIZE);
+}
+#endif
+
+static uint64_t cpu_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static bool device_open(io_mode_t mode) {
+  _mode = mode;
+  _async_result = 0;
+  _media_read_bytes = 0;
+  _busy_until = 0;
+  usbd_mock_init(&driver, TUSB_SPEED_HIGH, false);
+  mscd_init();
+  return mscd_open(0, (tusb_desc_interface_t const*) desc_msc, sizeof(desc_msc)) == sizeof(desc_msc);
+}
+
+// Sense is kept per LUN, READ CAPACITY and READ16/WRITE16 with 64-bit LBA on LUN 1
+static bool check_lun(void) {
+  enum { BLOCKS = 64 };
+  static uint8_t data[BLOCKS * BLOCK_SIZE];
+  static uint8_t buf[BLOCKS * BLOCK_SIZE];
+  char name[32];
+  snprintf(name, sizeof(name), "%s, lun", MSC_BENCH_NAME);
+
+  if (!device_open(MODE_SYNC)) {
+    printf("%-17s FAIL open\n", name);
+    return false;
+  }
+  _rounds = 0;
+
+  // unsupported command fails on LUN 1 only
+  uint8_t const cdb_vendor[6] = { 0xC0 };
+  if (!host_scsi_lun(1, cdb_vendor, sizeof(cdb_vendor), false, NULL, 0, 0, MSC_CSW_STATUS_FAILED) ||
+      !check_sense(0, SCSI_SENSE_NONE, 0) || !check_sense(1, SCSI_SENSE_ILLEGAL_REQUEST, 0x20) ||
+      !check_sense(1, SCSI_SENSE_NONE, 0)) {
+    printf("%-17s FAIL sense per LUN\n", name);
+    return false;
+  }
+
+  uint32_t last10;
+  uint64_t last16;
+  if (!read_capacity(0, &last10, &last16) || last10 != _block_count - 1 || last16 != _block_count - 1) {
+    printf("%-17s FAIL read capacity LUN 0\n", name);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t) (i * 13 + 1);
+
+  #ifdef MSC_BENCH_lba64
+  // last LBA does not fit READ CAPACITY (10)
+  if (!read_capacity(1, &last10, &last16) || last10 != UINT32_MAX || last16 != HUGE_BLOCKS - 1) {
+    printf("%-17s FAIL read capacity LUN 1: %08lx %016llx\n", name, (unsigned long) last10,
+           (unsigned long long) last16);
+    return false;
+  }
+
+  // crossing LBA 2^32
+  uint64_t const lba = (1ull << 32) - BLOCKS / 2;
+  _max_lba = 0;
+  if (!host_rdwr16(1, SCSI_CMD_WRITE_16, lba, BLOCKS, data, MSC_CSW_STATUS_PASSED) ||
+      !host_rdwr16(1, SCSI_CMD_READ_16, lba, BLOCKS, buf, MSC_CSW_STATUS_PASSED) ||
+      memcmp(buf, data, sizeof(data)) ||
+      memcmp(_window + (lba - WINDOW_LBA) * BLOCK_SIZE, data, sizeof(data)) || _max_lba <= UINT32_MAX) {
+    printf("%-17s FAIL READ16/WRITE16 at LBA %016llx\n", name, (unsigned long long) lba);
+    return false;
+  }
+  printf("%-17s OK READ16/WRITE16 across LBA 2^32, READ CAPACITY (10) %08lx, sense per LUN\n", name,
+         (unsigned long) last10);
+  #else
+  // READ16 within 2^32 is served by read10 callback, beyond fails with LBA out of range on its LUN only
+  if (!host_rdwr16(0, SCSI_CMD_WRITE_16, 0, BLOCKS, data, MSC_CSW_STATUS_PASSED) ||
+      !host_rdwr16(0, SCSI_CMD_READ_16, 0, BLOCKS, buf, MSC_CSW_STATUS_PASSED) || memcmp(buf, data, sizeof(data))) {
+    printf("%-17s FAIL READ16/WRITE16\n", name);
+    return false;
+  }
+  if (!host_rdwr16(0, SCSI_CMD_READ_16, 1ull << 32, BLOCKS, buf, MSC_CSW_STATUS_FAILED) ||
+      !check_sense(1, SCSI_SENSE_NONE, 0) || !check_sense(0, SCSI_SENSE_ILLEGAL_REQUEST, 0x21)) {
+    printf("%-17s FAIL READ16 beyond 2^32 without read16 callback\n", name);
+    return false;
+  }
+  printf("%-17s OK READ16/WRITE16, LBA beyond 2^32 out of range, sense per LUN\n", name);
+  #endif
+
+  return true;
+}
+
+#if !CFG_TUD_MSC_CACHE
+// Media is busy for a while at the start of a WRITE10 then a READ10: command must complete soon after media is ready,
+// with the callback retried at most every CFG_TUD_MSC_BUSY_RETRY_MAX rounds instead of every round
+static bool check_busy(void) {
+  enum { BUSY_ROUNDS = 500, BLOCKS = 8 };
+  static uint8_t data[BLOCKS * BLOCK_SIZE];
+  char name[32];
+  snprintf(name, sizeof(name), "%s, busy", MSC_BENCH_NAME);
+
+  if (!device_open(MODE_SYNC)) {
+    printf("%-17s FAIL open\n", name);
+    return false;
+  }
+  _rounds = 0;
+
+  for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t) (i * 7);
+
+  // backoff 1, 2, 4 .. up to max SOFs, plus first call when command starts
+  uint32_t max_calls = 2;
+  for (uint32_t interval = 1; interval < CFG_TUD_MSC_BUSY_RETRY_MAX; interval *= 2) max_calls++;
+  max_calls += BUSY_ROUNDS / CFG_TUD_MSC_BUSY_RETRY_MAX;
+
+  for (uint8_t op = 0; op < 2; op++) {
+    uint8_t const opcode = op ? SCSI_CMD_READ_10 : SCSI_CMD_WRITE_10;
+    uint8_t buf[sizeof(data)];
+    if (op == 0) {
+      memcpy(buf, data, sizeof(data));
+    } else {
+      memset(buf, 0, sizeof(buf));
+    }
+
+    _busy_calls = 0;
+    _busy_until = _rounds + BUSY_ROUNDS;
+    if (!host_rdwr(opcode, 0, BLOCKS, buf) || (op && memcmp(buf, data, sizeof(data)))) {
+      printf("%-17s FAIL %s\n", name, op ? "read" : "write");
+      return false;
+    }
+    uint32_t const late = _rounds - _busy_until;
+
+    printf("%-17s OK %s: %3lu busy callbacks in %lu rounds, done %lu rounds after ready\n", name,
+           op ? "read " : "write", (unsigned long) _busy_calls, (unsigned long) BUSY_ROUNDS, (unsigned long) late);
+    if (_busy_calls > max_calls || late > CFG_TUD_MSC_BUSY_RETRY_MAX + 2 * BLOCKS) {
+      printf("%-17s FAIL busy media polled without backoff or retried too late\n", name);
+      return false;
+    }
+  }
+
+  _busy_until = 0;
+  return true;
+}
+#endif
+
+static bool run(io_mode_t mode) {
+  static uint8_t data[XFER_BLOCKS * BLOCK_SIZE];
+  char name[32];
+  snprintf(name, sizeof(name), "%s, %s", MSC_BENCH_NAME, mode_name[mode]);
+
+  if (!device_open(mode)) {
+    printf("%-17s FAIL open\n", name);
+    return false;
+  }
+
+  #if CFG_TUD_MSC_CACHE
+  tud_msc_cache_clear_stats();
+  if (!check_mode_sense()) {
+    printf("%-17s FAIL mode sense caching page\n", name);
+    return false;
+  }
+  #endif
+
+  uint32_t rnd = 0x12345678u + mode;
+  usbd_mock_stats_clear();
+  _rounds = 0;
+  uint64_t const t0 = cpu_time_ns();
+
+  for (uint32_t lba = 0; lba < _block_count; lba += XFER_BLOCKS) {
+    for (uint32_t i = 0; i < sizeof(data); i += 4) {
+      rnd = rnd * 1664525u + 1013904223u;
+      memcpy(data + i, &rnd, 4);
+    }
+    if (!host_rdwr(SCSI_CMD_WRITE_10, lba, XFER_BLOCKS, data)) {
+      printf("%-17s FAIL write lba %lu\n", name, (unsigned long) lba);
+      return false;
+    }
+    memcpy(_expect + lba * BLOCK_SIZE, data, sizeof(data));
+  }
+
+  #if CFG_TUD_MSC_CACHE
+  // sequential writes of whole lines must not read media
+  uint64_t const write_media_read = _media_read_bytes;
+  #endif
+
+  for (uint32_t lba = 0; lba < _block_count; lba += XFER_BLOCKS) {
+    if (!host_rdwr(SCSI_CMD_READ_10, lba, XFER_BLOCKS, data) ||
+        0 != memcmp(data, _expect + lba * BLOCK_SIZE, sizeof(data))) {
+      printf("%-17s FAIL read lba %lu\n", name, (unsigned long) lba);
+      return false;
+    }
+  }
+
+  uint64_t const t1 = cpu_time_ns();
+  usbd_mock_stats_t stats;
+  usbd_mock_stats_get(&stats);
+
+  double const mb = 2.0 * _block_count * BLOCK_SIZE / (1024 * 1024);
+  printf("%-17s OK %5.2f packets/round, %7.1f NAK/MB, %7.1f us CPU/MB", name, (double) stats.packets / _rounds,
+         stats.naks / mb, (double) (t1 - t0) / 1000.0 / mb);
+
+  #if CFG_TUD_MSC_CACHE
+  if (!check_idle_flush()) {
+    printf("\n%-17s FAIL media not up to date after idle\n", name);
+    return false;
+  }
+
+  tud_msc_cache_stats_t cstats;
+  tud_msc_cache_get_stats(&cstats);
+  printf(", write amplification %.2f, %lu KB read from media while writing",
+         (double) cstats.media_write_bytes / (double) cstats.host_write_bytes,
+         (unsigned long) (write_media_read / 1024));
+  if (write_media_read) {
+    printf("\n%-17s FAIL read-modify-write of whole lines\n", name);
+    return false;
+  }
+  #endif
+
+  printf("\n");
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t const mbytes = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 16u;
+  _block_count = mbytes * 1024u * 1024u / BLOCK_SIZE;
+  _disk   = calloc(_block_count, BLOCK_SIZE);
+  _expect = calloc(_block_count, BLOCK_SIZE);
+
+  // callbacks must complete synchronously with cache
+  io_mode_t const last = CFG_TUD_MSC_CACHE ? MODE_SYNC : MODE_EARLY;
+
+  bool ok = true;
+  for (io_mode_t mode = MODE_SYNC; mode <= last; mode++) {
+    ok = run(mode) && ok;
+  }
+  ok = check_lun() && ok;
+
+  // with cache, host commands do not wait for media
+  #if !CFG_TUD_MSC_CACHE
+  ok = check_busy() && ok;
+  #endif
+
+  free(_disk);
+  free(_expect);
+  return ok ? 0 : 1;
+}
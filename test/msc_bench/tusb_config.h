@@ -0,0 +1,28 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          3
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_MSC             1
+
+#if defined(MSC_BENCH_bufcount4) || defined(MSC_BENCH_lba64)
+  #define CFG_TUD_MSC_EP_BUFSIZE   4096
+  #define CFG_TUD_MSC_EP_BUFCOUNT  4
+#elif defined(MSC_BENCH_cache)
+  // endpoint buffer smaller than cache line
+  #define CFG_TUD_MSC_EP_BUFSIZE        512
+  #define CFG_TUD_MSC_EP_BUFCOUNT       2
+  #define CFG_TUD_MSC_CACHE             1
+  #define CFG_TUD_MSC_CACHE_LINE_SIZE   4096
+  #define CFG_TUD_MSC_CACHE_LINE_COUNT  4
+#else
+  #define CFG_TUD_MSC_EP_BUFSIZE   4096
+  #define CFG_TUD_MSC_EP_BUFCOUNT  1
+#endif
+
+#endif
@@ -0,0 +1,510 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// NCM datagram loopback on the usbd mock: host packs datagrams of varying size into OUT NTBs, application echoes
+// each one with tud_network_xmit() (copy) or as header and payload segment with tud_network_xmit_sg() (sg), and host
+// checks that the IN NTBs carry the same datagrams in the same order. An NTB without datagrams must not block
+// reception. With NTB-32 (ntb32) host switches the format while an NTB-16 is still waiting for the application,
+// batch receives all datagrams of an NTB at once, sg_isr submits the parts of an NTB from the transfer complete ISR.
+// Host sends or takes packets until device NAKs, then device task runs once (a round). Reported are datagrams and
+// transfers per IN NTB, NAKs and device CPU time per MB, including the time spent in ISR.
+// Run with: make run [ARGS=<datagrams>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "usbd_mock.h"
+#include "class/net/ncm.h"
+
+#define EP_NOTIF    0x81
+#define EP_OUT      0x02
+#define EP_IN       0x82
+#define EP_SIZE     CFG_TUD_NET_ENDPOINT_SIZE
+#define ETH_HDR     14
+#define ETH_PAD     2
+#define DGRAM_MIN   60
+#define RING_N      16    // datagrams held by application
+#define POOL_N      64    // distinct datagram payloads
+
+static uint8_t const desc_ncm[] = {
+  TUD_CDC_NCM_DESCRIPTOR(0, 0, 0, EP_NOTIF, 64, EP_OUT, EP_IN, EP_SIZE, CFG_TUD_NET_MTU)
+};
+
+static void ncm_sof(uint8_t rhport, uint32_t frame_count) {
+  netd_sof(rhport, 0, frame_count);
+}
+
+static uint64_t cpu_time_ns(void);
+static uint64_t _device_ns;
+
+#if CFG_TUD_XFER_ISR
+// runs within host packet transfer, counted as device time
+static bool ncm_xfer_isr(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint64_t const t0 = cpu_time_ns();
+  bool const handled = netd_xfer_isr_cb(rhport, 0, ep_addr, result, xferred_bytes);
+  _device_ns += cpu_time_ns() - t0;
+  return handled;
+}
+#endif
+
+static usbd_mock_driver_t const driver = {
+  .xfer_cb     = netd_xfer_cb,
+#if CFG_TUD_XFER_ISR
+  .xfer_isr_cb = ncm_xfer_isr,
+#endif
+  .sof         = ncm_sof,
+};
+
+// received with ETH_PAD bytes in front so that the payload behind the Ethernet header is aligned, as lwIP does
+typedef struct {
+  TU_ATTR_ALIGNED(4) uint8_t data[ETH_PAD + CFG_TUD_NET_MTU];
+  uint16_t len;
+} datagram_t;
+
+static uint8_t  _pool[POOL_N][CFG_TUD_NET_MTU];
+static uint32_t _tx_seq;     // next datagram host sends
+static uint32_t _rx_seq;     // next datagram host expects back
+static uint32_t _in_ntbs;
+static uint32_t _out_ntbs;
+static uint32_t _rounds;
+static bool     _order_ok;
+static bool     _ntb32;      // NTB format selected by host
+static bool     _app_hold;   // application refuses datagrams
+
+//--------------------------------------------------------------------+
+// Application: echo every received datagram
+//--------------------------------------------------------------------+
+
+static datagram_t _ring[RING_N];
+static uint32_t _ring_wr;    // next slot to receive into
+static uint32_t _ring_xmit;  // next slot to echo
+static uint32_t _ring_rd;    // oldest slot still owned by driver (sg) or not yet echoed
+
+bool tud_network_recv_cb(const uint8_t* src, uint16_t size) {
+  if (_app_hold || _ring_wr - _ring_rd == RING_N) return false;
+
+  datagram_t* d = &_ring[_ring_wr % RING_N];
+  memcpy(d->data + ETH_PAD, src, size);
+  d->len = size;
+  _ring_wr++;
+  return true;
+}
+
+#if CFG_TUD_NCM_RECV_BATCH
+bool tud_network_recv_batch_cb(tud_network_seg_t const* datagrams, uint16_t count) {
+  if (_app_hold || _ring_wr - _ring_rd + count > RING_N) return false;
+
+  for (uint16_t i = 0; i < count; i++) {
+    tud_network_recv_cb((uint8_t const*) datagrams[i].buf, datagrams[i].len);
+  }
+  tud_network_recv_batch_release();
+  return true;
+}
+#endif
+
+uint16_t tud_network_xmit_cb(uint8_t* dst, void* ref, uint16_t arg) {
+  (void) arg;
+  datagram_t const* d = (datagram_t const*) ref;
+  memcpy(dst, d->data + ETH_PAD, d->len);
+  return d->len;
+}
+
+void tud_network_xmit_done_cb(void* ref) {
+  if (ref != &_ring[_ring_rd % RING_N]) _order_ok = false;
+  _ring_rd++;
+}
+
+static void app_task(void) {
+  while (_ring_xmit != _ring_wr) {
+    datagram_t* d = &_ring[_ring_xmit % RING_N];
+    if (!tud_network_can_xmit(d->len)) break;
+
+    #if CFG_TUD_NCM_XMIT_SG
+    tud_network_seg_t const segs[2] = {
+      { d->data + ETH_PAD, ETH_HDR },
+      { d->data + ETH_PAD + ETH_HDR, (uint16_t) (d->len - ETH_HDR) },
+    };
+    if (!tud_network_xmit_sg(d, segs, 2)) break;
+    #else
+    tud_network_xmit(d, 0);
+    _ring_rd++; // copied into NTB
+    #endif
+    _ring_xmit++;
+  }
+
+  // one datagram is handed over per renew
+  uint32_t wr;
+  do {
+    wr = _ring_wr;
+    tud_network_recv_renew();
+  } while (wr != _ring_wr);
+}
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+
+static uint16_t dgram_len(uint32_t seq) {
+  return (uint16_t) (DGRAM_MIN + ((seq * 2654435761u) >> 8) % (CFG_TUD_NET_MTU - DGRAM_MIN + 1));
+}
+
+// Single threaded, monotonic clock is CPU time. Unlike CLOCK_PROCESS_CPUTIME_ID it is no system call and cheap enough
+// to time every ISR
+static uint64_t cpu_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void device_round(void) {
+  uint64_t const t0 = cpu_time_ns();
+  usbd_mock_sof(_rounds);
+  usbd_mock_task();
+  app_task();
+  _device_ns += cpu_time_ns() - t0;
+  _rounds++;
+}
+
+static bool host_set_interface(uint8_t alt) {
+  tusb_control_request_t const request = {
+    .bmRequestType = 0x01,
+    .bRequest      = TUSB_REQ_SET_INTERFACE,
+    .wValue        = alt,
+    .wIndex        = 1,
+    .wLength       = 0
+  };
+  return netd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request);
+}
+
+// Pack the next datagrams up to count into an NTB of the format selected by host, return its length
+static uint32_t host_build_ntb(uint8_t* ntb, uint32_t count) {
+  uint32_t const max_n = CFG_TUD_NCM_OUT_MAX_DATAGRAMS_PER_NTB;
+  uint32_t const ndp_index = _ntb32 ? sizeof(nth32_t) : sizeof(nth16_t);
+  uint32_t const ndp_size = _ntb32 ? sizeof(ndp32_t) : sizeof(ndp16_t);
+  uint32_t const entry_size = _ntb32 ? sizeof(ndp32_datagram_t) : sizeof(ndp16_datagram_t);
+  uint8_t* entry = ntb + ndp_index + ndp_size;
+  uint32_t pos = ndp_index + ndp_size + (max_n + 1) * entry_size;
+  uint32_t n = 0;
+
+  memset(entry, 0, (max_n + 1) * entry_size);
+  while (n < max_n && _tx_seq < count) {
+    uint16_t const len = dgram_len(_tx_seq);
+    pos = (pos + 3) & ~3u;
+    if (pos + len > CFG_TUD_NCM_OUT_NTB_MAX_SIZE) break;
+
+    memcpy(ntb + pos, _pool[_tx_seq % POOL_N], len);
+    memcpy(ntb + pos, &_tx_seq, 4);
+    if (_ntb32) {
+      ndp32_datagram_t const e = { .dwDatagramIndex = pos, .dwDatagramLength = len };
+      memcpy(entry + n * entry_size, &e, sizeof(e));
+    } else {
+      ndp16_datagram_t const e = { .wDatagramIndex = (uint16_t) pos, .wDatagramLength = len };
+      memcpy(entry + n * entry_size, &e, sizeof(e));
+    }
+    pos += len;
+    n++;
+    _tx_seq++;
+  }
+
+  // terminator entry, at least two entries for an NTB without datagrams
+  uint16_t const ndp_len = (uint16_t) (ndp_size + TU_MAX(n + 1, 2) * entry_size);
+  if (_ntb32) {
+    nth32_t const nth = {
+      .dwSignature   = NTH32_SIGNATURE,
+      .wHeaderLength = sizeof(nth32_t),
+      .wSequence     = (uint16_t) _out_ntbs,
+      .dwBlockLength = pos,
+      .dwNdpIndex    = ndp_index,
+    };
+    ndp32_t const ndp = { .dwSignature = NDP32_SIGNATURE_NCM0, .wLength = ndp_len };
+    memcpy(ntb, &nth, sizeof(nth));
+    memcpy(ntb + ndp_index, &ndp, sizeof(ndp));
+  } else {
+    nth16_t const nth = {
+      .dwSignature   = NTH16_SIGNATURE,
+      .wHeaderLength = sizeof(nth16_t),
+      .wSequence     = (uint16_t) _out_ntbs,
+      .wBlockLength  = (uint16_t) pos,
+      .wNdpIndex     = (uint16_t) ndp_index,
+    };
+    ndp16_t const ndp = { .dwSignature = NDP16_SIGNATURE_NCM0, .wLength = ndp_len };
+    memcpy(ntb, &nth, sizeof(nth));
+    memcpy(ntb + ndp_index, &ndp, sizeof(ndp));
+  }
+  _out_ntbs++;
+  return pos;
+}
+
+// Whole NTB goes into the armed receive transfer, a short packet ends it
+static bool host_out_ntb(uint8_t const* ntb, uint32_t len) {
+  for (uint32_t pos = 0; pos < len; pos += EP_SIZE) {
+    if (!usbd_mock_host_out(EP_OUT, ntb + pos, (uint16_t) TU_MIN(len - pos, EP_SIZE))) return false;
+  }
+  if (len % EP_SIZE == 0 && len < CFG_TUD_NCM_OUT_NTB_MAX_SIZE) {
+    return usbd_mock_host_out(EP_OUT, ntb, 0);
+  }
+  return true;
+}
+
+static bool host_check_datagram(uint8_t const* data, uint32_t len) {
+  uint32_t seq;
+  memcpy(&seq, data, 4);
+  if (seq != _rx_seq || len != dgram_len(seq) || 0 != memcmp(data + 4, _pool[seq % POOL_N] + 4, len - 4)) {
+    printf("  datagram %lu: got seq %lu len %lu\n", (unsigned long) _rx_seq, (unsigned long) seq, (unsigned long) len);
+    return false;
+  }
+  _rx_seq++;
+  return true;
+}
+
+static bool host_check_ntb(uint8_t const* ntb, uint32_t len) {
+  uint32_t block_len, ndp_index, ndp_size, entry_size;
+  uint16_t ndp_len;
+  bool ndp_ok;
+
+  if (_ntb32) {
+    nth32_t nth;
+    ndp32_t ndp;
+    memcpy(&nth, ntb, sizeof(nth));
+    if (nth.dwSignature != NTH32_SIGNATURE || nth.dwNdpIndex + sizeof(ndp) > len) return false;
+    memcpy(&ndp, ntb + nth.dwNdpIndex, sizeof(ndp));
+    block_len = nth.dwBlockLength;
+    ndp_index = nth.dwNdpIndex;
+    ndp_ok = ndp.dwSignature == NDP32_SIGNATURE_NCM0;
+    ndp_len = ndp.wLength;
+    ndp_size = sizeof(ndp32_t);
+    entry_size = sizeof(ndp32_datagram_t);
+  } else {
+    nth16_t nth;
+    ndp16_t ndp;
+    memcpy(&nth, ntb, sizeof(nth));
+    if (nth.dwSignature != NTH16_SIGNATURE || nth.wNdpIndex + sizeof(ndp) > len) return false;
+    memcpy(&ndp, ntb + nth.wNdpIndex, sizeof(ndp));
+    block_len = nth.wBlockLength;
+    ndp_index = nth.wNdpIndex;
+    ndp_ok = ndp.dwSignature == NDP16_SIGNATURE_NCM0;
+    ndp_len = ndp.wLength;
+    ndp_size = sizeof(ndp16_t);
+    entry_size = sizeof(ndp16_datagram_t);
+  }
+  if (block_len != len || !ndp_ok || ndp_index + ndp_len > len) return false;
+
+  for (uint32_t i = 0; ndp_size + (i + 1) * entry_size <= ndp_len; i++) {
+    uint8_t const* e = ntb + ndp_index + ndp_size + i * entry_size;
+    uint32_t index, length;
+    if (_ntb32) {
+      ndp32_datagram_t entry;
+      memcpy(&entry, e, sizeof(entry));
+      index = entry.dwDatagramIndex;
+      length = entry.dwDatagramLength;
+    } else {
+      ndp16_datagram_t entry;
+      memcpy(&entry, e, sizeof(entry));
+      index = entry.wDatagramIndex;
+      length = entry.wDatagramLength;
+    }
+    if (index == 0 || length == 0) break;
+    if (index + length > len || !host_check_datagram(ntb + index, length)) return false;
+  }
+  _in_ntbs++;
+  return true;
+}
+
+// Take IN packets until device NAKs, each short packet ends an NTB
+static bool host_in_poll(void) {
+  static uint8_t ntb[CFG_TUD_NCM_IN_NTB_MAX_SIZE + EP_SIZE];
+  static uint32_t len;
+
+  for (;;) {
+    if (len + EP_SIZE > sizeof(ntb)) return false;
+    int32_t const n = usbd_mock_host_in(EP_IN, ntb + len, EP_SIZE);
+    if (n < 0) return true;
+    len += (uint32_t) n;
+    if (n < EP_SIZE) {
+      bool const ok = host_check_ntb(ntb, len);
+      len = 0;
+      if (!ok) return false;
+    }
+  }
+}
+
+#if CFG_TUD_NCM_XMIT_SG
+// Datagrams which can never be sent are refused without an assertion
+static bool check_sg_refused(void) {
+  static tud_network_seg_t segs[CFG_TUD_NCM_IN_MAX_SEGMENTS_PER_NTB + 1];
+  for (size_t i = 0; i < TU_ARRAY_SIZE(segs); i++) {
+    segs[i].buf = _pool[0];
+    segs[i].len = 64;
+  }
+  tud_network_seg_t const huge = { _pool[0], UINT16_MAX };
+
+  return !tud_network_xmit_sg(&segs, segs, (uint8_t) TU_ARRAY_SIZE(segs)) && !tud_network_xmit_sg((void *) (uintptr_t) &huge, &huge, 1) &&
+         !tud_network_xmit_sg(segs, segs, 0);
+}
+#endif
+
+#if CFG_TUD_NCM_NTB32
+static bool host_set_ntb_format(uint16_t format) {
+  tusb_control_request_t const request = {
+    .bmRequestType = 0x21,
+    .bRequest      = NCM_SET_NTB_FORMAT,
+    .wValue        = format,
+    .wIndex        = 0,
+    .wLength       = 0
+  };
+  return netd_control_xfer_cb(0, CONTROL_STAGE_SETUP, &request);
+}
+
+// NTB-16 still waiting for application when host switches to NTB-32 is delivered as NTB-16
+static bool check_format_switch(void) {
+  static uint8_t ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+  uint32_t const end = _tx_seq + 3;
+
+  _app_hold = true;
+  if (!host_out_ntb(ntb, host_build_ntb(ntb, end))) return false;
+  device_round();
+
+  _ntb32 = true;
+  if (!host_set_interface(0) || !host_set_ntb_format(NCM_NTB_FORMAT_32) || !host_set_interface(1)) return false;
+
+  _app_hold = false;
+  for (uint32_t i = 0; i < 100 && _rx_seq < end; i++) {
+    if (!host_in_poll()) return false;
+    device_round();
+  }
+  return _rx_seq == end;
+}
+#endif
+
+// NTB without datagrams is dropped and does not block the following ones
+static bool check_empty_ntb(void) {
+  static uint8_t ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+  uint32_t const end = _tx_seq + 3;
+
+  if (!host_out_ntb(ntb, host_build_ntb(ntb, _tx_seq))) return false;
+  device_round();
+  if (!host_out_ntb(ntb, host_build_ntb(ntb, end))) return false;
+
+  for (uint32_t i = 0; i < 100 && _rx_seq < end; i++) {
+    if (!host_in_poll()) return false;
+    device_round();
+  }
+  return _rx_seq == end;
+}
+
+static bool run(uint32_t count) {
+  static uint8_t ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+  char const* name = NCM_BENCH_NAME;
+
+  usbd_mock_init(&driver, TUSB_SPEED_HIGH, false);
+  netd_init();
+  // driver is opened at its control interface behind the association descriptor
+  uint16_t const drv_len = sizeof(desc_ncm) - 8;
+  if (netd_open(0, (tusb_desc_interface_t const*) (desc_ncm + 8), drv_len) != drv_len || !host_set_interface(1)) {
+    printf("%-17s FAIL open\n", name);
+    return false;
+  }
+
+  #if CFG_TUD_NCM_XMIT_SG
+  if (!check_sg_refused()) {
+    printf("%-17s FAIL invalid scatter-gather datagram accepted\n", name);
+    return false;
+  }
+  #endif
+
+  _tx_seq = _rx_seq = _in_ntbs = _out_ntbs = _rounds = 0;
+  _ring_wr = _ring_xmit = _ring_rd = 0;
+  _order_ok = true;
+
+  if (!check_empty_ntb()) {
+    printf("%-17s FAIL NTB without datagrams blocks reception\n", name);
+    return false;
+  }
+
+  #if CFG_TUD_NCM_NTB32
+  if (!check_format_switch()) {
+    printf("%-17s FAIL NTB-16 received before switch to NTB-32\n", name);
+    return false;
+  }
+  #endif
+
+  _device_ns = 0;
+  usbd_mock_stats_clear();
+
+  uint64_t bytes = 0;
+  while (_rx_seq < count) {
+    if (_tx_seq < count && usbd_mock_edpt_armed(EP_OUT)) {
+      uint32_t const first = _tx_seq;
+      uint32_t const len = host_build_ntb(ntb, count);
+      for (uint32_t seq = first; seq < _tx_seq; seq++) bytes += dgram_len(seq);
+      if (!host_out_ntb(ntb, len)) {
+        printf("%-17s FAIL OUT NTB %lu refused\n", name, (unsigned long) _out_ntbs);
+        return false;
+      }
+    }
+    if (!host_in_poll()) {
+      printf("%-17s FAIL IN NTB %lu\n", name, (unsigned long) _in_ntbs);
+      return false;
+    }
+    device_round();
+    if (_rounds > 100 * count + 1000) {
+      printf("%-17s FAIL stuck at datagram %lu\n", name, (unsigned long) _rx_seq);
+      return false;
+    }
+  }
+
+  // all echoed datagrams handed back to application in order
+  for (uint32_t i = 0; i < 4 && _ring_rd != _ring_wr; i++) device_round();
+  if (!_order_ok || _ring_rd != _ring_wr) {
+    printf("%-17s FAIL datagrams not handed back (%lu of %lu)\n", name, (unsigned long) _ring_rd,
+           (unsigned long) _ring_wr);
+    return false;
+  }
+
+  usbd_mock_stats_t stats;
+  usbd_mock_stats_get(&stats);
+  double const mb = (double) bytes / (1024 * 1024);
+  printf("%-17s OK %5.2f datagrams/IN NTB, %5.2f xfers/IN NTB, %7.1f NAK/MB, %7.1f us device CPU/MB\n", name,
+         (double) count / _in_ntbs, (double) (stats.xfers - _out_ntbs) / _in_ntbs, stats.naks / mb,
+         (double) _device_ns / 1000.0 / mb);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t const count = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 20000u;
+
+  uint32_t rnd = 0x12345678u;
+  for (uint32_t i = 0; i < POOL_N; i++) {
+    for (uint32_t j = 0; j < CFG_TUD_NET_MTU; j++) {
+      rnd = rnd * 1664525u + 1013904223u;
+      _pool[i][j] = (uint8_t) (rnd >> 24);
+    }
+  }
+
+  return run(count) ? 0 : 1;
+}
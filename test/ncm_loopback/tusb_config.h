@@ -0,0 +1,29 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          1
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_NCM                           1
+#define CFG_TUD_NCM_LOG_LEVEL                 2
+#define CFG_TUD_NCM_OUT_NTB_MAX_SIZE          8192
+#define CFG_TUD_NCM_IN_NTB_MAX_SIZE           8192
+#define CFG_TUD_NCM_OUT_NTB_N                 2
+#define CFG_TUD_NCM_IN_NTB_N                  2
+
+#if defined(NCM_BENCH_sg)
+  #define CFG_TUD_NCM_XMIT_SG                 1
+#elif defined(NCM_BENCH_sg_isr)
+  #define CFG_TUD_NCM_XMIT_SG                 1
+  #define CFG_TUD_XFER_ISR                    1
+#elif defined(NCM_BENCH_ntb32)
+  #define CFG_TUD_NCM_NTB32                   1
+#elif defined(NCM_BENCH_batch)
+  #define CFG_TUD_NCM_RECV_BATCH              1
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Per-port event queues (CFG_TUD_TASK_PORT_QUEUE) on the virtual hub: transfer complete events of HID functions
+// on three downstream ports are injected like the controller does from its interrupt, then tud_task() drains them.
+// Checks the weighted round-robin order, that the event budget only splits the schedule across tud_task() calls,
+// the queue statistics, and that every DISPATCH_START trace record is closed by a DISPATCH_END.
+// Run with: make run
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vhost.h"
+#include "hid_port.h"
+
+#define HUB_ADDR      1
+#define PORT_ADDR(_p) ((uint8_t) (HUB_ADDR + (_p)))
+#define PORT_COUNT    (CFG_TUD_HUB_PORT + 1)
+#define EVENT_MAX     64
+
+// completions in dispatch order, instance of port is its attach order
+typedef struct {
+  uint8_t  port;
+  uint16_t len;
+} dispatch_t;
+
+static dispatch_t _dispatch[EVENT_MAX];
+static uint32_t _dispatch_count;
+
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len) {
+  (void) report;
+  if (_dispatch_count < EVENT_MAX) {
+    _dispatch[_dispatch_count].port = (uint8_t) (instance + 1);
+    _dispatch[_dispatch_count].len  = len;
+  }
+  _dispatch_count++;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+// Completion of an IN transfer as posted by the controller, len tags the event
+static void inject(uint8_t port, uint16_t len) {
+  dcd_event_xfer_complete(0, HID_PORT_EPIN_N(port), len, XFER_RESULT_SUCCESS, true);
+}
+
+// Records written since last call must have each DISPATCH_START closed by a DISPATCH_END
+static bool trace_balanced(void) {
+  tu_trace_record_t rec[32];
+  uint32_t lost = 0;
+  uint32_t count;
+  int32_t depth = 0;
+
+  while ((count = tu_trace_read(rec, TU_ARRAY_SIZE(rec), &lost)) > 0) {
+    for (uint32_t i = 0; i < count; i++) {
+      if (rec[i].id == TU_TRACE_USBD_DISPATCH_START) depth++;
+      if (rec[i].id == TU_TRACE_USBD_DISPATCH_END) depth--;
+      CHECK(depth >= 0);
+    }
+  }
+  CHECK(lost == 0);
+  CHECK(depth == 0);
+  return true;
+}
+
+// Run tud_task() once, return number of completions it dispatched
+static uint32_t task_once(void) {
+  uint32_t const start = _dispatch_count;
+  tud_task();
+  return _dispatch_count - start;
+}
+
+static bool setup(void) {
+  uint8_t config[256];
+
+  CHECK(vhost_enumerate(HUB_ADDR, config, sizeof(config)));
+  for (uint8_t port = 1; port <= CFG_TUD_HUB_PORT; port++) {
+    CHECK(hid_port_bind(port));
+    CHECK(vhost_hub_port_attach(HUB_ADDR, port));
+    CHECK(vhost_enumerate(PORT_ADDR(port), config, sizeof(config)));
+  }
+
+  // enumeration overflows the trace ring, start checking from here
+  tu_trace_init();
+  return true;
+}
+
+// Reference schedule: every round serves up to weight events of each port, starting with port 0
+static uint32_t wrr_model(uint8_t const weight[PORT_COUNT], uint32_t const count[PORT_COUNT], uint8_t* order) {
+  uint32_t left[PORT_COUNT];
+  uint32_t total = 0;
+  uint32_t n = 0;
+  for (uint8_t p = 0; p < PORT_COUNT; p++) {
+    left[p] = count[p];
+    total += count[p];
+  }
+
+  while (n < total) {
+    for (uint8_t p = 0; p < PORT_COUNT; p++) {
+      for (uint8_t w = 0; w < weight[p] && left[p]; w++, left[p]--) order[n++] = p;
+    }
+  }
+  return n;
+}
+
+// Must run first: scheduler starts a round at port 0 as long as no budget ran out before
+static bool test_round_robin(void) {
+  uint8_t const weight[PORT_COUNT] = { 1, 1, 2, 3 };
+  uint32_t const count[PORT_COUNT] = { 0, 6, 6, 6 };
+  uint8_t order[EVENT_MAX];
+  uint32_t const total = wrr_model(weight, count, order);
+
+  for (uint8_t p = 0; p < PORT_COUNT; p++) CHECK(tud_port_queue_weight_set(p, weight[p]));
+  CHECK(!tud_port_queue_weight_set(0, 0));
+  CHECK(!tud_port_queue_weight_set(PORT_COUNT, 1));
+
+  // interleaved like concurrent traffic, len is the event number within its port
+  for (uint16_t i = 0; i < 6; i++) {
+    for (uint8_t p = 1; p < PORT_COUNT; p++) inject(p, i);
+  }
+
+  // each call stops after the budget, next one picks up in the middle of a port's weight
+  _dispatch_count = 0;
+  uint32_t calls = 0;
+  while (_dispatch_count < total) {
+    uint32_t const expected = TU_MIN(CFG_TUD_TASK_EVENT_BUDGET, total - _dispatch_count);
+    CHECK(task_once() == expected);
+    CHECK(trace_balanced());
+    CHECK(++calls <= total);
+  }
+  CHECK(task_once() == 0);
+  CHECK(trace_balanced());
+
+  uint16_t next_len[PORT_COUNT] = { 0 };
+  for (uint32_t i = 0; i < total; i++) {
+    CHECK(_dispatch[i].port == order[i]);
+    CHECK(_dispatch[i].len == next_len[order[i]]++); // FIFO within a port
+  }
+
+  for (uint8_t p = 0; p < PORT_COUNT; p++) CHECK(tud_port_queue_weight_set(p, 1));
+
+  printf("weighted round-robin, budget %2u OK (%lu events in %lu calls)\n", CFG_TUD_TASK_EVENT_BUDGET,
+         (unsigned long) total, (unsigned long) calls);
+  return true;
+}
+
+static bool test_stats(void) {
+  tud_port_queue_stats_t stats;
+  uint16_t const injected = CFG_TUD_TASK_PORT_QUEUE_SZ + 2;
+
+  for (uint8_t p = 0; p < PORT_COUNT; p++) tud_port_queue_stats_clear(p);
+  CHECK(!tud_port_queue_stats_get(PORT_COUNT, &stats));
+
+  // full queue drops only events of its own port
+  for (uint16_t i = 0; i < injected; i++) inject(1, i);
+  inject(2, 0);
+
+  CHECK(tud_port_queue_stats_get(1, &stats));
+  CHECK(stats.count == CFG_TUD_TASK_PORT_QUEUE_SZ);
+  CHECK(stats.high_water == CFG_TUD_TASK_PORT_QUEUE_SZ);
+  CHECK(stats.dropped == injected - CFG_TUD_TASK_PORT_QUEUE_SZ);
+  CHECK(tud_port_queue_stats_get(2, &stats));
+  CHECK(stats.count == 1 && stats.high_water == 1 && stats.dropped == 0);
+
+  _dispatch_count = 0;
+  while (task_once()) CHECK(trace_balanced());
+  CHECK(trace_balanced());
+  CHECK(_dispatch_count == CFG_TUD_TASK_PORT_QUEUE_SZ + 1u);
+
+  // high-water mark and drops stay until cleared
+  CHECK(tud_port_queue_stats_get(1, &stats));
+  CHECK(stats.count == 0 && stats.high_water == CFG_TUD_TASK_PORT_QUEUE_SZ);
+  CHECK(stats.dropped == injected - CFG_TUD_TASK_PORT_QUEUE_SZ);
+
+  tud_port_queue_stats_clear(1);
+  CHECK(tud_port_queue_stats_get(1, &stats));
+  CHECK(stats.count == 0 && stats.high_water == 0 && stats.dropped == 0);
+
+  printf("queue statistics               OK\n");
+  return true;
+}
+
+int main(void) {
+  vhost_init(TUSB_SPEED_HIGH);
+
+  if (setup()) {
+    test_round_robin();
+    test_stats();
+  }
+
+  return _fail ? 1 : 0;
+}
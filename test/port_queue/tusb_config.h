@@ -0,0 +1,24 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUD_HUB_PORT        3
+#include "CentralUSB.h"
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          3
+#define CFG_TUSB_TRACE          1
+#define CFG_TUSB_TRACE_TIMESTAMP()  tu_trace_timestamp_cb() // vhost time in us
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+// budget is not a multiple of any round so that it runs out in the middle of a port's weight
+#define CFG_TUD_TASK_PORT_QUEUE     1
+#define CFG_TUD_TASK_PORT_QUEUE_SZ  8
+#define CFG_TUD_TASK_EVENT_BUDGET   5
+
+#define CFG_TUD_HUB             1
+#define CFG_TUD_HID             CFG_TUD_HUB_PORT
+#define CFG_TUD_HID_EP_BUFSIZE  64
+
+#endif
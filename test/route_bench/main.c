@@ -0,0 +1,161 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Routing cost of the device stack as downstream ports are added to the hub: each step attaches one more HID
+// function, then measures the endpoint/address lookups done for every transfer completion and SETUP, and the
+// whole dispatch of interrupt IN reports and control requests to the newest port through the virtual controller.
+// Cost is expected to stay flat with the port count. Run with: make run [ARGS=<transfers>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vhost.h"
+#include "hid_port.h"
+
+#define HUB_ADDR      1
+#define PORT_ADDR(_p) ((uint8_t) (HUB_ADDR + (_p)))
+#define REPEAT        5    // best of, against scheduling noise
+#define RATIO_MAX     2.0  // cost with all ports against one port
+
+// routing lookups of usbd.c
+uint8_t ep2port(uint8_t ep_addr);
+uint8_t addr2port(uint8_t addr);
+
+typedef struct {
+  double lookup_ns;
+  double report_us;
+  double control_us;
+} cost_t;
+
+static volatile uint8_t _sink;
+
+static uint64_t cpu_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+static bool port_attach(uint8_t port) {
+  uint8_t config[256];
+
+  CHECK(hid_port_bind(port));
+  CHECK(vhost_hub_port_attach(HUB_ADDR, port));
+  CHECK(vhost_enumerate(PORT_ADDR(port), config, sizeof(config)));
+  CHECK(tud_mounted(port));
+
+  // every attached port keeps its routes
+  for (uint8_t p = 1; p <= port; p++) {
+    CHECK(ep2port(HID_PORT_EPIN_N(p)) == p);
+    CHECK(addr2port(PORT_ADDR(p)) == p);
+  }
+  CHECK(addr2port(HUB_ADDR) == TUD_HUB_PORT_NUM);
+  return true;
+}
+
+// instance of port is its attach order
+static bool report_roundtrip(uint8_t port, uint8_t seed) {
+  uint8_t report[HID_PORT_EPSIZE];
+  uint8_t rx[HID_PORT_EPSIZE];
+  for (uint8_t i = 0; i < HID_PORT_EPSIZE; i++) report[i] = (uint8_t) (seed + i);
+
+  CHECK(tud_hid_n_report((uint8_t) (port - 1), 0, report, sizeof(report)));
+  CHECK(HID_PORT_EPSIZE == vhost_in(PORT_ADDR(port), HID_PORT_EPIN_N(port), rx, sizeof(rx), HID_PORT_EPSIZE));
+  CHECK(0 == memcmp(report, rx, sizeof(rx)));
+  return true;
+}
+
+static bool measure(uint8_t port, uint32_t count, cost_t* cost) {
+  tusb_desc_device_t desc;
+  cost->lookup_ns = cost->report_us = cost->control_us = 1e30;
+
+  for (uint32_t r = 0; r < REPEAT; r++) {
+    // lookups done per transfer complete and per SETUP
+    uint64_t t0 = cpu_time_ns();
+    for (uint32_t i = 0; i < 16 * count; i++) {
+      _sink = ep2port(HID_PORT_EPIN_N(port));
+      _sink = addr2port(PORT_ADDR(port));
+    }
+    uint64_t t1 = cpu_time_ns();
+    cost->lookup_ns = TU_MIN(cost->lookup_ns, (double) (t1 - t0) / (16.0 * count));
+
+    t0 = cpu_time_ns();
+    for (uint32_t i = 0; i < count; i++) {
+      CHECK(report_roundtrip(port, (uint8_t) i));
+    }
+    t1 = cpu_time_ns();
+    cost->report_us = TU_MIN(cost->report_us, (double) (t1 - t0) / 1000.0 / count);
+
+    t0 = cpu_time_ns();
+    for (uint32_t i = 0; i < count / 4; i++) {
+      CHECK(sizeof(desc) == vhost_control(PORT_ADDR(port), 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0,
+                                          sizeof(desc), &desc));
+    }
+    t1 = cpu_time_ns();
+    cost->control_us = TU_MIN(cost->control_us, (double) (t1 - t0) / 1000.0 / (count / 4));
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t const count = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 20000u;
+  uint8_t config[256];
+  cost_t cost[CFG_TUD_HUB_PORT + 1];
+
+  vhost_init(TUSB_SPEED_HIGH);
+  if (!vhost_enumerate(HUB_ADDR, config, sizeof(config))) {
+    printf("FAIL enumerate hub\n");
+    return 1;
+  }
+
+  printf("ports  lookup ns  report us/xfer  control us/xfer\n");
+  for (uint8_t port = 1; port <= CFG_TUD_HUB_PORT; port++) {
+    if (!port_attach(port) || !measure(port, count, &cost[port])) return 1;
+    printf("%5u  %9.2f  %14.3f  %15.3f\n", port, cost[port].lookup_ns, cost[port].report_us, cost[port].control_us);
+  }
+
+  cost_t const* first = &cost[1];
+  cost_t const* last = &cost[CFG_TUD_HUB_PORT];
+  bool const flat = last->lookup_ns  <= RATIO_MAX * first->lookup_ns  &&
+                    last->report_us  <= RATIO_MAX * first->report_us  &&
+                    last->control_us <= RATIO_MAX * first->control_us;
+  printf("dispatch cost with %u ports     %s (x%.2f lookup, x%.2f report, x%.2f control)\n", CFG_TUD_HUB_PORT,
+         flat ? "OK" : "FAIL", last->lookup_ns / first->lookup_ns, last->report_us / first->report_us,
+         last->control_us / first->control_us);
+
+  return (flat && !_fail) ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+// all downstream ports the hub descriptors allow
+#define CFG_TUD_HUB_PORT        7
+#include "CentralUSB.h"
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          3
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_HUB             1
+#define CFG_TUD_HID             CFG_TUD_HUB_PORT
+#define CFG_TUD_HID_EP_BUFSIZE  64
+
+#endif
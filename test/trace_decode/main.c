@@ -0,0 +1,245 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Round trip of the binary trace through tools/trace_decode.py: records of known timing are written with
+// tu_trace_write(), saved both as memory dump of tu_trace_buf and as record stream read with tu_trace_read() like the
+// RTT channel does, then decoded. Checks record and lost counts and per-endpoint latencies reported by the decoder.
+// Run with: make run
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tusb.h"
+
+#define DUMP_FILE    "_build/trace.bin"
+#define STREAM_FILE  "_build/trace_stream.bin"
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+//--------------------------------------------------------------------+
+// Trace source
+//--------------------------------------------------------------------+
+
+// event ids as traced by usbd/usbh, the decoder matches on transfer complete
+enum {
+  EVT_DCD_SOF           = 3, // DCD_EVENT_SOF
+  EVT_DCD_XFER_COMPLETE = 7, // DCD_EVENT_XFER_COMPLETE
+  EVT_HCD_XFER_COMPLETE = 2, // HCD_EVENT_XFER_COMPLETE
+};
+
+static uint32_t _now;
+
+uint32_t tu_trace_timestamp_cb(void) {
+  return _now;
+}
+
+// One device transfer: submitted, completed after xfer ticks, dispatched after queue ticks, callback runs dispatch
+static void device_xfer(uint8_t port, uint8_t ep_addr, uint32_t len, uint32_t xfer, uint32_t queue, uint32_t dispatch) {
+  TU_TRACE(TU_TRACE_USBD_XFER, 0, port, ep_addr, len);
+  _now += xfer;
+  TU_TRACE(TU_TRACE_USBD_EVENT, EVT_DCD_XFER_COMPLETE, port, ep_addr, len);
+  _now += queue;
+  TU_TRACE(TU_TRACE_USBD_DISPATCH_START, EVT_DCD_XFER_COMPLETE, port, ep_addr, len);
+  _now += dispatch;
+  TU_TRACE(TU_TRACE_USBD_DISPATCH_END, EVT_DCD_XFER_COMPLETE, port, ep_addr, len);
+  _now += 100;
+}
+
+static void host_xfer(uint8_t dev_addr, uint8_t ep_addr, uint32_t xfer, uint32_t queue, uint32_t dispatch) {
+  TU_TRACE(TU_TRACE_USBH_XFER, 0, dev_addr, ep_addr, 8);
+  _now += xfer;
+  TU_TRACE(TU_TRACE_USBH_EVENT, EVT_HCD_XFER_COMPLETE, dev_addr, ep_addr, 8);
+  _now += queue;
+  TU_TRACE(TU_TRACE_USBH_DISPATCH_START, EVT_HCD_XFER_COMPLETE, dev_addr, ep_addr, 8);
+  _now += dispatch;
+  TU_TRACE(TU_TRACE_USBH_DISPATCH_END, EVT_HCD_XFER_COMPLETE, dev_addr, ep_addr, 8);
+  _now += 100;
+}
+
+// Non transfer event, decoder must not count it for any endpoint
+static void device_sof(void) {
+  TU_TRACE(TU_TRACE_USBD_EVENT, EVT_DCD_SOF, 0, 0, 0);
+  _now += 3;
+  TU_TRACE(TU_TRACE_USBD_DISPATCH_START, EVT_DCD_SOF, 0, 0, 0);
+  _now += 1;
+  TU_TRACE(TU_TRACE_USBD_DISPATCH_END, EVT_DCD_SOF, 0, 0, 0);
+}
+
+// Fixed pattern of 4 + 4 + 3 records per round
+static void trace_round(void) {
+  device_xfer(1, 0x81, 64, 30, 20, 5);
+  device_xfer(2, 0x02, 512, 250, 40, 12);
+  device_sof();
+}
+
+//--------------------------------------------------------------------+
+// Decoder
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint32_t records;
+  uint32_t lost;
+  char     text[8192];
+} decoded_t;
+
+static bool decode(char const* file, decoded_t* out) {
+  char cmd[512];
+  snprintf(cmd, sizeof(cmd), "python3 %s %s", TRACE_DECODE, file);
+  FILE* p = popen(cmd, "r");
+  CHECK(p != NULL);
+  size_t const n = fread(out->text, 1, sizeof(out->text) - 1, p);
+  out->text[n] = 0;
+  CHECK(pclose(p) == 0);
+  CHECK(sscanf(out->text, "%" SCNu32 " records, %" SCNu32 " lost", &out->records, &out->lost) == 2);
+  return true;
+}
+
+// Line of a latency in the section of an endpoint, e.g "  queue: n=10 min=20.00 avg=20.00 ... max=20.00 us"
+static bool latency_check(decoded_t const* d, char const* section, char const* name, uint32_t n, char const* value) {
+  char const* sec = strstr(d->text, section);
+  CHECK(sec != NULL);
+  char key[32];
+  snprintf(key, sizeof(key), "  %s: ", name);
+  char const* line = strstr(sec, key);
+  CHECK(line != NULL);
+
+  char expected[96];
+  snprintf(expected, sizeof(expected), "%sn=%" PRIu32 " min=%s avg=%s p50=%s p99=%s max=%s us", key, n, value, value,
+           value, value, value);
+  if (strncmp(line, expected, strlen(expected))) {
+    printf("  expected '%s'\n  got      '%.*s'\n", expected, (int) strcspn(line, "\n"), line);
+    CHECK(false);
+  }
+  return true;
+}
+
+static bool file_write(char const* name, void const* data, size_t len) {
+  FILE* f = fopen(name, "wb");
+  CHECK(f != NULL);
+  CHECK(fwrite(data, 1, len, f) == len);
+  fclose(f);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+// Dump of the buffer before it wraps: everything is decoded with 1 us ticks
+static bool test_dump(void) {
+  enum { ROUNDS = 4 };
+  decoded_t d;
+
+  tu_trace_init();
+  for (uint32_t i = 0; i < ROUNDS; i++) trace_round();
+  host_xfer(3, 0x81, 7, 9, 2);
+
+  CHECK(file_write(DUMP_FILE, &tu_trace_buf, sizeof(tu_trace_buf)));
+  CHECK(decode(DUMP_FILE, &d));
+  CHECK(d.records == ROUNDS * 11 + 4 && d.lost == 0);
+
+  CHECK(latency_check(&d, "USBD port 1 EP 81", "xfer", ROUNDS, "30.00"));
+  CHECK(latency_check(&d, "USBD port 1 EP 81", "queue", ROUNDS, "20.00"));
+  CHECK(latency_check(&d, "USBD port 1 EP 81", "dispatch", ROUNDS, "5.00"));
+  CHECK(latency_check(&d, "USBD port 2 EP 02", "xfer", ROUNDS, "250.00"));
+  CHECK(latency_check(&d, "USBD port 2 EP 02", "queue", ROUNDS, "40.00"));
+  CHECK(latency_check(&d, "USBD port 2 EP 02", "dispatch", ROUNDS, "12.00"));
+  CHECK(latency_check(&d, "USBH dev 3 EP 81", "xfer", 1, "7.00"));
+  CHECK(latency_check(&d, "USBH dev 3 EP 81", "queue", 1, "9.00"));
+  CHECK(latency_check(&d, "USBH dev 3 EP 81", "dispatch", 1, "2.00"));
+  CHECK(strstr(d.text, "USBD port 0 EP 00") == NULL); // SOF
+
+  printf("memory dump                    OK\n");
+  return true;
+}
+
+// Dump after the ring wrapped: only the last depth records are decoded, in order
+static bool test_dump_wrapped(void) {
+  decoded_t d;
+
+  tu_trace_init();
+  uint32_t const rounds = 3 * CFG_TUSB_TRACE_DEPTH / 11 + 1;
+  for (uint32_t i = 0; i < rounds; i++) trace_round();
+  CHECK(tu_trace_buf.wr_idx > CFG_TUSB_TRACE_DEPTH);
+
+  CHECK(file_write(DUMP_FILE, &tu_trace_buf, sizeof(tu_trace_buf)));
+  CHECK(decode(DUMP_FILE, &d));
+  CHECK(d.records == CFG_TUSB_TRACE_DEPTH && d.lost == 0);
+
+  // oldest record may cut a transfer in half, EP 02 starts at record 4 of a round: count only rounds kept whole
+  uint32_t const first = tu_trace_buf.wr_idx - CFG_TUSB_TRACE_DEPTH;
+  uint32_t const kept = rounds - (first - 4 + 10) / 11;
+  CHECK(latency_check(&d, "USBD port 2 EP 02", "xfer", kept, "250.00"));
+  CHECK(latency_check(&d, "USBD port 2 EP 02", "dispatch", kept, "12.00"));
+
+  printf("memory dump after wrap         OK\n");
+  return true;
+}
+
+// Stream read in chunks like tu_trace_rtt_drain() does, with the reader falling behind once: records overwritten
+// before being read are reported lost by both tu_trace_read() and decoder
+static bool test_stream(void) {
+  enum { CHUNK = 8 };
+  static tu_trace_record_t stream[4 * CFG_TUSB_TRACE_DEPTH];
+  uint32_t count = 0;
+  uint32_t lost = 0;
+  decoded_t d;
+
+  tu_trace_init();
+  for (uint32_t i = 0; i < 3; i++) {
+    trace_round();
+    count += tu_trace_read(&stream[count], CHUNK, &lost);
+  }
+  while ((count += tu_trace_read(&stream[count], CHUNK, &lost)), tu_trace_buf.wr_idx != count + lost) {}
+  CHECK(lost == 0);
+
+  // reader stalls while writer laps the ring
+  uint32_t const written = tu_trace_buf.wr_idx;
+  for (uint32_t i = 0; i < 2 * CFG_TUSB_TRACE_DEPTH / 11 + 1; i++) trace_round();
+  uint32_t n;
+  while ((n = tu_trace_read(&stream[count], CHUNK, &lost)) > 0) count += n;
+  CHECK(lost == tu_trace_buf.wr_idx - written - CFG_TUSB_TRACE_DEPTH);
+  CHECK(count + lost == tu_trace_buf.wr_idx);
+
+  CHECK(file_write(STREAM_FILE, stream, count * sizeof(tu_trace_record_t)));
+  CHECK(decode(STREAM_FILE, &d));
+  CHECK(d.records == count && d.lost == lost);
+
+  printf("record stream with %2" PRIu32 " lost     OK\n", lost);
+  return true;
+}
+
+int main(void) {
+  test_dump();
+  test_dump_wrapped();
+  test_stream();
+  return _fail ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS       OPT_OS_NONE
+#define CFG_TUSB_DEBUG    0
+
+#define CFG_TUSB_TRACE                1
+#define CFG_TUSB_TRACE_DEPTH          64
+#define CFG_TUSB_TRACE_TIMESTAMP()    tu_trace_timestamp_cb()
+#define CFG_TUSB_TRACE_TIMESTAMP_HZ   1000000
+
+#endif
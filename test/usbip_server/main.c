@@ -0,0 +1,334 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// USB/IP server on the virtual controller with a client in the same thread: messages are sent in fragments so that
+// the server must keep partially received requests without blocking, then IN URBs are unlinked while tokens are in
+// flight and the report taken from the device must not be lost. Run with: make run
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "tusb.h"
+#include "portable/virtual/dcd_virtual.h"
+#include "hid_port.h"
+
+#define HID_PORT      1
+#define ROUNDS_MAX    2000000u // device and server rounds before a reply is given up
+
+// usbip protocol, network byte order
+typedef struct TU_ATTR_PACKED {
+  uint32_t command;
+  uint32_t seqnum;
+  uint32_t devid;
+  uint32_t direction;
+  uint32_t ep;
+  uint32_t arg[5];    // submit: flags, length, start frame, packets, interval; unlink: seqnum
+  uint8_t  setup[8];
+} usbip_msg_t;
+
+TU_VERIFY_STATIC(sizeof(usbip_msg_t) == 48, "size is not correct");
+
+// offsets in device info
+enum {
+  DEVINFO_BUSID   = 256,
+  DEVINFO_PID     = 302,
+  DEVINFO_NUM_ITF = 311,
+  DEVINFO_SIZE    = 312,
+};
+
+static uint16_t _tcp_port;
+
+uint32_t tusb_time_millis_api(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) (ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+
+static void pump(void) {
+  usbip_server_task();
+  tud_int_handler(0);
+  tud_task();
+}
+
+static void pump_n(uint32_t n) {
+  while (n--) pump();
+}
+
+static int client_connect(void) {
+  int const fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(_tcp_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) return -1;
+
+  // each fragment is sent right away
+  int const one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+// send in fragments with server rounds in between, server must not wait for the rest
+static void client_send(int fd, void const* buf, size_t len, size_t frag) {
+  uint8_t const* p = (uint8_t const*) buf;
+  while (len) {
+    size_t const n = len < frag ? len : frag;
+    send(fd, p, n, MSG_NOSIGNAL);
+    p += n;
+    len -= n;
+    pump_n(50);
+  }
+}
+
+// receive exactly len bytes, server and device are pumped while waiting
+static bool client_recv(int fd, void* buf, size_t len) {
+  uint8_t* p = (uint8_t*) buf;
+  for (uint32_t round = 0; len && round < ROUNDS_MAX; round++) {
+    ssize_t const n = recv(fd, p, len, MSG_DONTWAIT);
+    if (n == 0) return false;
+    if (n > 0) {
+      p   += n;
+      len -= (size_t) n;
+    } else {
+      pump();
+    }
+  }
+  return len == 0;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+static bool devlist(char* busid, uint16_t pid, uint32_t* count) {
+  int const fd = client_connect();
+  CHECK(fd >= 0);
+
+  uint8_t const req[8] = { 0x01, 0x11, 0x80, 0x05, 0, 0, 0, 0 };
+  client_send(fd, req, sizeof(req), 3);
+
+  uint8_t rep[8];
+  uint32_t ndev;
+  CHECK(client_recv(fd, rep, sizeof(rep)) && client_recv(fd, &ndev, sizeof(ndev)));
+  CHECK(rep[2] == 0x00 && rep[3] == 0x05);
+  *count = ntohl(ndev);
+
+  for (uint32_t i = 0; i < *count; i++) {
+    uint8_t info[DEVINFO_SIZE];
+    CHECK(client_recv(fd, info, sizeof(info)));
+    uint16_t const id = tu_u16(info[DEVINFO_PID], info[DEVINFO_PID + 1]);
+    uint8_t itf[4 * 16];
+    CHECK(info[DEVINFO_NUM_ITF] <= 16 && client_recv(fd, itf, 4u * info[DEVINFO_NUM_ITF]));
+    if (id == pid) memcpy(busid, info + DEVINFO_BUSID, 32);
+  }
+
+  close(fd);
+  return true;
+}
+
+// import, wait until the HID function is probed by server
+static int import_hid(void) {
+  char busid[32] = { 0 };
+
+  for (uint32_t retry = 0; retry < 100 && busid[0] == 0; retry++) {
+    uint32_t count;
+    if (!devlist(busid, HID_PORT_PID, &count)) return -1;
+    pump_n(1000);
+  }
+  if (busid[0] == 0) {
+    printf("  FAIL HID function is not exported\n");
+    return -1;
+  }
+
+  int const fd = client_connect();
+  uint8_t const req[8] = { 0x01, 0x11, 0x80, 0x03, 0, 0, 0, 0 };
+  client_send(fd, req, sizeof(req), 5);
+  client_send(fd, busid, sizeof(busid), 7);
+
+  uint8_t rep[8];
+  uint8_t info[DEVINFO_SIZE];
+  if (!client_recv(fd, rep, sizeof(rep)) || rep[7] != 0 || !client_recv(fd, info, sizeof(info))) {
+    printf("  FAIL import %s\n", busid);
+    close(fd);
+    return -1;
+  }
+
+  printf("import %-22s OK\n", busid);
+  return fd;
+}
+
+static void submit(int fd, uint32_t seqnum, uint8_t dir, uint8_t epnum, uint32_t length, uint8_t const* setup,
+                   size_t frag) {
+  usbip_msg_t msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.command   = htonl(1);
+  msg.seqnum    = htonl(seqnum);
+  msg.direction = htonl(dir);
+  msg.ep        = htonl(epnum);
+  msg.arg[1]    = htonl(length);
+  if (setup) memcpy(msg.setup, setup, 8);
+  client_send(fd, &msg, sizeof(msg), frag);
+}
+
+static void unlink_urb(int fd, uint32_t seqnum, uint32_t target) {
+  usbip_msg_t msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.command = htonl(2);
+  msg.seqnum  = htonl(seqnum);
+  msg.arg[0]  = htonl(target);
+  send(fd, &msg, sizeof(msg), MSG_NOSIGNAL);
+}
+
+static bool test_control(int fd) {
+  uint8_t const setup[8] = { 0x80, TUSB_REQ_GET_DESCRIPTOR, 0, TUSB_DESC_DEVICE, 0, 0, 18, 0 };
+  submit(fd, 1, 1, 0, 18, setup, 5);
+
+  usbip_msg_t ret;
+  tusb_desc_device_t desc;
+  CHECK(client_recv(fd, &ret, sizeof(ret)));
+  CHECK(ntohl(ret.command) == 3 && ntohl(ret.seqnum) == 1 && ret.arg[0] == 0 && ntohl(ret.arg[1]) == 18);
+  CHECK(client_recv(fd, &desc, sizeof(desc)));
+  CHECK(desc.idProduct == HID_PORT_PID);
+
+  // server does not configure downstream ports, client does
+  uint8_t const set_config[8] = { 0x00, TUSB_REQ_SET_CONFIGURATION, 1, 0, 0, 0, 0, 0 };
+  submit(fd, 2, 0, 0, 0, set_config, sizeof(usbip_msg_t));
+  CHECK(client_recv(fd, &ret, sizeof(ret)));
+  CHECK(ntohl(ret.command) == 3 && ntohl(ret.seqnum) == 2 && ret.arg[0] == 0);
+  CHECK(tud_mounted(HID_PORT));
+
+  printf("fragmented control request     OK\n");
+  return true;
+}
+
+// Unlink an IN URB while its tokens are in flight, a report taken by one of them must still reach the client:
+// either with the unlinked URB, answered as completed, or with the next one
+static bool test_unlink_in(int fd) {
+  uint8_t report[HID_PORT_EPSIZE];
+  for (uint8_t i = 0; i < HID_PORT_EPSIZE; i++) report[i] = (uint8_t) (0xA0 + i);
+
+  // nothing to send, IN tokens are NAKed
+  submit(fd, 10, 1, tu_edpt_number(HID_PORT_EPIN), HID_PORT_EPSIZE, NULL, sizeof(usbip_msg_t));
+  pump_n(100);
+  unlink_urb(fd, 11, 10);
+
+  usbip_msg_t ret;
+  CHECK(client_recv(fd, &ret, sizeof(ret)));
+  CHECK(ntohl(ret.command) == 4 && ntohl(ret.seqnum) == 11 && (int32_t) ntohl(ret.arg[0]) == -ECONNRESET);
+
+  // report is queued on device right before the unlink
+  uint32_t delivered = 0;
+  for (uint32_t seq = 20; seq < 60; seq += 4) {
+    submit(fd, seq, 1, tu_edpt_number(HID_PORT_EPIN), HID_PORT_EPSIZE, NULL, sizeof(usbip_msg_t));
+    pump_n(seq % 7);
+    CHECK(tud_hid_n_report(0, 0, report, sizeof(report)));
+
+    // every other time server sends a token that device answers only after the unlink is received
+    if (seq % 8) {
+      usbip_server_task();
+      unlink_urb(fd, seq + 1, seq);
+      for (uint32_t i = 0; i < 20; i++) {
+        usleep(100);
+        usbip_server_task();
+      }
+    } else {
+      unlink_urb(fd, seq + 1, seq);
+    }
+
+    // RET_SUBMIT with data is followed by RET_UNLINK, unlinked URB only has RET_UNLINK
+    bool unlinked = false;
+    while (!unlinked) {
+      CHECK(client_recv(fd, &ret, sizeof(ret)));
+      if (ntohl(ret.command) == 3) {
+        uint8_t data[HID_PORT_EPSIZE];
+        CHECK(ntohl(ret.seqnum) == seq && ntohl(ret.arg[1]) == sizeof(data) && client_recv(fd, data, sizeof(data)));
+        CHECK(0 == memcmp(data, report, sizeof(report)));
+        delivered++;
+      } else {
+        CHECK(ntohl(ret.command) == 4 && ntohl(ret.seqnum) == seq + 1);
+        unlinked = true;
+      }
+    }
+
+    // report not taken yet stays on device until next URB
+    pump_n(10);
+    if (delivered < (seq - 20) / 4 + 1) {
+      uint8_t data[HID_PORT_EPSIZE];
+      submit(fd, seq + 2, 1, tu_edpt_number(HID_PORT_EPIN), HID_PORT_EPSIZE, NULL, sizeof(usbip_msg_t));
+      CHECK(client_recv(fd, &ret, sizeof(ret)));
+      CHECK(ntohl(ret.command) == 3 && ntohl(ret.seqnum) == seq + 2 && ntohl(ret.arg[1]) == sizeof(data));
+      CHECK(client_recv(fd, data, sizeof(data)) && 0 == memcmp(data, report, sizeof(report)));
+      delivered++;
+    }
+  }
+
+  CHECK(delivered == 10);
+  printf("unlink IN with tokens in flight OK\n");
+  return true;
+}
+
+int main(void) {
+  alarm(60); // a server blocking on partial messages never returns
+
+  _tcp_port = (uint16_t) (40000 + getpid() % 20000);
+
+  tusb_rhport_init_t const dev_init = { .role = TUSB_ROLE_DEVICE, .speed = TUSB_SPEED_HIGH };
+  tusb_init(0, &dev_init);
+  configure_hub();
+
+  if (!hid_port_bind(HID_PORT) || !usbip_server_init(0, _tcp_port)) {
+    printf("FAIL init\n");
+    return 1;
+  }
+
+  int const fd = import_hid();
+  if (fd < 0) return 1;
+
+  if (test_control(fd)) {
+    test_unlink_in(fd);
+  }
+
+  close(fd);
+  pump_n(100);
+  usbip_server_deinit();
+
+  return _fail ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+// one downstream port keeps probing short
+#define CFG_TUD_HUB_PORT        1
+#include "CentralUSB.h"
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          3
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_HUB             1
+#define CFG_TUD_HID             1
+#define CFG_TUD_HID_EP_BUFSIZE  64
+
+#define CFG_TUD_VIRTUAL_USBIP   1
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Video streaming on the usbd mock: application queues frames as slices of random size and alignment (an empty last
+// slice included) and frames of a single slice of every length up to a few payloads, host reads payloads from the
+// streaming endpoint and checks
+//   - payload header: length, FrameID constant within a frame and toggled between frames, EndOfFrame on last payload
+//   - payload size limits, a bulk payload below dwMaxPayloadTransferSize always ends with a short packet
+//   - frame data reassembled from the payloads, queued buffers unchanged when handed back to the application
+//   - with CFG_TUD_VIDEO_STREAMING_XFER_SG (sg): only the first payload of a slice is copied, others are sent in place
+//     starting at CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN; with CFG_TUD_XFER_ISR (isr) payloads of a slice are armed
+//     without tud_task() and without claiming the endpoint in ISR
+// Variants: copy, sg and sg_isr on bulk endpoint, iso and iso_sg_isr on isochronous endpoint
+// Run with: make run
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "usbd_mock.h"
+
+#define ITF_VC      0
+#define ITF_VS      1
+#define EP_IN       0x81
+#define EP_SIZE     (VIDEO_STREAM_BULK ? 512 : 1024)
+#define WIDTH       160
+#define HEIGHT      120
+#define FRAME_SZ    (WIDTH * HEIGHT * 2)
+#define INTERVAL    10000 // 1ms, payload size is limited by CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE then
+#define N_FRAMES    24    // random test
+#define MAX_SLICES  6     // per frame in random test
+#define SWEEP_LEN   (3 * CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE) // frames of length 0 to SWEEP_LEN in sweep test
+#define MAX_FRAMES  (SWEEP_LEN + 1)
+#define POOL_SLOTS  8     // more than queue depth, slot of a slice is reused after it was handed back
+
+#define VS_DESC_LEN (TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR_LEN + TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT_LEN + \
+                     TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN)
+
+static uint8_t const desc_video[] = {
+  TUD_VIDEO_DESC_STD_VC(ITF_VC, 0, 0),
+    TUD_VIDEO_DESC_CS_VC(0x0150, TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN, 27000000, ITF_VS),
+      TUD_VIDEO_DESC_CAMERA_TERM(1, 0, 0, 0, 0, 0, 0),
+      TUD_VIDEO_DESC_OUTPUT_TERM(2, VIDEO_TT_STREAMING, 0, 1, 0),
+  TUD_VIDEO_DESC_STD_VS(ITF_VS, 0, VIDEO_STREAM_BULK, 0),
+    TUD_VIDEO_DESC_CS_VS_INPUT(1, VS_DESC_LEN, EP_IN, 0, 2, 0, 0, 0, 0),
+      TUD_VIDEO_DESC_CS_VS_FMT_UNCOMPR(1, 1, TUD_VIDEO_GUID_YUY2, 16, 1, 0, 0, 0, 0),
+      TUD_VIDEO_DESC_CS_VS_FRM_UNCOMPR_CONT(1, 0, WIDTH, HEIGHT, FRAME_SZ * 8, FRAME_SZ * 8 * 1000, FRAME_SZ,
+                                            INTERVAL, INTERVAL, INTERVAL, 0),
+      TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709,
+                                          VIDEO_COLOR_COEF_SMPTE170M),
+#if VIDEO_STREAM_BULK
+    TUD_VIDEO_DESC_EP_BULK(EP_IN, EP_SIZE, 1),
+#else
+  TUD_VIDEO_DESC_STD_VS(ITF_VS, 1, 1, 0),
+    TUD_VIDEO_DESC_EP_ISO(EP_IN, EP_SIZE, 1),
+#endif
+};
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+#if CFG_TUD_XFER_ISR
+static bool video_xfer_isr(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  return videod_xfer_isr_cb(rhport, 0, ep_addr, result, xferred_bytes);
+}
+#endif
+
+static usbd_mock_driver_t const driver = {
+  .xfer_cb     = videod_xfer_cb,
+#if CFG_TUD_XFER_ISR
+  .xfer_isr_cb = video_xfer_isr,
+#endif
+};
+
+//--------------------------------------------------------------------+
+// Application: frames split into slices, each one copied from the reference into a pool slot at random alignment
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t* buf;
+  uint32_t pos;  // offset in frame
+  uint32_t len;
+  uint8_t  misalign;
+  bool     eof;
+} slice_t;
+
+static uint8_t  _ref[FRAME_SZ > SWEEP_LEN ? FRAME_SZ : SWEEP_LEN]; // content of every frame
+static TU_ATTR_ALIGNED(8) uint8_t _pool[POOL_SLOTS][sizeof(_ref) + 8];
+static slice_t  _slice[MAX_FRAMES * MAX_SLICES];
+static uint32_t _frame_len[MAX_FRAMES];
+static uint32_t _n_frames;
+static uint32_t _n_slices;
+static uint32_t _slice_wr;   // next slice to queue
+static uint32_t _slice_done; // slices handed back by driver
+static uint32_t _frames_done;
+static uint32_t _restore_err;
+
+static uint32_t _seed = 1;
+static uint32_t rnd(uint32_t n) {
+  _seed = _seed * 1103515245u + 12345u;
+  return (_seed >> 8) % n;
+}
+
+static void app_reset(void) {
+  for (uint32_t i = 0; i < sizeof(_ref); i++) _ref[i] = (uint8_t) rnd(256);
+  _n_frames = _n_slices = _slice_wr = _slice_done = _frames_done = _restore_err = 0;
+}
+
+static void app_slice(uint32_t pos, uint32_t len, bool eof) {
+  slice_t* sl = &_slice[_n_slices++];
+  sl->pos = pos;
+  sl->len = len;
+  sl->misalign = (uint8_t) rnd(8);
+  sl->eof = eof;
+}
+
+// frame of 1 to MAX_SLICES random slices, only the last one may be empty
+static void app_frame_random(void) {
+  uint32_t const n = 1 + rnd(MAX_SLICES);
+  bool const empty_last = n > 1 && !rnd(3);
+  uint32_t pos = 0;
+  for (uint32_t s = 0; s < n; s++) {
+    uint32_t const left = n - 1 - s - empty_last; // non-empty slices after this one
+    uint32_t len = FRAME_SZ - pos;
+    if (s + 1 == n && empty_last) {
+      len = 0;
+    } else if (left) {
+      len = 1 + rnd(tu_min32(len - left, FRAME_SZ / 2));
+    }
+    app_slice(pos, len, s + 1 == n);
+    pos += len;
+  }
+  _frame_len[_n_frames++] = FRAME_SZ;
+}
+
+static void app_frame_single(uint32_t len) {
+  app_slice(0, len, true);
+  _frame_len[_n_frames++] = len;
+}
+
+static void app_queue(void) {
+  while (_slice_wr < _n_slices && tud_video_n_queue_available(0, 0)) {
+    slice_t* sl = &_slice[_slice_wr];
+    sl->buf = _pool[_slice_wr % POOL_SLOTS] + sl->misalign;
+    memcpy(sl->buf, _ref + sl->pos, sl->len);
+    if (!tud_video_n_slice_xfer(0, 0, sl->buf, sl->len, sl->eof)) break;
+    _slice_wr++;
+  }
+}
+
+void tud_video_slice_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void* buffer) {
+  (void) ctl_idx; (void) stm_idx;
+  slice_t const* sl = &_slice[_slice_done++];
+  // header written in place must have been put back
+  if (sl->buf != buffer || memcmp(sl->buf, _ref + sl->pos, sl->len)) _restore_err++;
+}
+
+void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx) {
+  (void) ctl_idx; (void) stm_idx;
+  _frames_done++;
+}
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+
+static void host_request(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, void const* data, uint16_t len) {
+  tusb_control_request_t const req = {
+    .bmRequestType = bmRequestType, .bRequest = bRequest, .wValue = wValue, .wIndex = ITF_VS, .wLength = len
+  };
+  TU_ASSERT(videod_control_xfer_cb(0, CONTROL_STAGE_SETUP, &req), );
+  if (len) {
+    void const* buf;
+    TU_ASSERT(usbd_mock_control_data(&buf) == len, );
+    memcpy((void*) (uintptr_t) buf, data, len);
+    TU_ASSERT(videod_control_xfer_cb(0, CONTROL_STAGE_DATA, &req), );
+  }
+}
+
+static uint32_t host_start(void) {
+  video_probe_and_commit_control_t param = {
+    .bFormatIndex = 1, .bFrameIndex = 1, .dwFrameInterval = INTERVAL
+  };
+#if !VIDEO_STREAM_BULK
+  host_request(0x01, TUSB_REQ_SET_INTERFACE, 0, NULL, 0);
+#endif
+  host_request(0x21, VIDEO_REQUEST_SET_CUR, VIDEO_VS_CTL_PROBE << 8, &param, sizeof(param));
+  host_request(0x21, VIDEO_REQUEST_SET_CUR, VIDEO_VS_CTL_COMMIT << 8, &param, sizeof(param));
+#if !VIDEO_STREAM_BULK
+  host_request(0x01, TUSB_REQ_SET_INTERFACE, 1, NULL, 0);
+#endif
+
+  // negotiated payload size
+  tusb_control_request_t const req = {
+    .bmRequestType = 0xA1, .bRequest = VIDEO_REQUEST_GET_CUR, .wValue = VIDEO_VS_CTL_COMMIT << 8, .wIndex = ITF_VS,
+    .wLength = sizeof(param)
+  };
+  void const* buf;
+  videod_control_xfer_cb(0, CONTROL_STAGE_SETUP, &req);
+  usbd_mock_control_data(&buf);
+  memcpy(&param, buf, sizeof(param));
+  return param.dwMaxPayloadTransferSize;
+}
+
+typedef struct {
+  uint32_t payloads;
+  uint32_t copied;      // payloads sent from endpoint buffer
+  uint32_t unaligned;   // payloads sent in place at misaligned address
+  uint32_t task_rearm;  // payloads which needed tud_task() to be armed
+} host_stats_t;
+
+static bool in_pool(uint8_t const* p) {
+  return p >= &_pool[0][0] && p < &_pool[0][0] + sizeof(_pool);
+}
+
+// Read one payload, -1 if endpoint is not armed
+static int32_t host_payload(uint8_t* buf, uint32_t max_payload, host_stats_t* st) {
+  if (!usbd_mock_edpt_armed(EP_IN)) return -1;
+
+  uint8_t const* src = usbd_mock_edpt_buffer(EP_IN);
+  if (in_pool(src)) {
+    if ((uintptr_t) src % CFG_TUD_VIDEO_STREAMING_XFER_SG_ALIGN) st->unaligned++;
+  } else {
+    st->copied++;
+  }
+  st->payloads++;
+
+#if VIDEO_STREAM_BULK
+  // payload ends with a short packet or at dwMaxPayloadTransferSize
+  uint32_t len = 0;
+  for (;;) {
+    int32_t const n = usbd_mock_host_in(EP_IN, buf + len, (uint16_t) tu_min32(EP_SIZE, max_payload - len));
+    if (n < 0) return -2; // NAK within payload
+    len += (uint32_t) n;
+    if (n < EP_SIZE || len == max_payload) return (int32_t) len;
+  }
+#else
+  (void) max_payload;
+  return usbd_mock_host_in(EP_IN, buf, EP_SIZE);
+#endif
+}
+
+// Stream the frames set up by the application until the host received all of them
+static bool stream(char const* name) {
+  usbd_mock_init(&driver, TUSB_SPEED_HIGH, false);
+  videod_init();
+  CHECK(videod_open(0, (tusb_desc_interface_t const*) desc_video, sizeof(desc_video)) == sizeof(desc_video));
+  uint32_t const max_payload = host_start();
+  CHECK(max_payload == CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE);
+
+  static uint8_t rx[sizeof(_ref)];
+  uint8_t payload[CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE];
+  uint32_t rx_len = 0;
+  uint32_t frame = 0;
+  int fid = -1;
+  bool frame_started = false;
+  host_stats_t st = { 0 };
+  usbd_mock_stats_clear();
+
+  app_queue();
+  for (uint32_t rounds = 0; frame < _n_frames; rounds++) {
+    CHECK(rounds < 1000000);
+    int32_t const len = host_payload(payload, max_payload, &st);
+    CHECK(len != -2);
+    if (len < 0) {
+      // not armed: device task hands completed slices back and application queues more
+      usbd_mock_task();
+      app_queue();
+      if (usbd_mock_edpt_armed(EP_IN)) st.task_rearm++;
+      continue;
+    }
+
+    // header
+    CHECK(len >= 2 && (uint32_t) len <= max_payload);
+    CHECK(payload[0] == 2);
+    CHECK((payload[1] & ~0x03u) == 0);
+    int const pfid = payload[1] & 0x01;
+    bool const eof = payload[1] & 0x02;
+    if (!frame_started) {
+      CHECK(fid != pfid);
+      fid = pfid;
+      frame_started = true;
+    }
+    CHECK(pfid == fid);
+#if VIDEO_STREAM_BULK
+    // payload ending with a full packet would run into the next one
+    CHECK((uint32_t) len == max_payload || len % EP_SIZE);
+#endif
+
+    // data
+    uint32_t const n = (uint32_t) len - 2;
+    CHECK(rx_len + n <= _frame_len[frame]);
+    memcpy(rx + rx_len, payload + 2, n);
+    rx_len += n;
+    if (eof) {
+      CHECK(rx_len == _frame_len[frame]);
+      CHECK(!memcmp(rx, _ref, rx_len));
+      frame++;
+      rx_len = 0;
+      frame_started = false;
+    }
+  }
+  usbd_mock_task();
+
+  usbd_mock_stats_t ms;
+  usbd_mock_stats_get(&ms);
+  CHECK(_frames_done == _n_frames && _slice_done == _n_slices);
+  CHECK(_restore_err == 0);
+  CHECK(ms.isr_claims == 0);
+#if CFG_TUD_VIDEO_STREAMING_XFER_SG
+  CHECK(st.copied == _n_slices);
+  CHECK(st.unaligned == 0);
+#else
+  CHECK(st.copied == st.payloads);
+#endif
+#if CFG_TUD_XFER_ISR
+  // only the first payload of a slice waits for the device task
+  CHECK(st.task_rearm <= _n_slices);
+#else
+  CHECK(st.task_rearm + 1 == st.payloads); // the first one armed by queueing
+#endif
+
+  printf("%-10s %-6s %4u frames in %4u slices, %5u payloads: %4u copied, %5u armed by task   OK\n",
+         VIDEO_STREAM_NAME, name, (unsigned) _n_frames, (unsigned) _n_slices, (unsigned) st.payloads,
+         (unsigned) st.copied, (unsigned) st.task_rearm);
+  return true;
+}
+
+// Frames of random slices
+static bool test_random(void) {
+  app_reset();
+  for (uint32_t f = 0; f < N_FRAMES; f++) app_frame_random();
+  return stream("random");
+}
+
+// Frames of a single slice of every length, covers every split of a slice into payloads and packets
+static bool test_sweep(void) {
+  app_reset();
+  for (uint32_t len = 0; len <= SWEEP_LEN; len++) app_frame_single(len);
+  return stream("sweep");
+}
+
+int main(void) {
+  test_random();
+  test_sweep();
+  return _fail ? 1 : 0;
+}
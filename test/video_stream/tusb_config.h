@@ -0,0 +1,40 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          1
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_MAX_SPEED       OPT_MODE_HIGH_SPEED
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_VIDEO                         1
+#define CFG_TUD_VIDEO_STREAMING               1
+#define CFG_TUD_VIDEO_STREAMING_QUEUE_DEPTH   4
+#define CFG_TUD_VIDEO_LOG_LEVEL               1 // driver logs need its lookup tables
+
+#if defined(VIDEO_STREAM_copy)
+  #define VIDEO_STREAM_BULK                   1
+  #define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  1024
+#elif defined(VIDEO_STREAM_sg)
+  #define VIDEO_STREAM_BULK                   1
+  #define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  512
+  #define CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE 3000
+  #define CFG_TUD_VIDEO_STREAMING_XFER_SG     1
+#elif defined(VIDEO_STREAM_sg_isr)
+  #define VIDEO_STREAM_BULK                   1
+  #define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  512
+  #define CFG_TUD_VIDEO_STREAMING_PAYLOAD_MAX_SIZE 3000
+  #define CFG_TUD_VIDEO_STREAMING_XFER_SG     1
+  #define CFG_TUD_XFER_ISR                    1
+#elif defined(VIDEO_STREAM_iso)
+  #define VIDEO_STREAM_BULK                   0
+  #define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  1024
+#elif defined(VIDEO_STREAM_iso_sg_isr)
+  #define VIDEO_STREAM_BULK                   0
+  #define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  1024
+  #define CFG_TUD_VIDEO_STREAMING_XFER_SG     1
+  #define CFG_TUD_XFER_ISR                    1
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Whole device stack on the virtual controller against the fake host: enumerates the hub and a HID function on
+// downstream port 1, checks remote wakeup while replies are in flight, then reports control and interrupt
+// transfer rates. Run with: make run [ARGS=<transfers>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vhost.h"
+#include "hid_port.h"
+#include "class/hub/hub.h"
+
+#define HUB_ADDR    1
+#define HID_ADDR    2
+#define HID_PORT    1
+#define HID_EPIN    HID_PORT_EPIN
+#define HID_EPSIZE  HID_PORT_EPSIZE
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+static bool test_enumerate(void) {
+  uint8_t config[256];
+
+  CHECK(vhost_enumerate(HUB_ADDR, config, sizeof(config)));
+  CHECK(tud_mounted(TUD_HUB_PORT_NUM));
+
+  tusb_desc_interface_t const* itf = (tusb_desc_interface_t const*) (config + TUD_CONFIG_DESC_LEN);
+  CHECK(itf->bInterfaceClass == TUSB_CLASS_HUB);
+
+  CHECK(vhost_hub_port_attach(HUB_ADDR, HID_PORT));
+  CHECK(vhost_enumerate(HID_ADDR, config, sizeof(config)));
+  CHECK(0 == memcmp(config, hid_port_desc_configuration, hid_port_desc_configuration_len));
+
+  // hub keeps answering its own address
+  tusb_desc_device_t desc;
+  CHECK(sizeof(desc) == vhost_control(HUB_ADDR, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0, sizeof(desc), &desc));
+  CHECK(desc.bDeviceClass == TUSB_CLASS_HUB);
+  CHECK(sizeof(desc) == vhost_control(HID_ADDR, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, 0, sizeof(desc), &desc));
+  CHECK(desc.idProduct == HID_PORT_PID);
+
+  printf("enumerate hub and port %u      OK\n", HID_PORT);
+  return true;
+}
+
+static bool hid_roundtrip(uint8_t seed) {
+  uint8_t report[HID_EPSIZE];
+  uint8_t rx[HID_EPSIZE];
+  for (uint8_t i = 0; i < HID_EPSIZE; i++) report[i] = (uint8_t) (seed + i);
+
+  CHECK(tud_hid_n_report(0, 0, report, sizeof(report)));
+  CHECK(HID_EPSIZE == vhost_in(HID_ADDR, HID_EPIN, rx, sizeof(rx), HID_EPSIZE));
+  CHECK(0 == memcmp(report, rx, sizeof(rx)));
+  return true;
+}
+
+// Wakeup is requested from task context while interrupt handler is answering tokens: it must reach the host
+// without corrupting the replies around it
+static bool test_remote_wakeup(void) {
+  vhost_stats_t stats;
+
+  CHECK(0 == vhost_control(HUB_ADDR, 0x00, TUSB_REQ_SET_FEATURE, TUSB_REQ_FEATURE_REMOTE_WAKEUP, 0, 0, NULL));
+  CHECK(!tud_remote_wakeup(TUD_HUB_PORT_NUM)); // not suspended
+
+  vhost_bus_signal(DCD_VIRTUAL_PID_SUSPEND, 0);
+  vhost_pump();
+  CHECK(tud_suspended(TUD_HUB_PORT_NUM));
+
+  vhost_stats_clear();
+  for (uint8_t i = 0; i < 8; i++) {
+    CHECK(tud_remote_wakeup(TUD_HUB_PORT_NUM));
+    CHECK(hid_roundtrip(i));
+  }
+  vhost_stats_get(&stats);
+  CHECK(stats.wakeups >= 1 && stats.wakeups <= 8);
+
+  vhost_bus_signal(DCD_VIRTUAL_PID_RESUME, 0);
+  vhost_pump();
+  CHECK(!tud_suspended(TUD_HUB_PORT_NUM));
+
+  printf("remote wakeup                  OK (%lu signals)\n", (unsigned long) stats.wakeups);
+  return true;
+}
+
+static bool bench(uint32_t count) {
+  vhost_stats_t stats;
+  dcd_virtual_stats_t dstats;
+  uint8_t config[TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN];
+
+  // control transfers with data stage
+  vhost_stats_clear();
+  uint64_t t0 = vhost_time_us();
+  for (uint32_t i = 0; i < count; i++) {
+    CHECK(sizeof(config) == vhost_control(HID_ADDR, 0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, 0,
+                                          sizeof(config), config));
+  }
+  uint64_t t1 = vhost_time_us();
+  vhost_stats_get(&stats);
+  printf("control GET_DESCRIPTOR(%3u)    %8.2f us/xfer, %5.1f tokens/xfer, %lu NAK\n", (unsigned) sizeof(config),
+         (double) (t1 - t0) / count, (double) stats.tokens / count, (unsigned long) stats.naks);
+
+  // interrupt IN reports
+  vhost_stats_clear();
+  dcd_virtual_stats_clear(0);
+  t0 = vhost_time_us();
+  for (uint32_t i = 0; i < count; i++) {
+    CHECK(hid_roundtrip((uint8_t) i));
+  }
+  t1 = vhost_time_us();
+  vhost_stats_get(&stats);
+  dcd_virtual_stats_get(0, &dstats);
+  printf("interrupt IN report(%2u)        %8.2f us/xfer, %5.1f MB/s, %lu NAK, %lu pumps\n", HID_EPSIZE,
+         (double) (t1 - t0) / count, (double) dstats.bytes_in / (double) (t1 - t0), (unsigned long) stats.naks,
+         (unsigned long) stats.pumps);
+
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t const count = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 100000u;
+
+  vhost_init(TUSB_SPEED_HIGH);
+
+  if (!hid_port_bind(HID_PORT)) {
+    printf("FAIL descriptor pool\n");
+    return 1;
+  }
+
+  if (test_enumerate() && test_remote_wakeup()) {
+    bench(count);
+  }
+
+  return _fail ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+#ifndef TUSB_CONFIG_H_
+#define TUSB_CONFIG_H_
+
+#include "CentralUSB.h"
+
+#define CFG_TUSB_OS             OPT_OS_NONE
+#define CFG_TUSB_DEBUG          3
+
+#define CFG_TUD_ENABLED         1
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_HUB             1
+#define CFG_TUD_HID             1
+#define CFG_TUD_HID_EP_BUFSIZE  64
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026, TinyUSB contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Transfer complete coalescing (CFG_TUD_XFER_COALESCE) on the virtual controller: an application driver on
+// downstream port 1 re-arms its interrupt IN endpoint from xfer_isr_cb, completions reach its xfer_coalesced_cb in
+// task context merged per endpoint. Checks merged count and length, statistics, that failed transfers are not
+// forwarded and that a port reset drops what is still pending. Run with: make run
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vhost.h"
+#include "device/usbd_pvt.h"
+
+#define HUB_ADDR    1
+#define DEV_ADDR    2
+#define DEV_PORT    1
+#define EP_IN       0x82
+#define EP_SIZE     64
+
+//--------------------------------------------------------------------+
+// Application driver: vendor interface with one interrupt IN endpoint
+//--------------------------------------------------------------------+
+
+static struct {
+  uint8_t  ep_in;
+  uint16_t remaining; // transfers still to arm from ISR
+  uint8_t  buf[EP_SIZE];
+
+  uint32_t isr_count;
+  uint32_t cb_count;  // xfer_coalesced_cb invocations
+  uint32_t cb_xfers;  // sum of their count
+  uint32_t cb_bytes;
+  uint16_t cb_last_count;
+} _drv;
+
+static void drv_init(uint8_t port_num) {
+  (void) port_num;
+}
+
+static bool drv_deinit(uint8_t port_num) {
+  (void) port_num;
+  return true;
+}
+
+static void drv_reset(uint8_t rhport, uint8_t port_num) {
+  (void) rhport; (void) port_num;
+  _drv.ep_in = 0;
+}
+
+static uint16_t drv_open(uint8_t rhport, uint8_t port_num, tusb_desc_interface_t const* itf_desc, uint16_t max_len) {
+  (void) port_num;
+  TU_VERIFY(itf_desc->bInterfaceClass == TUSB_CLASS_VENDOR_SPECIFIC, 0);
+  uint16_t const drv_len = sizeof(tusb_desc_interface_t) + sizeof(tusb_desc_endpoint_t);
+  TU_VERIFY(max_len >= drv_len, 0);
+
+  uint8_t ep_out = 0;
+  TU_ASSERT(usbd_open_edpt_pair(rhport, tu_desc_next(itf_desc), 1, TUSB_XFER_INTERRUPT, &ep_out, &_drv.ep_in), 0);
+  return drv_len;
+}
+
+static bool drv_control_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t stage, tusb_control_request_t const* request) {
+  (void) rhport; (void) port_num; (void) stage; (void) request;
+  return false;
+}
+
+static bool drv_xfer_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) rhport; (void) port_num; (void) ep_addr; (void) result; (void) xferred_bytes;
+  return true;
+}
+
+static bool drv_xfer_isr_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result,
+                            uint32_t xferred_bytes) {
+  (void) port_num; (void) result; (void) xferred_bytes;
+  _drv.isr_count++;
+  if (_drv.remaining) {
+    _drv.remaining--;
+    _drv.buf[0] = (uint8_t) _drv.isr_count;
+    usbd_edpt_xfer(rhport, ep_addr, _drv.buf, EP_SIZE);
+  }
+  return true;
+}
+
+static void drv_xfer_coalesced_cb(uint8_t rhport, uint8_t port_num, uint8_t ep_addr, xfer_result_t result,
+                                  uint32_t xferred_bytes, uint16_t count) {
+  (void) rhport;
+  if (port_num != DEV_PORT || ep_addr != EP_IN || result != XFER_RESULT_SUCCESS) return;
+  _drv.cb_count++;
+  _drv.cb_xfers += count;
+  _drv.cb_bytes += xferred_bytes;
+  _drv.cb_last_count = count;
+}
+
+static usbd_class_driver_t const _app_driver[] = {
+  {
+    .name              = "VENDOR_ISR",
+    .init              = drv_init,
+    .deinit            = drv_deinit,
+    .reset             = drv_reset,
+    .open              = drv_open,
+    .control_xfer_cb   = drv_control_xfer_cb,
+    .xfer_cb           = drv_xfer_cb,
+    .sof               = NULL,
+    .xfer_isr_cb       = drv_xfer_isr_cb,
+    .xfer_coalesced_cb = drv_xfer_coalesced_cb,
+  }
+};
+
+usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count) {
+  *driver_count = TU_ARRAY_SIZE(_app_driver);
+  return _app_driver;
+}
+
+// Arm first transfer in task context, following ones are armed from ISR. Endpoint is switched to ISR dispatch once
+// configured, like audio does on SET_INTERFACE, since it is routed to its port only after open()
+static bool drv_start(uint16_t count) {
+  TU_VERIFY(usbd_edpt_isr_set(0, _drv.ep_in, true));
+  _drv.remaining = (uint16_t) (count - 1);
+  return usbd_edpt_xfer(0, _drv.ep_in, _drv.buf, EP_SIZE);
+}
+
+static void drv_stats_clear(void) {
+  _drv.isr_count = _drv.cb_count = _drv.cb_xfers = _drv.cb_bytes = 0;
+  _drv.cb_last_count = 0;
+  tud_xfer_coalesce_stats_clear();
+}
+
+//--------------------------------------------------------------------+
+// Descriptors of the port
+//--------------------------------------------------------------------+
+
+static tusb_desc_device_t const _desc_device = {
+  .bLength            = sizeof(tusb_desc_device_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = 0x00,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+  .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+  .idVendor           = 0xCafe,
+  .idProduct          = 0x4010,
+  .bcdDevice          = 0x0100,
+  .iManufacturer      = 0x00,
+  .iProduct           = 0x00,
+  .iSerialNumber      = 0x00,
+  .bNumConfigurations = 0x01
+};
+
+#define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + 9 + 7)
+
+static uint8_t const _desc_configuration[] = {
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, CONFIG_TOTAL_LEN, 0, 100),
+  // Interface: vendor specific, one endpoint
+  9, TUSB_DESC_INTERFACE, 0, 0, 1, TUSB_CLASS_VENDOR_SPECIFIC, 0x00, 0x00, 0,
+  // Endpoint In: interrupt, polled every frame
+  7, TUSB_DESC_ENDPOINT, EP_IN, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(EP_SIZE), 1
+};
+
+static uint8_t const _desc_langid[] = { TUD_STRING_LANGID_DESCRIPTOR(0x0409) };
+static void const* const _desc_configuration_arr[] = { _desc_configuration };
+static void const* const _desc_string_arr[] = { _desc_langid };
+
+static tud_desc_template_t const _desc_template = {
+  .device              = &_desc_device,
+  .configuration       = _desc_configuration_arr,
+  .configuration_count = 1,
+  .string              = _desc_string_arr,
+  .string_count        = 1,
+};
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static int _fail;
+
+#define CHECK(_cond) do { \
+    if (!(_cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_cond); _fail++; return false; } \
+  } while (0)
+
+static bool setup(void) {
+  uint8_t config[256];
+
+  vhost_init(TUSB_SPEED_FULL);
+  uint8_t const pool = tud_desc_pool_new_template(&_desc_template);
+  CHECK(pool != TUD_DESC_POOL_INVALID && tud_desc_pool_bind(DEV_PORT, pool));
+
+  CHECK(vhost_enumerate(HUB_ADDR, config, sizeof(config)));
+  CHECK(vhost_hub_port_attach(HUB_ADDR, DEV_PORT));
+  CHECK(vhost_enumerate(DEV_ADDR, config, sizeof(config)));
+  CHECK(tud_mounted(DEV_PORT));
+  CHECK(_drv.ep_in == EP_IN);
+  return true;
+}
+
+// Host polls a burst of packets in one interrupt: one callback with all of them
+static bool test_burst(void) {
+  enum { BURST = 8 };
+  uint8_t rx[BURST * EP_SIZE];
+  tud_xfer_coalesce_stats_t stats;
+
+  drv_stats_clear();
+  CHECK(drv_start(BURST));
+  CHECK(vhost_in(DEV_ADDR, EP_IN, rx, sizeof(rx), EP_SIZE) == (int32_t) sizeof(rx));
+  tud_task();
+
+  CHECK(_drv.isr_count == BURST);
+  CHECK(_drv.cb_count == 1);
+  CHECK(_drv.cb_last_count == BURST);
+  CHECK(_drv.cb_bytes == BURST * EP_SIZE);
+  for (uint8_t i = 0; i < BURST; i++) CHECK(rx[i * EP_SIZE] == i);
+
+  tud_xfer_coalesce_stats_get(&stats);
+  CHECK(stats.events == BURST && stats.saved == BURST - 1 && stats.dropped == 0);
+
+  printf("burst of %u merged into one     OK\n", BURST);
+  return true;
+}
+
+// Task runs between completions: nothing to merge
+static bool test_single(void) {
+  enum { ROUNDS = 4 };
+  uint8_t rx[EP_SIZE];
+  tud_xfer_coalesce_stats_t stats;
+
+  drv_stats_clear();
+  for (uint8_t i = 0; i < ROUNDS; i++) {
+    CHECK(drv_start(1));
+    CHECK(vhost_in(DEV_ADDR, EP_IN, rx, sizeof(rx), EP_SIZE) == EP_SIZE);
+    tud_task();
+    CHECK(_drv.cb_count == i + 1u && _drv.cb_last_count == 1);
+  }
+
+  tud_xfer_coalesce_stats_get(&stats);
+  CHECK(stats.events == ROUNDS && stats.saved == 0);
+
+  printf("one per task run not merged     OK\n");
+  return true;
+}
+
+// Failed transfers are not forwarded, completions of a port which is reset are dropped
+static bool test_failed_and_reset(void) {
+  tud_xfer_coalesce_stats_t stats;
+
+  drv_stats_clear();
+  CHECK(drv_start(1));
+  dcd_event_xfer_complete(0, EP_IN, 0, XFER_RESULT_FAILED, true);
+  tud_task();
+  CHECK(_drv.isr_count == 1 && _drv.cb_count == 0);
+  tud_xfer_coalesce_stats_get(&stats);
+  CHECK(stats.events == 0);
+
+  CHECK(drv_start(3));
+  for (uint8_t i = 0; i < 3; i++) dcd_event_xfer_complete(0, EP_IN, EP_SIZE, XFER_RESULT_SUCCESS, true);
+  usbd_hub_port_reset(0, DEV_PORT);
+  tud_task();
+  CHECK(_drv.cb_count == 0);
+  tud_xfer_coalesce_stats_get(&stats);
+  CHECK(stats.events == 3 && stats.saved == 2 && stats.dropped == 3);
+
+  printf("failed and reset not forwarded  OK\n");
+  return true;
+}
+
+int main(void) {
+  if (!setup()) return 1;
+
+  test_burst();
+  test_single();
+  test_failed_and_reset();
+
+  return _fail ? 1 : 0;
+}
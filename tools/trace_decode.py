@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Decode TinyUSB binary trace (CFG_TUSB_TRACE) into per-endpoint latency histograms.
+
+Input is either a memory dump of tu_trace_buf e.g from gdb
+    dump binary value trace.bin tu_trace_buf
+or a raw record stream captured from the RTT trace channel e.g
+    JLinkRTTLogger -Device <device> -If SWD -Speed 4000 -RTTChannel 1 trace.bin
+
+For each endpoint (port/device address and endpoint address) following latencies are reported:
+  - xfer     : transfer submitted to controller -> transfer complete queued by controller
+  - queue    : transfer complete queued -> dispatched by tud_task()/tuh_task()
+  - dispatch : duration of the class driver callback
+"""
+import argparse
+import struct
+import sys
+
+TRACE_MAGIC = 0x52545554
+HEADER_FMT = '<IBBHIII'
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+RECORD_FMT = '<IIIBBBB'
+RECORD_SIZE = struct.calcsize(RECORD_FMT)
+SEQ_BUSY = 0xFFFFFFFF
+
+# record id, bit 4 set for host stack
+ID_EVENT = 1
+ID_DISPATCH_START = 2
+ID_DISPATCH_END = 3
+ID_XFER = 4
+ID_HOST = 0x10
+
+# event id of transfer complete
+XFER_COMPLETE = {False: 7, True: 2}  # DCD_EVENT_XFER_COMPLETE, HCD_EVENT_XFER_COMPLETE
+
+LATENCY_NAMES = ['xfer', 'queue', 'dispatch']
+
+
+class Record:
+    __slots__ = ['seq', 'timestamp', 'len', 'id', 'arg', 'ep_addr', 'port']
+
+    def __init__(self, raw):
+        self.seq, self.timestamp, self.len, self.id, self.arg, self.ep_addr, self.port = \
+            struct.unpack(RECORD_FMT, raw)
+
+    @property
+    def host(self):
+        return bool(self.id & ID_HOST)
+
+    @property
+    def kind(self):
+        return self.id & ~ID_HOST
+
+
+def parse(data):
+    """Return (records sorted by seq, timestamp_hz)"""
+    hz = 0
+    records = []
+    if len(data) >= HEADER_SIZE and struct.unpack_from('<I', data)[0] == TRACE_MAGIC:
+        magic, version, record_size, _, depth, hz, wr_idx = struct.unpack_from(HEADER_FMT, data)
+        if record_size != RECORD_SIZE:
+            sys.exit(f'unsupported record size {record_size}')
+        body = data[HEADER_SIZE:HEADER_SIZE + depth * RECORD_SIZE]
+        oldest = max(wr_idx - depth, 0)
+        for i in range(len(body) // RECORD_SIZE):
+            rec = Record(body[i * RECORD_SIZE:(i + 1) * RECORD_SIZE])
+            if rec.seq != SEQ_BUSY and oldest <= rec.seq < wr_idx:
+                records.append(rec)
+    else:
+        for i in range(len(data) // RECORD_SIZE):
+            rec = Record(data[i * RECORD_SIZE:(i + 1) * RECORD_SIZE])
+            if rec.seq != SEQ_BUSY and rec.id:
+                records.append(rec)
+
+    records.sort(key=lambda r: r.seq)
+    return records, hz
+
+
+def collect(records):
+    """Match records and return {(host, port, ep_addr): {latency name: [ticks]}}, lost count"""
+    stats = {}
+    submitted = {}  # key -> timestamp of submit
+    queued = {}     # key -> [timestamp of queued completion], more than one if completions are pending
+    running = {}    # host -> (key, timestamp) of dispatch in progress
+    lost = 0
+    prev_seq = None
+
+    def add(key, name, start, end):
+        stats.setdefault(key, {n: [] for n in LATENCY_NAMES})[name].append((end - start) & 0xFFFFFFFF)
+
+    for rec in records:
+        if prev_seq is not None and rec.seq != prev_seq + 1:
+            lost += rec.seq - prev_seq - 1
+        prev_seq = rec.seq
+
+        key = (rec.host, rec.port, rec.ep_addr)
+        is_xfer_event = rec.arg == XFER_COMPLETE[rec.host]
+
+        if rec.kind == ID_XFER:
+            submitted[key] = rec.timestamp
+        elif rec.kind == ID_EVENT and is_xfer_event:
+            if key in submitted:
+                add(key, 'xfer', submitted.pop(key), rec.timestamp)
+            queued.setdefault(key, []).append(rec.timestamp)
+        elif rec.kind == ID_DISPATCH_START:
+            # dispatch end is missing if task returned early
+            running.pop(rec.host, None)
+            if is_xfer_event:
+                for ts in queued.pop(key, []):
+                    add(key, 'queue', ts, rec.timestamp)
+                running[rec.host] = (key, rec.timestamp)
+        elif rec.kind == ID_DISPATCH_END and is_xfer_event:
+            start = running.pop(rec.host, None)
+            if start and start[0] == key:
+                add(key, 'dispatch', start[1], rec.timestamp)
+
+    return stats, lost
+
+
+def percentile(sorted_values, p):
+    return sorted_values[min(len(sorted_values) - 1, int(len(sorted_values) * p / 100))]
+
+
+def print_histogram(name, values, hz):
+    unit = 'us' if hz else 'ticks'
+
+    def fmt(ticks):
+        return f'{ticks * 1e6 / hz:.2f}' if hz else f'{ticks}'
+
+    values = sorted(values)
+    print(f'  {name}: n={len(values)} min={fmt(values[0])} avg={fmt(sum(values) / len(values))} '
+          f'p50={fmt(percentile(values, 50))} p99={fmt(percentile(values, 99))} max={fmt(values[-1])} {unit}')
+
+    # log2 buckets
+    buckets = {}
+    for v in values:
+        b = v.bit_length()
+        buckets[b] = buckets.get(b, 0) + 1
+    peak = max(buckets.values())
+    for b in range(min(buckets), max(buckets) + 1):
+        count = buckets.get(b, 0)
+        lo = 0 if b == 0 else 1 << (b - 1)
+        hi = (1 << b) - 1
+        print(f'    {fmt(lo):>10} .. {fmt(hi):<10} {count:7} {"#" * (count * 40 // peak)}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('file', help='memory dump of tu_trace_buf or RTT trace stream')
+    parser.add_argument('--hz', type=int, default=0, help='timestamp frequency, overrides value in dump header')
+    parser.add_argument('--records', action='store_true', help='print decoded records')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+
+    records, hz = parse(data)
+    hz = args.hz or hz
+
+    if args.records:
+        for rec in records:
+            side = 'USBH' if rec.host else 'USBD'
+            kind = {ID_EVENT: 'event', ID_DISPATCH_START: 'start', ID_DISPATCH_END: 'end', ID_XFER: 'xfer'}.get(rec.kind, '?')
+            print(f'{rec.seq:10} {rec.timestamp:10} {side} {kind:5} evt={rec.arg} port={rec.port} '
+                  f'ep={rec.ep_addr:02X} len={rec.len}')
+
+    stats, lost = collect(records)
+    print(f'{len(records)} records, {lost} lost')
+
+    for key in sorted(stats):
+        host, port, ep_addr = key
+        print(f'{"USBH dev" if host else "USBD port"} {port} EP {ep_addr:02X}')
+        for name in LATENCY_NAMES:
+            if stats[key][name]:
+                print_histogram(name, stats[key][name], hz)
+
+
+if __name__ == '__main__':
+    main()